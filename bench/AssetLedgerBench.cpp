@@ -0,0 +1,106 @@
+/*
+ * AssetLedgerBench.cpp
+ *
+ * Measures the asset ledger's column layout. Compares AssetLedger::totals(), one vectorized
+ * sum per asset column, with the same totals taken wallet by wallet through
+ * Wallet::balanceOf, and reports save throughput with one thread and with several, which
+ * only scales while saves of different wallets take different shard locks.
+ *
+ * Usage: reward_bench_ledger [wallets] [threads]
+ */
+
+#include "models/Wallet.h"
+#include "services/AssetLedger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+const std::vector<std::string> kAssets = {"points", "gold", "miles", "tokens"};
+
+template <typename Fn>
+double nsPer(size_t repeats, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repeats; ++r) fn();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / repeats;
+}
+
+double saveRate(const std::vector<models::Wallet>& wallets, size_t threads) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t i = t; i < wallets.size(); i += threads) services::AssetLedger::update(wallets[i]);
+        });
+    }
+    for (auto& w : workers) w.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return wallets.size() / std::chrono::duration<double>(elapsed).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+    if (count == 0) count = 1;
+    if (threads == 0) threads = 1;
+
+    // The ledger builds from data/wallets under the working directory; start it empty
+    fs::path root = fs::temp_directory_path() / "reward_bench_ledger";
+    fs::remove_all(root);
+    fs::create_directories(root / "data" / "wallets");
+    fs::current_path(root);
+    services::AssetLedger::ensureBuilt();
+
+    std::vector<models::Wallet> wallets;
+    wallets.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string id = std::to_string(i);
+        models::Wallet w("wallet" + id, "user" + id, 100.5 + i % 97);
+        for (size_t a = 1; a < kAssets.size(); ++a) {
+            if (i % (a + 1) == 0) w.balanceFor(kAssets[a]) = 0.25 * (i % 13);
+        }
+        wallets.push_back(std::move(w));
+    }
+
+    double single = saveRate(wallets, 1);
+    double parallel = saveRate(wallets, threads);
+
+    const size_t repeats = 50;
+    double sink = 0;
+    double columns = nsPer(repeats, [&] {
+        for (const auto& t : services::AssetLedger::totals()) sink += t.total;
+    });
+    double rows = nsPer(repeats, [&] {
+        for (const auto& asset : kAssets) {
+            double total = 0;
+            size_t holders = 0;
+            for (const auto& w : wallets) {
+                double balance = w.balanceOf(asset);
+                total += balance;
+                holders += balance != 0.0;
+            }
+            sink += total + holders;
+        }
+    });
+
+    std::printf("%zu wallets, %zu assets\n", count, kAssets.size());
+    std::printf("totals  columns: %10.0f ns | per wallet: %10.0f ns | speedup %.2fx\n", columns, rows, rows / columns);
+    std::printf("saves   1 thread: %10.0f /s | %zu threads: %10.0f /s | scaling %.2fx\n", single, threads, parallel,
+                parallel / single);
+    std::printf("(checksum %.0f)\n", sink);
+
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(root);
+    return 0;
+}
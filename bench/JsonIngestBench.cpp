@@ -0,0 +1,118 @@
+/*
+ * JsonIngestBench.cpp
+ *
+ * Compares the two record read paths: the nlohmann::json DOM path (FileManager::readJson
+ * followed by from_json) and the SAX path (SaxModelReader::read). Reports parse time and
+ * heap allocations per record for users, wallets and transactions.
+ *
+ * Usage: reward_bench_ingest [records] [transaction_ids_per_wallet]
+ */
+
+#include "storage/FileManager.h"
+#include "storage/SaxModelReader.h"
+#include "storage/ResourceUsage.h"
+#include "models/UserAccount.h"
+#include "models/Wallet.h"
+#include "models/Transaction.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct Result {
+    double nsPerRecord;
+    double allocsPerRecord;
+    size_t loaded;
+};
+
+template <typename Fn>
+Result measure(const std::vector<std::string>& paths, Fn load) {
+    size_t loaded = 0;
+    storage::UsageScope usage;
+    uint64_t before = usage.totals().allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& path : paths) {
+        if (load(path)) ++loaded;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocs = usage.totals().allocations - before;
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return Result{ns / paths.size(), static_cast<double>(allocs) / paths.size(), loaded};
+}
+
+template <typename Model>
+void compare(const char* name, const std::vector<std::string>& paths) {
+    // Warm the page cache so both paths measure parsing rather than disk reads
+    measure(paths, [](const std::string& path) {
+        std::string buffer;
+        return storage::FileManager::readFile(path, buffer);
+    });
+
+    Result dom = measure(paths, [](const std::string& path) {
+        nlohmann::json j;
+        if (!storage::FileManager::readJson(path, j)) return false;
+        try {
+            Model m = j.get<Model>();
+            return true;
+        } catch (...) {
+            return false;
+        }
+    });
+    Result sax = measure(paths, [](const std::string& path) {
+        Model m;
+        return storage::SaxModelReader::read(path, m);
+    });
+
+    std::printf("%-12s dom: %8.0f ns/rec %7.1f allocs/rec | sax: %8.0f ns/rec %7.1f allocs/rec"
+                " | speedup %.2fx, allocs -%.0f%% (%zu/%zu loaded)\n",
+                name, dom.nsPerRecord, dom.allocsPerRecord, sax.nsPerRecord, sax.allocsPerRecord,
+                dom.nsPerRecord / sax.nsPerRecord,
+                100.0 * (1.0 - sax.allocsPerRecord / dom.allocsPerRecord),
+                sax.loaded, dom.loaded);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    size_t txPerWallet = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+    if (records == 0) records = 1;
+    storage::UsageScope::setAllocationCounting(true);
+
+    fs::path root = fs::temp_directory_path() / "reward_bench_ingest";
+    fs::remove_all(root);
+
+    std::vector<std::string> users, wallets, transactions;
+    for (size_t i = 0; i < records; ++i) {
+        std::string id = std::to_string(i);
+        models::UserAccount u("user" + id, std::string(64, 'a'), "user" + id + "@example.com", i % 10 == 0);
+        u.wallet_id = "wallet" + id;
+        models::Wallet w("wallet" + id, "user" + id, 100.5 + i);
+        for (size_t t = 0; t < txPerWallet; ++t) {
+            w.transaction_ids.push_back(models::Id128::generate());
+        }
+        models::Transaction tx("tx" + id, "wallet" + id, 12.25, "1745658288", "credit", "Campaign bonus");
+
+        users.push_back((root / "users" / (u.username + ".json")).string());
+        wallets.push_back((root / "wallets" / (w.wallet_id + ".json")).string());
+        transactions.push_back((root / "transactions" / (tx.transaction_id + ".json")).string());
+        storage::FileManager::writeJson(users.back(), nlohmann::json(u));
+        storage::FileManager::writeJson(wallets.back(), nlohmann::json(w));
+        storage::FileManager::writeJson(transactions.back(), nlohmann::json(tx));
+    }
+
+    std::printf("%zu records per type, %zu transaction ids per wallet\n", records, txPerWallet);
+    compare<models::UserAccount>("users", users);
+    compare<models::Wallet>("wallets", wallets);
+    compare<models::Transaction>("transactions", transactions);
+
+    fs::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,385 @@
+/*
+ * LoadGenerator.cpp
+ *
+ * Synthetic load generator for the full ApiRouter surface. Provisions N users with funded
+ * wallets in a scratch data directory, then drives a weighted mix of endpoints from M
+ * threads with Zipf-skewed user selection, either closed-loop (each thread issues its next
+ * call as soon as the previous one returns) or open-loop (calls are scheduled at a fixed
+ * arrival rate and latency is measured from the scheduled time, so queueing is not hidden).
+ *
+ * Usage: reward_loadgen [--users N] [--threads M] [--duration SECONDS] [--mode closed|open]
+ *                       [--rate CALLS_PER_SEC] [--zipf S] [--interval SECONDS]
+ *                       [--mix login=5,getWallet=35,execute=25,transfer=10,history=20,listUsers=5]
+ *                       [--dir PATH] [--keep]
+ *
+ * Without --dir a scratch directory is created under the system temp dir and removed
+ * afterwards unless --keep is given.
+ */
+
+#include "api/ApiRouter.h"
+#include "services/UserService.h"
+#include "services/WalletService.h"
+#include "storage/FileManager.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+enum Op { Login, GetWallet, Execute, Transfer, History, ListUsers, OpCount };
+const char* const kOpNames[OpCount] = {"login", "getWallet", "execute", "transfer", "history", "listUsers"};
+
+// Log-linear latency histogram in microseconds: exact below 64us, then 32 sub-buckets per
+// power of two (about 3% relative error). Counters are atomic so threads record lock-free.
+class LatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 64 + 40 * 32;
+
+    void record(uint64_t us) {
+        counts_[index(us)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Moves all counts into out (for per-interval reporting) and resets this histogram
+    void drainInto(std::array<uint64_t, kBuckets>& out) {
+        for (size_t i = 0; i < kBuckets; ++i) out[i] += counts_[i].exchange(0, std::memory_order_relaxed);
+    }
+
+    static uint64_t percentile(const std::array<uint64_t, kBuckets>& counts, double p) {
+        uint64_t total = 0;
+        for (uint64_t c : counts) total += c;
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return valueAt(i);
+        }
+        return valueAt(kBuckets - 1);
+    }
+
+private:
+    static size_t index(uint64_t v) {
+        if (v < 64) return static_cast<size_t>(v);
+        int e = 63 - __builtin_clzll(v);
+        size_t idx = 64 + static_cast<size_t>(e - 6) * 32 + ((v >> (e - 5)) & 31);
+        return std::min(idx, kBuckets - 1);
+    }
+
+    static uint64_t valueAt(size_t idx) {
+        if (idx < 64) return idx;
+        size_t e = (idx - 64) / 32 + 6;
+        uint64_t sub = (idx - 64) % 32;
+        return (uint64_t{32} + sub) << (e - 5);
+    }
+
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+};
+
+// Samples ranks 0..n-1 with P(k) proportional to 1/(k+1)^s via a precomputed CDF
+class ZipfSampler {
+public:
+    ZipfSampler(size_t n, double s) : cdf_(n) {
+        double sum = 0;
+        for (size_t k = 0; k < n; ++k) {
+            sum += s == 0 ? 1.0 : 1.0 / std::pow(static_cast<double>(k + 1), s);
+            cdf_[k] = sum;
+        }
+        for (auto& c : cdf_) c /= sum;
+    }
+
+    size_t sample(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        size_t k = static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+        return std::min(k, cdf_.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+struct Config {
+    size_t users = 1000;
+    unsigned threads = 4;
+    double duration = 10;
+    bool openLoop = false;
+    double rate = 1000;
+    double zipf = 0.99;
+    double interval = 1;
+    std::array<double, OpCount> mix = {5, 35, 25, 10, 20, 5};
+    std::string dir;
+    bool keep = false;
+};
+
+struct Stats {
+    std::array<LatencyHistogram, OpCount> interval;
+    std::array<std::array<uint64_t, LatencyHistogram::kBuckets>, OpCount> total{};
+    std::array<std::atomic<uint64_t>, OpCount> ops{};
+    std::array<std::atomic<uint64_t>, OpCount> errors{};
+};
+
+struct Fixture {
+    std::vector<std::string> usernames;
+    std::vector<std::string> tokens;
+    std::vector<std::string> wallets;
+    std::string adminToken;
+};
+
+bool parseMix(const std::string& spec, std::array<double, OpCount>& mix) {
+    mix.fill(0);
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string name = item.substr(0, eq);
+        auto it = std::find_if(std::begin(kOpNames), std::end(kOpNames),
+                               [&](const char* n) { return name == n; });
+        if (it == std::end(kOpNames)) return false;
+        mix[it - std::begin(kOpNames)] = std::atof(item.c_str() + eq + 1);
+    }
+    return true;
+}
+
+bool parseArgs(int argc, char** argv, Config& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--users") cfg.users = std::strtoul(next(), nullptr, 10);
+        else if (arg == "--threads") cfg.threads = static_cast<unsigned>(std::strtoul(next(), nullptr, 10));
+        else if (arg == "--duration") cfg.duration = std::atof(next());
+        else if (arg == "--mode") cfg.openLoop = std::string(next()) == "open";
+        else if (arg == "--rate") cfg.rate = std::atof(next());
+        else if (arg == "--zipf") cfg.zipf = std::atof(next());
+        else if (arg == "--interval") cfg.interval = std::atof(next());
+        else if (arg == "--mix") { if (!parseMix(next(), cfg.mix)) return false; }
+        else if (arg == "--dir") cfg.dir = next();
+        else if (arg == "--keep") cfg.keep = true;
+        else return false;
+    }
+    return cfg.users >= 2 && cfg.threads > 0 && cfg.duration > 0 && cfg.rate > 0 && cfg.interval > 0;
+}
+
+std::optional<std::string> login(const std::string& username, const std::string& callerId) {
+    auto otp = api::ApiRouter::initiateLogin(username, "loadgen", callerId);
+    if (!otp.success) return std::nullopt;
+    auto token = api::ApiRouter::completeLogin(username, otp.data["otp"].get<std::string>(), callerId);
+    if (!token.success) return std::nullopt;
+    return token.data["token"].get<std::string>();
+}
+
+bool provision(const Config& cfg, Fixture& fx) {
+    fx.usernames.resize(cfg.users);
+    fx.tokens.resize(cfg.users);
+    fx.wallets.resize(cfg.users);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> ok{true};
+    auto work = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < cfg.users && ok;) {
+            std::string name = "loadgen" + std::to_string(i);
+            services::UserService::registerUser(name, "loadgen", name + "@loadgen.local");
+            // A kept directory from an earlier run already has the wallets
+            auto wallet = services::WalletService::createWallet(name);
+            if (!wallet) {
+                auto profile = services::UserService::getProfile(name);
+                if (profile && !profile->wallet_id.empty()) wallet = profile->wallet_id;
+            }
+            auto token = login(name, "");
+            if (!wallet || !token ||
+                !services::WalletService::executeTransaction(*wallet, 1e6, "credit", "loadgen seed")) {
+                ok = false;
+                return;
+            }
+            fx.usernames[i] = name;
+            fx.wallets[i] = *wallet;
+            fx.tokens[i] = *token;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < cfg.threads; ++t) pool.emplace_back(work);
+    for (auto& t : pool) t.join();
+    if (!ok) return false;
+
+    services::UserService::registerUser("loadgen_admin", "loadgen", "admin@loadgen.local", true);
+    auto admin = login("loadgen_admin", "");
+    if (!admin) return false;
+    fx.adminToken = *admin;
+    return true;
+}
+
+bool runOp(Op op, size_t u, size_t v, const Fixture& fx) {
+    switch (op) {
+        case Login:
+            // Each synthetic user logs in from its own client; hot users will hit the login rate limit
+            return login(fx.usernames[u], "client-" + std::to_string(u)).has_value();
+        case GetWallet:
+            return api::ApiRouter::getWallet(fx.tokens[u], fx.wallets[u]).success;
+        case Execute:
+            return api::ApiRouter::executeTransaction(fx.tokens[u], fx.wallets[u], 1, "credit", "loadgen").success;
+        case Transfer: {
+            // Same two-step transfer the CLI performs
+            if (!api::ApiRouter::executeTransaction(fx.tokens[u], fx.wallets[u], 1, "debit", "loadgen").success) {
+                return false;
+            }
+            return api::ApiRouter::executeTransaction(fx.tokens[u], fx.wallets[v], 1, "credit",
+                                                      "Received from " + fx.usernames[u]).success;
+        }
+        case History:
+            return api::ApiRouter::getTransactions(fx.tokens[u], fx.wallets[u]).success;
+        case ListUsers:
+            return api::ApiRouter::listUsers(fx.adminToken).success;
+        default:
+            return false;
+    }
+}
+
+void printRow(const char* label, double seconds, uint64_t ops, uint64_t errors,
+              const std::array<uint64_t, LatencyHistogram::kBuckets>& h) {
+    std::printf("%-12s %10.1f %8llu %8llu %9llu %9llu %9llu\n", label, seconds > 0 ? ops / seconds : 0.0,
+                static_cast<unsigned long long>(ops), static_cast<unsigned long long>(errors),
+                static_cast<unsigned long long>(LatencyHistogram::percentile(h, 0.50)),
+                static_cast<unsigned long long>(LatencyHistogram::percentile(h, 0.99)),
+                static_cast<unsigned long long>(LatencyHistogram::percentile(h, 0.999)));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Config cfg;
+    if (!parseArgs(argc, argv, cfg)) {
+        std::fprintf(stderr,
+                     "usage: reward_loadgen [--users N] [--threads M] [--duration S] [--mode closed|open]\n"
+                     "                      [--rate R] [--zipf S] [--interval S] [--mix op=w,...] [--dir PATH] [--keep]\n"
+                     "ops: login getWallet execute transfer history listUsers\n");
+        return 1;
+    }
+
+    fs::path dir = cfg.dir.empty()
+        ? fs::temp_directory_path() / ("reward_loadgen_" + std::to_string(::getpid()))
+        : fs::path(cfg.dir);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    fs::current_path(dir);
+
+    std::printf("provisioning %zu users in %s ...\n", cfg.users, dir.string().c_str());
+    Fixture fx;
+    auto provisionStart = Clock::now();
+    if (!provision(cfg, fx)) {
+        std::fprintf(stderr, "provisioning failed\n");
+        return 1;
+    }
+    std::printf("provisioned in %.1fs\n", std::chrono::duration<double>(Clock::now() - provisionStart).count());
+
+    std::discrete_distribution<int> opPicker(cfg.mix.begin(), cfg.mix.end());
+    ZipfSampler zipf(cfg.users, cfg.zipf);
+    Stats stats;
+    std::atomic<bool> stop{false};
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.duration));
+    // Open loop: each thread owns every M-th slot of the global arrival schedule
+    auto gap = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.threads / cfg.rate));
+
+    auto worker = [&](unsigned id) {
+        std::mt19937_64 rng(std::random_device{}() ^ (uint64_t{id} << 32));
+        auto picker = opPicker;
+        auto scheduled = start + gap * id / cfg.threads;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (cfg.openLoop) {
+                if (scheduled >= end) break;
+                std::this_thread::sleep_until(scheduled);
+            }
+            Op op = static_cast<Op>(picker(rng));
+            size_t u = zipf.sample(rng);
+            size_t v = zipf.sample(rng);
+            if (v == u) v = (u + 1) % cfg.users;
+            auto issued = cfg.openLoop ? scheduled : Clock::now();
+            bool ok = runOp(op, u, v, fx);
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - issued).count();
+            stats.interval[op].record(static_cast<uint64_t>(latency));
+            stats.ops[op].fetch_add(1, std::memory_order_relaxed);
+            if (!ok) stats.errors[op].fetch_add(1, std::memory_order_relaxed);
+            scheduled += gap;
+        }
+    };
+
+    std::printf("running %s loop for %.0fs on %u threads", cfg.openLoop ? "open" : "closed",
+                cfg.duration, cfg.threads);
+    if (cfg.openLoop) std::printf(" at %.0f calls/s", cfg.rate);
+    std::printf(", zipf s=%.2f\n", cfg.zipf);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < cfg.threads; ++t) pool.emplace_back(worker, t);
+
+    std::array<uint64_t, OpCount> lastOps{}, lastErrors{};
+    auto lastReport = start;
+    while (Clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(cfg.interval));
+        auto now = Clock::now();
+        double window = std::chrono::duration<double>(now - lastReport).count();
+        lastReport = now;
+        std::array<uint64_t, LatencyHistogram::kBuckets> merged{};
+        uint64_t ops = 0, errors = 0;
+        for (int op = 0; op < OpCount; ++op) {
+            std::array<uint64_t, LatencyHistogram::kBuckets> h{};
+            stats.interval[op].drainInto(h);
+            for (size_t i = 0; i < h.size(); ++i) {
+                merged[i] += h[i];
+                stats.total[op][i] += h[i];
+            }
+            uint64_t o = stats.ops[op].load(), e = stats.errors[op].load();
+            ops += o - lastOps[op];
+            errors += e - lastErrors[op];
+            lastOps[op] = o;
+            lastErrors[op] = e;
+        }
+        std::printf("[t=%6.1fs] %10.1f calls/s  errors %6llu  p50 %7lluus  p99 %7lluus  p999 %7lluus\n",
+                    std::chrono::duration<double>(now - start).count(), ops / window,
+                    static_cast<unsigned long long>(errors),
+                    static_cast<unsigned long long>(LatencyHistogram::percentile(merged, 0.50)),
+                    static_cast<unsigned long long>(LatencyHistogram::percentile(merged, 0.99)),
+                    static_cast<unsigned long long>(LatencyHistogram::percentile(merged, 0.999)));
+    }
+    stop = true;
+    for (auto& t : pool) t.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::printf("\n%-12s %10s %8s %8s %9s %9s %9s\n", "op", "calls/s", "calls", "errors", "p50us", "p99us", "p999us");
+    std::array<uint64_t, LatencyHistogram::kBuckets> all{};
+    uint64_t allOps = 0, allErrors = 0;
+    for (int op = 0; op < OpCount; ++op) {
+        stats.interval[op].drainInto(stats.total[op]);
+        for (size_t i = 0; i < all.size(); ++i) all[i] += stats.total[op][i];
+        allOps += stats.ops[op];
+        allErrors += stats.errors[op];
+        printRow(kOpNames[op], seconds, stats.ops[op], stats.errors[op], stats.total[op]);
+    }
+    printRow("total", seconds, allOps, allErrors, all);
+    auto locks = storage::FileManager::lockStats();
+    std::printf("\nrecord locks: %llu shared, %llu exclusive, %llu contended, wait total %lluus max %lluus\n",
+                static_cast<unsigned long long>(locks.shared_acquired),
+                static_cast<unsigned long long>(locks.exclusive_acquired),
+                static_cast<unsigned long long>(locks.contended),
+                static_cast<unsigned long long>(locks.wait_us_total),
+                static_cast<unsigned long long>(locks.wait_us_max));
+
+    // Only the generated scratch directory is removed; a --dir given by the caller is left alone
+    if (cfg.dir.empty() && !cfg.keep) {
+        fs::current_path(fs::temp_directory_path());
+        fs::remove_all(dir, ec);
+    }
+    return 0;
+}
@@ -1,21 +1,92 @@
 #pragma once
 
 #include "ApiResponse.h"
+#include "ResponseSink.h"
+#include "models/Asset.h"
+#include "services/HoldService.h"
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 namespace api {
 
+// Op codes of the endpoints callable through ApiRouter::dispatch: every endpoint that takes
+// a session token and returns its result whole (not the login, registration and streaming
+// endpoints). Each names the ApiRouter method it calls.
+enum class ApiOp : uint8_t {
+    GetProfile,
+    UpdateProfile,
+    ChangePassword,
+    DeleteUser,
+    CreateWallet,
+    GetWallet,
+    ExecuteTransaction,
+    Transfer,
+    AuthorizeHold,
+    CaptureHold,
+    ReleaseHold,
+    GetHold,
+    GetTransactions,
+    GetLeaderboard,
+    GetWalletRank,
+    ListUsers,
+    AdminCreateUser,
+    AdminUpdateUser,
+    AdminResetPassword,
+    GetRateLimitStats,
+    GetReplicationStatus,
+    GetStorageLockStats,
+    GetResourceUsage,
+    GetAssetTotals,
+    GetIndexStatus,
+    RunTiering,
+    GetTieringStats,
+    RunPointExpiry,
+    GetPointExpiryStats,
+    GetEventFeedStats,
+    VerifyAuditLog,
+    CreateCampaign,
+    RunCampaign,
+    GetCampaign,
+    Count
+};
+
+// One command of a batch: the endpoint and its arguments by parameter name, without the
+// token (e.g. GetWallet with {"walletId": "..."})
+struct ApiCommand {
+    ApiOp op;
+    nlohmann::json args;
+};
+
 class ApiRouter {
 public:
+    // Runs a batch of commands under one token, validated once for the whole batch, in
+    // order. Fails as a whole only if the token is invalid or the batch holds more than
+    // kMaxBatch commands; otherwise data["results"] has one {success, message, data} per
+    // command, and a failed command does not stop the ones after it.
+    static constexpr size_t kMaxBatch = 64;
+    static ApiResponse dispatch(const std::string& token, const std::vector<ApiCommand>& commands);
+    // Endpoint name of an op ("getWallet") and back; nullopt for names dispatch cannot call
+    static const char* opName(ApiOp op);
+    static std::optional<ApiOp> opFromName(std::string_view name);
+
     // Auth endpoints
     // Step 1: verify credentials and generate OTP
-    static ApiResponse initiateLogin(const std::string& username, const std::string& password);
+    // callerId identifies the client for rate limiting; attempts are also limited per username
+    static ApiResponse initiateLogin(const std::string& username, const std::string& password,
+                                     const std::string& callerId = "");
 
     // Step 2: validate OTP and issue session token
-    static ApiResponse completeLogin(const std::string& username, const std::string& otp);
+    static ApiResponse completeLogin(const std::string& username, const std::string& otp,
+                                     const std::string& callerId = "");
 
     // User endpoints
+    // getProfile, getWallet, getTransactions and streamTransactions read from the configured
+    // read replica (storage::ReadReplica) while it is within its staleness bound, and then
+    // report the bound as data["replication_lag_ms"]
     static ApiResponse registerUser(const std::string& username,
                                     const std::string& password,
                                     const std::string& email);
@@ -35,12 +106,46 @@ public:
                                          const std::string& walletId,
                                          double amount,
                                          const std::string& type,
-                                         const std::string& description);
+                                         const std::string& description,
+                                         const std::string& idempotencyKey = "",
+                                         const std::string& asset = models::kDefaultAsset);
+    // Moves amount of asset from one wallet to another as one debit and one credit
+    static ApiResponse transfer(const std::string& token,
+                                const std::string& fromWalletId,
+                                const std::string& toWalletId,
+                                double amount,
+                                const std::string& asset,
+                                const std::string& description,
+                                const std::string& idempotencyKey = "");
+    // Two-phase debits (services::HoldService): authorizeHold reserves amount for ttlSeconds
+    // without touching the wallet file; captureHold debits it (amount <= 0 captures all)
+    static ApiResponse authorizeHold(const std::string& token,
+                                     const std::string& walletId,
+                                     double amount,
+                                     const std::string& asset = models::kDefaultAsset,
+                                     int64_t ttlSeconds = services::HoldService::kDefaultTtlSeconds);
+    static ApiResponse captureHold(const std::string& token,
+                                   const std::string& holdId,
+                                   double amount,
+                                   const std::string& description);
+    static ApiResponse releaseHold(const std::string& token, const std::string& holdId);
+    static ApiResponse getHold(const std::string& token, const std::string& holdId);
     static ApiResponse getTransactions(const std::string& token,
                                        const std::string& walletId);
+    // Highest balances: limit (at most 1000) entries from rank offset + 1
+    static ApiResponse getLeaderboard(const std::string& token, size_t limit, size_t offset = 0);
+    // Rank of a wallet on the balance leaderboard
+    static ApiResponse getWalletRank(const std::string& token, const std::string& walletId);
+    // Streaming variant: writes the full response envelope to sink as records are loaded,
+    // keeping memory constant; the returned ApiResponse carries status only (data is empty)
+    static ApiResponse streamTransactions(const std::string& token,
+                                          const std::string& walletId,
+                                          ResponseSink& sink);
 
     // Admin endpoints
     static ApiResponse listUsers(const std::string& token);
+    // Streaming variant of listUsers, see streamTransactions
+    static ApiResponse streamUsers(const std::string& token, ResponseSink& sink);
     static ApiResponse adminCreateUser(const std::string& token,
                                        const std::string& username,
                                        const std::string& password,
@@ -53,6 +158,41 @@ public:
     static ApiResponse adminResetPassword(const std::string& token,
                                           const std::string& username,
                                           const std::string& newPassword);
+    static ApiResponse getRateLimitStats(const std::string& token);
+    // Change log position, replica progress and replication lag
+    static ApiResponse getReplicationStatus(const std::string& token);
+    // Record lock acquisitions and wait times of this process
+    static ApiResponse getStorageLockStats(const std::string& token);
+    // Per endpoint: calls, total and worst-call file opens, bytes read and written, renames,
+    // directory scans and (with storage::UsageScope::setAllocationCounting) heap allocations
+    static ApiResponse getResourceUsage(const std::string& token);
+    // Debug aid: also return each call's usage as data["resource_usage"]
+    static void setUsageInResponses(bool on);
+    // Total balance and holder count of every asset across all wallets
+    static ApiResponse getAssetTotals(const std::string& token);
+    // How the record index was loaded and its current size
+    static ApiResponse getIndexStatus(const std::string& token);
+    // Runs a hot/cold tiering pass now; reports space reclaimed and archive read stats
+    static ApiResponse runTiering(const std::string& token, int coldAfterDays);
+    // Last tiering pass and archive read stats (cold read latency, block cache)
+    static ApiResponse getTieringStats(const std::string& token);
+    // Expires every point lot that is due now
+    static ApiResponse runPointExpiry(const std::string& token);
+    // Last point expiry run
+    static ApiResponse getPointExpiryStats(const std::string& token);
+    // Events published to the in-process feed and how its subscribers keep up
+    static ApiResponse getEventFeedStats(const std::string& token);
+    // Flushes the audit log and checks its hash chain end to end
+    static ApiResponse verifyAuditLog(const std::string& token);
+
+    // Campaign endpoints (admin only)
+    // rule: {campaign_id (idempotency key), description, amount, target, usernames, predicate}
+    static ApiResponse createCampaign(const std::string& token,
+                                      const nlohmann::json& rule);
+    static ApiResponse runCampaign(const std::string& token,
+                                   const std::string& campaignId);
+    static ApiResponse getCampaign(const std::string& token,
+                                   const std::string& campaignId);
 };
 
 } // namespace api 
\ No newline at end of file
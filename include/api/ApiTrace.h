@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ApiResponse.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace api {
+
+// One recorded ApiRouter call
+struct TraceEntry {
+    std::string endpoint;
+    nlohmann::json args;
+    // Start time in microseconds since the epoch, and call latency in microseconds
+    int64_t timestamp_us;
+    int64_t latency_us;
+    bool success;
+    std::string message;
+    // Identifiers returned by the call (otp, token, walletId, ...) needed to remap later calls
+    nlohmann::json ids;
+};
+
+// Records every ApiRouter call to a trace file while enabled. Entries are MessagePack
+// documents, each prefixed by its 32-bit little-endian length. Credentials are redacted:
+// passwords and OTPs are recorded as "secret:<n>" aliases, equal within one recording, and
+// session tokens as traceTokenFor(token).
+class TraceRecorder {
+public:
+    // Starts recording to path (truncating it); returns false if it cannot be opened
+    static bool start(const std::string& path);
+    static void stop();
+    static bool enabled();
+    static void record(const std::string& endpoint, const nlohmann::json& args,
+                       int64_t timestampUs, int64_t latencyUs, const ApiResponse& response);
+};
+
+// Recorded form of a session token
+std::string traceTokenFor(const std::string& token);
+
+// Reads a trace file written by TraceRecorder
+class TraceReader {
+public:
+    explicit TraceReader(const std::string& path);
+    bool ok() const { return static_cast<bool>(in_); }
+    // Reads the next entry; returns false at end of file or on a corrupt entry
+    bool next(TraceEntry& entry);
+
+private:
+    std::ifstream in_;
+};
+
+// Re-executes a recorded call against the current data directory
+ApiResponse replayCall(const std::string& endpoint, const nlohmann::json& args);
+
+} // namespace api
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "api/ResponseSink.h"
+#include <string_view>
+#include <vector>
+
+namespace api {
+
+// Incremental JSON encoder writing directly into a ResponseSink. Output matches
+// nlohmann::json::dump() (compact form), without building a DOM.
+class JsonStreamWriter {
+public:
+    explicit JsonStreamWriter(ResponseSink& sink) : sink_(sink) {}
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(std::string_view name);
+
+    void value(std::string_view s);
+    void value(const char* s) { value(std::string_view(s)); }
+    void value(double d);
+    void value(long long n);
+    void value(bool b);
+    void null();
+
+private:
+    // Emits the separator owed before the next value in the current container
+    void separate();
+
+    ResponseSink& sink_;
+    // One entry per open container: true until its first element has been written
+    std::vector<bool> first_;
+    bool afterKey_ = false;
+};
+
+} // namespace api
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace api {
+
+// Destination for streamed responses. Bytes are staged in a fixed-size buffer and handed
+// to emit() one chunk at a time, so memory stays constant however large the response is.
+class ResponseSink {
+public:
+    explicit ResponseSink(size_t chunkSize = 64 * 1024);
+    virtual ~ResponseSink() = default;
+
+    void write(std::string_view bytes);
+    void put(char c);
+    // Emits any buffered bytes
+    void flush();
+    // False once emit() has failed; later writes are dropped
+    bool ok() const { return ok_; }
+    size_t bytesWritten() const { return written_; }
+
+protected:
+    // Delivers one chunk; returns false on an unrecoverable error
+    virtual bool emit(const char* data, size_t size) = 0;
+
+private:
+    std::string buffer_;
+    size_t chunkSize_;
+    size_t written_ = 0;
+    bool ok_ = true;
+};
+
+// Hands each filled chunk to a callback (e.g. a transport's chunked-encoding writer)
+class ChunkedBufferSink : public ResponseSink {
+public:
+    using ChunkHandler = std::function<bool(const char*, size_t)>;
+
+    explicit ChunkedBufferSink(ChunkHandler handler, size_t chunkSize = 64 * 1024);
+    ~ChunkedBufferSink() override;
+
+protected:
+    bool emit(const char* data, size_t size) override;
+
+private:
+    ChunkHandler handler_;
+};
+
+// Writes chunks straight to a file descriptor (socket, pipe or file)
+class FdSink : public ResponseSink {
+public:
+    explicit FdSink(int fd, size_t chunkSize = 64 * 1024);
+    ~FdSink() override;
+
+protected:
+    bool emit(const char* data, size_t size) override;
+
+private:
+    int fd_;
+};
+
+} // namespace api
@@ -2,9 +2,18 @@
 
 #include <string>
 #include <optional>
+#include "auth/RateLimiter.h"
 
 namespace auth {
 
+// Rejection counters for the login rate limiters, keyed by username and by caller
+struct LoginRateLimitStats {
+    RateLimiter::Stats loginByUser;
+    RateLimiter::Stats loginByCaller;
+    RateLimiter::Stats otpByUser;
+    RateLimiter::Stats otpByCaller;
+};
+
 class AuthService {
 public:
     // Hashes a plaintext password using SHA256
@@ -13,12 +22,18 @@ public:
     static bool verifyPassword(const std::string& password, const std::string& hash);
 
     // Initiates login by verifying credentials and generating an OTP code
-    // Returns the OTP code on success, nullopt on failure
-    static std::optional<std::string> initiateLogin(const std::string& username, const std::string& password);
+    // Returns the OTP code on success, nullopt on failure or when rate limited
+    // callerId identifies the client (e.g. remote address); empty limits by username only
+    static std::optional<std::string> initiateLogin(const std::string& username, const std::string& password,
+                                                    const std::string& callerId = "");
 
     // Completes login by validating the OTP and issuing a session token (24h expiry)
-    // Returns token string on success, nullopt on failure
-    static std::optional<std::string> completeLogin(const std::string& username, const std::string& otp);
+    // Returns token string on success, nullopt on failure or when rate limited
+    static std::optional<std::string> completeLogin(const std::string& username, const std::string& otp,
+                                                    const std::string& callerId = "");
+
+    // Counters of allowed/rejected login and OTP attempts
+    static LoginRateLimitStats rateLimitStats();
 
     // Validates a session token and returns associated username if valid
     static std::optional<std::string> validateToken(const std::string& token);
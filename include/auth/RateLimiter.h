@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace auth {
+
+// In-memory token-bucket rate limiter keyed by arbitrary strings (usernames, caller IDs).
+// Buckets live in a fixed-size table split into shards; each slot is a pair of atomics updated
+// with compare-and-swap, so a check is O(1) and never takes a lock. Slots whose bucket has been
+// idle long enough to be full again are reclaimed by new keys, which evicts idle keys for free.
+// An active key is never evicted: a new key whose probe window holds only active keys shares
+// its shard's overflow bucket until a slot goes idle.
+class RateLimiter {
+public:
+    struct Stats {
+        uint64_t allowed;
+        uint64_t rejected;
+        // idle keys reclaimed, and checks charged to an overflow bucket because the key's
+        // probe window held only active keys
+        uint64_t evicted;
+        uint64_t overflowed;
+    };
+
+    // capacity: burst size in tokens; refillPerSecond: sustained rate; slots: table size
+    RateLimiter(double capacity, double refillPerSecond, size_t slots = 1 << 16);
+
+    // Consumes one token for key; returns false if the key is over its limit
+    bool tryAcquire(const std::string& key);
+
+    Stats stats() const;
+
+private:
+    struct alignas(16) Slot {
+        std::atomic<uint64_t> key{0};
+        // high 40 bits: last refill time in ms since construction (0 = never), low 24 bits: milli-tokens
+        std::atomic<uint64_t> state{0};
+    };
+
+    uint64_t hashKey(const std::string& key) const;
+    uint64_t nowMs() const;
+    bool consume(Slot& slot, uint64_t now);
+
+    static constexpr size_t kShards = 64;
+    static constexpr size_t kProbe = 8;
+
+    uint64_t capacityMilli_;
+    double refillMilliPerMs_;
+    uint64_t idleMs_;
+    size_t slotsPerShard_;
+    uint64_t seed_;
+    std::chrono::steady_clock::time_point start_;
+    std::unique_ptr<Slot[]> slots_;
+    Slot overflow_[kShards];
+
+    std::atomic<uint64_t> allowed_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> evicted_{0};
+    std::atomic<uint64_t> overflowed_{0};
+};
+
+} // namespace auth
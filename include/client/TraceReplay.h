@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+namespace client {
+
+class TraceReplay {
+public:
+    // Re-executes the calls in tracePath against a scratch copy of dataDir and prints
+    // throughput, latency percentiles and result divergences per endpoint.
+    // paced == true reproduces the original inter-call gaps, otherwise runs flat out.
+    // Returns 0 if the trace replayed without divergences.
+    static int run(const std::string& tracePath, const std::string& dataDir, bool paced);
+};
+
+} // namespace client
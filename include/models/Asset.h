@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace models {
+
+// The asset every wallet has always held. Its balance is Wallet::balance; point lots,
+// expiry and the leaderboard apply to it alone.
+inline const std::string kDefaultAsset = "points";
+
+// Asset codes are 1 to 32 characters of lowercase letters, digits, '_' and '-'
+inline bool validAssetCode(std::string_view code) {
+    if (code.empty() || code.size() > 32) return false;
+    for (char c : code) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+} // namespace models
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <nlohmann/json.hpp>
+
+namespace models {
+
+// Optional filters applied to each candidate user; unset fields match everything
+struct CampaignPredicate {
+    std::optional<bool> is_admin;
+    std::string email_suffix;
+    std::optional<double> min_balance;
+    std::optional<double> max_balance;
+};
+
+// Campaign IDs name files, so they are 1 to 64 characters of letters, digits, '_' and '-'
+inline bool validCampaignId(std::string_view id) {
+    if (id.empty() || id.size() > 64) return false;
+    for (char c : id) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+class Campaign {
+public:
+    // The idempotency key doubles as the campaign ID: creating the same key twice is a no-op
+    std::string campaign_id;
+    std::string description;
+    double amount;
+    // "all", "list" or "predicate"
+    std::string target;
+    std::vector<std::string> usernames;
+    CampaignPredicate predicate;
+
+    // "pending", "running", "interrupted" or "completed"
+    std::string status;
+    long long processed = 0;
+    long long credited = 0;
+    long long already_credited = 0;
+    long long skipped = 0;
+    long long failed = 0;
+
+    Campaign() = default;
+    Campaign(const std::string& id, const std::string& desc, double amt, const std::string& tgt)
+        : campaign_id(id), description(desc), amount(amt), target(tgt), status("pending") {}
+};
+
+// JSON serialization
+inline void to_json(nlohmann::json& j, const CampaignPredicate& p) {
+    j = nlohmann::json::object();
+    if (p.is_admin) j["is_admin"] = *p.is_admin;
+    if (!p.email_suffix.empty()) j["email_suffix"] = p.email_suffix;
+    if (p.min_balance) j["min_balance"] = *p.min_balance;
+    if (p.max_balance) j["max_balance"] = *p.max_balance;
+}
+
+inline void from_json(const nlohmann::json& j, CampaignPredicate& p) {
+    if (j.contains("is_admin")) p.is_admin = j.at("is_admin").get<bool>();
+    if (j.contains("email_suffix")) j.at("email_suffix").get_to(p.email_suffix);
+    if (j.contains("min_balance")) p.min_balance = j.at("min_balance").get<double>();
+    if (j.contains("max_balance")) p.max_balance = j.at("max_balance").get<double>();
+}
+
+inline void to_json(nlohmann::json& j, const Campaign& c) {
+    j = nlohmann::json{
+        {"campaign_id", c.campaign_id},
+        {"description", c.description},
+        {"amount", c.amount},
+        {"target", c.target},
+        {"usernames", c.usernames},
+        {"predicate", c.predicate},
+        {"status", c.status},
+        {"processed", c.processed},
+        {"credited", c.credited},
+        {"already_credited", c.already_credited},
+        {"skipped", c.skipped},
+        {"failed", c.failed}
+    };
+}
+
+inline void from_json(const nlohmann::json& j, Campaign& c) {
+    j.at("campaign_id").get_to(c.campaign_id);
+    j.at("description").get_to(c.description);
+    j.at("amount").get_to(c.amount);
+    j.at("target").get_to(c.target);
+    if (j.contains("usernames")) j.at("usernames").get_to(c.usernames);
+    if (j.contains("predicate")) j.at("predicate").get_to(c.predicate);
+    j.at("status").get_to(c.status);
+    if (j.contains("processed")) j.at("processed").get_to(c.processed);
+    if (j.contains("credited")) j.at("credited").get_to(c.credited);
+    if (j.contains("already_credited")) j.at("already_credited").get_to(c.already_credited);
+    if (j.contains("skipped")) j.at("skipped").get_to(c.skipped);
+    if (j.contains("failed")) j.at("failed").get_to(c.failed);
+}
+
+} // namespace models
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "models/Asset.h"
+
+namespace models {
+
+// Funds reserved on a wallet while a redemption is in flight. The reservation lowers the
+// wallet's available balance but writes nothing to the wallet until it is captured.
+class Hold {
+public:
+    std::string hold_id;
+    std::string wallet_id;
+    std::string asset = kDefaultAsset;
+    double amount = 0;
+    // Seconds since epoch
+    int64_t created_at = 0;
+    int64_t expires_at = 0;
+    // "authorized", then "captured", "released" or "expired"; "capturing" while the debit
+    // is being written
+    std::string status;
+    // The capture's debit and how much it took (the rest of the hold was released)
+    std::string transaction_id;
+    double captured = 0;
+    // When the hold reached its final status
+    int64_t finalized_at = 0;
+};
+
+// JSON serialization
+inline void to_json(nlohmann::json& j, const Hold& h) {
+    j = nlohmann::json{
+        {"hold_id", h.hold_id},
+        {"wallet_id", h.wallet_id},
+        {"asset", h.asset},
+        {"amount", h.amount},
+        {"created_at", h.created_at},
+        {"expires_at", h.expires_at},
+        {"status", h.status}
+    };
+    if (!h.transaction_id.empty()) {
+        j["transaction_id"] = h.transaction_id;
+        j["captured"] = h.captured;
+    }
+    if (h.finalized_at != 0) j["finalized_at"] = h.finalized_at;
+}
+
+inline void from_json(const nlohmann::json& j, Hold& h) {
+    j.at("hold_id").get_to(h.hold_id);
+    j.at("wallet_id").get_to(h.wallet_id);
+    j.at("asset").get_to(h.asset);
+    j.at("amount").get_to(h.amount);
+    j.at("created_at").get_to(h.created_at);
+    j.at("expires_at").get_to(h.expires_at);
+    j.at("status").get_to(h.status);
+    h.transaction_id = j.value("transaction_id", "");
+    h.captured = j.value("captured", 0.0);
+    h.finalized_at = j.value("finalized_at", int64_t(0));
+}
+
+} // namespace models
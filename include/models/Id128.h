@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+namespace models {
+
+// Wallet and transaction identifier held as two 64-bit words instead of a heap string.
+// Canonical ids (32 lowercase hex digits, as generate() makes) are stored directly. Any
+// other string, such as the shorter ids older builds wrote, is interned once per process
+// and stored as kInternedTag plus its index, so parse() and toString() round-trip every
+// id exactly. In JSON and the API an Id128 is still its string.
+//
+// Interned ids are never released, so only ids of records a process holds are interned:
+// lookups go through find() or parseCanonical(), and the transaction archive keeps its
+// legacy ids as strings. New ids are always canonical, which bounds the table by the legacy
+// records already on disk.
+class Id128 {
+public:
+    static constexpr uint64_t kInternedTag = ~0ULL;
+
+    Id128() = default;
+    constexpr Id128(uint64_t hi, uint64_t lo) : hi_(hi), lo_(lo) {}
+
+    // Random high word and nanosecond clock low word, the layout ids have always had
+    static Id128 generate();
+    static Id128 parse(std::string_view text);
+    // Like parse(), but never interns: for lookups, where an unknown legacy id cannot match
+    // anything stored and should not grow the table
+    static std::optional<Id128> find(std::string_view text);
+    // The id when text is canonical, nullopt otherwise; never touches the intern table
+    static std::optional<Id128> parseCanonical(std::string_view text);
+    // Legacy ids interned by this process
+    static size_t internedCount();
+
+    void appendTo(std::string& out) const;
+    std::string toString() const {
+        std::string out;
+        appendTo(out);
+        return out;
+    }
+
+    bool canonical() const { return hi_ != kInternedTag; }
+    uint64_t hi() const { return hi_; }
+    uint64_t lo() const { return lo_; }
+
+    size_t hash() const {
+        // Both words through a 64-bit finalizer, so ids differing in one word still spread
+        uint64_t h = hi_ ^ (lo_ * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    friend bool operator==(const Id128& a, const Id128& b) { return a.hi_ == b.hi_ && a.lo_ == b.lo_; }
+    friend bool operator!=(const Id128& a, const Id128& b) { return !(a == b); }
+    // Canonical ids order as their hex strings do; interned ids sort after them
+    friend bool operator<(const Id128& a, const Id128& b) {
+        return a.hi_ != b.hi_ ? a.hi_ < b.hi_ : a.lo_ < b.lo_;
+    }
+
+private:
+    uint64_t hi_ = 0;
+    uint64_t lo_ = 0;
+};
+
+// JSON serialization: always the id's string form
+template <typename BasicJsonType>
+void to_json(BasicJsonType& j, const Id128& id) {
+    j = id.toString();
+}
+
+inline void from_json(const nlohmann::json& j, Id128& id) {
+    id = Id128::parse(j.get_ref<const std::string&>());
+}
+
+} // namespace models
+
+namespace std {
+template <>
+struct hash<models::Id128> {
+    size_t operator()(const models::Id128& id) const { return id.hash(); }
+};
+} // namespace std
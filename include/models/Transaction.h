@@ -2,17 +2,24 @@
 
 #include <string>
 #include <nlohmann/json.hpp>
+#include "models/Asset.h"
 
 namespace models {
 
 class Transaction {
 public:
+    // Strings, unlike Wallet::transaction_ids: transactions are streamed by the thousand
+    // (index rebuild, tiering, listings) and Id128 would intern every legacy id they carry
     std::string transaction_id;
     std::string wallet_id;
     double amount;
     std::string timestamp;
     std::string type;
     std::string description;
+    // Client-supplied key deduplicating retried requests; empty when none was given
+    std::string idempotency_key;
+    // Asset the amount is in; stored only when not kDefaultAsset
+    std::string asset = kDefaultAsset;
 
     Transaction() = default;
     Transaction(const std::string& id,
@@ -24,9 +31,11 @@ public:
         : transaction_id(id), wallet_id(wallet), amount(amt), timestamp(time), type(t), description(desc) {}
 };
 
-// JSON serialization
-inline void to_json(nlohmann::json& j, const Transaction& t) {
-    j = nlohmann::json{
+// JSON serialization. to_json is generic over basic_json so storage can build
+// documents in its request arena (storage::ArenaJson).
+template <typename BasicJsonType>
+void to_json(BasicJsonType& j, const Transaction& t) {
+    j = BasicJsonType{
         {"transaction_id", t.transaction_id},
         {"wallet_id", t.wallet_id},
         {"amount", t.amount},
@@ -34,6 +43,12 @@ inline void to_json(nlohmann::json& j, const Transaction& t) {
         {"type", t.type},
         {"description", t.description}
     };
+    if (!t.idempotency_key.empty()) {
+        j["idempotency_key"] = t.idempotency_key;
+    }
+    if (t.asset != kDefaultAsset) {
+        j["asset"] = t.asset;
+    }
 }
 
 inline void from_json(const nlohmann::json& j, Transaction& t) {
@@ -43,6 +58,12 @@ inline void from_json(const nlohmann::json& j, Transaction& t) {
     j.at("timestamp").get_to(t.timestamp);
     j.at("type").get_to(t.type);
     j.at("description").get_to(t.description);
+    if (j.contains("idempotency_key")) {
+        j.at("idempotency_key").get_to(t.idempotency_key);
+    } else {
+        t.idempotency_key = "";
+    }
+    t.asset = j.contains("asset") ? j.at("asset").get<std::string>() : kDefaultAsset;
 }
 
 } 
\ No newline at end of file
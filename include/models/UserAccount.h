@@ -19,8 +19,9 @@ public:
 };
 
 // JSON serialization
-inline void to_json(nlohmann::json& j, const UserAccount& u) {
-    j = nlohmann::json{
+template <typename BasicJsonType>
+void to_json(BasicJsonType& j, const UserAccount& u) {
+    j = BasicJsonType{
         {"username", u.username},
         {"password_hash", u.password_hash},
         {"email", u.email},
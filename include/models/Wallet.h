@@ -1,31 +1,86 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <nlohmann/json.hpp>
+#include "models/Asset.h"
+#include "models/Id128.h"
 
 namespace models {
 
+// Points earned on one day, spent oldest-first and expired together
+struct PointLot {
+    double amount;
+    // Seconds since epoch of the first credit in the lot, and when what is left expires
+    int64_t earned_at;
+    int64_t expires_at;
+};
+
 class Wallet {
 public:
+    // A string like Transaction::wallet_id: one per wallet, where the id list below is the
+    // part that grows
     std::string wallet_id;
     std::string owner_username;
     double balance;
-    std::vector<std::string> transaction_ids;
+    std::vector<Id128> transaction_ids;
+    // Unspent earned points by expiry, oldest first. Balance not covered by lots predates
+    // lot tracking and never expires.
+    std::vector<PointLot> lots;
+    // Balances of the wallet's other assets as parallel arrays, asset_codes[i] holding
+    // asset_balances[i], in the order first credited
+    std::vector<std::string> asset_codes;
+    std::vector<double> asset_balances;
 
     Wallet() = default;
     Wallet(const std::string& id, const std::string& owner, double bal)
         : wallet_id(id), owner_username(owner), balance(bal) {}
+
+    // Balance of asset; 0 for an asset the wallet has never held
+    double balanceOf(std::string_view asset) const {
+        if (asset == kDefaultAsset) return balance;
+        for (size_t i = 0; i < asset_codes.size(); ++i) {
+            if (asset_codes[i] == asset) return asset_balances[i];
+        }
+        return 0;
+    }
+
+    // Balance of asset for update, added at 0 on first use
+    double& balanceFor(std::string_view asset) {
+        if (asset == kDefaultAsset) return balance;
+        for (size_t i = 0; i < asset_codes.size(); ++i) {
+            if (asset_codes[i] == asset) return asset_balances[i];
+        }
+        asset_codes.emplace_back(asset);
+        asset_balances.push_back(0);
+        return asset_balances.back();
+    }
 };
 
 // JSON serialization
-inline void to_json(nlohmann::json& j, const Wallet& w) {
-    j = nlohmann::json{
+template <typename BasicJsonType>
+void to_json(BasicJsonType& j, const Wallet& w) {
+    j = BasicJsonType{
         {"wallet_id", w.wallet_id},
         {"owner_username", w.owner_username},
         {"balance", w.balance},
         {"transaction_ids", w.transaction_ids}
     };
+    // Stored flat as [amount, earned_at, expires_at, ...] to keep wallet files small
+    if (!w.lots.empty()) {
+        auto& lots = j["lots"] = BasicJsonType::array();
+        for (const auto& lot : w.lots) {
+            lots.push_back(lot.amount);
+            lots.push_back(lot.earned_at);
+            lots.push_back(lot.expires_at);
+        }
+    }
+    if (!w.asset_codes.empty()) {
+        j["asset_codes"] = w.asset_codes;
+        j["asset_balances"] = w.asset_balances;
+    }
 }
 
 inline void from_json(const nlohmann::json& j, Wallet& w) {
@@ -33,6 +88,24 @@ inline void from_json(const nlohmann::json& j, Wallet& w) {
     j.at("owner_username").get_to(w.owner_username);
     j.at("balance").get_to(w.balance);
     j.at("transaction_ids").get_to(w.transaction_ids);
+    w.lots.clear();
+    if (j.contains("lots")) {
+        const auto& lots = j.at("lots");
+        if (!lots.is_array() || lots.size() % 3 != 0) throw nlohmann::json::other_error::create(501, "lots must hold triples", &lots);
+        for (size_t i = 0; i < lots.size(); i += 3) {
+            w.lots.push_back(PointLot{lots.at(i).get<double>(), lots.at(i + 1).get<int64_t>(), lots.at(i + 2).get<int64_t>()});
+        }
+    }
+    w.asset_codes.clear();
+    w.asset_balances.clear();
+    // Written together by to_json; one without the other is not a wallet it wrote
+    if (j.contains("asset_codes") || j.contains("asset_balances")) {
+        j.at("asset_codes").get_to(w.asset_codes);
+        j.at("asset_balances").get_to(w.asset_balances);
+        if (w.asset_codes.size() != w.asset_balances.size()) {
+            throw nlohmann::json::other_error::create(501, "asset arrays differ in length", &j);
+        }
+    }
 }
 
 } 
\ No newline at end of file
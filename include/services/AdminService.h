@@ -3,15 +3,19 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <functional>
 #include "models/UserAccount.h"
 
 namespace services {
 
 class AdminService {
 public:
-    // Lists all registered users
+    // Lists all registered users as of one storage snapshot
     static std::vector<models::UserAccount> listAllUsers();
 
+    // Streams all registered users to fn one at a time, as of one storage snapshot
+    static void forEachUser(const std::function<void(const models::UserAccount&)>& fn);
+
     // Creates a user on behalf, with optional admin flag
     static bool createUser(const std::string& username,
                            const std::string& password,
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+#include "models/Wallet.h"
+
+namespace services {
+
+struct AssetTotal {
+    std::string asset;
+    double total;
+    // Wallets with a nonzero balance of the asset
+    size_t holders;
+};
+
+// Every wallet's balance of every asset, held column-wise: one contiguous array of balances
+// per asset, indexed by a slot per wallet. A per-asset total is then a plain sum over one
+// array of doubles, which the compiler vectorizes. Wallets are split over shards by id, each
+// with its own lock and columns, so concurrent saves of different wallets rarely contend.
+// Built from the wallet files on first use and kept current by WalletService on every save,
+// like the Leaderboard.
+class AssetLedger {
+public:
+    // Rebuilds the ledger from the wallet files; saves made while it runs are applied after
+    static bool rebuild();
+    // Builds the ledger on first use
+    static void ensureBuilt();
+
+    // Records the wallet's current balances; a no-op until the ledger is built
+    static void update(const models::Wallet& wallet);
+
+    // Totals of every asset any wallet has held, default asset first. Shards are summed one at
+    // a time, so a total read during saves may include some of them and not others
+    static std::vector<AssetTotal> totals();
+    static std::optional<AssetTotal> total(const std::string& asset);
+};
+
+} // namespace services
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <vector>
+#include "models/Campaign.h"
+
+namespace services {
+
+class CampaignService {
+public:
+    // Stores a new campaign rule; returns the stored campaign, or the existing one
+    // if a campaign with the same idempotency key was already created
+    static std::optional<models::Campaign> createCampaign(const models::Campaign& rule);
+
+    // Retrieves a campaign and its progress counters
+    static std::optional<models::Campaign> getCampaign(const std::string& campaignId);
+
+    // Lists all campaigns
+    static std::vector<models::Campaign> listCampaigns();
+
+    // Runs (or resumes) a campaign: streams the target set and credits matching wallets
+    // on a worker pool, checkpointing progress. workers == 0 picks the hardware concurrency.
+    // Returns the final campaign state, nullopt if it does not exist or is already running.
+    static std::optional<models::Campaign> runCampaign(const std::string& campaignId,
+                                                       unsigned workers = 0);
+
+    // Deterministic transaction ID used when crediting a wallet for a campaign
+    static std::string transactionIdFor(const std::string& campaignId,
+                                        const std::string& walletId);
+};
+
+} // namespace services
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace services {
+
+enum class WalletEventType : uint8_t {
+    TransactionApplied = 1,
+    WalletCreated = 2,
+    UserDeleted = 3
+};
+
+struct WalletEvent {
+    // Position in the feed, strictly increasing
+    uint64_t sequence = 0;
+    WalletEventType type = WalletEventType::TransactionApplied;
+    // Microseconds since epoch when the event was published
+    int64_t timestamp_us = 0;
+    std::string wallet_id;
+    std::string transaction_id;
+    std::string username;
+    // "credit" or "debit" for TransactionApplied
+    std::string transaction_type;
+    // Asset of amount and balance for TransactionApplied
+    std::string asset;
+    double amount = 0;
+    // Wallet balance of the asset after the transaction
+    double balance = 0;
+    // Set if the text fields did not fit a feed slot and were cut short
+    bool truncated = false;
+};
+
+// What publishers do when a subscriber falls a full ring behind
+enum class SlowConsumerPolicy {
+    // Overwrite; the subscriber skips ahead and counts the events it lost
+    Drop,
+    // Wait for the subscriber to catch up, at most EventFeed::kMaxBlockMicros; a subscriber
+    // that does not is treated as Drop until it polls again (a subscriber must not publish
+    // from its own thread)
+    Block,
+    // Copy the events about to be overwritten aside, read back first; a background writer
+    // moves them to the subscriber's spill file
+    Spill
+};
+
+struct SubscriptionStats {
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    uint64_t spilled = 0;
+    // Times a publisher had to wait for this subscriber, and gave up waiting
+    uint64_t producer_waits = 0;
+    uint64_t block_timeouts = 0;
+};
+
+struct EventFeedStats {
+    uint64_t published = 0;
+    size_t subscribers = 0;
+    uint64_t dropped = 0;
+    uint64_t spilled = 0;
+    uint64_t producer_waits = 0;
+    uint64_t block_timeouts = 0;
+};
+
+// In-process feed of wallet and user events. Publishers claim a sequence number with one
+// atomic increment and write the event into a fixed ring of slots, each guarded by its own
+// version word, so neither publishing nor consuming takes a lock. Every subscriber reads the
+// whole feed through its own cursor. With no subscribers, publishing is a single load.
+class EventFeed {
+public:
+    static constexpr size_t kCapacity = 8192;
+    static constexpr size_t kMaxSubscribers = 16;
+    // Longest a publisher waits for a Block subscriber; publishers run under the wallet lock
+    static constexpr int64_t kMaxBlockMicros = 2000;
+
+    static void publishTransaction(const std::string& walletId,
+                                   const std::string& transactionId,
+                                   const std::string& type,
+                                   double amount,
+                                   double balance,
+                                   const std::string& owner,
+                                   const std::string& asset);
+    static void publishWalletCreated(const std::string& walletId, const std::string& owner);
+    static void publishUserDeleted(const std::string& username);
+
+    static EventFeedStats stats();
+};
+
+// One reader of the feed, starting at the events published after it was created. Each
+// subscription is consumed from one thread at a time.
+class EventSubscription {
+public:
+    EventSubscription(const std::string& name, SlowConsumerPolicy policy);
+    ~EventSubscription();
+    EventSubscription(const EventSubscription&) = delete;
+    EventSubscription& operator=(const EventSubscription&) = delete;
+
+    // False if all kMaxSubscribers subscriptions were taken
+    bool active() const { return slot_ >= 0; }
+
+    // Appends up to max pending events to out without waiting; returns how many
+    size_t poll(std::vector<WalletEvent>& out, size_t max = 256);
+    // Next event, spinning briefly and then sleeping until one arrives or timeout passes
+    std::optional<WalletEvent> next(std::chrono::microseconds timeout);
+
+    SubscriptionStats stats() const;
+
+private:
+    int slot_ = -1;
+};
+
+} // namespace services
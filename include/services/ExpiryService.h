@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace services {
+
+// Outcome of one point expiry run
+struct ExpiryReport {
+    // Schedule days that were due, and the distinct wallets listed under them
+    size_t days = 0;
+    size_t wallets_checked = 0;
+    // Wallets that lost points, and how many points expired in total
+    size_t wallets_expired = 0;
+    double points_expired = 0;
+    // Wallets that could not be processed; their day is kept for the next run
+    size_t failures = 0;
+    int64_t elapsed_ms = 0;
+};
+
+class ExpiryService {
+public:
+    // Expires every lot due by now. Only wallets listed in the expiry schedule for due days
+    // are visited, spread over workers threads (0 picks the hardware concurrency).
+    static ExpiryReport runDue(unsigned workers = 0);
+
+    // Runs every interval on a background thread until stopBackground
+    static void startBackground(std::chrono::seconds interval);
+    static void stopBackground();
+
+    // Report of the most recent run, if any
+    static std::optional<ExpiryReport> lastReport();
+};
+
+} // namespace services
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "models/Hold.h"
+
+namespace services {
+
+// Two-phase debits: authorize reserves funds on a wallet, and capture, release or expiry
+// finalizes the reservation. A wallet's holds are stored with it (storage::HoldStorage) and
+// changed only under the wallet's RecordLock, so every process sees them and a debit anywhere
+// counts them against the balance. Only a capture writes the wallet (one debit transaction).
+//
+// Hold IDs start with the wallet ID. A capture's debit ID is derived from the hold ID, and
+// the hold is saved as "capturing" before the debit, so a capture cut short by a crash is
+// settled from the wallet's transactions and never debits twice.
+class HoldService {
+public:
+    static constexpr int64_t kDefaultTtlSeconds = 900;
+    static constexpr int64_t kMaxTtlSeconds = 7 * 86400;
+    // Finalized holds are kept this long, so late captures and lookups still see the outcome
+    static constexpr int64_t kRetainSeconds = 86400;
+
+    // Reserves amount of asset on the wallet for ttlSeconds; nullopt if the wallet does not
+    // exist or its available balance (balance less active holds) does not cover amount
+    static std::optional<models::Hold> authorize(const std::string& walletId,
+                                                 double amount,
+                                                 const std::string& asset = models::kDefaultAsset,
+                                                 int64_t ttlSeconds = kDefaultTtlSeconds);
+
+    // Debits amount (the whole hold if amount <= 0) and releases the rest. Capturing a
+    // captured hold returns it unchanged; nullopt if the hold is not authorized, has expired,
+    // is smaller than amount, or the debit fails (the hold then stays authorized).
+    static std::optional<models::Hold> capture(const std::string& holdId,
+                                               double amount,
+                                               const std::string& description);
+
+    // Releases an authorized hold; releasing a released hold returns it unchanged
+    static std::optional<models::Hold> release(const std::string& holdId);
+
+    static std::optional<models::Hold> get(const std::string& holdId);
+
+    // Amount of asset reserved on the wallet by active holds
+    static double held(const std::string& walletId, const std::string& asset = models::kDefaultAsset);
+    // Reserved amount per asset, for assets with active holds
+    static std::vector<std::pair<std::string, double>> heldBy(const std::string& walletId);
+
+    // Marks authorized holds past their expiry expired and drops finalized holds past
+    // kRetainSeconds; returns the holds expired. Expired holds stop counting as held at
+    // their expiry either way.
+    static size_t expireDue(int64_t now);
+
+    // Runs expireDue every interval on a background thread until stopBackground
+    static void startBackground(std::chrono::seconds interval);
+    static void stopBackground();
+};
+
+} // namespace services
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace services {
+
+struct LeaderboardEntry {
+    // 1-based position, highest balance first; equal balances are ordered by wallet ID
+    size_t rank;
+    std::string wallet_id;
+    std::string owner_username;
+    double balance;
+};
+
+// Wallets ordered by balance in an indexed skip list (every link records how many entries it
+// skips), so inserts, removals, rank lookups and seeks to a rank are O(log n). Kept current
+// by WalletService on every balance change once built.
+class Leaderboard {
+public:
+    // Builds the board from the wallet files on a worker pool (workers == 0 picks the
+    // hardware concurrency). Balance changes made while it runs are applied afterwards.
+    static bool rebuild(unsigned workers = 0);
+    // Builds the board on first use; the leaderboard endpoints call it, so startup reads no
+    // wallet files for it
+    static void ensureBuilt();
+    static bool built();
+
+    // Records a wallet's new balance; a no-op until the board is built
+    static void update(const std::string& walletId, const std::string& owner, double balance);
+    // Takes a wallet off the board, as when its owner is deleted
+    static void remove(const std::string& walletId);
+
+    // limit entries starting at rank offset + 1
+    static std::vector<LeaderboardEntry> top(size_t limit, size_t offset = 0);
+    static std::optional<LeaderboardEntry> rankOf(const std::string& walletId);
+    static size_t size();
+};
+
+} // namespace services
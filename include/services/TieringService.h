@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace services {
+
+// Outcome of one tiering pass
+struct TieringReport {
+    // Index entries or hot files examined
+    size_t scanned = 0;
+    // Transactions moved to the archive, and hot copies removed
+    size_t archived = 0;
+    size_t evicted = 0;
+    size_t segments_written = 0;
+    // Apparent and allocated size of the removed hot files
+    uint64_t hot_bytes_reclaimed = 0;
+    uint64_t hot_disk_bytes_reclaimed = 0;
+    uint64_t archive_bytes_written = 0;
+    int64_t elapsed_ms = 0;
+};
+
+class TieringService {
+public:
+    static constexpr int kDefaultColdAfterDays = 90;
+
+    // Moves transactions older than coldAfterDays from data/transactions into compressed
+    // archive segments, then removes their hot copies. Safe to interrupt: hot copies are only
+    // removed once their segment is durable, and an interrupted pass is finished by the next.
+    // A pass examines a bounded number of records, walking the record index's timestamp order
+    // when it is loaded (the record directory otherwise); the next pass resumes after them.
+    static TieringReport runOnce(int coldAfterDays = kDefaultColdAfterDays);
+
+    // Runs a pass every interval on a background thread until stopBackground
+    static void startBackground(std::chrono::seconds interval, int coldAfterDays = kDefaultColdAfterDays);
+    static void stopBackground();
+
+    // Report of the most recent pass, if any
+    static std::optional<TieringReport> lastReport();
+};
+
+} // namespace services
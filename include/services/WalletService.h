@@ -1,29 +1,153 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <optional>
+#include <utility>
 #include <vector>
+#include <functional>
 #include "models/Wallet.h"
 #include "models/Transaction.h"
 
 namespace services {
 
+// Outcome of an idempotent transaction request
+struct TransactionResult {
+    bool success;
+    std::string transaction_id;
+    // True when the key had already been applied and the original result was returned
+    bool duplicate;
+    // True when the key was already used for a different request (another wallet, amount,
+    // type or asset); nothing was applied
+    bool conflict = false;
+    // True when another request with the key is still running; nothing was applied
+    bool in_progress = false;
+};
+
+// Outcome of WalletService::executeTransactionIf
+enum class ConditionalOutcome {
+    Applied,
+    // The wallet already lists the transaction ID
+    AlreadyApplied,
+    // The condition did not hold; nothing was written
+    Skipped,
+    Failed
+};
+
+// A wallet and its transactions as of one commit sequence
+struct WalletHistory {
+    models::Wallet wallet;
+    std::vector<models::Transaction> transactions;
+    uint64_t snapshot_seq;
+};
+
 class WalletService {
 public:
+    // Points expire this long after they are earned unless configured otherwise
+    static constexpr int kDefaultPointLifetimeDays = 365;
+
     // Creates a new wallet for the user, returns walletId on success
     static std::optional<std::string> createWallet(const std::string& username);
 
     // Retrieves a wallet by ID
     static std::optional<models::Wallet> getWallet(const std::string& walletId);
 
-    // Executes a transaction (credit/debit) for the wallet; returns true on success
+    // Executes a transaction (credit/debit) of one asset for the wallet; returns true on success
     static bool executeTransaction(const std::string& walletId,
                                    double amount,
                                    const std::string& type,
-                                   const std::string& description);
+                                   const std::string& description,
+                                   const std::string& idempotencyKey = "",
+                                   const std::string& asset = models::kDefaultAsset);
+
+    // Executes a transaction deduplicated by idempotencyKey: a repeated key returns the
+    // original transaction ID without touching the wallet, and a key reused for a different
+    // request is refused as a conflict. The key is reserved while the request runs, so a
+    // concurrent request with it is refused as in progress. Only successful results are
+    // kept, so a failed request may be retried with the same key.
+    static TransactionResult executeTransactionIdempotent(const std::string& walletId,
+                                                          double amount,
+                                                          const std::string& type,
+                                                          const std::string& description,
+                                                          const std::string& idempotencyKey,
+                                                          const std::string& asset = models::kDefaultAsset);
+
+    // Executes a transaction under a caller-chosen ID; returns true without changes
+    // if the wallet already lists that ID, so replays never apply twice. A credit to a hot
+    // wallet is journaled instead, and a replayed ID is dropped when it is folded.
+    static bool executeTransactionWithId(const std::string& walletId,
+                                         const std::string& transactionId,
+                                         double amount,
+                                         const std::string& type,
+                                         const std::string& description,
+                                         const std::string& idempotencyKey = "",
+                                         const std::string& asset = models::kDefaultAsset);
 
-    // Retrieves all transactions for a wallet
+    // Executes a points transaction under a caller-chosen ID only if condition holds for the
+    // wallet. The condition is tested under the wallet lock, on the state the transaction
+    // applies to.
+    static ConditionalOutcome executeTransactionIf(const std::string& walletId,
+                                                   const std::string& transactionId,
+                                                   double amount,
+                                                   const std::string& type,
+                                                   const std::string& description,
+                                                   const std::function<bool(const models::Wallet&)>& condition);
+
+    // Moves amount of asset between two wallets: a debit on the sender and a credit on the
+    // recipient, saved together. transaction_id is the debit's. With an idempotency key a
+    // repeated request returns the original result, and a retry after a crash completes
+    // whichever half had not landed.
+    static TransactionResult transfer(const std::string& fromWalletId,
+                                      const std::string& toWalletId,
+                                      double amount,
+                                      const std::string& asset,
+                                      const std::string& description,
+                                      const std::string& idempotencyKey = "");
+
+    // Retrieves all transactions for a wallet, read from one storage snapshot
     static std::vector<models::Transaction> getTransactions(const std::string& walletId);
+
+    // Retrieves a wallet together with its transactions from one storage snapshot, so the
+    // balance always matches the listed transactions
+    static std::optional<WalletHistory> getHistory(const std::string& walletId);
+
+    // Lifetime of points credited from now on; existing lots keep their expiry
+    static void setPointLifetimeDays(int days);
+
+    // Expires the wallet's lots due at or before now with one debit; returns the points
+    // expired (0 if none were due or the wallet file no longer exists), nullopt if the wallet
+    // could not be read or saved
+    static std::optional<double> expirePoints(const std::string& walletId, int64_t now);
+
+    // Hot wallets take credits without rewriting their wallet file: each credit is appended
+    // to one of shards journals (storage::CreditJournal), one per thread, so concurrent
+    // credits to the wallet do not serialize. foldCredits later applies them in one save,
+    // and a debit the wallet's balance does not cover folds first. shards 0 makes the
+    // wallet ordinary again. Designation is per process; returns false if the wallet does
+    // not exist.
+    static bool setHotWallet(const std::string& walletId, size_t shards);
+    static bool isHotWallet(const std::string& walletId);
+
+    // Applies the wallet's journaled credits to it in one save; returns how many were
+    // applied, nullopt if the wallet could not be loaded or saved (the credits stay journaled)
+    static std::optional<size_t> foldCredits(const std::string& walletId);
+    // Folds every wallet with journaled credits, including ones left by an earlier run
+    static size_t foldAllCredits();
+    // Folds journaled credits into wallet, and reloads it, if its available balance of asset
+    // does not cover amount; requires the wallet's RecordLock held exclusively
+    static void foldCreditsIfShort(models::Wallet& wallet, const std::string& asset, double amount);
+    // Credits journaled for a hot wallet and not yet folded, per asset; the balance
+    // includes them only once folded
+    static std::vector<std::pair<std::string, double>> pendingCredits(const std::string& walletId);
+
+    // Runs foldAllCredits every interval on a background thread until stopCreditFolding
+    static void startCreditFolding(std::chrono::milliseconds interval);
+    static void stopCreditFolding();
+
+    // Streams a wallet's transactions to fn one at a time as they are loaded, from one
+    // storage snapshot; returns false if the wallet does not exist
+    static bool forEachTransaction(const std::string& walletId,
+                                   const std::function<void(const models::Transaction&)>& fn);
 };
 
 } // namespace services 
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace storage {
+
+struct FileRead {
+    // Resolved path
+    std::string path;
+    std::string data;
+    // False if the file could not be opened or read
+    bool ok = false;
+};
+
+struct FileWrite {
+    // data is written to tmp_path, which is then renamed over path
+    std::string tmp_path;
+    std::string path;
+    const std::string* data = nullptr;
+    bool ok = false;
+};
+
+// Batched file I/O under FileManager. With io_uring, a batch of reads is one submission of
+// opens and one of read+close pairs, whatever its size; a write chain is one submission of
+// linked write, close and rename steps. Where io_uring is unavailable (old kernel, seccomp)
+// reads and a chain's temp file writes are spread over a small thread pool, and only the
+// renames run one after another. Both keep many operations in flight so multi-record loads
+// pay device latency once, not per file.
+class AsyncIO {
+public:
+    // Reads every file whole
+    static void read(std::vector<FileRead>& reads);
+    // Writes and renames each file in order; each rename happens only after the ones before
+    // it succeeded. Stops at the first failure, removing the temp files of every write not
+    // renamed. Returns true if all were renamed.
+    static bool writeChain(std::vector<FileWrite>& writes);
+
+    // "io_uring" or "threads"
+    static const char* backend();
+};
+
+} // namespace storage
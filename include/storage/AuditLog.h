@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace storage {
+
+// Result of checking an audit log's hash chain
+struct AuditVerifyReport {
+    bool ok = false;
+    uint64_t entries = 0;
+    // Sequence number of the first entry that breaks the chain (0 when ok)
+    uint64_t first_bad_seq = 0;
+    std::string error;
+    // Hash of the last entry; publishing it elsewhere pins everything before it
+    std::string head_hash;
+    int64_t elapsed_ms = 0;
+};
+
+struct AuditStats {
+    uint64_t recorded = 0;
+    uint64_t written = 0;
+    uint64_t batches = 0;
+    uint64_t fsyncs = 0;
+    // Times a caller found the queue full and had to wait for the writer
+    uint64_t queue_full_waits = 0;
+    // Failed append or sync attempts; the entries are kept and retried
+    uint64_t write_failures = 0;
+    // Partial entries left by interrupted appends, kept in the file as breaks in the chain
+    uint64_t torn_tails = 0;
+    // Whether the latest attempt failed, leaving entries not yet durable
+    bool failing = false;
+};
+
+// Append-only, hash-chained log of privileged actions in data/audit/audit.log, one entry
+// per line:
+//   <seq> <prev hash> <hash> <payload JSON>
+// where hash = hex SHA-256 of "<seq> <prev hash> <payload JSON>" and the first entry's prev
+// hash is 64 zeros, so editing, dropping or reordering any entry breaks every hash after it.
+// record() only enqueues: a writer thread drains a bounded queue in batches, appends each
+// batch with one write and fsyncs at most every kSyncIntervalMs. A batch that fails to
+// write or sync is kept and retried; entries count as durable only after a successful sync.
+class AuditLog {
+public:
+    static constexpr const char* kDefaultPath = "data/audit/audit.log";
+    static constexpr size_t kQueueCapacity = 65536;
+    static constexpr int64_t kSyncIntervalMs = 100;
+
+    // Queues an entry {ts, actor, action, target, ok, details}; waits only if the queue is full.
+    // Returns false if the log is currently failing to write (the entry is still queued).
+    static bool record(const std::string& actor,
+                       const std::string& action,
+                       const std::string& target,
+                       bool ok,
+                       const nlohmann::json& details = nlohmann::json::object());
+    // Blocks until everything queued so far is written and fsynced; returns false as soon as
+    // an attempt fails instead, with the entries still queued for retry
+    static bool flush();
+
+    // Checks every entry's hash and the links between them, splitting the file across
+    // workers threads (0 picks the hardware concurrency)
+    static AuditVerifyReport verify(const std::string& path = kDefaultPath, unsigned workers = 0);
+
+    static AuditStats stats();
+};
+
+} // namespace storage
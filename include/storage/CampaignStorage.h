@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <vector>
+#include "models/Campaign.h"
+
+namespace storage {
+
+class CampaignStorage {
+public:
+    // Save campaign to data/campaigns/{campaign_id}.json; IDs failing models::validCampaignId
+    // are refused by save and load
+    static bool save(const models::Campaign& campaign);
+    // Load campaign from data/campaigns/{campaign_id}.json
+    static std::optional<models::Campaign> load(const std::string& campaign_id);
+    // List all campaigns from data/campaigns/*.json
+    static std::vector<models::Campaign> listAll();
+};
+
+} // namespace storage
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "storage/RequestArena.h"
+
+namespace storage {
+
+// Sequence number of the last entry and the log size just past it
+struct ChangeLogPosition {
+    uint64_t seq = 0;
+    uint64_t offset = 0;
+};
+
+// Append-only log of every record saved or deleted through FileManager, shipped to read
+// replicas by ReplicaFollower. One compact JSON document per line:
+//   {"seq":N,"ts":<ms since epoch>,"op":"put"|"del","path":"data/...","doc":{...}}
+// Sequence numbers are strictly increasing and continue across restarts and across processes
+// logging to the same file: each entry takes the number after the log's last line under an
+// exclusive RecordLock on the log, and is written with a single O_APPEND write. A log past
+// 64 MiB is rotated to <path>.1 and continues in a new file.
+class ChangeLog {
+public:
+    static constexpr const char* kDefaultPath = "data/replication/changelog.log";
+
+    // Starts logging to path (appending); returns false if the log cannot be opened
+    static bool enable(const std::string& path = kDefaultPath);
+    static void disable();
+    static bool enabled();
+
+    // Json is nlohmann::json or ArenaJson; the document is serialized straight into the entry
+    template <typename Json>
+    static void appendPut(const std::string& path, const Json& doc);
+    static void appendDelete(const std::string& path);
+    // Sequence number of the last entry in the log (0 if none), by any process
+    static uint64_t lastSequence();
+    // End of the current log file, by any process
+    static ChangeLogPosition position();
+    // Path of the open log, empty when disabled
+    static std::string path();
+};
+
+} // namespace storage
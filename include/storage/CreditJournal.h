@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "models/Transaction.h"
+
+namespace storage {
+
+// Credits to a hot wallet that have not been folded into its wallet file yet. Each of the
+// wallet's shards appends to its own file, data/hot/<wallet>/<shard>.log, one transaction
+// per line, so shards never contend with each other. A fold first seals a shard's log by
+// renaming it to <shard>.fold, and removes the sealed files once the wallet is saved.
+// Appends and seals of a shard exclude each other across processes through a RecordLock on
+// the shard's log, shared for appends and exclusive for seals.
+class CreditJournal {
+public:
+    // Appends one credit to the shard's open log
+    static bool append(const std::string& walletId, size_t shard, const models::Transaction& tx);
+    // Seals the shard's open log for folding. Returns false, leaving the log open, if a sealed
+    // file from an earlier fold that did not finish is still there.
+    static bool seal(const std::string& walletId, size_t shard);
+    // True if the wallet has any open log or sealed file, whichever process wrote it
+    static bool hasPending(const std::string& walletId);
+    // Shards of the wallet with an open log
+    static std::vector<size_t> openShards(const std::string& walletId);
+    // Credits in the wallet's sealed files, shard by shard in append order
+    static std::vector<models::Transaction> sealed(const std::string& walletId);
+    // Removes the wallet's sealed files
+    static bool removeSealed(const std::string& walletId);
+    // Wallets with any log or sealed file
+    static std::vector<std::string> wallets();
+};
+
+} // namespace storage
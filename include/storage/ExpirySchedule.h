@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace storage {
+
+// Wallets with point lots expiring on each day, so an expiry run visits only the wallets
+// that have something due. One append-only file per day, data/expiry/<day>.due (day =
+// expiry time / 86400), holding one wallet ID per line; a wallet may appear more than once.
+class ExpirySchedule {
+public:
+    // Records that walletId has a lot expiring at the start of day
+    static bool add(int64_t day, const std::string& walletId);
+    // Days with scheduled wallets whose start is at or before now, oldest first
+    static std::vector<int64_t> dueDays(int64_t now);
+    // Distinct wallets scheduled for day
+    static std::vector<std::string> wallets(int64_t day);
+    // Drops the day once all its wallets have been processed
+    static bool remove(int64_t day);
+};
+
+} // namespace storage
@@ -1,16 +1,107 @@
 #pragma once
 
+#include <cstdint>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
+#include "storage/RequestArena.h"
 
 namespace storage {
 
+// Lock wait accounting for RecordLock, process-wide
+struct LockStats {
+    uint64_t shared_acquired = 0;
+    uint64_t exclusive_acquired = 0;
+    // Acquisitions that had to wait for another holder
+    uint64_t contended = 0;
+    uint64_t wait_us_total = 0;
+    uint64_t wait_us_max = 0;
+};
+
+// One record of a FileManager::writeJsonChain
+struct ChainedWrite {
+    std::string path;
+    const ArenaJson* doc;
+};
+
 class FileManager {
 public:
-    // Atomically writes JSON to the given file path with exclusive lock
-    static bool writeJson(const std::string& path, const nlohmann::json& j);
+    // Atomically writes JSON to the given file path with exclusive lock. Json is
+    // nlohmann::json or ArenaJson, for a document built in the request arena.
+    template <typename Json>
+    static bool writeJson(const std::string& path, const Json& j);
+    // Writes several records as one AsyncIO write chain, each made visible only after the
+    // ones before it. Stops at the first failure, leaving the later records untouched.
+    static bool writeJsonChain(const std::vector<ChainedWrite>& writes);
     // Reads JSON from the given file path with shared lock
     static bool readJson(const std::string& path, nlohmann::json& j);
+    // Reads the whole file into out with a single sized read, with shared lock
+    static bool readFile(const std::string& path, std::string& out);
+    // readFile for many records at once, their I/O kept in flight together through AsyncIO.
+    // Takes no record locks; each record is still read whole and as of the thread's Snapshot.
+    // out[i] is empty where paths[i] does not exist or could not be read.
+    static void readFiles(const std::vector<std::string>& paths, std::vector<std::optional<std::string>>& out);
+    // Removes the file at path with exclusive lock; returns true if it existed
+    static bool removeFile(const std::string& path);
+    // Removes the hot copy of a record that now lives in another storage tier: locked and
+    // snapshot-safe like removeFile, but the record is not reported as deleted to the change
+    // log or the record index
+    static bool evictFile(const std::string& path);
+    // Paths of the .json records in a data directory ("data/users" -> "data/users/x.json"),
+    // as of the calling thread's Snapshot if it has one
+    static std::vector<std::string> listRecords(const std::string& dir);
+
+    // Snapshot of the RecordLock counters
+    static LockStats lockStats();
+
+    // Maps a data-relative path ("data/...") onto the calling thread's data root
+    static std::string resolve(const std::string& path);
+
+private:
+    static bool remove(const std::string& path, bool deleted);
+};
+
+enum class LockMode { Shared, Exclusive };
+
+// Cross-process advisory lock on one record path, held for the lifetime of the object.
+// Implemented as an open-file-description fcntl lock on one byte of <root>/data/.locks chosen
+// by hashing the path, so it excludes other threads and other processes sharing the data
+// directory alike. Locks are re-entrant per thread; a thread that will write a record must
+// take Exclusive up front rather than upgrading from Shared.
+class RecordLock {
+public:
+    RecordLock(const std::string& path, LockMode mode);
+    // Takes the lock only if that needs no wait; held() tells whether it did. For callers
+    // holding several locks at once, which must not block while holding any.
+    RecordLock(const std::string& path, LockMode mode, std::try_to_lock_t);
+    ~RecordLock();
+    RecordLock(const RecordLock&) = delete;
+    RecordLock& operator=(const RecordLock&) = delete;
+
+    // False if the lock file could not be opened (the caller then runs unlocked)
+    bool held() const { return held_; }
+
+private:
+    void acquire(const std::string& path, LockMode mode, bool wait);
+
+    int fd_ = -1;
+    int64_t offset_ = 0;
+    bool held_ = false;
+};
+
+// Redirects the calling thread's storage access to another data root (e.g. a read replica)
+// for the lifetime of the object. Writes under a redirected root are not change-logged.
+class ScopedDataRoot {
+public:
+    explicit ScopedDataRoot(const std::string& root);
+    ~ScopedDataRoot();
+    ScopedDataRoot(const ScopedDataRoot&) = delete;
+    ScopedDataRoot& operator=(const ScopedDataRoot&) = delete;
+
+private:
+    std::string previous_;
 };
 
-} // namespace storage 
\ No newline at end of file
+} // namespace storage
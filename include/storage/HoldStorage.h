@@ -0,0 +1,24 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "models/Hold.h"
+
+namespace storage {
+
+// Holds of one wallet in data/holds/{wallet_id}.json. Callers hold the wallet's RecordLock
+// (data/wallets/{wallet_id}.json) from a load through the save that follows it, so every
+// process sees and changes a wallet's holds in step with its balance.
+class HoldStorage {
+public:
+    // Replaces the wallet's holds; an empty list removes the file
+    static bool save(const std::string& walletId, const std::vector<models::Hold>& holds);
+    // Loads the wallet's holds; empty if it has none, nullopt if the file cannot be parsed or
+    // the wallet ID cannot name a file
+    static std::optional<std::vector<models::Hold>> load(const std::string& walletId);
+    // Wallets with a holds file
+    static std::vector<std::string> wallets();
+};
+
+} // namespace storage
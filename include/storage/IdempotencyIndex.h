@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <optional>
+
+namespace storage {
+
+// Maps client idempotency keys to the transaction they produced.
+// A key is reserved before its request runs and completed once it succeeds, so two
+// concurrent requests with one key cannot both execute as new. Keys are stored one file per
+// key in a bucket per day, data/idempotency/{day}/{hh}/{digest}.json, and are kept for
+// kRetentionDays full days after the day they were first used; older buckets are removed as
+// whole directories. Recently completed keys are also kept in a bounded in-memory table.
+class IdempotencyIndex {
+public:
+    static constexpr int64_t kRetentionDays = 1;
+    // A reservation older than this belongs to a request that died; its key may be taken over.
+    // An empty or unparsable reservation file is judged by its mtime.
+    static constexpr int64_t kPendingTimeoutSeconds = 30;
+
+    struct Entry {
+        std::string wallet_id;
+        std::string transaction_id;
+        // Caller-defined summary of the request (endpoint, amount, type...); a reuse of the
+        // key must match it
+        std::string fingerprint;
+    };
+
+    enum class Status {
+        // The caller owns the key: run the request, then complete or abandon it
+        Reserved,
+        // The key already completed for the same request; entry holds its result
+        Duplicate,
+        // The key was used for a different request
+        Conflict,
+        // Another request with the key is still running
+        InProgress,
+        // The reservation could not be stored
+        Failed
+    };
+
+    struct Claim {
+        Status status;
+        Entry entry;
+    };
+
+    // Who chose the key. Each scope has its own directory (data/campaign_credits for
+    // campaigns), so a client key can never collide with one the server derives.
+    enum class Scope { Client, Campaign };
+
+    // Reserves key for the request described by walletId and fingerprint
+    static Claim reserve(const std::string& key, const std::string& walletId, const std::string& fingerprint,
+                         Scope scope = Scope::Client);
+    // Records the result of a reserved key
+    static bool complete(const std::string& key, const Entry& entry, Scope scope = Scope::Client);
+    // Drops a reservation whose request failed, so the key can be retried
+    static void abandon(const std::string& key, Scope scope = Scope::Client);
+    // Returns the completed entry for the key, if any
+    static std::optional<Entry> lookup(const std::string& key, Scope scope = Scope::Client);
+    // Removes day buckets past the retention window. The first reserve of each day hands
+    // this to a background thread, so no request waits for it.
+    static size_t expire(int64_t now);
+    // Stable digest of a key, used for file names and derived transaction IDs
+    static std::string digest(const std::string& key);
+};
+
+} // namespace storage
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "storage/RequestArena.h"
+
+namespace storage {
+
+// How the index was brought up at startup
+struct RecordIndexStatus {
+    // "snapshot" (snapshot plus change log replay), "rebuild" or "" before load
+    std::string source;
+    // Why a snapshot was not used, if it was not
+    std::string rebuild_reason;
+    uint64_t replayed_changes = 0;
+    int64_t load_ms = 0;
+    size_t transactions = 0;
+    // Creation time (ms since epoch) of the last snapshot written or loaded
+    int64_t snapshot_ms = 0;
+};
+
+// In-memory index of every transaction, hot or archived, with its wallet, ordered by
+// timestamp (tiering walks its cold end). Kept current by FileManager on every save and
+// delete once loaded.
+//
+// Persisted to data/index/records.snapshot by save() (at clean shutdown and periodically):
+// a fixed header with a format version and a CRC-32 of the payload, then length-prefixed
+// records. load() maps the snapshot, verifies it and replays the change log entries newer
+// than it; without a change log it only trusts a snapshot when data/transactions has not
+// changed since it was taken. Anything else falls back to a parallel rebuild from the
+// transaction files and the archive.
+class RecordIndex {
+public:
+    static constexpr const char* kSnapshotPath = "data/index/records.snapshot";
+
+    // Brings the index up from the snapshot or a rebuild; returns false if neither worked
+    static bool load(unsigned workers = 0);
+    // Writes a snapshot of the current index; returns false if not loaded or on I/O failure
+    static bool save();
+    // Saves every interval from a background thread until stopPeriodicSnapshots
+    static void startPeriodicSnapshots(std::chrono::seconds interval);
+    static void stopPeriodicSnapshots();
+    static bool loaded();
+    static RecordIndexStatus status();
+
+    // A transaction's place in timestamp order
+    struct TransactionPosition {
+        int64_t timestamp = 0;
+        std::string id;
+    };
+    // Up to limit transactions with a timestamp before `before`, oldest first, starting after
+    // `from` (from the oldest without one); successive calls walk the cold end of the index
+    static std::vector<TransactionPosition> transactionsBefore(int64_t before,
+                                                               const std::optional<TransactionPosition>& from,
+                                                               size_t limit);
+
+    // Storage hooks used by FileManager; the updates are no-ops until the index is loaded.
+    // A FileManager write holds an UpdateScope from before it replaces the file until it has
+    // updated the index and the change log, so save() never captures a directory state or
+    // log position the index has not caught up with.
+    class UpdateScope {
+    public:
+        UpdateScope();
+        ~UpdateScope();
+        UpdateScope(const UpdateScope&) = delete;
+        UpdateScope& operator=(const UpdateScope&) = delete;
+    };
+    // Json is nlohmann::json or ArenaJson
+    template <typename Json>
+    static void onPut(const std::string& path, const Json& doc);
+    static void onDelete(const std::string& path);
+};
+
+} // namespace storage
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace storage {
+
+// Progress of a follower, persisted in <replicaRoot>/data/replication/follower.json
+struct ReplicaStatus {
+    // Byte offset and sequence number of the last applied change log entry
+    uint64_t offset = 0;
+    uint64_t applied_seq = 0;
+    // Leader timestamp (ms since epoch) of the last applied entry
+    int64_t last_entry_ts = 0;
+    // The replica reflects every leader write that completed before this time (ms since epoch).
+    // Idle polls refresh it on disk only every 100 ms, so an idle replica reads that much staler.
+    int64_t caught_up_at = 0;
+    // Sequence number and timestamp of the first entry of the log file being tailed, to tell
+    // a rotated or replaced log from the one offset points into
+    uint64_t file_seq = 0;
+    int64_t file_ts = 0;
+};
+
+// Tails a leader's ChangeLog and applies it to a replica data root (a local directory
+// standing in for a remote node).
+class ReplicaFollower {
+public:
+    ReplicaFollower(const std::string& leaderLogPath, const std::string& replicaRoot);
+
+    // Applies every complete entry appended since the last poll; returns the number applied
+    size_t pollOnce();
+    // Polls until stop is set
+    void run(const std::atomic<bool>& stop, std::chrono::milliseconds interval);
+
+    static std::optional<ReplicaStatus> readStatus(const std::string& replicaRoot);
+
+private:
+    // Applies the complete entries of logPath past status_.offset; returns the number applied
+    size_t applyFrom(const std::string& logPath);
+
+    std::string leaderLogPath_;
+    std::string replicaRoot_;
+    ReplicaStatus status_;
+};
+
+// Routes read-only requests to a replica when it is fresh enough
+class ReadReplica {
+public:
+    // Serve reads from replicaRoot while its staleness is at most maxStalenessMs
+    static void configure(const std::string& replicaRoot, int64_t maxStalenessMs);
+    static void disable();
+    // Staleness bound of the replica in ms if reads may use it right now, nullopt otherwise
+    static std::optional<int64_t> usableLagMs();
+    // Current staleness of the configured replica in ms, nullopt if none or unknown
+    static std::optional<int64_t> lagMs();
+    static std::string root();
+};
+
+} // namespace storage
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace storage {
+
+struct RequestArenaStats {
+    uint64_t requests = 0;
+    // Bytes served from request arenas
+    uint64_t arena_bytes = 0;
+    // Allocations passed to the heap because a request's arena reached kMaxBytes
+    uint64_t heap_fallbacks = 0;
+    // Largest arena footprint of a single request
+    uint64_t peak_bytes = 0;
+};
+
+// Per-thread bump allocator for the short-lived allocations of one request: JSON documents
+// built to be serialised, scratch strings. Opening a RequestArena starts a request on the
+// calling thread (nested scopes join the open one); everything allocated from it is
+// released at once when the outermost scope closes, so frees cost nothing and threads never
+// meet in the global heap. The first kInitialBytes are kept between requests; past
+// kMaxBytes a request's allocations go to the heap, so long requests (a campaign run) stay
+// bounded. Memory from the arena must not outlive the scope or leave the thread.
+class RequestArena {
+public:
+    static constexpr size_t kInitialBytes = 64 * 1024;
+    static constexpr size_t kMaxBytes = 8 * 1024 * 1024;
+
+    RequestArena();
+    ~RequestArena();
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // The calling thread's arena while a request is open, the heap otherwise. Deallocating
+    // through it is always safe: blocks the arena did not hand out go back to the heap.
+    static std::pmr::memory_resource* resource();
+
+    static RequestArenaStats stats();
+};
+
+// Allocator for types that default-construct their allocators (nlohmann::basic_json
+// does for every node): binds to RequestArena::resource() at the point of use
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : resource_(RequestArena::resource()) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : resource_(other.resource()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        resource_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    std::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return resource_ == other.resource(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return resource_ != other.resource(); }
+
+private:
+    std::pmr::memory_resource* resource_;
+};
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// JSON document whose nodes, containers and strings live in the request arena. Convertible
+// to and from nlohmann::json; the model to_json functions fill it directly.
+using ArenaJson = nlohmann::basic_json<std::map, std::vector, ArenaString, bool, std::int64_t,
+                                       std::uint64_t, double, ArenaAllocator>;
+
+// Appends j's text to out, as j.dump(indent) would produce it, without building it as a
+// string of the document's own type first (for an ArenaJson, an arena string to copy out)
+template <typename Json>
+void dumpInto(std::string& out, const Json& j, int indent = -1) {
+    nlohmann::detail::serializer<Json> serializer(nlohmann::detail::output_adapter<char, std::string>(out), ' ');
+    serializer.dump(j, indent >= 0, false, indent >= 0 ? static_cast<unsigned int>(indent) : 0);
+}
+
+} // namespace storage
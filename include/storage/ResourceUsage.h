@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+namespace storage {
+
+// What one request cost besides time
+struct ResourceUsage {
+    uint64_t files_opened = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t renames = 0;
+    uint64_t dir_scans = 0;
+    // Entries visited by those scans
+    uint64_t dir_entries = 0;
+    // Heap allocations; counted only while UsageScope::setAllocationCounting is on
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+
+    ResourceUsage& operator+=(const ResourceUsage& o) {
+        files_opened += o.files_opened;
+        bytes_read += o.bytes_read;
+        bytes_written += o.bytes_written;
+        renames += o.renames;
+        dir_scans += o.dir_scans;
+        dir_entries += o.dir_entries;
+        allocations += o.allocations;
+        allocated_bytes += o.allocated_bytes;
+        return *this;
+    }
+
+    // Field-wise maximum, for the worst call of an endpoint
+    void maxWith(const ResourceUsage& o) {
+        files_opened = std::max(files_opened, o.files_opened);
+        bytes_read = std::max(bytes_read, o.bytes_read);
+        bytes_written = std::max(bytes_written, o.bytes_written);
+        renames = std::max(renames, o.renames);
+        dir_scans = std::max(dir_scans, o.dir_scans);
+        dir_entries = std::max(dir_entries, o.dir_entries);
+        allocations = std::max(allocations, o.allocations);
+        allocated_bytes = std::max(allocated_bytes, o.allocated_bytes);
+    }
+};
+
+inline void to_json(nlohmann::json& j, const ResourceUsage& u) {
+    j = nlohmann::json{
+        {"files_opened", u.files_opened},
+        {"bytes_read", u.bytes_read},
+        {"bytes_written", u.bytes_written},
+        {"renames", u.renames},
+        {"dir_scans", u.dir_scans},
+        {"dir_entries", u.dir_entries},
+        {"allocations", u.allocations},
+        {"allocated_bytes", u.allocated_bytes}
+    };
+}
+
+class UsageShare;
+
+// Accounts the calling thread's file and heap activity to the open request. ApiRouter opens
+// one per call; nested scopes join the open one. The recording functions are no-ops on a
+// thread with no scope open.
+class UsageScope {
+public:
+    UsageScope();
+    // Opened by a task running on another thread for the request that created share; what
+    // the task uses is added to share when the scope closes
+    explicit UsageScope(UsageShare& share);
+    ~UsageScope();
+    UsageScope(const UsageScope&) = delete;
+    UsageScope& operator=(const UsageScope&) = delete;
+
+    // Totals so far of the request this scope belongs to
+    const ResourceUsage& totals() const;
+
+    static void fileOpened();
+    static void bytesRead(uint64_t bytes);
+    static void bytesWritten(uint64_t bytes);
+    static void renamed();
+    static void dirScanned(uint64_t entries);
+    // Called by the counting operator new in src/AllocationHook.cpp, which only the executables
+    // that count allocations link
+    static void allocated(uint64_t bytes);
+
+    // Opt-in because it puts a check on every operator new in the process
+    static void setAllocationCounting(bool on);
+    static bool allocationCounting();
+
+private:
+    bool owner_ = false;
+    UsageShare* share_ = nullptr;
+    ResourceUsage usage_;
+};
+
+// Charges work a request hands to worker threads to that request. Create one on the request's
+// thread, open a UsageScope on it in each task, and join it on the request's thread once the
+// tasks are done. Tasks that finish after the join are not charged.
+class UsageShare {
+public:
+    UsageShare();
+    // Joins if join has not been called
+    ~UsageShare();
+    UsageShare(const UsageShare&) = delete;
+    UsageShare& operator=(const UsageShare&) = delete;
+
+    // Adds what the tasks used so far to the request's totals
+    void join();
+
+private:
+    friend class UsageScope;
+    std::mutex mutex_;
+    // The creating thread's open request, null when it had none or after join
+    ResourceUsage* request_;
+    ResourceUsage collected_;
+};
+
+} // namespace storage
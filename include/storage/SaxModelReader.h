@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "models/UserAccount.h"
+#include "models/Wallet.h"
+#include "models/Transaction.h"
+
+namespace storage {
+
+// Parses stored records straight into models with a SAX handler, skipping the
+// intermediate nlohmann::json DOM. Accepts exactly what the models' from_json accept:
+// required fields must be present with the right type, unknown fields are ignored.
+class SaxModelReader {
+public:
+    static bool parse(std::string_view text, models::UserAccount& user);
+    static bool parse(std::string_view text, models::Wallet& wallet);
+    static bool parse(std::string_view text, models::Transaction& tx);
+
+    // Bulk-reads the file at path and parses it into the model
+    template <typename Model>
+    static bool read(const std::string& path, Model& model);
+    // read for many paths, kReadBatch files in flight at a time (FileManager::readFiles).
+    // out[i] is empty where paths[i] is missing or does not parse.
+    template <typename Model>
+    static void readMany(const std::vector<std::string>& paths, std::vector<std::optional<Model>>& out);
+
+    static constexpr size_t kReadBatch = 128;
+};
+
+} // namespace storage
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace storage {
+
+// Pins the calling thread's storage reads to one point in time for the lifetime of the
+// object: FileManager::readFile/readJson and listRecords return each record as of the commit
+// sequence current at construction, however many writes land meanwhile. Readers take no lock
+// beyond the per-record shared lock of an ordinary read, so writers are never held up.
+// Snapshots are read-only scopes (the thread's own writes are not visible through them) and
+// cover writes made by this process. A snapshot taken inside another reads at the outer one's
+// sequence. Taking a snapshot never waits: a write already under way counts as made before it,
+// and reading that record waits for the write's record lock like any other read.
+class Snapshot {
+public:
+    Snapshot();
+    ~Snapshot();
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    // Commit sequence this snapshot reads at
+    uint64_t sequence() const { return sequence_; }
+
+private:
+    uint64_t sequence_;
+    const Snapshot* previous_;
+};
+
+struct VersionStats {
+    uint64_t commit_sequence = 0;
+    size_t active_snapshots = 0;
+    // Records with retained versions and the number of versions retained
+    size_t chains = 0;
+    size_t versions = 0;
+    // Replaced files kept open until a snapshot reads them or they are collected
+    size_t pinned_files = 0;
+};
+
+// Multi-version record store behind FileManager. Every write gets the next commit sequence;
+// while a snapshot is open, the new contents of each written record are kept in memory so the
+// snapshot can still read the version it is pinned to. What the first such write to a record
+// replaces is kept as an open descriptor on the old file, which is only read if a snapshot asks
+// for it; records are always replaced by rename, never rewritten in place. Versions no open
+// snapshot can see are dropped by a background collector.
+class VersionStore {
+public:
+    using Bytes = std::shared_ptr<const std::string>;
+
+    // Write protocol used by FileManager with the record's exclusive lock held:
+    // beginWrite before replacing the file (true means a snapshot is open, and the old file
+    // is pinned if its record has no versions yet), commit after the new contents are in
+    // place (null bytes for a delete)
+    static bool beginWrite(const std::string& path);
+    static uint64_t commit(const std::string& path, bool versioned, Bytes current);
+    // Ends a write that failed before replacing the file
+    static void abortWrite(const std::string& path, bool versioned);
+
+    // The version of path visible to the calling thread's snapshot: nullopt when the file on
+    // disk is that version (or no snapshot is active), a null pointer when the record did not
+    // exist at the snapshot. A write pins what it replaces before the rename, so a caller that
+    // read the file without the record lock gets the right version by asking again afterwards.
+    static std::optional<Bytes> visible(const std::string& path);
+    // Records under dir (a resolved directory path) that existed at the calling thread's
+    // snapshot but have since been deleted, as file names
+    static std::vector<std::string> deletedSince(const std::string& dir);
+
+    static const Snapshot* current();
+    static uint64_t commitSequence();
+    // Drops every version no open snapshot can read; also runs periodically in the background
+    static void collectGarbage();
+    static VersionStats stats();
+};
+
+} // namespace storage
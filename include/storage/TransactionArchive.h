@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "models/Transaction.h"
+
+namespace storage {
+
+struct ArchiveStats {
+    uint64_t segments = 0;
+    uint64_t records = 0;
+    // Bytes of all segment files
+    uint64_t archive_bytes = 0;
+    // Loads served from the archive, and their latency
+    uint64_t cold_reads = 0;
+    uint64_t cold_read_us_total = 0;
+    uint64_t cold_read_us_max = 0;
+    uint64_t block_cache_hits = 0;
+    uint64_t block_cache_misses = 0;
+};
+
+// Cold tier for transactions: immutable segment files in data/archive/*.seg, each a run of
+// zlib-compressed blocks of compact JSON records followed by a block index (block offsets,
+// sizes and CRCs, and the block of every transaction ID) and a fixed trailer locating it.
+// The block indexes of all segments are loaded on first use, and segments written since by
+// other processes are picked up when a lookup misses; reads decompress one block,
+// and a small cache of decompressed blocks serves neighbouring records (segments are
+// written in wallet order, so a wallet's history shares blocks).
+class TransactionArchive {
+public:
+    static std::optional<models::Transaction> load(const std::string& transactionId);
+    static bool contains(const std::string& transactionId);
+    // Writes the transactions as one new segment (durably, before returning) and makes them
+    // readable; returns the segment size in bytes, nullopt on failure
+    static std::optional<uint64_t> writeSegment(std::vector<models::Transaction> transactions);
+    // Visits every archived transaction, segment by segment
+    static void forEach(const std::function<void(const models::Transaction&)>& fn);
+    static ArchiveStats stats();
+};
+
+} // namespace storage
@@ -11,9 +11,14 @@ class TransactionStorage {
 public:
     // Save transaction to data/transactions/{transaction_id}.json
     static bool save(const models::Transaction& tx);
-    // Load transaction from data/transactions/{transaction_id}.json
+    // Load transaction from data/transactions/{transaction_id}.json, or from the cold
+    // archive (TransactionArchive) once it has been tiered out
     static std::optional<models::Transaction> load(const std::string& transaction_id);
-    // List all transactions from data/transactions/*.json
+    // load for many transactions, reading the hot records as one batch; out[i] is empty if
+    // transaction_ids[i] is in neither tier
+    static void loadMany(const std::vector<std::string>& transaction_ids,
+                         std::vector<std::optional<models::Transaction>>& out);
+    // List all transactions from data/transactions/*.json and the cold archive
     static std::vector<models::Transaction> listAll();
 };
 
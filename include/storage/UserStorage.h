@@ -3,6 +3,7 @@
 #include <string>
 #include <optional>
 #include <vector>
+#include <functional>
 #include "models/UserAccount.h"
 
 namespace storage {
@@ -13,8 +14,14 @@ public:
     static bool save(const models::UserAccount& user);
     // Load user from data/users/{username}.json
     static std::optional<models::UserAccount> load(const std::string& username);
+    // load for many users, read as one batch; out[i] is empty if usernames[i] does not exist
+    static void loadMany(const std::vector<std::string>& usernames,
+                         std::vector<std::optional<models::UserAccount>>& out);
     // List all users from data/users/*.json
     static std::vector<models::UserAccount> listAll();
+    // Streams users from data/users/*.json, read a batch at a time; stops early when fn
+    // returns false
+    static void forEach(const std::function<bool(const models::UserAccount&)>& fn);
 };
 
 } // namespace storage 
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <optional>
 #include <vector>
 #include "models/Wallet.h"
+#include "models/Transaction.h"
 
 namespace storage {
 
@@ -11,6 +12,12 @@ class WalletStorage {
 public:
     // Save wallet to data/wallets/{wallet_id}.json
     static bool save(const models::Wallet& wallet);
+    // Saves the transactions and then the wallet as one write chain, so a wallet never lists
+    // a transaction whose record did not land
+    static bool save(const models::Wallet& wallet, const std::vector<models::Transaction>& transactions);
+    // Same for several wallets, saved in the order given after all the transactions
+    static bool save(const std::vector<const models::Wallet*>& wallets,
+                     const std::vector<models::Transaction>& transactions);
     // Load wallet from data/wallets/{wallet_id}.json
     static std::optional<models::Wallet> load(const std::string& wallet_id);
     // List all wallets from data/wallets/*.json
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace tracing {
+
+// Head-sampled request tracing. Each ApiRouter call opens a RootSpan, which decides once
+// whether the request is sampled; Spans opened beneath it on the same thread (services,
+// storage) record only when it was. Finished spans are buffered per thread and appended to
+// the trace file when the root closes, as Chrome trace-event "complete" events (a JSON
+// array, left open so it can be appended to; chrome://tracing and Perfetto accept it).
+class Tracer {
+public:
+    // Starts writing sampled requests to path (truncating it); sampleRate is the fraction
+    // of requests traced, 0..1. Returns false if the file cannot be opened.
+    static bool start(const std::string& path, double sampleRate);
+    static void stop();
+    static bool enabled();
+    // Spans recorded and requests sampled since start
+    static uint64_t spansWritten();
+    static uint64_t requestsSampled();
+};
+
+// A timed region of the current request; free when the request is not sampled
+class Span {
+public:
+    // category and name must outlive the span (string literals)
+    Span(const char* category, const char* name);
+    // detail (e.g. a record path) is copied only when the request is sampled
+    Span(const char* category, const char* name, const std::string& detail);
+    ~Span();
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    void begin(const char* category, const char* name);
+
+    bool active_ = false;
+    const char* category_ = nullptr;
+    const char* name_ = nullptr;
+    int64_t start_us_ = 0;
+    std::string detail_;
+};
+
+// Opens a request: makes the sampling decision and, if sampled, writes the request's spans
+// when it closes. Inside an already open request it behaves as a plain Span, recording
+// only if that request is sampled.
+class RootSpan {
+public:
+    RootSpan(const char* category, const char* name);
+    ~RootSpan();
+    // Extra args for the request's root event (e.g. its resource usage); ignored when the
+    // request is not sampled or this is not the root
+    void annotate(const nlohmann::json& args);
+    RootSpan(const RootSpan&) = delete;
+    RootSpan& operator=(const RootSpan&) = delete;
+
+private:
+    bool owner_ = false;
+    std::optional<Span> span_;
+};
+
+} // namespace tracing
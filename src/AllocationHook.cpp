@@ -0,0 +1,18 @@
+#include "storage/ResourceUsage.h"
+
+#include <cstdlib>
+#include <new>
+
+// Counting hook for UsageScope, linked only into the executables that count allocations (the
+// app and the ingest benchmark), so the library, the tests and the load generator keep the
+// standard allocator. Only the plain form is replaced: the array and nothrow forms call it,
+// and the default operator delete frees what malloc returned.
+void* operator new(std::size_t size) {
+    storage::UsageScope::allocated(size);
+    for (;;) {
+        if (void* p = std::malloc(size ? size : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
@@ -11,140 +11,621 @@
 #include "services/UserService.h"
 #include "services/WalletService.h"
 #include "services/AdminService.h"
+#include "services/CampaignService.h"
+#include "api/JsonStreamWriter.h"
+#include "api/ApiTrace.h"
+#include "storage/ChangeLog.h"
+#include "storage/AsyncIO.h"
+#include "storage/FileManager.h"
+#include "storage/RecordIndex.h"
+#include "storage/RequestArena.h"
+#include "storage/ResourceUsage.h"
+#include "storage/ReplicaFollower.h"
+#include "storage/TransactionArchive.h"
+#include "services/TieringService.h"
+#include "services/ExpiryService.h"
+#include "services/EventFeed.h"
+#include "storage/AuditLog.h"
+#include "tracing/Tracer.h"
+#include "services/AssetLedger.h"
+#include "services/HoldService.h"
+#include "services/Leaderboard.h"
 #include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <optional>
 
 namespace api {
 
-ApiResponse ApiRouter::initiateLogin(const std::string& username, const std::string& password) {
-    auto otpOpt = auth::AuthService::initiateLogin(username, password);
-    if (!otpOpt) {
-        return ApiResponse{false, "Invalid credentials", {}};
+namespace {
+
+// Streamed records use the same (sorted) key order as nlohmann::json so both modes match
+
+void writeRecord(JsonStreamWriter& w, const models::Transaction& t) {
+    w.beginObject();
+    w.key("amount"); w.value(t.amount);
+    if (t.asset != models::kDefaultAsset) {
+        w.key("asset"); w.value(t.asset);
     }
-    nlohmann::json data;
-    data["otp"] = *otpOpt;
-    return ApiResponse{true, "OTP generated", data};
+    w.key("description"); w.value(t.description);
+    if (!t.idempotency_key.empty()) {
+        w.key("idempotency_key"); w.value(t.idempotency_key);
+    }
+    w.key("timestamp"); w.value(t.timestamp);
+    w.key("transaction_id"); w.value(t.transaction_id);
+    w.key("type"); w.value(t.type);
+    w.key("wallet_id"); w.value(t.wallet_id);
+    w.endObject();
 }
 
-ApiResponse ApiRouter::completeLogin(const std::string& username, const std::string& otp) {
-    auto tokenOpt = auth::AuthService::completeLogin(username, otp);
-    if (!tokenOpt) {
-        return ApiResponse{false, "Invalid OTP", {}};
+void writeRecord(JsonStreamWriter& w, const models::UserAccount& u) {
+    w.beginObject();
+    w.key("email"); w.value(u.email);
+    w.key("is_admin"); w.value(u.is_admin);
+    w.key("password_hash"); w.value(u.password_hash);
+    w.key("username"); w.value(u.username);
+    w.key("wallet_id"); w.value(u.wallet_id);
+    w.endObject();
+}
+
+ApiResponse streamError(ResponseSink& sink, const std::string& message) {
+    JsonStreamWriter w(sink);
+    w.beginObject();
+    w.key("data"); w.null();
+    w.key("message"); w.value(message);
+    w.key("success"); w.value(false);
+    w.endObject();
+    sink.flush();
+    return ApiResponse{false, message, {}};
+}
+
+// Writes {"data":{"<field>":[ ... ]},"message":...,"success":true} around the records
+template <typename Producer>
+ApiResponse streamList(ResponseSink& sink, const char* field, const std::string& message,
+                       Producer produce) {
+    JsonStreamWriter w(sink);
+    w.beginObject();
+    w.key("data");
+    w.beginObject();
+    w.key(field);
+    w.beginArray();
+    produce(w);
+    w.endArray();
+    w.endObject();
+    w.key("message"); w.value(message);
+    w.key("success"); w.value(true);
+    w.endObject();
+    sink.flush();
+    if (!sink.ok()) return ApiResponse{false, "Response sink failed", {}};
+    return ApiResponse{true, message, {}};
+}
+
+nlohmann::json expiryJson(const std::optional<services::ExpiryReport>& report) {
+    nlohmann::json data;
+    if (report) {
+        data["last_run"] = {
+            {"days", report->days},
+            {"wallets_checked", report->wallets_checked},
+            {"wallets_expired", report->wallets_expired},
+            {"points_expired", report->points_expired},
+            {"failures", report->failures},
+            {"elapsed_ms", report->elapsed_ms}
+        };
     }
+    return data;
+}
+
+nlohmann::json tieringJson(const std::optional<services::TieringReport>& report) {
     nlohmann::json data;
-    data["token"] = *tokenOpt;
-    return ApiResponse{true, "Login successful", data};
+    if (report) {
+        data["last_run"] = {
+            {"scanned", report->scanned},
+            {"archived", report->archived},
+            {"evicted", report->evicted},
+            {"segments_written", report->segments_written},
+            {"hot_bytes_reclaimed", report->hot_bytes_reclaimed},
+            {"hot_disk_bytes_reclaimed", report->hot_disk_bytes_reclaimed},
+            {"archive_bytes_written", report->archive_bytes_written},
+            {"elapsed_ms", report->elapsed_ms}
+        };
+    }
+    auto stats = storage::TransactionArchive::stats();
+    data["archive"] = {
+        {"segments", stats.segments},
+        {"records", stats.records},
+        {"bytes", stats.archive_bytes},
+        {"cold_reads", stats.cold_reads},
+        {"cold_read_us_avg", stats.cold_reads ? stats.cold_read_us_total / stats.cold_reads : 0},
+        {"cold_read_us_max", stats.cold_read_us_max},
+        {"block_cache_hits", stats.block_cache_hits},
+        {"block_cache_misses", stats.block_cache_misses}
+    };
+    return data;
+}
+
+// Serves the storage reads in its scope from the read replica while the replica is within
+// its staleness bound. Tokens are validated before entering the scope, against the leader,
+// so sessions created moments ago are never rejected by a lagging replica.
+class ReplicaRead {
+public:
+    ReplicaRead() {
+        if (auto lag = storage::ReadReplica::usableLagMs()) {
+            lag_ = lag;
+            root_.emplace(storage::ReadReplica::root());
+        }
+    }
+
+    void annotate(nlohmann::json& data) const {
+        if (lag_) data["replication_lag_ms"] = *lag_;
+    }
+
+private:
+    std::optional<int64_t> lag_;
+    std::optional<storage::ScopedDataRoot> root_;
+};
+
+// Token check of the batch being dispatched on this thread, reused by its commands
+struct BatchSession {
+    const std::string* token = nullptr;
+    std::optional<std::string> username;
+};
+
+thread_local BatchSession* currentBatch = nullptr;
+
+class BatchScope {
+public:
+    explicit BatchScope(BatchSession& session) { currentBatch = &session; }
+    ~BatchScope() { currentBatch = nullptr; }
+};
+
+std::optional<std::string> authenticate(const std::string& token) {
+    if (currentBatch && *currentBatch->token == token) return currentBatch->username;
+    return auth::AuthService::validateToken(token);
+}
+
+// After logout the rest of the batch must see the token as invalid
+void endSession(const std::string& token) {
+    if (currentBatch && *currentBatch->token == token) currentBatch->username.reset();
+}
+
+// Response for an idempotency key that was not the request's to run, if it was refused
+std::optional<ApiResponse> idempotencyRefusal(const services::TransactionResult& result) {
+    if (result.conflict) return ApiResponse{false, "Idempotency key was already used for a different request", {}};
+    if (result.in_progress) return ApiResponse{false, "A request with this idempotency key is still running", {}};
+    return std::nullopt;
+}
+
+// Resource usage per endpoint, for spotting endpoints whose cost grows with the data
+struct EndpointUsage {
+    uint64_t calls = 0;
+    storage::ResourceUsage total;
+    storage::ResourceUsage max;
+};
+
+std::mutex usageMutex;
+std::map<std::string, EndpointUsage> endpointUsage;
+std::atomic<bool> usageInResponses{false};
+
+void recordUsage(const char* endpoint, const storage::ResourceUsage& usage) {
+    std::lock_guard<std::mutex> lock(usageMutex);
+    auto& entry = endpointUsage[endpoint];
+    ++entry.calls;
+    entry.total += usage;
+    entry.max.maxWith(usage);
+}
+
+// Common wrapper for every endpoint: opens the request's root span, arena and usage scope,
+// records the call when a trace is being captured, and accounts its resource usage
+template <typename ArgsFn, typename Body>
+ApiResponse instrumented(const char* endpoint, ArgsFn args, Body body) {
+    tracing::RootSpan span("api", endpoint);
+    // Scratch allocations of the request (serialised records) come from one per-thread arena
+    storage::RequestArena arena;
+    storage::UsageScope usage;
+    // Commands of a batch are recorded and accounted as part of the dispatch call
+    if (currentBatch) return body();
+    bool recording = TraceRecorder::enabled();
+    auto wallStart = std::chrono::system_clock::now();
+    auto start = std::chrono::steady_clock::now();
+    ApiResponse response = body();
+    auto latency = std::chrono::steady_clock::now() - start;
+    if (recording) {
+        TraceRecorder::record(endpoint, args(),
+                              std::chrono::duration_cast<std::chrono::microseconds>(
+                                  wallStart.time_since_epoch()).count(),
+                              std::chrono::duration_cast<std::chrono::microseconds>(latency).count(),
+                              response);
+    }
+    const storage::ResourceUsage& totals = usage.totals();
+    recordUsage(endpoint, totals);
+    if (tracing::Tracer::enabled()) span.annotate(nlohmann::json{{"usage", totals}});
+    if (usageInResponses.load(std::memory_order_relaxed) && (response.data.is_object() || response.data.is_null())) {
+        response.data["resource_usage"] = totals;
+    }
+    return response;
+}
+
+} // namespace
+
+ApiResponse ApiRouter::initiateLogin(const std::string& username, const std::string& password,
+                                     const std::string& callerId) {
+    auto args = [&] { return nlohmann::json{{"username", username}, {"password", password}, {"callerId", callerId}}; };
+    return instrumented("initiateLogin", args, [&]() -> ApiResponse {
+        auto otpOpt = auth::AuthService::initiateLogin(username, password, callerId);
+        if (!otpOpt) {
+            return ApiResponse{false, "Invalid credentials", {}};
+        }
+        nlohmann::json data;
+        data["otp"] = *otpOpt;
+        return ApiResponse{true, "OTP generated", data};
+    });
+}
+
+ApiResponse ApiRouter::completeLogin(const std::string& username, const std::string& otp,
+                                     const std::string& callerId) {
+    auto args = [&] { return nlohmann::json{{"username", username}, {"otp", otp}, {"callerId", callerId}}; };
+    return instrumented("completeLogin", args, [&]() -> ApiResponse {
+        auto tokenOpt = auth::AuthService::completeLogin(username, otp, callerId);
+        if (!tokenOpt) {
+            return ApiResponse{false, "Invalid OTP", {}};
+        }
+        nlohmann::json data;
+        data["token"] = *tokenOpt;
+        return ApiResponse{true, "Login successful", data};
+    });
 }
 
 // User endpoints
 ApiResponse ApiRouter::registerUser(const std::string& username,
                                    const std::string& password,
                                    const std::string& email) {
-    bool ok = services::UserService::registerUser(username, password, email);
-    if (!ok) return ApiResponse{false, "Registration failed", {}};
-    return ApiResponse{true, "User registered", {}};
+    auto args = [&] { return nlohmann::json{{"username", username}, {"password", password}, {"email", email}}; };
+    return instrumented("registerUser", args, [&]() -> ApiResponse {
+        bool ok = services::UserService::registerUser(username, password, email);
+        if (!ok) return ApiResponse{false, "Registration failed", {}};
+        return ApiResponse{true, "User registered", {}};
+    });
 }
 
 ApiResponse ApiRouter::getProfile(const std::string& token) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    auto profileOpt = services::UserService::getProfile(*userOpt);
-    if (!profileOpt) return ApiResponse{false, "User not found", {}};
-    nlohmann::json data;
-    data["user"] = *profileOpt;
-    return ApiResponse{true, "Profile fetched", data};
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getProfile", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        ReplicaRead replica;
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt) return ApiResponse{false, "User not found", {}};
+        nlohmann::json data;
+        data["user"] = *profileOpt;
+        replica.annotate(data);
+        return ApiResponse{true, "Profile fetched", data};
+    });
 }
 
 ApiResponse ApiRouter::updateProfile(const std::string& token,
                                     const std::string& email) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    bool ok = services::UserService::updateProfile(*userOpt, email);
-    if (!ok) return ApiResponse{false, "Update failed", {}};
-    return ApiResponse{true, "Profile updated", {}};
+    auto args = [&] { return nlohmann::json{{"token", token}, {"email", email}}; };
+    return instrumented("updateProfile", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        bool ok = services::UserService::updateProfile(*userOpt, email);
+        if (!ok) return ApiResponse{false, "Update failed", {}};
+        return ApiResponse{true, "Profile updated", {}};
+    });
 }
 
 ApiResponse ApiRouter::changePassword(const std::string& token,
                                      const std::string& oldPassword,
                                      const std::string& newPassword) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    bool ok = services::UserService::changePassword(*userOpt, oldPassword, newPassword);
-    if (!ok) return ApiResponse{false, "Change password failed", {}};
-    return ApiResponse{true, "Password changed", {}};
+    auto args = [&] { return nlohmann::json{{"token", token}, {"oldPassword", oldPassword}, {"newPassword", newPassword}}; };
+    return instrumented("changePassword", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        bool ok = services::UserService::changePassword(*userOpt, oldPassword, newPassword);
+        if (!ok) return ApiResponse{false, "Change password failed", {}};
+        return ApiResponse{true, "Password changed", {}};
+    });
 }
 
 ApiResponse ApiRouter::deleteUser(const std::string& token) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    bool ok = services::UserService::deleteUser(*userOpt);
-    if (!ok) return ApiResponse{false, "Delete user failed", {}};
-    auth::AuthService::logout(token);
-    return ApiResponse{true, "User deleted", {}};
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("deleteUser", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        bool ok = services::UserService::deleteUser(*userOpt);
+        if (!ok) return ApiResponse{false, "Delete user failed", {}};
+        auth::AuthService::logout(token);
+        endSession(token);
+        return ApiResponse{true, "User deleted", {}};
+    });
 }
 
 // Wallet endpoints
 ApiResponse ApiRouter::createWallet(const std::string& token) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("createWallet", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
     
-    auto walletOpt = services::WalletService::createWallet(*userOpt);
-    if (!walletOpt) {
-        // Check if user already has a wallet
-        auto user = services::UserService::getProfile(*userOpt);
-        if (user && !user->wallet_id.empty()) {
-            return ApiResponse{false, "Wallet already exists for this user", {}};
-        }
-        return ApiResponse{false, "Failed to create wallet", {}};
-    }
+        auto walletOpt = services::WalletService::createWallet(*userOpt);
+        if (!walletOpt) {
+            // Check if user already has a wallet
+            auto user = services::UserService::getProfile(*userOpt);
+            if (user && !user->wallet_id.empty()) {
+                return ApiResponse{false, "Wallet already exists for this user", {}};
+            }
+            return ApiResponse{false, "Failed to create wallet", {}};
+        }
     
-    nlohmann::json data;
-    data["walletId"] = *walletOpt;
-    return ApiResponse{true, "Wallet created successfully", data};
+        nlohmann::json data;
+        data["walletId"] = *walletOpt;
+        return ApiResponse{true, "Wallet created successfully", data};
+    });
 }
 
 ApiResponse ApiRouter::getWallet(const std::string& token,
                                 const std::string& walletId) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    auto walletOpt = services::WalletService::getWallet(walletId);
-    if (!walletOpt) return ApiResponse{false, "Wallet not found", {}};
-    nlohmann::json data;
-    data["wallet"] = *walletOpt;
-    return ApiResponse{true, "Wallet fetched", data};
+    auto args = [&] { return nlohmann::json{{"token", token}, {"walletId", walletId}}; };
+    return instrumented("getWallet", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        ReplicaRead replica;
+        auto walletOpt = services::WalletService::getWallet(walletId);
+        if (!walletOpt) return ApiResponse{false, "Wallet not found", {}};
+        nlohmann::json data;
+        data["wallet"] = *walletOpt;
+        // Reserved by active holds, per asset; the available balance is the balance less this
+        auto held = services::HoldService::heldBy(walletId);
+        if (!held.empty()) {
+            auto& out = data["held"] = nlohmann::json::object();
+            for (const auto& [asset, amount] : held) out[asset] = amount;
+        }
+        // Credits to a hot wallet not yet folded into its balance
+        auto pending = services::WalletService::pendingCredits(walletId);
+        if (!pending.empty()) {
+            auto& out = data["pending_credits"] = nlohmann::json::object();
+            for (const auto& [asset, amount] : pending) out[asset] = amount;
+        }
+        replica.annotate(data);
+        return ApiResponse{true, "Wallet fetched", data};
+    });
 }
 
 ApiResponse ApiRouter::executeTransaction(const std::string& token,
                                         const std::string& walletId,
                                         double amount,
                                         const std::string& type,
-                                        const std::string& description) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    bool ok = services::WalletService::executeTransaction(walletId, amount, type, description);
-    if (!ok) return ApiResponse{false, "Transaction failed", {}};
-    return ApiResponse{true, "Transaction executed", {}};
+                                        const std::string& description,
+                                        const std::string& idempotencyKey,
+                                        const std::string& asset) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"walletId", walletId}, {"amount", amount}, {"type", type}, {"description", description}, {"idempotencyKey", idempotencyKey}, {"asset", asset}}; };
+    return instrumented("executeTransaction", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        if (!models::validAssetCode(asset)) return ApiResponse{false, "Invalid asset", {}};
+        nlohmann::json audit{{"amount", amount}, {"type", type}, {"description", description}};
+        if (asset != models::kDefaultAsset) audit["asset"] = asset;
+        if (idempotencyKey.empty()) {
+            bool ok = services::WalletService::executeTransaction(walletId, amount, type, description, "", asset);
+            storage::AuditLog::record(*userOpt, "executeTransaction", walletId, ok, audit);
+            if (!ok) return ApiResponse{false, "Transaction failed", {}};
+            return ApiResponse{true, "Transaction executed", {}};
+        }
+        auto result = services::WalletService::executeTransactionIdempotent(walletId, amount, type,
+                                                                            description, idempotencyKey, asset);
+        audit["idempotency_key"] = idempotencyKey;
+        audit["transaction_id"] = result.transaction_id;
+        audit["duplicate"] = result.duplicate;
+        storage::AuditLog::record(*userOpt, "executeTransaction", walletId, result.success, audit);
+        if (auto refused = idempotencyRefusal(result)) return *refused;
+        if (!result.success) return ApiResponse{false, "Transaction failed", {}};
+        nlohmann::json data;
+        data["transaction_id"] = result.transaction_id;
+        data["duplicate"] = result.duplicate;
+        return ApiResponse{true, result.duplicate ? "Transaction already executed" : "Transaction executed", data};
+    });
+}
+
+ApiResponse ApiRouter::transfer(const std::string& token,
+                                const std::string& fromWalletId,
+                                const std::string& toWalletId,
+                                double amount,
+                                const std::string& asset,
+                                const std::string& description,
+                                const std::string& idempotencyKey) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"fromWalletId", fromWalletId}, {"toWalletId", toWalletId}, {"amount", amount}, {"asset", asset}, {"description", description}, {"idempotencyKey", idempotencyKey}}; };
+    return instrumented("transfer", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        if (!models::validAssetCode(asset)) return ApiResponse{false, "Invalid asset", {}};
+        auto result = services::WalletService::transfer(fromWalletId, toWalletId, amount, asset, description,
+                                                        idempotencyKey);
+        nlohmann::json audit{{"to", toWalletId}, {"amount", amount}, {"asset", asset}, {"description", description},
+                             {"transaction_id", result.transaction_id}};
+        if (!idempotencyKey.empty()) audit["idempotency_key"] = idempotencyKey;
+        storage::AuditLog::record(*userOpt, "transfer", fromWalletId, result.success, audit);
+        if (auto refused = idempotencyRefusal(result)) return *refused;
+        if (!result.success) return ApiResponse{false, "Transfer failed", {}};
+        nlohmann::json data;
+        data["transaction_id"] = result.transaction_id;
+        data["duplicate"] = result.duplicate;
+        return ApiResponse{true, result.duplicate ? "Transfer already executed" : "Transfer executed", data};
+    });
+}
+
+ApiResponse ApiRouter::authorizeHold(const std::string& token,
+                                     const std::string& walletId,
+                                     double amount,
+                                     const std::string& asset,
+                                     int64_t ttlSeconds) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"walletId", walletId}, {"amount", amount}, {"asset", asset}, {"ttlSeconds", ttlSeconds}}; };
+    return instrumented("authorizeHold", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        if (!models::validAssetCode(asset)) return ApiResponse{false, "Invalid asset", {}};
+        if (ttlSeconds <= 0 || ttlSeconds > services::HoldService::kMaxTtlSeconds) {
+            return ApiResponse{false, "Invalid hold lifetime", {}};
+        }
+        auto hold = services::HoldService::authorize(walletId, amount, asset, ttlSeconds);
+        nlohmann::json audit{{"amount", amount}, {"asset", asset}, {"ttl_seconds", ttlSeconds}};
+        if (hold) audit["hold_id"] = hold->hold_id;
+        storage::AuditLog::record(*userOpt, "authorizeHold", walletId, hold.has_value(), audit);
+        if (!hold) return ApiResponse{false, "Hold not authorized", {}};
+        nlohmann::json data;
+        data["hold"] = *hold;
+        return ApiResponse{true, "Hold authorized", data};
+    });
+}
+
+ApiResponse ApiRouter::captureHold(const std::string& token,
+                                   const std::string& holdId,
+                                   double amount,
+                                   const std::string& description) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"holdId", holdId}, {"amount", amount}, {"description", description}}; };
+    return instrumented("captureHold", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto hold = services::HoldService::capture(holdId, amount, description);
+        nlohmann::json audit{{"amount", amount}, {"description", description}};
+        if (hold) audit["transaction_id"] = hold->transaction_id;
+        storage::AuditLog::record(*userOpt, "captureHold", holdId, hold.has_value(), audit);
+        if (!hold) return ApiResponse{false, "Hold not captured", {}};
+        nlohmann::json data;
+        data["hold"] = *hold;
+        return ApiResponse{true, "Hold captured", data};
+    });
+}
+
+ApiResponse ApiRouter::releaseHold(const std::string& token, const std::string& holdId) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"holdId", holdId}}; };
+    return instrumented("releaseHold", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto hold = services::HoldService::release(holdId);
+        storage::AuditLog::record(*userOpt, "releaseHold", holdId, hold.has_value());
+        if (!hold) return ApiResponse{false, "Hold not released", {}};
+        nlohmann::json data;
+        data["hold"] = *hold;
+        return ApiResponse{true, "Hold released", data};
+    });
+}
+
+ApiResponse ApiRouter::getHold(const std::string& token, const std::string& holdId) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"holdId", holdId}}; };
+    return instrumented("getHold", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto hold = services::HoldService::get(holdId);
+        if (!hold) return ApiResponse{false, "Hold not found", {}};
+        nlohmann::json data;
+        data["hold"] = *hold;
+        return ApiResponse{true, "Hold fetched", data};
+    });
 }
 
 ApiResponse ApiRouter::getTransactions(const std::string& token,
                                       const std::string& walletId) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    auto list = services::WalletService::getTransactions(walletId);
-    nlohmann::json data;
-    data["transactions"] = list;
-    return ApiResponse{true, "Transactions fetched", data};
+    auto args = [&] { return nlohmann::json{{"token", token}, {"walletId", walletId}}; };
+    return instrumented("getTransactions", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        ReplicaRead replica;
+        auto history = services::WalletService::getHistory(walletId);
+        tracing::Span encode("api", "encode");
+        nlohmann::json data;
+        data["transactions"] = history ? history->transactions : std::vector<models::Transaction>{};
+        if (history) {
+            data["balance"] = history->wallet.balance;
+            data["snapshot_seq"] = history->snapshot_seq;
+        }
+        replica.annotate(data);
+        return ApiResponse{true, "Transactions fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::getLeaderboard(const std::string& token, size_t limit, size_t offset) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"limit", limit}, {"offset", offset}}; };
+    return instrumented("getLeaderboard", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        if (limit == 0 || limit > 1000) return ApiResponse{false, "Limit must be between 1 and 1000", {}};
+        services::Leaderboard::ensureBuilt();
+        nlohmann::json entries = nlohmann::json::array();
+        for (const auto& e : services::Leaderboard::top(limit, offset)) {
+            entries.push_back({{"rank", e.rank}, {"wallet_id", e.wallet_id},
+                               {"owner_username", e.owner_username}, {"balance", e.balance}});
+        }
+        nlohmann::json data;
+        data["entries"] = entries;
+        data["total"] = services::Leaderboard::size();
+        return ApiResponse{true, "Leaderboard fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::getWalletRank(const std::string& token, const std::string& walletId) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"walletId", walletId}}; };
+    return instrumented("getWalletRank", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        services::Leaderboard::ensureBuilt();
+        auto entry = services::Leaderboard::rankOf(walletId);
+        if (!entry) return ApiResponse{false, "Wallet not found", {}};
+        nlohmann::json data;
+        data["rank"] = entry->rank;
+        data["total"] = services::Leaderboard::size();
+        data["wallet_id"] = entry->wallet_id;
+        data["balance"] = entry->balance;
+        return ApiResponse{true, "Wallet rank fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::streamTransactions(const std::string& token,
+                                         const std::string& walletId,
+                                         ResponseSink& sink) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"walletId", walletId}}; };
+    return instrumented("streamTransactions", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return streamError(sink, "Authentication failed");
+        ReplicaRead replica;
+        return streamList(sink, "transactions", "Transactions fetched", [&](JsonStreamWriter& w) {
+            services::WalletService::forEachTransaction(walletId, [&](const models::Transaction& tx) {
+                writeRecord(w, tx);
+            });
+        });
+    });
 }
 
 // Admin endpoints
 ApiResponse ApiRouter::listUsers(const std::string& token) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    auto profileOpt = services::UserService::getProfile(*userOpt);
-    if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
-    auto users = services::AdminService::listAllUsers();
-    nlohmann::json data;
-    data["users"] = users;
-    return ApiResponse{true, "Users fetched", data};
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("listUsers", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        auto users = services::AdminService::listAllUsers();
+        nlohmann::json data;
+        data["users"] = users;
+        return ApiResponse{true, "Users fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::streamUsers(const std::string& token, ResponseSink& sink) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("streamUsers", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return streamError(sink, "Authentication failed");
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return streamError(sink, "Unauthorized");
+        return streamList(sink, "users", "Users fetched", [&](JsonStreamWriter& w) {
+            services::AdminService::forEachUser([&](const models::UserAccount& user) {
+                writeRecord(w, user);
+            });
+        });
+    });
 }
 
 ApiResponse ApiRouter::adminCreateUser(const std::string& token,
@@ -152,38 +633,516 @@ ApiResponse ApiRouter::adminCreateUser(const std::string& token,
                                        const std::string& password,
                                        const std::string& email,
                                        bool isAdmin) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    auto profileOpt = services::UserService::getProfile(*userOpt);
-    if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
-    bool ok = services::AdminService::createUser(username, password, email, isAdmin);
-    if (!ok) return ApiResponse{false, "Admin create user failed", {}};
-    return ApiResponse{true, "User created by admin", {}};
+    auto args = [&] { return nlohmann::json{{"token", token}, {"username", username}, {"password", password}, {"email", email}, {"isAdmin", isAdmin}}; };
+    return instrumented("adminCreateUser", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) {
+            storage::AuditLog::record(*userOpt, "adminCreateUser", username, false, {{"reason", "not an admin"}});
+            return ApiResponse{false, "Unauthorized", {}};
+        }
+        bool ok = services::AdminService::createUser(username, password, email, isAdmin);
+        storage::AuditLog::record(*userOpt, "adminCreateUser", username, ok, {{"email", email}, {"is_admin", isAdmin}});
+        if (!ok) return ApiResponse{false, "Admin create user failed", {}};
+        return ApiResponse{true, "User created by admin", {}};
+    });
 }
 
 ApiResponse ApiRouter::adminUpdateUser(const std::string& token,
                                        const std::string& username,
                                        const std::string& email,
                                        bool isAdmin) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    auto profileOpt = services::UserService::getProfile(*userOpt);
-    if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
-    bool ok = services::AdminService::updateUser(username, email, isAdmin);
-    if (!ok) return ApiResponse{false, "Admin update user failed", {}};
-    return ApiResponse{true, "User updated by admin", {}};
+    auto args = [&] { return nlohmann::json{{"token", token}, {"username", username}, {"email", email}, {"isAdmin", isAdmin}}; };
+    return instrumented("adminUpdateUser", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) {
+            storage::AuditLog::record(*userOpt, "adminUpdateUser", username, false, {{"reason", "not an admin"}});
+            return ApiResponse{false, "Unauthorized", {}};
+        }
+        bool ok = services::AdminService::updateUser(username, email, isAdmin);
+        storage::AuditLog::record(*userOpt, "adminUpdateUser", username, ok, {{"email", email}, {"is_admin", isAdmin}});
+        if (!ok) return ApiResponse{false, "Admin update user failed", {}};
+        return ApiResponse{true, "User updated by admin", {}};
+    });
 }
 
 ApiResponse ApiRouter::adminResetPassword(const std::string& token,
                                           const std::string& username,
                                           const std::string& newPassword) {
-    auto userOpt = auth::AuthService::validateToken(token);
-    if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
-    auto profileOpt = services::UserService::getProfile(*userOpt);
-    if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
-    bool ok = services::AdminService::resetPassword(username, newPassword);
-    if (!ok) return ApiResponse{false, "Admin reset password failed", {}};
-    return ApiResponse{true, "Password reset by admin", {}};
+    auto args = [&] { return nlohmann::json{{"token", token}, {"username", username}, {"newPassword", newPassword}}; };
+    return instrumented("adminResetPassword", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) {
+            storage::AuditLog::record(*userOpt, "adminResetPassword", username, false, {{"reason", "not an admin"}});
+            return ApiResponse{false, "Unauthorized", {}};
+        }
+        bool ok = services::AdminService::resetPassword(username, newPassword);
+        // The new password itself is never logged
+        storage::AuditLog::record(*userOpt, "adminResetPassword", username, ok);
+        if (!ok) return ApiResponse{false, "Admin reset password failed", {}};
+        return ApiResponse{true, "Password reset by admin", {}};
+    });
+}
+
+ApiResponse ApiRouter::getReplicationStatus(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getReplicationStatus", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        nlohmann::json data;
+        data["changelog_enabled"] = storage::ChangeLog::enabled();
+        data["leader_seq"] = storage::ChangeLog::lastSequence();
+        std::string root = storage::ReadReplica::root();
+        data["replica_root"] = root;
+        if (!root.empty()) {
+            if (auto status = storage::ReplicaFollower::readStatus(root)) {
+                data["replica_applied_seq"] = status->applied_seq;
+            }
+            if (auto lag = storage::ReadReplica::lagMs()) data["replication_lag_ms"] = *lag;
+            data["replica_in_use"] = storage::ReadReplica::usableLagMs().has_value();
+        }
+        return ApiResponse{true, "Replication status fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::getStorageLockStats(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getStorageLockStats", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        auto stats = storage::FileManager::lockStats();
+        nlohmann::json data;
+        data["shared_acquired"] = stats.shared_acquired;
+        data["exclusive_acquired"] = stats.exclusive_acquired;
+        data["contended"] = stats.contended;
+        data["wait_us_total"] = stats.wait_us_total;
+        data["wait_us_max"] = stats.wait_us_max;
+        data["io_backend"] = storage::AsyncIO::backend();
+        data["interned_ids"] = models::Id128::internedCount();
+        return ApiResponse{true, "Storage lock stats fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::getAssetTotals(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getAssetTotals", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        services::AssetLedger::ensureBuilt();
+        nlohmann::json assets = nlohmann::json::array();
+        for (const auto& t : services::AssetLedger::totals()) {
+            assets.push_back({{"asset", t.asset}, {"total", t.total}, {"holders", t.holders}});
+        }
+        nlohmann::json data;
+        data["assets"] = std::move(assets);
+        return ApiResponse{true, "Asset totals fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::getResourceUsage(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getResourceUsage", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        nlohmann::json endpoints = nlohmann::json::object();
+        {
+            std::lock_guard<std::mutex> lock(usageMutex);
+            for (const auto& e : endpointUsage) {
+                endpoints[e.first] = {{"calls", e.second.calls}, {"total", e.second.total}, {"max", e.second.max}};
+            }
+        }
+        nlohmann::json data;
+        data["endpoints"] = std::move(endpoints);
+        data["allocation_counting"] = storage::UsageScope::allocationCounting();
+        return ApiResponse{true, "Resource usage fetched", data};
+    });
+}
+
+void ApiRouter::setUsageInResponses(bool on) {
+    usageInResponses.store(on, std::memory_order_relaxed);
+}
+
+ApiResponse ApiRouter::getIndexStatus(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getIndexStatus", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        if (!storage::RecordIndex::loaded()) return ApiResponse{false, "Record index not loaded", {}};
+        auto status = storage::RecordIndex::status();
+        nlohmann::json data;
+        data["source"] = status.source;
+        data["rebuild_reason"] = status.rebuild_reason;
+        data["replayed_changes"] = status.replayed_changes;
+        data["load_ms"] = status.load_ms;
+        data["transactions"] = status.transactions;
+        data["snapshot_ms"] = status.snapshot_ms;
+        return ApiResponse{true, "Index status fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::runTiering(const std::string& token, int coldAfterDays) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"coldAfterDays", coldAfterDays}}; };
+    return instrumented("runTiering", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        if (coldAfterDays < 0) return ApiResponse{false, "Invalid age", {}};
+        auto report = services::TieringService::runOnce(coldAfterDays);
+        return ApiResponse{true, "Tiering pass completed", tieringJson(report)};
+    });
+}
+
+ApiResponse ApiRouter::getTieringStats(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getTieringStats", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        return ApiResponse{true, "Tiering stats fetched", tieringJson(services::TieringService::lastReport())};
+    });
+}
+
+ApiResponse ApiRouter::runPointExpiry(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("runPointExpiry", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        auto report = services::ExpiryService::runDue();
+        return ApiResponse{true, "Point expiry completed", expiryJson(report)};
+    });
+}
+
+ApiResponse ApiRouter::getPointExpiryStats(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getPointExpiryStats", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        return ApiResponse{true, "Point expiry stats fetched", expiryJson(services::ExpiryService::lastReport())};
+    });
+}
+
+ApiResponse ApiRouter::getEventFeedStats(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getEventFeedStats", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        auto stats = services::EventFeed::stats();
+        nlohmann::json data;
+        data["published"] = stats.published;
+        data["subscribers"] = stats.subscribers;
+        data["dropped"] = stats.dropped;
+        data["spilled"] = stats.spilled;
+        data["producer_waits"] = stats.producer_waits;
+        data["block_timeouts"] = stats.block_timeouts;
+        return ApiResponse{true, "Event feed stats fetched", data};
+    });
+}
+
+ApiResponse ApiRouter::verifyAuditLog(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("verifyAuditLog", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        bool flushed = storage::AuditLog::flush();
+        auto report = storage::AuditLog::verify();
+        auto stats = storage::AuditLog::stats();
+        nlohmann::json data;
+        data["ok"] = report.ok;
+        data["entries"] = report.entries;
+        data["first_bad_seq"] = report.first_bad_seq;
+        data["error"] = report.error;
+        data["head_hash"] = report.head_hash;
+        data["elapsed_ms"] = report.elapsed_ms;
+        data["writer"] = {
+            {"recorded", stats.recorded},
+            {"written", stats.written},
+            {"batches", stats.batches},
+            {"fsyncs", stats.fsyncs},
+            {"queue_full_waits", stats.queue_full_waits},
+            {"write_failures", stats.write_failures},
+            {"torn_tails", stats.torn_tails},
+            {"failing", stats.failing}
+        };
+        if (!flushed) {
+            return ApiResponse{false, "Audit log writes are failing; queued entries are not yet durable", data};
+        }
+        return ApiResponse{report.ok, report.ok ? "Audit log intact" : "Audit log broken", data};
+    });
+}
+
+ApiResponse ApiRouter::getRateLimitStats(const std::string& token) {
+    auto args = [&] { return nlohmann::json{{"token", token}}; };
+    return instrumented("getRateLimitStats", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        auto stats = auth::AuthService::rateLimitStats();
+        auto toJson = [](const auth::RateLimiter::Stats& s) {
+            return nlohmann::json{
+                {"allowed", s.allowed},
+                {"rejected", s.rejected},
+                {"evicted", s.evicted},
+                {"overflowed", s.overflowed}
+            };
+        };
+        nlohmann::json data;
+        data["login_by_user"] = toJson(stats.loginByUser);
+        data["login_by_caller"] = toJson(stats.loginByCaller);
+        data["otp_by_user"] = toJson(stats.otpByUser);
+        data["otp_by_caller"] = toJson(stats.otpByCaller);
+        return ApiResponse{true, "Rate limit stats fetched", data};
+    });
+}
+
+// Campaign endpoints
+ApiResponse ApiRouter::createCampaign(const std::string& token,
+                                      const nlohmann::json& rule) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"rule", rule}}; };
+    return instrumented("createCampaign", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        models::Campaign campaign;
+        try {
+            nlohmann::json j = rule;
+            if (!j.contains("campaign_id")) j["campaign_id"] = "";
+            j["status"] = "pending";
+            campaign = j.get<models::Campaign>();
+        } catch (...) {
+            return ApiResponse{false, "Invalid campaign rule", {}};
+        }
+        auto createdOpt = services::CampaignService::createCampaign(campaign);
+        if (!createdOpt) return ApiResponse{false, "Create campaign failed", {}};
+        nlohmann::json data;
+        data["campaign"] = *createdOpt;
+        return ApiResponse{true, "Campaign created", data};
+    });
+}
+
+ApiResponse ApiRouter::runCampaign(const std::string& token,
+                                   const std::string& campaignId) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"campaignId", campaignId}}; };
+    return instrumented("runCampaign", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        auto campaignOpt = services::CampaignService::runCampaign(campaignId);
+        if (!campaignOpt) return ApiResponse{false, "Campaign not found or already running", {}};
+        nlohmann::json data;
+        data["campaign"] = *campaignOpt;
+        return ApiResponse{true, "Campaign " + campaignOpt->status, data};
+    });
+}
+
+ApiResponse ApiRouter::getCampaign(const std::string& token,
+                                   const std::string& campaignId) {
+    auto args = [&] { return nlohmann::json{{"token", token}, {"campaignId", campaignId}}; };
+    return instrumented("getCampaign", args, [&]() -> ApiResponse {
+        auto userOpt = authenticate(token);
+        if (!userOpt) return ApiResponse{false, "Authentication failed", {}};
+        auto profileOpt = services::UserService::getProfile(*userOpt);
+        if (!profileOpt || !profileOpt->is_admin) return ApiResponse{false, "Unauthorized", {}};
+        auto campaignOpt = services::CampaignService::getCampaign(campaignId);
+        if (!campaignOpt) return ApiResponse{false, "Campaign not found", {}};
+        nlohmann::json data;
+        data["campaign"] = *campaignOpt;
+        return ApiResponse{true, "Campaign fetched", data};
+    });
+}
+
+// Batched dispatch
+namespace {
+
+using OpHandler = ApiResponse (*)(const std::string& token, const nlohmann::json& args);
+
+struct OpEntry {
+    ApiOp op;
+    const char* name;
+    OpHandler handler;
+};
+
+std::string str(const nlohmann::json& a, const char* key) {
+    return a.at(key).get<std::string>();
+}
+
+// Indexed by op code; argument names match the endpoint parameters, as in ApiTrace
+constexpr OpEntry kOps[] = {
+    {ApiOp::GetProfile, "getProfile",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getProfile(t); }},
+    {ApiOp::UpdateProfile, "updateProfile",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::updateProfile(t, str(a, "email")); }},
+    {ApiOp::ChangePassword, "changePassword",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::changePassword(t, str(a, "oldPassword"), str(a, "newPassword"));
+     }},
+    {ApiOp::DeleteUser, "deleteUser",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::deleteUser(t); }},
+    {ApiOp::CreateWallet, "createWallet",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::createWallet(t); }},
+    {ApiOp::GetWallet, "getWallet",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::getWallet(t, str(a, "walletId")); }},
+    {ApiOp::ExecuteTransaction, "executeTransaction",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::executeTransaction(t, str(a, "walletId"), a.at("amount").get<double>(), str(a, "type"),
+                                              str(a, "description"), a.value("idempotencyKey", ""),
+                                              a.value("asset", models::kDefaultAsset));
+     }},
+    {ApiOp::Transfer, "transfer",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::transfer(t, str(a, "fromWalletId"), str(a, "toWalletId"), a.at("amount").get<double>(),
+                                    str(a, "asset"), str(a, "description"), a.value("idempotencyKey", ""));
+     }},
+    {ApiOp::AuthorizeHold, "authorizeHold",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::authorizeHold(t, str(a, "walletId"), a.at("amount").get<double>(),
+                                         a.value("asset", models::kDefaultAsset),
+                                         a.value("ttlSeconds", services::HoldService::kDefaultTtlSeconds));
+     }},
+    {ApiOp::CaptureHold, "captureHold",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::captureHold(t, str(a, "holdId"), a.value("amount", 0.0), str(a, "description"));
+     }},
+    {ApiOp::ReleaseHold, "releaseHold",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::releaseHold(t, str(a, "holdId")); }},
+    {ApiOp::GetHold, "getHold",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::getHold(t, str(a, "holdId")); }},
+    {ApiOp::GetTransactions, "getTransactions",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::getTransactions(t, str(a, "walletId")); }},
+    {ApiOp::GetLeaderboard, "getLeaderboard",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::getLeaderboard(t, a.at("limit").get<size_t>(), a.value("offset", size_t(0)));
+     }},
+    {ApiOp::GetWalletRank, "getWalletRank",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::getWalletRank(t, str(a, "walletId")); }},
+    {ApiOp::ListUsers, "listUsers",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::listUsers(t); }},
+    {ApiOp::AdminCreateUser, "adminCreateUser",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::adminCreateUser(t, str(a, "username"), str(a, "password"), str(a, "email"),
+                                           a.at("isAdmin").get<bool>());
+     }},
+    {ApiOp::AdminUpdateUser, "adminUpdateUser",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::adminUpdateUser(t, str(a, "username"), str(a, "email"), a.at("isAdmin").get<bool>());
+     }},
+    {ApiOp::AdminResetPassword, "adminResetPassword",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::adminResetPassword(t, str(a, "username"), str(a, "newPassword"));
+     }},
+    {ApiOp::GetRateLimitStats, "getRateLimitStats",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getRateLimitStats(t); }},
+    {ApiOp::GetReplicationStatus, "getReplicationStatus",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getReplicationStatus(t); }},
+    {ApiOp::GetStorageLockStats, "getStorageLockStats",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getStorageLockStats(t); }},
+    {ApiOp::GetResourceUsage, "getResourceUsage",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getResourceUsage(t); }},
+    {ApiOp::GetAssetTotals, "getAssetTotals",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getAssetTotals(t); }},
+    {ApiOp::GetIndexStatus, "getIndexStatus",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getIndexStatus(t); }},
+    {ApiOp::RunTiering, "runTiering",
+     [](const std::string& t, const nlohmann::json& a) {
+         return ApiRouter::runTiering(t, a.at("coldAfterDays").get<int>());
+     }},
+    {ApiOp::GetTieringStats, "getTieringStats",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getTieringStats(t); }},
+    {ApiOp::RunPointExpiry, "runPointExpiry",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::runPointExpiry(t); }},
+    {ApiOp::GetPointExpiryStats, "getPointExpiryStats",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getPointExpiryStats(t); }},
+    {ApiOp::GetEventFeedStats, "getEventFeedStats",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::getEventFeedStats(t); }},
+    {ApiOp::VerifyAuditLog, "verifyAuditLog",
+     [](const std::string& t, const nlohmann::json&) { return ApiRouter::verifyAuditLog(t); }},
+    {ApiOp::CreateCampaign, "createCampaign",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::createCampaign(t, a.at("rule")); }},
+    {ApiOp::RunCampaign, "runCampaign",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::runCampaign(t, str(a, "campaignId")); }},
+    {ApiOp::GetCampaign, "getCampaign",
+     [](const std::string& t, const nlohmann::json& a) { return ApiRouter::getCampaign(t, str(a, "campaignId")); }},
+};
+
+constexpr bool opsInOrder() {
+    for (size_t i = 0; i < std::size(kOps); ++i) {
+        if (static_cast<size_t>(kOps[i].op) != i) return false;
+    }
+    return true;
+}
+
+static_assert(std::size(kOps) == static_cast<size_t>(ApiOp::Count), "every ApiOp needs a handler");
+static_assert(opsInOrder(), "kOps must follow ApiOp declaration order");
+
+} // namespace
+
+const char* ApiRouter::opName(ApiOp op) {
+    size_t i = static_cast<size_t>(op);
+    return i < std::size(kOps) ? kOps[i].name : "";
+}
+
+std::optional<ApiOp> ApiRouter::opFromName(std::string_view name) {
+    for (const auto& entry : kOps) {
+        if (name == entry.name) return entry.op;
+    }
+    return std::nullopt;
+}
+
+ApiResponse ApiRouter::dispatch(const std::string& token, const std::vector<ApiCommand>& commands) {
+    auto args = [&] {
+        nlohmann::json list = nlohmann::json::array();
+        for (const auto& c : commands) list.push_back({{"op", opName(c.op)}, {"args", c.args}});
+        return nlohmann::json{{"token", token}, {"commands", list}};
+    };
+    return instrumented("dispatch", args, [&]() -> ApiResponse {
+        if (commands.size() > kMaxBatch) return ApiResponse{false, "Too many commands in batch", {}};
+        BatchSession session{&token, auth::AuthService::validateToken(token)};
+        if (!session.username) return ApiResponse{false, "Authentication failed", {}};
+        BatchScope scope(session);
+        nlohmann::json results = nlohmann::json::array();
+        for (const auto& command : commands) {
+            ApiResponse result{false, "Unknown op", {}};
+            size_t i = static_cast<size_t>(command.op);
+            if (i < std::size(kOps)) {
+                try {
+                    result = kOps[i].handler(token, command.args);
+                } catch (const nlohmann::json::exception&) {
+                    result = ApiResponse{false, "Malformed arguments", {}};
+                }
+            }
+            results.push_back({{"success", result.success}, {"message", result.message}, {"data", result.data}});
+        }
+        nlohmann::json data;
+        data["results"] = std::move(results);
+        return ApiResponse{true, "Batch executed", data};
+    });
 }
 
-} // namespace api 
\ No newline at end of file
+} // namespace api
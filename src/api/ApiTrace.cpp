@@ -0,0 +1,246 @@
+/*
+ * ApiTrace.cpp
+ *
+ * Implements the ApiRouter call recorder, the trace reader and the replay dispatcher
+ * used by the CLI's scripted replay mode.
+ */
+
+#include "api/ApiTrace.h"
+#include "api/ApiRouter.h"
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace api {
+
+namespace {
+
+std::atomic<bool> recording{false};
+std::mutex recorderMutex;
+std::ofstream traceOut;
+
+// Response fields that carry generated identifiers later calls may refer to
+const char* const kIdFields[] = {"otp", "token", "walletId", "transaction_id"};
+
+// Credentials never reach the trace. Passwords and OTPs become aliases numbered per
+// recording, so equal values stay equal; session tokens become their digest.
+const char* const kSecretFields[] = {"password", "oldPassword", "newPassword", "otp"};
+const char* const kTokenFields[] = {"token"};
+
+// Alias number by digest of the secret; guarded by recorderMutex and cleared per recording
+std::unordered_map<std::string, size_t> secretAliases;
+
+std::string digestOf(const std::string& value) {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(value.data()), value.size(), hash);
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0');
+    for (int i = 0; i < 16; ++i) {
+        oss << std::setw(2) << static_cast<int>(hash[i]);
+    }
+    return oss.str();
+}
+
+// Requires recorderMutex
+std::string aliasFor(const std::string& secret) {
+    auto it = secretAliases.emplace(digestOf(secret), secretAliases.size() + 1).first;
+    return "secret:" + std::to_string(it->second);
+}
+
+bool isOneOf(const std::string& key, const char* const* first, const char* const* last) {
+    return std::find_if(first, last, [&](const char* field) { return key == field; }) != last;
+}
+
+// Replaces credential fields at any depth (batched commands nest their arguments);
+// requires recorderMutex
+void redact(nlohmann::json& value) {
+    if (value.is_array()) {
+        for (auto& item : value) redact(item);
+        return;
+    }
+    if (!value.is_object()) return;
+    for (auto it = value.begin(); it != value.end(); ++it) {
+        if (it->is_string() && isOneOf(it.key(), std::begin(kSecretFields), std::end(kSecretFields))) {
+            *it = aliasFor(it->get<std::string>());
+        } else if (it->is_string() && isOneOf(it.key(), std::begin(kTokenFields), std::end(kTokenFields))) {
+            if (!it->get_ref<const std::string&>().empty()) *it = traceTokenFor(it->get<std::string>());
+        } else {
+            redact(*it);
+        }
+    }
+}
+
+} // namespace
+
+std::string traceTokenFor(const std::string& token) {
+    return "token:" + digestOf(token);
+}
+
+bool TraceRecorder::start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(recorderMutex);
+    if (traceOut.is_open()) traceOut.close();
+    traceOut.open(path, std::ios::binary | std::ios::trunc);
+    if (!traceOut) return false;
+    secretAliases.clear();
+    recording.store(true, std::memory_order_release);
+    return true;
+}
+
+void TraceRecorder::stop() {
+    std::lock_guard<std::mutex> lock(recorderMutex);
+    recording.store(false, std::memory_order_release);
+    if (traceOut.is_open()) traceOut.close();
+    secretAliases.clear();
+}
+
+bool TraceRecorder::enabled() {
+    return recording.load(std::memory_order_acquire);
+}
+
+void TraceRecorder::record(const std::string& endpoint, const nlohmann::json& args,
+                           int64_t timestampUs, int64_t latencyUs, const ApiResponse& response) {
+    nlohmann::json j;
+    j["e"] = endpoint;
+    j["a"] = args;
+    j["t"] = timestampUs;
+    j["l"] = latencyUs;
+    j["s"] = response.success;
+    j["m"] = response.message;
+    nlohmann::json ids = nlohmann::json::object();
+    if (response.data.is_object()) {
+        for (const char* field : kIdFields) {
+            auto it = response.data.find(field);
+            if (it != response.data.end() && it->is_string()) ids[field] = *it;
+        }
+    }
+    j["d"] = ids;
+
+    std::lock_guard<std::mutex> lock(recorderMutex);
+    if (!traceOut.is_open()) return;
+    redact(j["a"]);
+    redact(j["d"]);
+    std::vector<std::uint8_t> bytes = nlohmann::json::to_msgpack(j);
+    std::uint32_t size = static_cast<std::uint32_t>(bytes.size());
+    unsigned char prefix[4] = {
+        static_cast<unsigned char>(size), static_cast<unsigned char>(size >> 8),
+        static_cast<unsigned char>(size >> 16), static_cast<unsigned char>(size >> 24)};
+    traceOut.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+    traceOut.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+TraceReader::TraceReader(const std::string& path) : in_(path, std::ios::binary) {}
+
+bool TraceReader::next(TraceEntry& entry) {
+    unsigned char prefix[4];
+    if (!in_.read(reinterpret_cast<char*>(prefix), sizeof(prefix))) return false;
+    std::uint32_t size = prefix[0] | (prefix[1] << 8) | (prefix[2] << 16) |
+                         (static_cast<std::uint32_t>(prefix[3]) << 24);
+    std::vector<std::uint8_t> bytes(size);
+    if (!in_.read(reinterpret_cast<char*>(bytes.data()), size)) return false;
+    try {
+        nlohmann::json j = nlohmann::json::from_msgpack(bytes);
+        entry.endpoint = j.at("e").get<std::string>();
+        entry.args = j.at("a");
+        entry.timestamp_us = j.at("t").get<int64_t>();
+        entry.latency_us = j.at("l").get<int64_t>();
+        entry.success = j.at("s").get<bool>();
+        entry.message = j.at("m").get<std::string>();
+        entry.ids = j.at("d");
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+ApiResponse replayCall(const std::string& endpoint, const nlohmann::json& a) {
+    try {
+        auto s = [&](const char* key) { return a.at(key).get<std::string>(); };
+        if (endpoint == "initiateLogin") return ApiRouter::initiateLogin(s("username"), s("password"), s("callerId"));
+        if (endpoint == "completeLogin") return ApiRouter::completeLogin(s("username"), s("otp"), s("callerId"));
+        if (endpoint == "registerUser") return ApiRouter::registerUser(s("username"), s("password"), s("email"));
+        if (endpoint == "getProfile") return ApiRouter::getProfile(s("token"));
+        if (endpoint == "updateProfile") return ApiRouter::updateProfile(s("token"), s("email"));
+        if (endpoint == "changePassword") {
+            return ApiRouter::changePassword(s("token"), s("oldPassword"), s("newPassword"));
+        }
+        if (endpoint == "deleteUser") return ApiRouter::deleteUser(s("token"));
+        if (endpoint == "createWallet") return ApiRouter::createWallet(s("token"));
+        if (endpoint == "getWallet") return ApiRouter::getWallet(s("token"), s("walletId"));
+        if (endpoint == "executeTransaction") {
+            return ApiRouter::executeTransaction(s("token"), s("walletId"), a.at("amount").get<double>(),
+                                                 s("type"), s("description"), s("idempotencyKey"),
+                                                 a.value("asset", models::kDefaultAsset));
+        }
+        if (endpoint == "transfer") {
+            return ApiRouter::transfer(s("token"), s("fromWalletId"), s("toWalletId"), a.at("amount").get<double>(),
+                                       s("asset"), s("description"), s("idempotencyKey"));
+        }
+        if (endpoint == "authorizeHold") {
+            return ApiRouter::authorizeHold(s("token"), s("walletId"), a.at("amount").get<double>(), s("asset"),
+                                            a.at("ttlSeconds").get<int64_t>());
+        }
+        if (endpoint == "captureHold") {
+            return ApiRouter::captureHold(s("token"), s("holdId"), a.at("amount").get<double>(), s("description"));
+        }
+        if (endpoint == "releaseHold") return ApiRouter::releaseHold(s("token"), s("holdId"));
+        if (endpoint == "getHold") return ApiRouter::getHold(s("token"), s("holdId"));
+        if (endpoint == "getTransactions") return ApiRouter::getTransactions(s("token"), s("walletId"));
+        if (endpoint == "getLeaderboard") {
+            return ApiRouter::getLeaderboard(s("token"), a.at("limit").get<size_t>(), a.at("offset").get<size_t>());
+        }
+        if (endpoint == "getWalletRank") return ApiRouter::getWalletRank(s("token"), s("walletId"));
+        if (endpoint == "listUsers") return ApiRouter::listUsers(s("token"));
+        if (endpoint == "streamTransactions" || endpoint == "streamUsers") {
+            // Replayed into a sink that discards the payload
+            ChunkedBufferSink sink([](const char*, size_t) { return true; });
+            if (endpoint == "streamUsers") return ApiRouter::streamUsers(s("token"), sink);
+            return ApiRouter::streamTransactions(s("token"), s("walletId"), sink);
+        }
+        if (endpoint == "adminCreateUser") {
+            return ApiRouter::adminCreateUser(s("token"), s("username"), s("password"), s("email"),
+                                              a.at("isAdmin").get<bool>());
+        }
+        if (endpoint == "adminUpdateUser") {
+            return ApiRouter::adminUpdateUser(s("token"), s("username"), s("email"), a.at("isAdmin").get<bool>());
+        }
+        if (endpoint == "adminResetPassword") {
+            return ApiRouter::adminResetPassword(s("token"), s("username"), s("newPassword"));
+        }
+        if (endpoint == "getReplicationStatus") return ApiRouter::getReplicationStatus(s("token"));
+        if (endpoint == "getStorageLockStats") return ApiRouter::getStorageLockStats(s("token"));
+        if (endpoint == "getAssetTotals") return ApiRouter::getAssetTotals(s("token"));
+        if (endpoint == "getResourceUsage") return ApiRouter::getResourceUsage(s("token"));
+        if (endpoint == "getIndexStatus") return ApiRouter::getIndexStatus(s("token"));
+        if (endpoint == "runTiering") return ApiRouter::runTiering(s("token"), a.at("coldAfterDays").get<int>());
+        if (endpoint == "getTieringStats") return ApiRouter::getTieringStats(s("token"));
+        if (endpoint == "runPointExpiry") return ApiRouter::runPointExpiry(s("token"));
+        if (endpoint == "getPointExpiryStats") return ApiRouter::getPointExpiryStats(s("token"));
+        if (endpoint == "getEventFeedStats") return ApiRouter::getEventFeedStats(s("token"));
+        if (endpoint == "verifyAuditLog") return ApiRouter::verifyAuditLog(s("token"));
+        if (endpoint == "getRateLimitStats") return ApiRouter::getRateLimitStats(s("token"));
+        if (endpoint == "createCampaign") return ApiRouter::createCampaign(s("token"), a.at("rule"));
+        if (endpoint == "runCampaign") return ApiRouter::runCampaign(s("token"), s("campaignId"));
+        if (endpoint == "getCampaign") return ApiRouter::getCampaign(s("token"), s("campaignId"));
+        if (endpoint == "dispatch") {
+            std::vector<ApiCommand> commands;
+            for (const auto& c : a.at("commands")) {
+                auto op = ApiRouter::opFromName(c.at("op").get<std::string>());
+                if (!op) return ApiResponse{false, "Unknown op in trace", {}};
+                commands.push_back(ApiCommand{*op, c.at("args")});
+            }
+            return ApiRouter::dispatch(s("token"), commands);
+        }
+    } catch (...) {
+        return ApiResponse{false, "Malformed trace arguments", {}};
+    }
+    return ApiResponse{false, "Unknown endpoint", {}};
+}
+
+} // namespace api
@@ -0,0 +1,110 @@
+#include "api/JsonStreamWriter.h"
+
+#include <charconv>
+#include <cmath>
+
+#include <nlohmann/json.hpp>
+
+namespace api {
+
+void JsonStreamWriter::separate() {
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    if (first_.empty()) return;
+    if (first_.back()) {
+        first_.back() = false;
+    } else {
+        sink_.put(',');
+    }
+}
+
+void JsonStreamWriter::beginObject() {
+    separate();
+    sink_.put('{');
+    first_.push_back(true);
+}
+
+void JsonStreamWriter::endObject() {
+    sink_.put('}');
+    first_.pop_back();
+}
+
+void JsonStreamWriter::beginArray() {
+    separate();
+    sink_.put('[');
+    first_.push_back(true);
+}
+
+void JsonStreamWriter::endArray() {
+    sink_.put(']');
+    first_.pop_back();
+}
+
+void JsonStreamWriter::key(std::string_view name) {
+    value(name);
+    sink_.put(':');
+    afterKey_ = true;
+}
+
+void JsonStreamWriter::value(std::string_view s) {
+    static const char* hex = "0123456789abcdef";
+    separate();
+    sink_.put('"');
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        // Copy the clean run in one go, then the escape
+        sink_.write(s.substr(run, i - run));
+        run = i + 1;
+        switch (c) {
+            case '"': sink_.write("\\\""); break;
+            case '\\': sink_.write("\\\\"); break;
+            case '\b': sink_.write("\\b"); break;
+            case '\f': sink_.write("\\f"); break;
+            case '\n': sink_.write("\\n"); break;
+            case '\r': sink_.write("\\r"); break;
+            case '\t': sink_.write("\\t"); break;
+            default: {
+                char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                sink_.write(std::string_view(esc, sizeof(esc)));
+            }
+        }
+    }
+    sink_.write(s.substr(run));
+    sink_.put('"');
+}
+
+void JsonStreamWriter::value(double d) {
+    separate();
+    if (!std::isfinite(d)) {
+        sink_.write("null");
+        return;
+    }
+    // The formatter dump() uses, so the switch between plain and exponent notation and the
+    // trailing ".0" on integral values match byte for byte
+    char buf[64];
+    char* end = nlohmann::detail::to_chars(buf, buf + sizeof(buf), d);
+    sink_.write(std::string_view(buf, static_cast<size_t>(end - buf)));
+}
+
+void JsonStreamWriter::value(long long n) {
+    separate();
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), n);
+    sink_.write(std::string_view(buf, static_cast<size_t>(res.ptr - buf)));
+}
+
+void JsonStreamWriter::value(bool b) {
+    separate();
+    sink_.write(b ? "true" : "false");
+}
+
+void JsonStreamWriter::null() {
+    separate();
+    sink_.write("null");
+}
+
+} // namespace api
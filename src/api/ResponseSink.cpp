@@ -0,0 +1,66 @@
+#include "api/ResponseSink.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+namespace api {
+
+ResponseSink::ResponseSink(size_t chunkSize) : chunkSize_(chunkSize == 0 ? 1 : chunkSize) {
+    buffer_.reserve(chunkSize_);
+}
+
+void ResponseSink::write(std::string_view bytes) {
+    while (!bytes.empty()) {
+        size_t room = chunkSize_ - buffer_.size();
+        size_t n = bytes.size() < room ? bytes.size() : room;
+        buffer_.append(bytes.data(), n);
+        bytes.remove_prefix(n);
+        if (buffer_.size() == chunkSize_) flush();
+    }
+}
+
+void ResponseSink::put(char c) {
+    buffer_.push_back(c);
+    if (buffer_.size() == chunkSize_) flush();
+}
+
+void ResponseSink::flush() {
+    if (buffer_.empty()) return;
+    if (ok_) {
+        ok_ = emit(buffer_.data(), buffer_.size());
+        if (ok_) written_ += buffer_.size();
+    }
+    buffer_.clear();
+}
+
+ChunkedBufferSink::ChunkedBufferSink(ChunkHandler handler, size_t chunkSize)
+    : ResponseSink(chunkSize), handler_(std::move(handler)) {}
+
+ChunkedBufferSink::~ChunkedBufferSink() {
+    flush();
+}
+
+bool ChunkedBufferSink::emit(const char* data, size_t size) {
+    return handler_(data, size);
+}
+
+FdSink::FdSink(int fd, size_t chunkSize) : ResponseSink(chunkSize), fd_(fd) {}
+
+FdSink::~FdSink() {
+    flush();
+}
+
+bool FdSink::emit(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd_, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace api
@@ -9,6 +9,7 @@
 #include "storage/FileManager.h"
 #include "storage/UserStorage.h"
 #include "services/OTPService.h"
+#include "tracing/Tracer.h"
 
 #include <nlohmann/json.hpp>
 #include <openssl/sha.h>
@@ -22,6 +23,37 @@
 
 namespace auth {
 
+namespace {
+
+// Limits are checked before any storage access so bursts never reach the disk
+RateLimiter& loginUserLimiter() {
+    static RateLimiter limiter(5, 5.0 / 60);
+    return limiter;
+}
+
+RateLimiter& loginCallerLimiter() {
+    static RateLimiter limiter(20, 2);
+    return limiter;
+}
+
+RateLimiter& otpUserLimiter() {
+    static RateLimiter limiter(5, 1.0 / 30);
+    return limiter;
+}
+
+RateLimiter& otpCallerLimiter() {
+    static RateLimiter limiter(20, 2);
+    return limiter;
+}
+
+bool allow(RateLimiter& byCaller, RateLimiter& byUser,
+           const std::string& callerId, const std::string& username) {
+    if (!callerId.empty() && !byCaller.tryAcquire(callerId)) return false;
+    return byUser.tryAcquire(username);
+}
+
+} // namespace
+
 std::string AuthService::hashPassword(const std::string& password) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
     SHA256(reinterpret_cast<const unsigned char*>(password.c_str()), password.size(), hash);
@@ -37,7 +69,9 @@ bool AuthService::verifyPassword(const std::string& password, const std::string&
     return hashPassword(password) == hash;
 }
 
-std::optional<std::string> AuthService::initiateLogin(const std::string& username, const std::string& password) {
+std::optional<std::string> AuthService::initiateLogin(const std::string& username, const std::string& password,
+                                                      const std::string& callerId) {
+    if (!allow(loginCallerLimiter(), loginUserLimiter(), callerId, username)) return std::nullopt;
     auto userOpt = storage::UserStorage::load(username);
     if (!userOpt) return std::nullopt;
     const auto& user = *userOpt;
@@ -47,7 +81,9 @@ std::optional<std::string> AuthService::initiateLogin(const std::string& usernam
     return services::OTPService::generateOTP(username);
 }
 
-std::optional<std::string> AuthService::completeLogin(const std::string& username, const std::string& otp) {
+std::optional<std::string> AuthService::completeLogin(const std::string& username, const std::string& otp,
+                                                      const std::string& callerId) {
+    if (!allow(otpCallerLimiter(), otpUserLimiter(), callerId, username)) return std::nullopt;
     if (!services::OTPService::validateOTP(username, otp)) return std::nullopt;
 
     // Generate session token
@@ -75,6 +111,7 @@ std::optional<std::string> AuthService::completeLogin(const std::string& usernam
 }
 
 std::optional<std::string> AuthService::validateToken(const std::string& token) {
+    tracing::Span span("auth", "AuthService::validateToken");
     std::string path = "data/sessions/" + token + ".json";
     nlohmann::json j;
     if (!storage::FileManager::readJson(path, j)) return std::nullopt;
@@ -83,8 +120,7 @@ std::optional<std::string> AuthService::validateToken(const std::string& token)
         long long now = std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::system_clock::now().time_since_epoch()).count();
         if (now > expiry_ts) {
-            std::error_code ec;
-            std::filesystem::remove(path, ec);
+            storage::FileManager::removeFile(path);
             return std::nullopt;
         }
         return j.at("username").get<std::string>();
@@ -93,10 +129,14 @@ std::optional<std::string> AuthService::validateToken(const std::string& token)
     }
 }
 
+LoginRateLimitStats AuthService::rateLimitStats() {
+    return LoginRateLimitStats{loginUserLimiter().stats(), loginCallerLimiter().stats(),
+                               otpUserLimiter().stats(), otpCallerLimiter().stats()};
+}
+
 bool AuthService::logout(const std::string& token) {
     std::string path = "data/sessions/" + token + ".json";
-    std::error_code ec;
-    return std::filesystem::remove(path, ec);
+    return storage::FileManager::removeFile(path);
 }
 
 } // namespace auth 
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "auth/RateLimiter.h"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+namespace auth {
+
+namespace {
+
+constexpr uint64_t kTokenBits = 24;
+constexpr uint64_t kTokenMask = (uint64_t{1} << kTokenBits) - 1;
+constexpr uint64_t kMilli = 1000;
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(double capacity, double refillPerSecond, size_t slots)
+    : start_(std::chrono::steady_clock::now()) {
+    capacityMilli_ = std::clamp<uint64_t>(static_cast<uint64_t>(capacity * kMilli), kMilli, kTokenMask);
+    refillMilliPerMs_ = std::max(refillPerSecond, 1e-6);
+    // A bucket idle for this long has refilled completely, so forgetting it changes nothing
+    idleMs_ = static_cast<uint64_t>(capacityMilli_ / refillMilliPerMs_) + 1;
+    slotsPerShard_ = std::max(kProbe, slots / kShards);
+    slots_.reset(new Slot[slotsPerShard_ * kShards]);
+    std::random_device rd;
+    seed_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+uint64_t RateLimiter::hashKey(const std::string& key) const {
+    // Seeded so callers cannot aim many keys at one probe window
+    uint64_t h = mix64(std::hash<std::string>{}(key) ^ seed_);
+    return h == 0 ? 1 : h;
+}
+
+uint64_t RateLimiter::nowMs() const {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) + 1;
+}
+
+bool RateLimiter::consume(Slot& slot, uint64_t now) {
+    uint64_t state = slot.state.load(std::memory_order_acquire);
+    while (true) {
+        uint64_t last = state >> kTokenBits;
+        uint64_t tokens = state & kTokenMask;
+        if (last == 0) {
+            tokens = capacityMilli_;
+            last = now;
+        } else if (now > last) {
+            double refill = static_cast<double>(now - last) * refillMilliPerMs_;
+            tokens = std::min<uint64_t>(capacityMilli_, tokens + static_cast<uint64_t>(refill));
+            last = now;
+        }
+        if (tokens < kMilli) return false;
+        uint64_t next = (last << kTokenBits) | (tokens - kMilli);
+        if (slot.state.compare_exchange_weak(state, next, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+}
+
+bool RateLimiter::tryAcquire(const std::string& key) {
+    uint64_t h = hashKey(key);
+    uint64_t now = nowMs();
+    size_t shardIndex = static_cast<size_t>(h % kShards);
+    Slot* shard = &slots_[shardIndex * slotsPerShard_];
+    size_t start = static_cast<size_t>((h / kShards) % slotsPerShard_);
+
+    auto charge = [&](Slot& slot) {
+        bool ok = consume(slot, now);
+        (ok ? allowed_ : rejected_).fetch_add(1, std::memory_order_relaxed);
+        return ok;
+    };
+
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        Slot* empty = nullptr;
+        Slot* idle = nullptr;
+        uint64_t idleKey = 0;
+        for (size_t i = 0; i < kProbe; ++i) {
+            Slot& slot = shard[(start + i) % slotsPerShard_];
+            uint64_t k = slot.key.load(std::memory_order_acquire);
+            if (k == h) return charge(slot);
+            if (k == 0) {
+                if (!empty) empty = &slot;
+                continue;
+            }
+            uint64_t last = slot.state.load(std::memory_order_relaxed) >> kTokenBits;
+            if (!idle && now > last && now - last >= idleMs_) {
+                idle = &slot;
+                idleKey = k;
+            }
+        }
+
+        // Unknown key: take a free slot, else one whose bucket has refilled completely
+        Slot* target = empty ? empty : idle;
+        if (!target) {
+            overflowed_.fetch_add(1, std::memory_order_relaxed);
+            return charge(overflow_[shardIndex]);
+        }
+        uint64_t expected = empty ? 0 : idleKey;
+        if (target->key.compare_exchange_strong(expected, h, std::memory_order_acq_rel)) {
+            target->state.store(0, std::memory_order_release);
+            if (!empty) evicted_.fetch_add(1, std::memory_order_relaxed);
+            return charge(*target);
+        }
+    }
+
+    // Persistent contention on the probe window: deny, as a limiter must not fail open
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+RateLimiter::Stats RateLimiter::stats() const {
+    return Stats{allowed_.load(std::memory_order_relaxed),
+                 rejected_.load(std::memory_order_relaxed),
+                 evicted_.load(std::memory_order_relaxed),
+                 overflowed_.load(std::memory_order_relaxed)};
+}
+
+} // namespace auth
@@ -12,9 +12,18 @@
 #include <limits>
 #include <algorithm>  // for std::transform in CLI validation
 #include <random>
+#include <sstream>
 
 namespace client {
 
+namespace {
+
+// Caller ID for login rate limiting: every CLI on this host is one client, as a remote
+// address would be
+constexpr const char* kCallerId = "cli:local";
+
+} // namespace
+
 void CLIClient::run() {
     std::string token;
     bool isAdmin = false;
@@ -40,7 +49,7 @@ void CLIClient::run() {
                     std::cout << "Username and password cannot be empty\n";
                     continue;
                 }
-                auto res1 = api::ApiRouter::initiateLogin(username, password);
+                auto res1 = api::ApiRouter::initiateLogin(username, password, kCallerId);
                 if (!res1.success) {
                     std::cout << "Error: " << res1.message << "\n";
                     continue;
@@ -50,7 +59,7 @@ void CLIClient::run() {
                 std::cout << "Enter OTP: ";
                 std::string code;
                 std::cin >> code;
-                auto res2 = api::ApiRouter::completeLogin(username, code);
+                auto res2 = api::ApiRouter::completeLogin(username, code, kCallerId);
                 if (!res2.success) {
                     std::cout << "Error: " << res2.message << "\n";
                 } else {
@@ -102,6 +111,7 @@ void CLIClient::run() {
                 std::cout << "11) Create User (admin)\n";
                 std::cout << "12) Update User (admin)\n";
                 std::cout << "13) Reset Password (admin)\n";
+                std::cout << "14) Run Reward Campaign (admin)\n";
             }
             std::cout << "0) Exit\nChoice: ";
             int choice;
@@ -166,6 +176,12 @@ void CLIClient::run() {
                         std::cout << "Wallet ID: " << w["wallet_id"] << "\n";
                         std::cout << "Owner: " << w["owner_username"] << "\n";
                         std::cout << "Balance: " << w["balance"] << "\n";
+                        if (w.contains("asset_codes")) {
+                            for (size_t i = 0; i < w["asset_codes"].size(); ++i) {
+                                std::cout << "  " << w["asset_codes"][i].get<std::string>() << ": "
+                                          << w["asset_balances"][i] << "\n";
+                            }
+                        }
                         std::cout << "Transactions: ";
                         for (auto &id : w["transaction_ids"]) std::cout << id.get<std::string>() << " ";
                         std::cout << "\n";
@@ -173,7 +189,7 @@ void CLIClient::run() {
                     break;
                 }
                 case 7: {
-                    std::string senderWalletId, recipientWalletId, type, desc;
+                    std::string senderWalletId, recipientWalletId, type, asset, desc;
                     double amount;
                     
                     // First ask for transaction type
@@ -184,6 +200,11 @@ void CLIClient::run() {
                         std::cout << "Type must be 'credit' or 'debit'\n";
                         break;
                     }
+                    std::cout << "Asset (e.g. " << models::kDefaultAsset << "): "; std::cin >> asset;
+                    if (!models::validAssetCode(asset)) {
+                        std::cout << "Asset codes are lowercase letters, digits, '_' and '-'\n";
+                        break;
+                    }
 
                     // Get sender's wallet ID first
                     auto profileRes = api::ApiRouter::getProfile(token);
@@ -223,8 +244,6 @@ void CLIClient::run() {
                     std::getline(std::cin, desc);
 
                     // Generate and verify OTP before proceeding with transaction
-                    std::string username = profileRes.data["user"]["username"].get<std::string>();
-                    
                     // Generate a simple 6-digit OTP
                     std::random_device rd;
                     std::mt19937 gen(rd());
@@ -244,17 +263,10 @@ void CLIClient::run() {
                     }
 
                     // If OTP verification successful, proceed with transaction
-                    // For debit transactions, use sender's wallet
-                    // For credit transactions, also use sender's wallet (since it's a credit to their own wallet)
-                    auto res = api::ApiRouter::executeTransaction(token, senderWalletId, amount, type, desc);
-                    if (res.success && type == "debit") {
-                        // If debit was successful, credit the recipient's wallet
-                        auto creditRes = api::ApiRouter::executeTransaction(token, recipientWalletId, amount, "credit", 
-                            "Received from " + username);
-                        if (!creditRes.success) {
-                            std::cout << "Warning: Money was deducted but transfer to recipient failed\n";
-                        }
-                    }
+                    // A debit is a transfer to the recipient; a credit goes to the sender's own wallet
+                    auto res = type == "debit"
+                        ? api::ApiRouter::transfer(token, senderWalletId, recipientWalletId, amount, asset, desc)
+                        : api::ApiRouter::executeTransaction(token, senderWalletId, amount, type, desc, "", asset);
                     std::cout << res.message << "\n";
                     break;
                 }
@@ -329,6 +341,50 @@ void CLIClient::run() {
                     std::cout << (res.success ? res.message : std::string("Error: ") + res.message) << "\n";
                     break;
                 }
+                case 14: {
+                    if (!isAdmin) { std::cout << "Invalid choice\n"; break; }
+                    std::string key, target, desc, line;
+                    double amount;
+                    std::cout << "Campaign key: "; std::cin >> key;
+                    std::cout << "Target (all/list): "; std::cin >> target;
+                    std::cout << "Amount: "; std::cin >> amount;
+                    if (!std::cin || amount <= 0) {
+                        std::cin.clear();
+                        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                        std::cout << "Amount must be a positive number\n";
+                        break;
+                    }
+                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                    std::cout << "Description: "; std::getline(std::cin, desc);
+                    nlohmann::json rule;
+                    rule["campaign_id"] = key;
+                    rule["description"] = desc;
+                    rule["amount"] = amount;
+                    rule["target"] = target;
+                    rule["usernames"] = nlohmann::json::array();
+                    if (target == "list") {
+                        std::cout << "Usernames (space separated): "; std::getline(std::cin, line);
+                        std::istringstream iss(line);
+                        std::string name;
+                        while (iss >> name) rule["usernames"].push_back(name);
+                    }
+                    auto created = api::ApiRouter::createCampaign(token, rule);
+                    if (!created.success) {
+                        std::cout << "Error: " << created.message << "\n";
+                        break;
+                    }
+                    auto res = api::ApiRouter::runCampaign(token, key);
+                    if (!res.success) {
+                        std::cout << "Error: " << res.message << "\n";
+                    } else {
+                        auto c = res.data["campaign"];
+                        std::cout << res.message << " | credited=" << c["credited"]
+                                  << " already=" << c["already_credited"]
+                                  << " skipped=" << c["skipped"]
+                                  << " failed=" << c["failed"] << "\n";
+                    }
+                    break;
+                }
                 case 0: {
                     exitApp = true;
                     break;
@@ -0,0 +1,170 @@
+/*
+ * TraceReplay.cpp
+ *
+ * Replays a trace captured with TraceRecorder. Generated values (OTPs, session tokens,
+ * wallet IDs) differ between the original run and the replay, so every identifier a
+ * replayed call returns is mapped from its recorded value and substituted into later calls.
+ * Traces carry no credentials: a recorded password alias is itself used as the password, and
+ * users that existed before the recording get that alias as a fixture password at their first
+ * login that succeeded in the recording.
+ */
+
+#include "client/TraceReplay.h"
+#include "api/ApiTrace.h"
+#include "auth/AuthService.h"
+#include "storage/UserStorage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <unistd.h>
+
+namespace client {
+namespace fs = std::filesystem;
+
+namespace {
+
+struct EndpointStats {
+    std::vector<int64_t> latencies;
+    size_t divergences = 0;
+};
+
+int64_t percentile(std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+void substitute(nlohmann::json& args, const std::unordered_map<std::string, std::string>& ids) {
+    for (auto& value : args) {
+        if (!value.is_string()) continue;
+        auto it = ids.find(value.get<std::string>());
+        if (it != ids.end()) value = it->second;
+    }
+}
+
+// Sessions present in the data directory, by their recorded form
+void mapSessions(const fs::path& sessions, std::unordered_map<std::string, std::string>& ids) {
+    std::error_code ec;
+    for (fs::directory_iterator it(sessions, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".json") continue;
+        std::string token = it->path().stem().string();
+        ids[api::traceTokenFor(token)] = token;
+    }
+}
+
+// Gives a user the recorded password alias as its password, once per replay. Users the trace
+// creates or resets already have an alias as their password.
+void applyFixtureCredential(const api::TraceEntry& entry, std::unordered_set<std::string>& fixtured) {
+    const auto& a = entry.args;
+    if (!a.is_object() || !a.contains("username") || !a["username"].is_string()) return;
+    std::string username = a["username"].get<std::string>();
+    if (fixtured.count(username)) return;
+    if (entry.endpoint == "registerUser" || entry.endpoint == "adminCreateUser" ||
+        entry.endpoint == "adminResetPassword") {
+        fixtured.insert(username);
+        return;
+    }
+    if (entry.endpoint != "initiateLogin" || !entry.success || !a.contains("password")) return;
+    auto user = storage::UserStorage::load(username);
+    if (!user) return;
+    user->password_hash = auth::AuthService::hashPassword(a["password"].get<std::string>());
+    if (storage::UserStorage::save(*user)) fixtured.insert(username);
+}
+
+} // namespace
+
+int TraceReplay::run(const std::string& tracePath, const std::string& dataDir, bool paced) {
+    api::TraceReader reader(tracePath);
+    if (!reader.ok()) {
+        std::cerr << "Cannot open trace " << tracePath << "\n";
+        return 1;
+    }
+
+    // Work on a scratch copy so the source data directory is never modified
+    std::error_code ec;
+    fs::path scratch = fs::temp_directory_path() / ("reward_replay_" + std::to_string(::getpid()));
+    fs::remove_all(scratch, ec);
+    fs::create_directories(scratch / "data", ec);
+    fs::copy(dataDir, scratch / "data", fs::copy_options::recursive, ec);
+    if (ec) {
+        std::cerr << "Cannot copy data directory " << dataDir << ": " << ec.message() << "\n";
+        return 1;
+    }
+    fs::path previous = fs::current_path();
+    fs::current_path(scratch);
+
+    std::map<std::string, EndpointStats> stats;
+    std::unordered_map<std::string, std::string> ids;
+    mapSessions(scratch / "data" / "sessions", ids);
+    std::unordered_set<std::string> fixtured;
+    size_t calls = 0;
+    size_t divergences = 0;
+    int64_t firstTimestamp = -1;
+    auto replayStart = std::chrono::steady_clock::now();
+
+    api::TraceEntry entry;
+    while (reader.next(entry)) {
+        if (firstTimestamp < 0) firstTimestamp = entry.timestamp_us;
+        if (paced) {
+            std::this_thread::sleep_until(replayStart +
+                                          std::chrono::microseconds(entry.timestamp_us - firstTimestamp));
+        }
+
+        substitute(entry.args, ids);
+        applyFixtureCredential(entry, fixtured);
+        auto start = std::chrono::steady_clock::now();
+        api::ApiResponse response = api::replayCall(entry.endpoint, entry.args);
+        auto latency = std::chrono::steady_clock::now() - start;
+
+        auto& endpoint = stats[entry.endpoint];
+        endpoint.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        ++calls;
+
+        for (auto it = entry.ids.begin(); it != entry.ids.end(); ++it) {
+            if (!response.data.is_object() || !response.data.contains(it.key())) continue;
+            const auto& replayed = response.data.at(it.key());
+            if (replayed.is_string()) ids[it.value().get<std::string>()] = replayed.get<std::string>();
+        }
+
+        if (response.success != entry.success || response.message != entry.message) {
+            ++endpoint.divergences;
+            if (++divergences <= 10) {
+                std::cout << "Divergence #" << divergences << " at call " << calls << " (" << entry.endpoint
+                          << "): recorded " << (entry.success ? "ok" : "fail") << " \"" << entry.message
+                          << "\", replayed " << (response.success ? "ok" : "fail") << " \""
+                          << response.message << "\"\n";
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count();
+
+    fs::current_path(previous);
+    fs::remove_all(scratch, ec);
+
+    std::cout << "\nReplayed " << calls << " calls in " << std::fixed << std::setprecision(3) << seconds
+              << "s (" << std::setprecision(1) << (seconds > 0 ? calls / seconds : 0.0) << " calls/s)"
+              << (paced ? ", original pacing" : ", as fast as possible") << "\n";
+    std::cout << std::left << std::setw(22) << "endpoint" << std::right << std::setw(8) << "calls"
+              << std::setw(10) << "calls/s" << std::setw(10) << "p50us" << std::setw(10) << "p90us"
+              << std::setw(10) << "p99us" << std::setw(10) << "maxus" << std::setw(8) << "diverg" << "\n";
+    for (auto& [name, s] : stats) {
+        std::sort(s.latencies.begin(), s.latencies.end());
+        std::cout << std::left << std::setw(22) << name << std::right << std::setw(8) << s.latencies.size()
+                  << std::setw(10) << std::setprecision(1) << (seconds > 0 ? s.latencies.size() / seconds : 0.0)
+                  << std::setw(10) << percentile(s.latencies, 0.50) << std::setw(10) << percentile(s.latencies, 0.90)
+                  << std::setw(10) << percentile(s.latencies, 0.99) << std::setw(10) << s.latencies.back()
+                  << std::setw(8) << s.divergences << "\n";
+    }
+    std::cout << divergences << " divergence(s)\n";
+    return divergences == 0 ? 0 : 2;
+}
+
+} // namespace client
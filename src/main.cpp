@@ -1,7 +1,214 @@
 #include "client/CLIClient.h"
+#include "client/TraceReplay.h"
+#include "api/ApiRouter.h"
+#include "api/ApiTrace.h"
+#include "storage/ChangeLog.h"
+#include "storage/FileManager.h"
+#include "storage/RecordIndex.h"
+#include "storage/AuditLog.h"
+#include "storage/ResourceUsage.h"
+#include "tracing/Tracer.h"
+#include "services/TieringService.h"
+#include "services/ExpiryService.h"
+#include "services/HoldService.h"
+#include "services/WalletService.h"
+#include "storage/ReplicaFollower.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Usage:
+//   RewardManagement                                   interactive CLI
+//   RewardManagement --record <trace>                  interactive CLI, recording every API call
+//   RewardManagement --replay <trace> [--data <dir>] [--paced]
+//                                                      replay a trace against a copy of <dir> (default: data)
+//   RewardManagement --changelog                       interactive CLI, logging every save/delete for followers
+//   RewardManagement --follow <log> --replica <dir>    apply a leader's change log to <dir> until stdin closes
+//   RewardManagement --read-replica <dir> [--max-staleness <ms>]
+//                                                      interactive CLI, serving reads from a fresh enough replica
+//   --index-interval <s>                               seconds between record index snapshots (default 300)
+//   --tiering-interval <s> [--cold-after-days <d>]     archive transactions older than d days (default 90)
+//                                                      every s seconds in the background
+//   RewardManagement --verify-audit [<log>] [--workers <n>]
+//                                                      check the audit log's hash chain and exit
+//   --spans <file> [--span-sample <p>]                 write a fraction p (default 0.01) of requests
+//                                                      as Chrome trace-event spans
+//   --expiry-interval <s>                              expire due point lots every s seconds
+//   --hold-interval <s>                                expire overdue holds every s seconds (default 5)
+//   --hot-wallet <id>[:<n>]                            take credits to wallet id in n journal shards (default:
+//                                                      one per core), folded every --fold-interval ms (default 1000)
+//   --point-lifetime-days <d>                          lifetime of newly earned points (default 365)
+//   --count-allocations                                count heap allocations per API call
+//   --debug-usage                                      add each call's resource usage to its response
+int main(int argc, char** argv) {
+    std::string recordPath, replayPath, dataDir = "data";
+    std::string followLog, replicaDir, readReplicaDir;
+    int64_t maxStalenessMs = 1000;
+    int64_t indexIntervalS = 300;
+    int64_t tieringIntervalS = 0;
+    int coldAfterDays = services::TieringService::kDefaultColdAfterDays;
+    int64_t expiryIntervalS = 0;
+    int64_t holdIntervalS = 5;
+    std::vector<std::string> hotWallets;
+    int64_t foldIntervalMs = 1000;
+    bool paced = false, changelog = false;
+    std::string verifyAudit, spansPath;
+    double spanSample = 0.01;
+    unsigned workers = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--data" && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else if (arg == "--paced") {
+            paced = true;
+        } else if (arg == "--changelog") {
+            changelog = true;
+        } else if (arg == "--follow" && i + 1 < argc) {
+            followLog = argv[++i];
+        } else if (arg == "--replica" && i + 1 < argc) {
+            replicaDir = argv[++i];
+        } else if (arg == "--read-replica" && i + 1 < argc) {
+            readReplicaDir = argv[++i];
+        } else if (arg == "--max-staleness" && i + 1 < argc) {
+            maxStalenessMs = std::stoll(argv[++i]);
+        } else if (arg == "--index-interval" && i + 1 < argc) {
+            indexIntervalS = std::stoll(argv[++i]);
+        } else if (arg == "--tiering-interval" && i + 1 < argc) {
+            tieringIntervalS = std::stoll(argv[++i]);
+        } else if (arg == "--cold-after-days" && i + 1 < argc) {
+            coldAfterDays = std::stoi(argv[++i]);
+        } else if (arg == "--verify-audit") {
+            verifyAudit = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : storage::AuditLog::kDefaultPath;
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--spans" && i + 1 < argc) {
+            spansPath = argv[++i];
+        } else if (arg == "--span-sample" && i + 1 < argc) {
+            spanSample = std::stod(argv[++i]);
+        } else if (arg == "--expiry-interval" && i + 1 < argc) {
+            expiryIntervalS = std::stoll(argv[++i]);
+        } else if (arg == "--hold-interval" && i + 1 < argc) {
+            holdIntervalS = std::stoll(argv[++i]);
+        } else if (arg == "--hot-wallet" && i + 1 < argc) {
+            hotWallets.push_back(argv[++i]);
+        } else if (arg == "--fold-interval" && i + 1 < argc) {
+            foldIntervalMs = std::stoll(argv[++i]);
+        } else if (arg == "--point-lifetime-days" && i + 1 < argc) {
+            services::WalletService::setPointLifetimeDays(std::stoi(argv[++i]));
+        } else if (arg == "--count-allocations") {
+            storage::UsageScope::setAllocationCounting(true);
+        } else if (arg == "--debug-usage") {
+            api::ApiRouter::setUsageInResponses(true);
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (!verifyAudit.empty()) {
+        auto report = storage::AuditLog::verify(verifyAudit, workers);
+        std::cout << report.entries << " entries checked in " << report.elapsed_ms << " ms: ";
+        if (report.ok) {
+            std::cout << "chain intact, head " << report.head_hash << "\n";
+            return 0;
+        }
+        std::cout << report.error << " at entry " << report.first_bad_seq << "\n";
+        return 2;
+    }
+    if (!replayPath.empty()) {
+        return client::TraceReplay::run(replayPath, dataDir, paced);
+    }
+    if (!followLog.empty()) {
+        if (replicaDir.empty()) {
+            std::cerr << "--follow requires --replica <dir>\n";
+            return 1;
+        }
+        std::atomic<bool> stop{false};
+        storage::ReplicaFollower follower(followLog, replicaDir);
+        std::thread poller([&] { follower.run(stop, std::chrono::milliseconds(20)); });
+        std::cout << "Following " << followLog << " into " << replicaDir << " (close stdin to stop)\n";
+        for (std::string line; std::getline(std::cin, line);) {}
+        stop = true;
+        poller.join();
+        return 0;
+    }
+    if (changelog && !storage::ChangeLog::enable()) {
+        std::cerr << "Cannot open change log " << storage::ChangeLog::kDefaultPath << "\n";
+        return 1;
+    }
+    if (!readReplicaDir.empty()) {
+        storage::ReadReplica::configure(readReplicaDir, maxStalenessMs);
+    }
+    if (!storage::RecordIndex::load()) {
+        // Without a snapshot to read the load is a rebuild from the record files
+        std::error_code ec;
+        std::filesystem::remove(storage::FileManager::resolve(storage::RecordIndex::kSnapshotPath), ec);
+        if (!storage::RecordIndex::load()) std::cerr << "Cannot build the record index; running without it\n";
+    }
+    if (storage::RecordIndex::loaded()) {
+        auto index = storage::RecordIndex::status();
+        std::cout << "Record index ready from " << index.source << " in " << index.load_ms << " ms";
+        if (!index.rebuild_reason.empty()) std::cout << " (" << index.rebuild_reason << ")";
+        std::cout << "\n";
+    }
+    storage::RecordIndex::startPeriodicSnapshots(std::chrono::seconds(indexIntervalS));
+    if (tieringIntervalS > 0) {
+        services::TieringService::startBackground(std::chrono::seconds(tieringIntervalS), coldAfterDays);
+    }
+    if (expiryIntervalS > 0) {
+        services::ExpiryService::startBackground(std::chrono::seconds(expiryIntervalS));
+    }
+    // Credits journaled for hot wallets by an earlier run land before anything reads them
+    services::WalletService::foldAllCredits();
+    for (const auto& spec : hotWallets) {
+        auto colon = spec.find(':');
+        std::string walletId = spec.substr(0, colon);
+        size_t shards = colon == std::string::npos ? std::max(1u, std::thread::hardware_concurrency())
+                                                   : std::stoul(spec.substr(colon + 1));
+        if (!services::WalletService::setHotWallet(walletId, shards)) {
+            std::cerr << "No such wallet for --hot-wallet: " << walletId << "\n";
+            return 1;
+        }
+    }
+    if (!hotWallets.empty() && foldIntervalMs > 0) {
+        services::WalletService::startCreditFolding(std::chrono::milliseconds(foldIntervalMs));
+    }
+    if (holdIntervalS > 0) {
+        services::HoldService::startBackground(std::chrono::seconds(holdIntervalS));
+    }
+    if (!spansPath.empty() && !tracing::Tracer::start(spansPath, spanSample)) {
+        std::cerr << "Cannot open span file " << spansPath << "\n";
+        return 1;
+    }
+    if (!recordPath.empty() && !api::TraceRecorder::start(recordPath)) {
+        std::cerr << "Cannot open trace file " << recordPath << "\n";
+        return 1;
+    }
 
-int main() {
     client::CLIClient cli;
     cli.run();
+    api::TraceRecorder::stop();
+    tracing::Tracer::stop();
+    if (!storage::AuditLog::flush()) {
+        std::cerr << "Audit log writes are failing; some entries were not written\n";
+    }
+    services::TieringService::stopBackground();
+    services::ExpiryService::stopBackground();
+    services::WalletService::stopCreditFolding();
+    services::WalletService::foldAllCredits();
+    services::HoldService::stopBackground();
+    storage::RecordIndex::stopPeriodicSnapshots();
+    storage::RecordIndex::save();
+    storage::ChangeLog::disable();
     return 0;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,113 @@
+#include "models/Id128.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace models {
+
+namespace {
+
+bool parseHex(std::string_view text, uint64_t& out) {
+    uint64_t v = 0;
+    for (char c : text) {
+        unsigned d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else return false;  // upper case would not round-trip
+        v = (v << 4) | d;
+    }
+    out = v;
+    return true;
+}
+
+bool decode(std::string_view text, uint64_t& hi, uint64_t& lo) {
+    return text.size() == 32 && parseHex(text.substr(0, 16), hi) && parseHex(text.substr(16), lo) &&
+           hi != Id128::kInternedTag;
+}
+
+struct Interned {
+    std::shared_mutex mutex;
+    // deque keeps the strings in place as it grows, so the map can view them
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, uint64_t> index;
+};
+
+Interned& interned() {
+    static Interned table;
+    return table;
+}
+
+uint64_t intern(std::string_view text) {
+    auto& table = interned();
+    {
+        std::shared_lock<std::shared_mutex> lock(table.mutex);
+        auto it = table.index.find(text);
+        if (it != table.index.end()) return it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(table.mutex);
+    auto it = table.index.find(text);
+    if (it != table.index.end()) return it->second;
+    uint64_t slot = table.strings.size();
+    table.strings.emplace_back(text);
+    table.index.emplace(table.strings.back(), slot);
+    return slot;
+}
+
+} // namespace
+
+Id128 Id128::generate() {
+    thread_local std::mt19937_64 eng(std::random_device{}() ^
+        static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    uint64_t hi;
+    do { hi = eng(); } while (hi == kInternedTag);
+    auto now = std::chrono::system_clock::now().time_since_epoch().count();
+    return Id128(hi, static_cast<uint64_t>(now));
+}
+
+Id128 Id128::parse(std::string_view text) {
+    if (auto id = parseCanonical(text)) return *id;
+    return Id128(kInternedTag, intern(text));
+}
+
+std::optional<Id128> Id128::find(std::string_view text) {
+    if (auto id = parseCanonical(text)) return id;
+    auto& table = interned();
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    auto it = table.index.find(text);
+    if (it == table.index.end()) return std::nullopt;
+    return Id128(kInternedTag, it->second);
+}
+
+std::optional<Id128> Id128::parseCanonical(std::string_view text) {
+    uint64_t hi, lo;
+    if (!decode(text, hi, lo)) return std::nullopt;
+    return Id128(hi, lo);
+}
+
+size_t Id128::internedCount() {
+    auto& table = interned();
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    return table.strings.size();
+}
+
+void Id128::appendTo(std::string& out) const {
+    if (hi_ == kInternedTag) {
+        auto& table = interned();
+        std::shared_lock<std::shared_mutex> lock(table.mutex);
+        if (lo_ < table.strings.size()) out += table.strings[lo_];
+        return;
+    }
+    static constexpr char kDigits[] = "0123456789abcdef";
+    char buf[32];
+    for (int i = 0; i < 16; ++i) {
+        buf[i] = kDigits[(hi_ >> (60 - 4 * i)) & 0xF];
+        buf[16 + i] = kDigits[(lo_ >> (60 - 4 * i)) & 0xF];
+    }
+    out.append(buf, sizeof(buf));
+}
+
+} // namespace models
@@ -1,5 +1,8 @@
 #include "services/AdminService.h"
+#include "tracing/Tracer.h"
 #include "storage/UserStorage.h"
+#include "storage/FileManager.h"
+#include "storage/Snapshot.h"
 #include "auth/AuthService.h"
 #include "services/UserService.h"
 
@@ -8,13 +11,25 @@
 namespace services {
 
 std::vector<models::UserAccount> AdminService::listAllUsers() {
+    tracing::Span span("service", "AdminService::listAllUsers");
+    storage::Snapshot snapshot;
     return storage::UserStorage::listAll();
 }
 
+void AdminService::forEachUser(const std::function<void(const models::UserAccount&)>& fn) {
+    tracing::Span span("service", "AdminService::forEachUser");
+    storage::Snapshot snapshot;
+    storage::UserStorage::forEach([&](const models::UserAccount& user) {
+        fn(user);
+        return true;
+    });
+}
+
 bool AdminService::createUser(const std::string& username,
                               const std::string& password,
                               const std::string& email,
                               bool isAdmin) {
+    tracing::Span span("service", "AdminService::createUser");
     // Directly register user (bypass OTP)
     return UserService::registerUser(username, password, email, isAdmin);
 }
@@ -22,9 +37,11 @@ bool AdminService::createUser(const std::string& username,
 bool AdminService::updateUser(const std::string& username,
                               const std::string& email,
                               bool isAdmin) {
+    tracing::Span span("service", "AdminService::updateUser");
+    storage::RecordLock lock("data/users/" + username + ".json", storage::LockMode::Exclusive);
     auto userOpt = storage::UserStorage::load(username);
     if (!userOpt) return false;
-    auto user = *userOpt;
+    auto user = std::move(*userOpt);
     user.email = email;
     user.is_admin = isAdmin;
     return storage::UserStorage::save(user);
@@ -32,9 +49,11 @@ bool AdminService::updateUser(const std::string& username,
 
 bool AdminService::resetPassword(const std::string& username,
                                  const std::string& newPassword) {
+    tracing::Span span("service", "AdminService::resetPassword");
+    storage::RecordLock lock("data/users/" + username + ".json", storage::LockMode::Exclusive);
     auto userOpt = storage::UserStorage::load(username);
     if (!userOpt) return false;
-    auto user = *userOpt;
+    auto user = std::move(*userOpt);
     user.password_hash = auth::AuthService::hashPassword(newPassword);
     return storage::UserStorage::save(user);
 }
@@ -0,0 +1,210 @@
+#include "services/AssetLedger.h"
+#include "storage/WalletStorage.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace services {
+
+namespace {
+
+// One wallet's balances, as recorded
+struct Balances {
+    double points;
+    std::vector<std::string> codes;
+    std::vector<double> amounts;
+};
+
+struct PendingUpdate {
+    std::string walletId;
+    Balances balances;
+};
+
+// Wallets are spread over shards by id, so saves of different wallets rarely share a lock.
+// Each shard keeps its own slots and columns; a total adds up the shards' column sums.
+constexpr size_t kShards = 16;
+
+struct Shard {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, size_t> slotOf;
+    // Indexed like the asset list; shorter than it until a wallet here holds the later assets
+    std::vector<std::vector<double>> columns;
+};
+
+std::array<Shard, kShards> shards;
+
+// Column 0 is the default asset; a column is added the first time any wallet holds an asset
+std::shared_mutex assetsMutex;
+std::vector<std::string> assets{models::kDefaultAsset};
+std::unordered_map<std::string, size_t> columnOf{{models::kDefaultAsset, 0}};
+
+// Saves hold stateMutex shared while they apply; a rebuild holds it exclusively to swap in
+// the columns it read
+std::shared_mutex stateMutex;
+bool isBuilt = false;
+bool building = false;
+// Saves that arrive while a rebuild is reading, replayed in order after it
+std::mutex pendingMutex;
+std::vector<PendingUpdate> pending;
+std::mutex rebuildMutex;
+
+Balances balancesOf(const models::Wallet& w) {
+    return Balances{w.balance, w.asset_codes, w.asset_balances};
+}
+
+Shard& shardOf(const std::string& walletId) {
+    return shards[std::hash<std::string>{}(walletId) % kShards];
+}
+
+size_t columnFor(const std::string& asset) {
+    {
+        std::shared_lock<std::shared_mutex> lock(assetsMutex);
+        auto it = columnOf.find(asset);
+        if (it != columnOf.end()) return it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(assetsMutex);
+    auto [it, added] = columnOf.emplace(asset, assets.size());
+    if (added) assets.push_back(asset);
+    return it->second;
+}
+
+// Requires stateMutex held, shared or exclusively
+void applyUpdate(const std::string& walletId, const Balances& b) {
+    // Columns are looked up before the shard is locked: the asset list's lock is never taken
+    // while a shard lock is held
+    std::vector<size_t> columnIds(b.codes.size());
+    size_t width = 1;
+    for (size_t i = 0; i < b.codes.size(); ++i) {
+        columnIds[i] = columnFor(b.codes[i]);
+        width = std::max(width, columnIds[i] + 1);
+    }
+
+    Shard& shard = shardOf(walletId);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto [it, added] = shard.slotOf.emplace(walletId, shard.slotOf.size());
+    size_t slot = it->second;
+    if (added) {
+        for (auto& column : shard.columns) column.push_back(0.0);
+    } else {
+        for (auto& column : shard.columns) column[slot] = 0.0;
+    }
+    while (shard.columns.size() < width) shard.columns.emplace_back(shard.slotOf.size(), 0.0);
+    shard.columns[0][slot] = b.points;
+    for (size_t i = 0; i < columnIds.size(); ++i) shard.columns[columnIds[i]][slot] = b.amounts[i];
+}
+
+// Four independent partial sums: a single running sum is a dependency chain the compiler may
+// not reorder, so it would stay scalar
+AssetTotal sumColumn(const std::string& asset, const std::vector<double>& column) {
+    const double* v = column.data();
+    size_t n = column.size();
+    double sum[4] = {0, 0, 0, 0};
+    size_t held[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            sum[lane] += v[i + lane];
+            held[lane] += v[i + lane] != 0.0;
+        }
+    }
+    for (; i < n; ++i) {
+        sum[0] += v[i];
+        held[0] += v[i] != 0.0;
+    }
+    return AssetTotal{asset, (sum[0] + sum[1]) + (sum[2] + sum[3]), held[0] + held[1] + held[2] + held[3]};
+}
+
+// Sums one column in every shard; a shard that has not seen the asset adds nothing
+AssetTotal sumShards(const std::string& asset, size_t column) {
+    AssetTotal out{asset, 0.0, 0};
+    for (auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        if (column >= shard.columns.size()) continue;
+        AssetTotal part = sumColumn(asset, shard.columns[column]);
+        out.total += part.total;
+        out.holders += part.holders;
+    }
+    return out;
+}
+
+} // namespace
+
+bool AssetLedger::rebuild() {
+    std::lock_guard<std::mutex> serial(rebuildMutex);
+    {
+        std::unique_lock<std::shared_mutex> state(stateMutex);
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        building = true;
+        pending.clear();
+    }
+    auto wallets = storage::WalletStorage::listAll();
+
+    // Waits for saves still applying; those that arrive from here on wait for the swap
+    std::unique_lock<std::shared_mutex> state(stateMutex);
+    {
+        std::unique_lock<std::shared_mutex> lock(assetsMutex);
+        assets.assign(1, models::kDefaultAsset);
+        columnOf.clear();
+        columnOf.emplace(models::kDefaultAsset, 0);
+    }
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.slotOf.clear();
+        shard.columns.assign(1, {});
+        shard.columns[0].reserve(wallets.size() / kShards + 1);
+    }
+    for (const auto& w : wallets) applyUpdate(w.wallet_id, balancesOf(w));
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    for (const auto& update : pending) applyUpdate(update.walletId, update.balances);
+    pending.clear();
+    building = false;
+    isBuilt = true;
+    return true;
+}
+
+void AssetLedger::ensureBuilt() {
+    {
+        std::shared_lock<std::shared_mutex> state(stateMutex);
+        if (isBuilt) return;
+    }
+    rebuild();
+}
+
+void AssetLedger::update(const models::Wallet& wallet) {
+    std::shared_lock<std::shared_mutex> state(stateMutex);
+    if (building) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.push_back(PendingUpdate{wallet.wallet_id, balancesOf(wallet)});
+    } else if (isBuilt) {
+        applyUpdate(wallet.wallet_id, balancesOf(wallet));
+    }
+}
+
+std::vector<AssetTotal> AssetLedger::totals() {
+    std::vector<std::string> names;
+    {
+        std::shared_lock<std::shared_mutex> lock(assetsMutex);
+        names = assets;
+    }
+    std::vector<AssetTotal> out;
+    out.reserve(names.size());
+    for (size_t c = 0; c < names.size(); ++c) out.push_back(sumShards(names[c], c));
+    return out;
+}
+
+std::optional<AssetTotal> AssetLedger::total(const std::string& asset) {
+    size_t column;
+    {
+        std::shared_lock<std::shared_mutex> lock(assetsMutex);
+        auto it = columnOf.find(asset);
+        if (it == columnOf.end()) return std::nullopt;
+        column = it->second;
+    }
+    return sumShards(asset, column);
+}
+
+} // namespace services
@@ -0,0 +1,252 @@
+#include "services/CampaignService.h"
+#include "services/WalletService.h"
+#include "models/Id128.h"
+#include "storage/CampaignStorage.h"
+#include "storage/IdempotencyIndex.h"
+#include "storage/ResourceUsage.h"
+#include "storage/UserStorage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace services {
+
+namespace {
+
+constexpr size_t kQueueCapacity = 4096;
+constexpr long long kCheckpointEvery = 1000;
+
+std::mutex runningMutex;
+std::set<std::string> runningCampaigns;
+
+// Bounded hand-off between the user stream and the crediting workers
+class WorkQueue {
+public:
+    void push(models::UserAccount user) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [this] { return items_.size() < kQueueCapacity; });
+        items_.push_back(std::move(user));
+        notEmpty_.notify_one();
+    }
+
+    bool pop(models::UserAccount& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this] { return !items_.empty() || closed_; });
+        if (items_.empty()) return false;
+        out = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<models::UserAccount> items_;
+    bool closed_ = false;
+};
+
+struct Progress {
+    std::atomic<long long> processed{0};
+    std::atomic<long long> credited{0};
+    std::atomic<long long> alreadyCredited{0};
+    std::atomic<long long> skipped{0};
+    std::atomic<long long> failed{0};
+};
+
+bool matchesProfile(const models::CampaignPredicate& p, const models::UserAccount& u) {
+    if (p.is_admin && *p.is_admin != u.is_admin) return false;
+    if (!p.email_suffix.empty()) {
+        if (u.email.size() < p.email_suffix.size()) return false;
+        if (u.email.compare(u.email.size() - p.email_suffix.size(),
+                            p.email_suffix.size(), p.email_suffix) != 0) return false;
+    }
+    return true;
+}
+
+bool matchesWallet(const models::CampaignPredicate& p, const models::Wallet& w) {
+    if (p.min_balance && w.balance < *p.min_balance) return false;
+    if (p.max_balance && w.balance > *p.max_balance) return false;
+    return true;
+}
+
+void copyProgress(const Progress& progress, models::Campaign& campaign) {
+    campaign.processed = progress.processed.load();
+    campaign.credited = progress.credited.load();
+    campaign.already_credited = progress.alreadyCredited.load();
+    campaign.skipped = progress.skipped.load();
+    campaign.failed = progress.failed.load();
+}
+
+} // namespace
+
+std::optional<models::Campaign> CampaignService::createCampaign(const models::Campaign& rule) {
+    if (rule.amount <= 0) return std::nullopt;
+    if (rule.target != "all" && rule.target != "list" && rule.target != "predicate") {
+        return std::nullopt;
+    }
+    if (rule.target == "list" && rule.usernames.empty()) return std::nullopt;
+    if (!rule.campaign_id.empty() && !models::validCampaignId(rule.campaign_id)) return std::nullopt;
+
+    models::Campaign campaign = rule;
+    if (campaign.campaign_id.empty()) {
+        campaign.campaign_id = models::Id128::generate().toString();
+    } else if (auto existing = storage::CampaignStorage::load(campaign.campaign_id)) {
+        return existing;
+    }
+
+    campaign.status = "pending";
+    campaign.processed = campaign.credited = campaign.already_credited = 0;
+    campaign.skipped = campaign.failed = 0;
+    if (!storage::CampaignStorage::save(campaign)) return std::nullopt;
+    return campaign;
+}
+
+std::optional<models::Campaign> CampaignService::getCampaign(const std::string& campaignId) {
+    return storage::CampaignStorage::load(campaignId);
+}
+
+std::vector<models::Campaign> CampaignService::listCampaigns() {
+    return storage::CampaignStorage::listAll();
+}
+
+std::string CampaignService::transactionIdFor(const std::string& campaignId,
+                                              const std::string& walletId) {
+    return storage::IdempotencyIndex::digest("campaign:" + campaignId + ":" + walletId);
+}
+
+std::optional<models::Campaign> CampaignService::runCampaign(const std::string& campaignId,
+                                                             unsigned workers) {
+    {
+        std::lock_guard<std::mutex> lock(runningMutex);
+        if (!runningCampaigns.insert(campaignId).second) return std::nullopt;
+    }
+    struct RunningGuard {
+        const std::string& id;
+        ~RunningGuard() {
+            std::lock_guard<std::mutex> lock(runningMutex);
+            runningCampaigns.erase(id);
+        }
+    } guard{campaignId};
+
+    auto campaignOpt = storage::CampaignStorage::load(campaignId);
+    if (!campaignOpt) return std::nullopt;
+    models::Campaign campaign = std::move(*campaignOpt);
+    if (campaign.status == "completed") return campaign;
+
+    // A "running" status on disk means a previous run was interrupted; resuming is safe because
+    // every wallet is credited under a deterministic transaction ID that is applied at most once
+    campaign.status = "running";
+    campaign.processed = campaign.credited = campaign.already_credited = 0;
+    campaign.skipped = campaign.failed = 0;
+    if (!storage::CampaignStorage::save(campaign)) return std::nullopt;
+
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+
+    Progress progress;
+    WorkQueue queue;
+    std::mutex checkpointMutex;
+
+    auto checkpoint = [&]() {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        copyProgress(progress, campaign);
+        storage::CampaignStorage::save(campaign);
+    };
+
+    // Each wallet's credit is keyed in the idempotency index, in the campaign scope so no client
+    // key can collide with it, and a resumed run finds the wallets it already credited without
+    // reading them
+    using Index = storage::IdempotencyIndex;
+    std::string fingerprint = "campaign|" + nlohmann::json(campaign.amount).dump();
+    auto eligible = [&](const models::Wallet& wallet) {
+        return campaign.target != "predicate" || matchesWallet(campaign.predicate, wallet);
+    };
+    auto credit = [&](const std::string& walletId) {
+        std::string key = "campaign:" + campaign.campaign_id + ":" + walletId;
+        auto claim = Index::reserve(key, walletId, fingerprint, Index::Scope::Campaign);
+        if (claim.status == Index::Status::Duplicate) {
+            progress.alreadyCredited++;
+            return;
+        }
+        // Without the reservation (another run still holds it, or it could not be stored) the
+        // credit goes ahead anyway: its transaction ID is applied at most once per wallet
+        bool reserved = claim.status == Index::Status::Reserved;
+        std::string txId = transactionIdFor(campaign.campaign_id, walletId);
+        // The balance predicate is tested under the wallet lock, on the balance being credited
+        auto outcome = WalletService::executeTransactionIf(walletId, txId, campaign.amount, "credit",
+                                                           campaign.description, eligible);
+        if (outcome == ConditionalOutcome::Applied || outcome == ConditionalOutcome::AlreadyApplied) {
+            (outcome == ConditionalOutcome::Applied ? progress.credited : progress.alreadyCredited)++;
+            Index::complete(key, {walletId, txId, fingerprint}, Index::Scope::Campaign);
+        } else {
+            (outcome == ConditionalOutcome::Skipped ? progress.skipped : progress.failed)++;
+            if (reserved) Index::abandon(key, Index::Scope::Campaign);
+        }
+    };
+
+    // Worker I/O is charged to the request that started the run
+    storage::UsageShare usage;
+    auto worker = [&]() {
+        storage::UsageScope scope(usage);
+        models::UserAccount user;
+        while (queue.pop(user)) {
+            if (user.wallet_id.empty()) {
+                progress.skipped++;
+            } else {
+                credit(user.wallet_id);
+            }
+            if (++progress.processed % kCheckpointEvery == 0) checkpoint();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (unsigned i = 0; i < workers; ++i) pool.emplace_back(worker);
+
+    if (campaign.target == "list") {
+        std::vector<std::optional<models::UserAccount>> users;
+        storage::UserStorage::loadMany(campaign.usernames, users);
+        for (auto& userOpt : users) {
+            if (!userOpt) {
+                progress.skipped++;
+                progress.processed++;
+                continue;
+            }
+            queue.push(std::move(*userOpt));
+        }
+    } else {
+        bool filter = campaign.target == "predicate";
+        storage::UserStorage::forEach([&](const models::UserAccount& user) {
+            if (filter && !matchesProfile(campaign.predicate, user)) {
+                progress.skipped++;
+                progress.processed++;
+                return true;
+            }
+            queue.push(user);
+            return true;
+        });
+    }
+    queue.close();
+    for (auto& t : pool) t.join();
+    usage.join();
+
+    copyProgress(progress, campaign);
+    // Failed wallets leave the campaign resumable so a rerun retries only what is missing
+    campaign.status = campaign.failed == 0 ? "completed" : "interrupted";
+    storage::CampaignStorage::save(campaign);
+    return campaign;
+}
+
+} // namespace services
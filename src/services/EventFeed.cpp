@@ -0,0 +1,518 @@
+#include "services/EventFeed.h"
+#include "storage/FileManager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace services {
+
+namespace {
+
+constexpr uint64_t kCapacity = EventFeed::kCapacity;
+constexpr uint64_t kMask = kCapacity - 1;
+static_assert((kCapacity & kMask) == 0, "ring capacity must be a power of two");
+
+// Events parked in memory per Spill subscriber until the spill writer stores them; beyond
+// this a slow subscriber loses events as under Drop
+constexpr size_t kMaxPendingSpill = 4 * kCapacity;
+
+constexpr size_t kTextBytes = 216;
+constexpr int kFields = 5;
+
+// An event as stored in a slot and in spill files: fixed size, text fields packed back to back
+struct Record {
+    uint64_t sequence;
+    int64_t timestamp_us;
+    double amount;
+    double balance;
+    uint8_t type;
+    uint8_t truncated;
+    // wallet_id, transaction_id, username, transaction_type, asset
+    uint8_t lengths[kFields];
+    uint8_t reserved[1];
+    char text[kTextBytes];
+};
+
+constexpr size_t kWords = sizeof(Record) / sizeof(uint64_t);
+static_assert(sizeof(Record) % sizeof(uint64_t) == 0, "records are copied word by word");
+static_assert(std::is_trivially_copyable_v<Record>, "records are copied as raw words");
+
+// Seqlock slot: version is 2s+1 while event s is being written and 2s+2 once it is complete.
+// The payload is copied with relaxed atomic word accesses, so a reader racing a writer sees
+// a torn copy that the version recheck rejects rather than undefined behaviour.
+struct alignas(64) Slot {
+    std::atomic<uint64_t> version{0};
+    std::atomic<uint64_t> words[kWords];
+};
+
+struct Ring {
+    alignas(64) std::atomic<uint64_t> head{0};
+    std::unique_ptr<Slot[]> slots{new Slot[kCapacity]};
+};
+
+struct SubscriberState {
+    std::atomic<bool> active{false};
+    std::atomic<SlowConsumerPolicy> policy{SlowConsumerPolicy::Drop};
+    // Next sequence the subscriber will deliver; published for the Block and Spill checks
+    alignas(64) std::atomic<uint64_t> cursor{0};
+    // Spilled events cover every sequence below spillNext that was still unread
+    std::atomic<uint64_t> spillNext{0};
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> spilled{0};
+    std::atomic<uint64_t> producerWaits{0};
+    std::atomic<uint64_t> blockTimeouts{0};
+    // Set when a Block publisher gave up waiting; publishers then overwrite without waiting
+    // until the subscriber polls again
+    std::atomic<bool> stalled{false};
+    // Guards pending and spillNext; only taken once the subscriber has fallen a ring behind.
+    // Publishers copy events aside into pending, the spill writer moves them to the file.
+    std::mutex spillMutex;
+    std::vector<Record> pending;
+    // Guards the spill file; taken before spillMutex when both are held
+    std::mutex fileMutex;
+    int spillFd = -1;
+    std::string spillPath;
+    uint64_t spillWriteOffset = 0;
+    uint64_t spillReadOffset = 0;
+};
+
+std::atomic<size_t> activeSubscribers{0};
+std::atomic<uint64_t> published{0};
+// Subscriber states are never freed, so publishers can inspect them without a lock
+SubscriberState subscribers[EventFeed::kMaxSubscribers];
+std::mutex subscribeMutex;
+
+Ring& ring() {
+    static Ring r;
+    return r;
+}
+
+int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void pack(Record& rec, const std::string* fields[kFields]) {
+    size_t used = 0;
+    for (int i = 0; i < kFields; ++i) {
+        size_t room = std::min<size_t>(kTextBytes - used, 255);
+        size_t n = std::min(fields[i]->size(), room);
+        if (n < fields[i]->size()) rec.truncated = 1;
+        std::memcpy(rec.text + used, fields[i]->data(), n);
+        rec.lengths[i] = static_cast<uint8_t>(n);
+        used += n;
+    }
+}
+
+WalletEvent unpack(const Record& rec) {
+    WalletEvent event;
+    event.sequence = rec.sequence;
+    event.type = static_cast<WalletEventType>(rec.type);
+    event.timestamp_us = rec.timestamp_us;
+    event.amount = rec.amount;
+    event.balance = rec.balance;
+    event.truncated = rec.truncated != 0;
+    std::string* fields[kFields] = {&event.wallet_id, &event.transaction_id, &event.username,
+                                    &event.transaction_type, &event.asset};
+    size_t used = 0;
+    for (int i = 0; i < kFields; ++i) {
+        fields[i]->assign(rec.text + used, rec.lengths[i]);
+        used += rec.lengths[i];
+    }
+    return event;
+}
+
+// Copies slot s's event out if the slot still holds it intact
+bool readSlot(uint64_t s, Record& rec, uint64_t& version) {
+    Slot& slot = ring().slots[s & kMask];
+    version = slot.version.load(std::memory_order_acquire);
+    if (version != 2 * s + 2) return false;
+    uint64_t words[kWords];
+    for (size_t i = 0; i < kWords; ++i) words[i] = slot.words[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != version) {
+        version = 2 * s + 3;
+        return false;
+    }
+    std::memcpy(&rec, words, sizeof(rec));
+    return true;
+}
+
+bool writeAll(int fd, const void* data, size_t size, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Appends events moved aside by publishers to their subscribers' spill files, so no file
+// I/O happens on the publishing path (which runs under the wallet's record lock)
+class SpillWriter {
+public:
+    SpillWriter() : thread_([this] { run(); }) {}
+
+    ~SpillWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    void notify() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            dirty_ = true;
+        }
+        wake_.notify_one();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] { return stop_ || dirty_; });
+            if (stop_) return;
+            dirty_ = false;
+            lock.unlock();
+            for (auto& sub : subscribers) store(sub);
+            lock.lock();
+        }
+    }
+
+    static void store(SubscriberState& sub) {
+        std::lock_guard<std::mutex> file(sub.fileMutex);
+        std::vector<Record> records;
+        {
+            std::lock_guard<std::mutex> lock(sub.spillMutex);
+            if (sub.pending.empty() || !sub.active.load(std::memory_order_acquire)) return;
+            records.swap(sub.pending);
+        }
+        if (sub.spillFd < 0) {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(sub.spillPath).parent_path(), ec);
+            sub.spillFd = ::open(sub.spillPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        }
+        size_t bytes = records.size() * sizeof(Record);
+        if (sub.spillFd >= 0 && writeAll(sub.spillFd, records.data(), bytes, sub.spillWriteOffset)) {
+            sub.spillWriteOffset += bytes;
+            sub.spilled.fetch_add(records.size(), std::memory_order_relaxed);
+        } else {
+            sub.dropped.fetch_add(records.size(), std::memory_order_relaxed);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool dirty_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+SpillWriter& spillWriter() {
+    static SpillWriter w;
+    return w;
+}
+
+// Copies the subscriber's unread events up to and including `through` aside before a
+// publisher overwrites them; the spill writer stores them in the subscriber's file
+void spill(SubscriberState& sub, uint64_t through) {
+    {
+        std::lock_guard<std::mutex> lock(sub.spillMutex);
+        if (!sub.active.load(std::memory_order_acquire)) return;
+        uint64_t from = std::max(sub.cursor.load(std::memory_order_acquire),
+                                 sub.spillNext.load(std::memory_order_relaxed));
+        if (from > through) return;
+        for (uint64_t s = from; s <= through; ++s) {
+            Record rec;
+            uint64_t version;
+            // The event may still be mid-write by its own publisher
+            bool present;
+            while (!(present = readSlot(s, rec, version)) && version < 2 * s + 2) std::this_thread::yield();
+            if (present && sub.pending.size() < kMaxPendingSpill) {
+                sub.pending.push_back(rec);
+            } else {
+                sub.dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        sub.spillNext.store(through + 1, std::memory_order_release);
+    }
+    spillWriter().notify();
+}
+
+// Waits for a Block subscriber to free the slot, at most kMaxBlockMicros; after that the
+// subscriber is treated as Drop until it polls again
+void waitFor(SubscriberState& sub, uint64_t oldest) {
+    if (sub.stalled.load(std::memory_order_acquire)) return;
+    sub.producerWaits.fetch_add(1, std::memory_order_relaxed);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(EventFeed::kMaxBlockMicros);
+    while (sub.active.load(std::memory_order_acquire) && sub.cursor.load(std::memory_order_acquire) <= oldest) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            sub.blockTimeouts.fetch_add(1, std::memory_order_relaxed);
+            sub.stalled.store(true, std::memory_order_release);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void publish(Record& rec) {
+    if (activeSubscribers.load(std::memory_order_acquire) == 0) return;
+    Ring& r = ring();
+    uint64_t s = r.head.fetch_add(1, std::memory_order_acq_rel);
+    rec.sequence = s;
+    rec.timestamp_us = nowMicros();
+
+    // Only subscribers a full ring behind cost the publisher anything
+    if (s >= kCapacity) {
+        uint64_t oldest = s - kCapacity;
+        for (auto& sub : subscribers) {
+            if (!sub.active.load(std::memory_order_acquire)) continue;
+            if (sub.cursor.load(std::memory_order_acquire) > oldest) continue;
+            auto policy = sub.policy.load(std::memory_order_relaxed);
+            if (policy == SlowConsumerPolicy::Block) {
+                waitFor(sub, oldest);
+            } else if (policy == SlowConsumerPolicy::Spill) {
+                spill(sub, oldest);
+            }
+        }
+    }
+
+    Slot& slot = r.slots[s & kMask];
+    // The publisher of the event one lap earlier must have finished with the slot
+    uint64_t previous = s >= kCapacity ? 2 * (s - kCapacity) + 2 : 0;
+    while (slot.version.load(std::memory_order_acquire) < previous) std::this_thread::yield();
+    // Release, so a reader that sees the slot taken also sees any spill made for it
+    slot.version.store(2 * s + 1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    uint64_t words[kWords];
+    std::memcpy(words, &rec, sizeof(rec));
+    for (size_t i = 0; i < kWords; ++i) slot.words[i].store(words[i], std::memory_order_relaxed);
+    slot.version.store(2 * s + 2, std::memory_order_release);
+    published.fetch_add(1, std::memory_order_relaxed);
+}
+
+Record makeRecord(WalletEventType type, double amount, double balance,
+                  const std::string& walletId, const std::string& transactionId,
+                  const std::string& username, const std::string& transactionType, const std::string& asset) {
+    Record rec{};
+    rec.type = static_cast<uint8_t>(type);
+    rec.amount = amount;
+    rec.balance = balance;
+    const std::string* fields[kFields] = {&walletId, &transactionId, &username, &transactionType, &asset};
+    pack(rec, fields);
+    return rec;
+}
+
+} // namespace
+
+void EventFeed::publishTransaction(const std::string& walletId,
+                                   const std::string& transactionId,
+                                   const std::string& type,
+                                   double amount,
+                                   double balance,
+                                   const std::string& owner,
+                                   const std::string& asset) {
+    if (activeSubscribers.load(std::memory_order_acquire) == 0) return;
+    Record rec = makeRecord(WalletEventType::TransactionApplied, amount, balance, walletId, transactionId, owner, type,
+                            asset);
+    publish(rec);
+}
+
+void EventFeed::publishWalletCreated(const std::string& walletId, const std::string& owner) {
+    if (activeSubscribers.load(std::memory_order_acquire) == 0) return;
+    static const std::string none;
+    Record rec = makeRecord(WalletEventType::WalletCreated, 0, 0, walletId, none, owner, none, none);
+    publish(rec);
+}
+
+void EventFeed::publishUserDeleted(const std::string& username) {
+    if (activeSubscribers.load(std::memory_order_acquire) == 0) return;
+    static const std::string none;
+    Record rec = makeRecord(WalletEventType::UserDeleted, 0, 0, none, none, username, none, none);
+    publish(rec);
+}
+
+EventFeedStats EventFeed::stats() {
+    EventFeedStats stats;
+    stats.published = published.load(std::memory_order_relaxed);
+    for (auto& sub : subscribers) {
+        if (!sub.active.load(std::memory_order_acquire)) continue;
+        ++stats.subscribers;
+        stats.dropped += sub.dropped.load(std::memory_order_relaxed);
+        stats.spilled += sub.spilled.load(std::memory_order_relaxed);
+        stats.producer_waits += sub.producerWaits.load(std::memory_order_relaxed);
+        stats.block_timeouts += sub.blockTimeouts.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+EventSubscription::EventSubscription(const std::string& name, SlowConsumerPolicy policy) {
+    std::lock_guard<std::mutex> lock(subscribeMutex);
+    for (size_t i = 0; i < EventFeed::kMaxSubscribers; ++i) {
+        auto& sub = subscribers[i];
+        if (sub.active.load(std::memory_order_acquire)) continue;
+        std::lock_guard<std::mutex> fileLock(sub.fileMutex);
+        std::lock_guard<std::mutex> spillLock(sub.spillMutex);
+        sub.policy.store(policy, std::memory_order_relaxed);
+        uint64_t start = ring().head.load(std::memory_order_acquire);
+        sub.cursor.store(start, std::memory_order_release);
+        sub.spillNext.store(start, std::memory_order_relaxed);
+        sub.delivered.store(0, std::memory_order_relaxed);
+        sub.dropped.store(0, std::memory_order_relaxed);
+        sub.spilled.store(0, std::memory_order_relaxed);
+        sub.producerWaits.store(0, std::memory_order_relaxed);
+        sub.blockTimeouts.store(0, std::memory_order_relaxed);
+        sub.stalled.store(false, std::memory_order_relaxed);
+        sub.pending.clear();
+        sub.spillPath = storage::FileManager::resolve("data/feed/" + name + "." + std::to_string(::getpid()) +
+                                                      "." + std::to_string(i) + ".spill");
+        sub.spillWriteOffset = sub.spillReadOffset = 0;
+        sub.active.store(true, std::memory_order_release);
+        activeSubscribers.fetch_add(1, std::memory_order_acq_rel);
+        if (policy == SlowConsumerPolicy::Spill) spillWriter();
+        slot_ = static_cast<int>(i);
+        return;
+    }
+}
+
+EventSubscription::~EventSubscription() {
+    if (slot_ < 0) return;
+    std::lock_guard<std::mutex> lock(subscribeMutex);
+    auto& sub = subscribers[slot_];
+    std::lock_guard<std::mutex> fileLock(sub.fileMutex);
+    std::lock_guard<std::mutex> spillLock(sub.spillMutex);
+    sub.active.store(false, std::memory_order_release);
+    activeSubscribers.fetch_sub(1, std::memory_order_acq_rel);
+    sub.pending.clear();
+    if (sub.spillFd >= 0) {
+        ::close(sub.spillFd);
+        sub.spillFd = -1;
+        ::unlink(sub.spillPath.c_str());
+    }
+}
+
+size_t EventSubscription::poll(std::vector<WalletEvent>& out, size_t max) {
+    if (slot_ < 0) return 0;
+    auto& sub = subscribers[slot_];
+    uint64_t c = sub.cursor.load(std::memory_order_relaxed);
+    size_t count = 0;
+    auto deliver = [&](const Record& rec) {
+        out.push_back(unpack(rec));
+        ++count;
+        // Spilled events can have gaps where some were lost
+        c = rec.sequence + 1;
+        sub.cursor.store(c, std::memory_order_release);
+    };
+
+    while (count < max) {
+        // Events a publisher had to move aside come first, in order: those already in the
+        // spill file, then those still waiting for the spill writer
+        if (sub.spillNext.load(std::memory_order_acquire) > c) {
+            std::lock_guard<std::mutex> file(sub.fileMutex);
+            Record rec;
+            while (count < max && sub.spillReadOffset < sub.spillWriteOffset) {
+                ssize_t n = ::pread(sub.spillFd, &rec, sizeof(rec), static_cast<off_t>(sub.spillReadOffset));
+                if (n != static_cast<ssize_t>(sizeof(rec))) {
+                    sub.spillReadOffset = sub.spillWriteOffset;
+                    break;
+                }
+                sub.spillReadOffset += sizeof(rec);
+                // Already read from the ring before it was spilled
+                if (rec.sequence < c) continue;
+                deliver(rec);
+            }
+            if (sub.spillReadOffset == sub.spillWriteOffset && sub.spillFd >= 0) {
+                sub.spillReadOffset = sub.spillWriteOffset = 0;
+                if (::ftruncate(sub.spillFd, 0) != 0) {}
+            }
+            if (sub.spillReadOffset != 0) continue;
+            std::lock_guard<std::mutex> lock(sub.spillMutex);
+            size_t taken = 0;
+            for (; count < max && taken < sub.pending.size(); ++taken) {
+                if (sub.pending[taken].sequence >= c) deliver(sub.pending[taken]);
+            }
+            sub.pending.erase(sub.pending.begin(), sub.pending.begin() + taken);
+            // Lost to a full spill buffer or a failed spill write
+            uint64_t spillNext = sub.spillNext.load(std::memory_order_acquire);
+            if (sub.pending.empty() && c < spillNext) {
+                c = spillNext;
+                sub.cursor.store(c, std::memory_order_release);
+            }
+            continue;
+        }
+
+        Record rec;
+        uint64_t version;
+        if (readSlot(c, rec, version)) {
+            deliver(rec);
+            continue;
+        }
+        // Not published yet
+        if (version < 2 * c + 2) break;
+        // Lapped: spilled events are picked up above, dropped ones are skipped. Publishers
+        // spill under the mutex before overwriting, so checking under it cannot miss a spill.
+        if (sub.policy.load(std::memory_order_relaxed) == SlowConsumerPolicy::Spill) {
+            std::lock_guard<std::mutex> lock(sub.spillMutex);
+            if (sub.spillNext.load(std::memory_order_acquire) > c) continue;
+        }
+        uint64_t head = ring().head.load(std::memory_order_acquire);
+        uint64_t resume = std::max(c + 1, head > kCapacity ? head - kCapacity : 0);
+        sub.dropped.fetch_add(resume - c, std::memory_order_relaxed);
+        c = resume;
+        sub.cursor.store(c, std::memory_order_release);
+    }
+    sub.delivered.fetch_add(count, std::memory_order_relaxed);
+    // Caught up as far as it can; a Block publisher may wait for it again
+    sub.stalled.store(false, std::memory_order_release);
+    return count;
+}
+
+std::optional<WalletEvent> EventSubscription::next(std::chrono::microseconds timeout) {
+    std::vector<WalletEvent> events;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (int attempt = 0;; ++attempt) {
+        if (poll(events, 1) == 1) return std::move(events.front());
+        if (std::chrono::steady_clock::now() >= deadline) return std::nullopt;
+        // Spin first so a waiting consumer reacts within microseconds, then back off
+        if (attempt < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+SubscriptionStats EventSubscription::stats() const {
+    SubscriptionStats stats;
+    if (slot_ < 0) return stats;
+    const auto& sub = subscribers[slot_];
+    stats.delivered = sub.delivered.load(std::memory_order_relaxed);
+    stats.dropped = sub.dropped.load(std::memory_order_relaxed);
+    stats.spilled = sub.spilled.load(std::memory_order_relaxed);
+    stats.producer_waits = sub.producerWaits.load(std::memory_order_relaxed);
+    stats.block_timeouts = sub.blockTimeouts.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace services
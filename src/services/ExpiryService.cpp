@@ -0,0 +1,138 @@
+#include "services/ExpiryService.h"
+#include "services/WalletService.h"
+#include "storage/ExpirySchedule.h"
+#include "storage/ResourceUsage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace services {
+
+namespace {
+
+std::mutex runMutex;
+std::mutex reportMutex;
+std::optional<ExpiryReport> last;
+
+class BackgroundRunner {
+public:
+    void start(std::chrono::seconds interval) {
+        stop();
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+        thread_ = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, interval, [this] { return stop_; })) {
+                lock.unlock();
+                ExpiryService::runDue();
+                lock.lock();
+            }
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    ~BackgroundRunner() { stop(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+BackgroundRunner& runner() {
+    static BackgroundRunner r;
+    return r;
+}
+
+// Per-worker tallies, merged once the day is done
+struct Tally {
+    size_t expired = 0;
+    double points = 0;
+    size_t failures = 0;
+};
+
+} // namespace
+
+ExpiryReport ExpiryService::runDue(unsigned workers) {
+    std::lock_guard<std::mutex> running(runMutex);
+    auto start = std::chrono::steady_clock::now();
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    ExpiryReport report;
+
+    for (int64_t day : storage::ExpirySchedule::dueDays(now)) {
+        auto wallets = storage::ExpirySchedule::wallets(day);
+        ++report.days;
+        report.wallets_checked += wallets.size();
+
+        // Workers claim wallets from a shared cursor, so one slow wallet does not stall a stripe
+        std::atomic<size_t> next{0};
+        unsigned threads = static_cast<unsigned>(std::min<size_t>(workers, std::max<size_t>(1, wallets.size())));
+        std::vector<Tally> tallies(threads);
+        storage::UsageShare usage;
+        std::vector<std::thread> pool;
+        for (unsigned w = 0; w < threads; ++w) {
+            pool.emplace_back([&, w] {
+                storage::UsageScope scope(usage);
+                auto& tally = tallies[w];
+                for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < wallets.size();) {
+                    auto expired = WalletService::expirePoints(wallets[i], now);
+                    if (!expired) {
+                        ++tally.failures;
+                    } else if (*expired > 0) {
+                        ++tally.expired;
+                        tally.points += *expired;
+                    }
+                }
+            });
+        }
+        for (auto& t : pool) t.join();
+        usage.join();
+
+        size_t failures = 0;
+        for (const auto& tally : tallies) {
+            report.wallets_expired += tally.expired;
+            report.points_expired += tally.points;
+            failures += tally.failures;
+        }
+        report.failures += failures;
+        // Every wallet on the day is settled (expirePoints is idempotent, so a retry is safe)
+        if (failures == 0) storage::ExpirySchedule::remove(day);
+    }
+
+    report.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(reportMutex);
+    last = report;
+    return report;
+}
+
+void ExpiryService::startBackground(std::chrono::seconds interval) {
+    runner().start(interval);
+}
+
+void ExpiryService::stopBackground() {
+    runner().stop();
+}
+
+std::optional<ExpiryReport> ExpiryService::lastReport() {
+    std::lock_guard<std::mutex> lock(reportMutex);
+    return last;
+}
+
+} // namespace services
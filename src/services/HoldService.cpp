@@ -0,0 +1,285 @@
+#include "services/HoldService.h"
+#include "services/WalletService.h"
+#include "storage/FileManager.h"
+#include "storage/HoldStorage.h"
+#include "storage/IdempotencyIndex.h"
+#include "storage/WalletStorage.h"
+#include "models/Id128.h"
+#include "tracing/Tracer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace services {
+
+namespace {
+
+// Reserved amounts this small are rounding residue
+constexpr double kHeldEpsilon = 1e-9;
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string walletLockPath(const std::string& walletId) {
+    return "data/wallets/" + walletId + ".json";
+}
+
+// Hold IDs are "<wallet_id>-<id>", so a hold is found from its ID without an index
+std::optional<std::string> walletOf(const std::string& holdId) {
+    auto dash = holdId.rfind('-');
+    if (dash == std::string::npos || dash == 0 || dash + 1 == holdId.size()) return std::nullopt;
+    return holdId.substr(0, dash);
+}
+
+bool isFinal(const std::string& status) {
+    return status == "captured" || status == "released" || status == "expired";
+}
+
+// An authorized hold reserves its amount until it expires, whether or not expireDue has
+// marked it yet
+bool isActive(const models::Hold& hold, int64_t now) {
+    return hold.status == "authorized" && hold.expires_at > now;
+}
+
+double heldIn(const std::vector<models::Hold>& holds, const std::string& asset, int64_t now) {
+    double total = 0;
+    for (const auto& hold : holds) {
+        if (hold.asset == asset && isActive(hold, now)) total += hold.amount;
+    }
+    return total > kHeldEpsilon ? total : 0;
+}
+
+void finalize(models::Hold& hold, const std::string& status, int64_t now) {
+    hold.status = status;
+    hold.finalized_at = now;
+}
+
+std::vector<models::Hold>::iterator findHold(std::vector<models::Hold>& holds, const std::string& holdId) {
+    return std::find_if(holds.begin(), holds.end(), [&](const models::Hold& h) { return h.hold_id == holdId; });
+}
+
+// Settles a hold left "capturing" by a process that died during its debit; requires the
+// wallet locked. The debit either landed, and the hold is captured, or it did not, and the
+// hold is authorized again until it expires.
+void settleCapturing(models::Hold& hold, int64_t now) {
+    auto wallet = storage::WalletStorage::load(hold.wallet_id);
+    auto id = models::Id128::find(hold.transaction_id);
+    if (wallet && id && std::find(wallet->transaction_ids.begin(), wallet->transaction_ids.end(), *id) !=
+                            wallet->transaction_ids.end()) {
+        finalize(hold, "captured", now);
+        return;
+    }
+    hold.transaction_id.clear();
+    hold.captured = 0;
+    if (hold.expires_at <= now) {
+        finalize(hold, "expired", now);
+    } else {
+        hold.status = "authorized";
+    }
+}
+
+class BackgroundRunner {
+public:
+    void start(std::chrono::seconds interval) {
+        stop();
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+        thread_ = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, interval, [this] { return stop_; })) {
+                lock.unlock();
+                HoldService::expireDue(nowSeconds());
+                lock.lock();
+            }
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    ~BackgroundRunner() { stop(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+BackgroundRunner& runner() {
+    static BackgroundRunner r;
+    return r;
+}
+
+} // namespace
+
+std::optional<models::Hold> HoldService::authorize(const std::string& walletId,
+                                                   double amount,
+                                                   const std::string& asset,
+                                                   int64_t ttlSeconds) {
+    tracing::Span span("service", "HoldService::authorize");
+    if (!(amount > 0) || !models::validAssetCode(asset)) return std::nullopt;
+    if (ttlSeconds <= 0 || ttlSeconds > kMaxTtlSeconds) return std::nullopt;
+    // Excludes debits and other authorizations on the wallet between the check and the save
+    storage::RecordLock lock(walletLockPath(walletId), storage::LockMode::Exclusive);
+    auto walletOpt = storage::WalletStorage::load(walletId);
+    if (!walletOpt) return std::nullopt;
+    WalletService::foldCreditsIfShort(*walletOpt, asset, amount);
+    auto holds = storage::HoldStorage::load(walletId);
+    if (!holds) return std::nullopt;
+    int64_t now = nowSeconds();
+    if (walletOpt->balanceOf(asset) - heldIn(*holds, asset, now) < amount) return std::nullopt;
+
+    models::Hold hold;
+    hold.hold_id = walletId + "-" + models::Id128::generate().toString();
+    hold.wallet_id = walletId;
+    hold.asset = asset;
+    hold.amount = amount;
+    hold.created_at = now;
+    hold.expires_at = now + ttlSeconds;
+    hold.status = "authorized";
+    holds->push_back(hold);
+    if (!storage::HoldStorage::save(walletId, *holds)) return std::nullopt;
+    return hold;
+}
+
+std::optional<models::Hold> HoldService::capture(const std::string& holdId,
+                                                 double amount,
+                                                 const std::string& description) {
+    tracing::Span span("service", "HoldService::capture");
+    auto walletId = walletOf(holdId);
+    if (!walletId) return std::nullopt;
+    // Held from the check through the debit, so nothing else can spend the released amount
+    storage::RecordLock lock(walletLockPath(*walletId), storage::LockMode::Exclusive);
+    auto holds = storage::HoldStorage::load(*walletId);
+    if (!holds) return std::nullopt;
+    auto it = findHold(*holds, holdId);
+    if (it == holds->end()) return std::nullopt;
+    int64_t now = nowSeconds();
+    if (it->status == "capturing") settleCapturing(*it, now);
+    if (it->status == "captured") return *it;
+    if (it->status != "authorized") return std::nullopt;
+    if (it->expires_at <= now) {
+        finalize(*it, "expired", now);
+        storage::HoldStorage::save(*walletId, *holds);
+        return std::nullopt;
+    }
+    double take = amount > 0 ? amount : it->amount;
+    if (take > it->amount) return std::nullopt;
+
+    // Saved as capturing first: off the held total, which would otherwise count the hold
+    // against its own debit, and settled from the wallet if this process dies mid-debit
+    std::string txId = storage::IdempotencyIndex::digest(*walletId + ":hold:" + holdId);
+    it->status = "capturing";
+    it->transaction_id = txId;
+    it->captured = take;
+    if (!storage::HoldStorage::save(*walletId, *holds)) return std::nullopt;
+    bool ok = WalletService::executeTransactionWithId(*walletId, txId, take, "debit", description, "", it->asset);
+    if (ok) {
+        finalize(*it, "captured", nowSeconds());
+    } else {
+        it->status = "authorized";
+        it->transaction_id.clear();
+        it->captured = 0;
+    }
+    // If this save fails the hold stays capturing, and the next capture or expiry pass
+    // settles it from the wallet
+    storage::HoldStorage::save(*walletId, *holds);
+    if (!ok) return std::nullopt;
+    return *it;
+}
+
+std::optional<models::Hold> HoldService::release(const std::string& holdId) {
+    tracing::Span span("service", "HoldService::release");
+    auto walletId = walletOf(holdId);
+    if (!walletId) return std::nullopt;
+    storage::RecordLock lock(walletLockPath(*walletId), storage::LockMode::Exclusive);
+    auto holds = storage::HoldStorage::load(*walletId);
+    if (!holds) return std::nullopt;
+    auto it = findHold(*holds, holdId);
+    if (it == holds->end()) return std::nullopt;
+    if (it->status == "capturing") settleCapturing(*it, nowSeconds());
+    if (it->status == "released") return *it;
+    if (it->status != "authorized") return std::nullopt;
+    finalize(*it, "released", nowSeconds());
+    if (!storage::HoldStorage::save(*walletId, *holds)) return std::nullopt;
+    return *it;
+}
+
+std::optional<models::Hold> HoldService::get(const std::string& holdId) {
+    auto walletId = walletOf(holdId);
+    if (!walletId) return std::nullopt;
+    auto holds = storage::HoldStorage::load(*walletId);
+    if (!holds) return std::nullopt;
+    auto it = findHold(*holds, holdId);
+    if (it == holds->end()) return std::nullopt;
+    return *it;
+}
+
+double HoldService::held(const std::string& walletId, const std::string& asset) {
+    auto holds = storage::HoldStorage::load(walletId);
+    return holds ? heldIn(*holds, asset, nowSeconds()) : 0;
+}
+
+std::vector<std::pair<std::string, double>> HoldService::heldBy(const std::string& walletId) {
+    std::vector<std::pair<std::string, double>> result;
+    auto holds = storage::HoldStorage::load(walletId);
+    if (!holds) return result;
+    int64_t now = nowSeconds();
+    for (const auto& hold : *holds) {
+        if (!isActive(hold, now)) continue;
+        auto it = std::find_if(result.begin(), result.end(), [&](const auto& e) { return e.first == hold.asset; });
+        if (it == result.end()) it = result.insert(result.end(), {hold.asset, 0.0});
+        it->second += hold.amount;
+    }
+    return result;
+}
+
+size_t HoldService::expireDue(int64_t now) {
+    tracing::Span span("service", "HoldService::expireDue");
+    size_t expired = 0;
+    for (const auto& walletId : storage::HoldStorage::wallets()) {
+        storage::RecordLock lock(walletLockPath(walletId), storage::LockMode::Exclusive);
+        auto holds = storage::HoldStorage::load(walletId);
+        if (!holds) continue;
+        bool changed = false;
+        for (auto it = holds->begin(); it != holds->end();) {
+            if (it->status == "capturing") {
+                settleCapturing(*it, now);
+                changed = true;
+            }
+            if (it->status == "authorized" && it->expires_at <= now) {
+                finalize(*it, "expired", now);
+                changed = true;
+                ++expired;
+            } else if (isFinal(it->status) && it->finalized_at + kRetainSeconds <= now) {
+                it = holds->erase(it);
+                changed = true;
+                continue;
+            }
+            ++it;
+        }
+        if (changed) storage::HoldStorage::save(walletId, *holds);
+    }
+    return expired;
+}
+
+void HoldService::startBackground(std::chrono::seconds interval) {
+    runner().start(interval);
+}
+
+void HoldService::stopBackground() {
+    runner().stop();
+}
+
+} // namespace services
@@ -0,0 +1,359 @@
+#include "services/Leaderboard.h"
+#include "storage/FileManager.h"
+#include "storage/ResourceUsage.h"
+#include "storage/SaxModelReader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace services {
+
+namespace {
+
+constexpr int kMaxLevel = 32;
+
+struct Key {
+    double balance;
+    std::string walletId;
+};
+
+// Leaderboard order: higher balance first, then wallet ID
+bool before(const Key& a, const Key& b) {
+    if (a.balance != b.balance) return a.balance > b.balance;
+    return a.walletId < b.walletId;
+}
+
+class IndexedSkipList {
+public:
+    struct Node;
+    struct Link {
+        Node* next = nullptr;
+        // Entries passed by following this link (the target counts, the origin does not)
+        size_t span = 0;
+    };
+    struct Node {
+        Key key;
+        std::vector<Link> links;
+    };
+
+    IndexedSkipList() : head_(std::make_unique<Node>()) {
+        head_->links.resize(kMaxLevel);
+    }
+
+    ~IndexedSkipList() { clear(); }
+    IndexedSkipList(const IndexedSkipList&) = delete;
+    IndexedSkipList& operator=(const IndexedSkipList&) = delete;
+
+    void clear() {
+        Node* n = head_->links[0].next;
+        while (n) {
+            Node* next = n->links[0].next;
+            delete n;
+            n = next;
+        }
+        for (auto& l : head_->links) l = Link{};
+        level_ = 1;
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+
+    void insert(Key key) {
+        Node* update[kMaxLevel];
+        size_t rank[kMaxLevel];
+        Node* x = head_.get();
+        for (int i = level_ - 1; i >= 0; --i) {
+            rank[i] = i == level_ - 1 ? 0 : rank[i + 1];
+            while (x->links[i].next && before(x->links[i].next->key, key)) {
+                rank[i] += x->links[i].span;
+                x = x->links[i].next;
+            }
+            update[i] = x;
+        }
+        int level = randomLevel();
+        if (level > level_) {
+            for (int i = level_; i < level; ++i) {
+                rank[i] = 0;
+                update[i] = head_.get();
+                update[i]->links[i].span = size_;
+            }
+            level_ = level;
+        }
+        Node* node = new Node{std::move(key), std::vector<Link>(static_cast<size_t>(level))};
+        for (int i = 0; i < level; ++i) {
+            node->links[i].next = update[i]->links[i].next;
+            update[i]->links[i].next = node;
+            node->links[i].span = update[i]->links[i].span - (rank[0] - rank[i]);
+            update[i]->links[i].span = (rank[0] - rank[i]) + 1;
+        }
+        for (int i = level; i < level_; ++i) ++update[i]->links[i].span;
+        ++size_;
+    }
+
+    bool erase(const Key& key) {
+        Node* update[kMaxLevel];
+        Node* x = head_.get();
+        for (int i = level_ - 1; i >= 0; --i) {
+            while (x->links[i].next && before(x->links[i].next->key, key)) x = x->links[i].next;
+            update[i] = x;
+        }
+        x = x->links[0].next;
+        if (!x || before(key, x->key) || before(x->key, key)) return false;
+        for (int i = 0; i < level_; ++i) {
+            if (update[i]->links[i].next == x) {
+                update[i]->links[i].span += x->links[i].span - 1;
+                update[i]->links[i].next = x->links[i].next;
+            } else {
+                --update[i]->links[i].span;
+            }
+        }
+        while (level_ > 1 && !head_->links[level_ - 1].next) --level_;
+        --size_;
+        delete x;
+        return true;
+    }
+
+    // 1-based rank of key, 0 if absent
+    size_t rankOf(const Key& key) const {
+        size_t rank = 0;
+        const Node* x = head_.get();
+        for (int i = level_ - 1; i >= 0; --i) {
+            while (x->links[i].next && !before(key, x->links[i].next->key)) {
+                rank += x->links[i].span;
+                x = x->links[i].next;
+            }
+            if (x != head_.get() && !before(x->key, key)) return rank;
+        }
+        return 0;
+    }
+
+    // Node at 1-based rank, nullptr if out of range
+    const Node* at(size_t rank) const {
+        if (rank == 0 || rank > size_) return nullptr;
+        size_t traversed = 0;
+        const Node* x = head_.get();
+        for (int i = level_ - 1; i >= 0; --i) {
+            while (x->links[i].next && traversed + x->links[i].span <= rank) {
+                traversed += x->links[i].span;
+                x = x->links[i].next;
+            }
+            if (traversed == rank) return x;
+        }
+        return nullptr;
+    }
+
+    // Replaces the contents with keys already in leaderboard order, in O(n). Levels follow
+    // the binary ruler (entry i gets 1 + trailing zeros of i), a perfectly balanced list.
+    void assignSorted(std::vector<Key> keys) {
+        clear();
+        Node* last[kMaxLevel];
+        size_t lastRank[kMaxLevel];
+        for (int i = 0; i < kMaxLevel; ++i) {
+            last[i] = head_.get();
+            lastRank[i] = 0;
+        }
+        size_t rank = 0;
+        for (auto& key : keys) {
+            ++rank;
+            int level = 1;
+            while (level < kMaxLevel && (rank & ((size_t(1) << level) - 1)) == 0) ++level;
+            Node* node = new Node{std::move(key), std::vector<Link>(static_cast<size_t>(level))};
+            for (int i = 0; i < level; ++i) {
+                last[i]->links[i].next = node;
+                last[i]->links[i].span = rank - lastRank[i];
+                last[i] = node;
+                lastRank[i] = rank;
+            }
+            level_ = std::max(level_, level);
+        }
+        size_ = rank;
+        // Links off the end of each level span the remaining entries
+        for (int i = 0; i < kMaxLevel; ++i) last[i]->links[i].span = size_ - lastRank[i];
+    }
+
+private:
+    int randomLevel() {
+        int level = 1;
+        // p = 1/4, as the expected search cost is lowest near it
+        while (level < kMaxLevel && (rng_() & 3) == 0) ++level;
+        return level;
+    }
+
+    std::unique_ptr<Node> head_;
+    int level_ = 1;
+    size_t size_ = 0;
+    std::mt19937_64 rng_{0x5eed};
+};
+
+struct WalletEntry {
+    std::string owner;
+    double balance;
+};
+
+struct PendingUpdate {
+    std::string walletId;
+    std::optional<WalletEntry> entry;
+};
+
+std::shared_mutex boardMutex;
+IndexedSkipList board;
+std::unordered_map<std::string, WalletEntry> wallets;
+bool isBuilt = false;
+bool building = false;
+// Balance changes that arrive while a rebuild is scanning, replayed in order after it
+std::vector<PendingUpdate> pending;
+std::mutex rebuildMutex;
+
+// Requires boardMutex held exclusively
+void applyUpdate(const std::string& walletId, const std::optional<WalletEntry>& entry) {
+    auto it = wallets.find(walletId);
+    if (it != wallets.end()) {
+        board.erase(Key{it->second.balance, walletId});
+        if (!entry) {
+            wallets.erase(it);
+            return;
+        }
+        it->second = *entry;
+    } else {
+        if (!entry) return;
+        wallets.emplace(walletId, *entry);
+    }
+    board.insert(Key{entry->balance, walletId});
+}
+
+void record(const std::string& walletId, std::optional<WalletEntry> entry) {
+    std::unique_lock<std::shared_mutex> lock(boardMutex);
+    if (isBuilt) {
+        applyUpdate(walletId, entry);
+    } else if (building) {
+        pending.push_back(PendingUpdate{walletId, std::move(entry)});
+    }
+}
+
+LeaderboardEntry toEntry(size_t rank, const Key& key) {
+    auto it = wallets.find(key.walletId);
+    return LeaderboardEntry{rank, key.walletId, it != wallets.end() ? it->second.owner : "", key.balance};
+}
+
+} // namespace
+
+bool Leaderboard::rebuild(unsigned workers) {
+    std::lock_guard<std::mutex> serial(rebuildMutex);
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+    {
+        std::unique_lock<std::shared_mutex> lock(boardMutex);
+        building = true;
+        pending.clear();
+    }
+
+    auto paths = storage::FileManager::listRecords("data/wallets");
+    std::vector<std::vector<std::pair<Key, std::string>>> parts(workers);
+    storage::UsageShare usage;
+    std::vector<std::thread> pool;
+    for (unsigned w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w] {
+            storage::UsageScope scope(usage);
+            auto& out = parts[w];
+            for (size_t i = w; i < paths.size(); i += workers) {
+                models::Wallet wallet;
+                if (!storage::SaxModelReader::read(paths[i], wallet)) continue;
+                // Wallets of deleted users keep their file but leave the board
+                std::error_code ec;
+                if (!std::filesystem::exists(storage::FileManager::resolve("data/users/" + wallet.owner_username + ".json"), ec)) {
+                    continue;
+                }
+                out.emplace_back(Key{wallet.balance, wallet.wallet_id}, wallet.owner_username);
+            }
+            std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return before(a.first, b.first); });
+        });
+    }
+    for (auto& t : pool) t.join();
+    usage.join();
+
+    // Merge the sorted runs pairwise
+    while (parts.size() > 1) {
+        std::vector<std::vector<std::pair<Key, std::string>>> merged;
+        for (size_t i = 0; i + 1 < parts.size(); i += 2) {
+            std::vector<std::pair<Key, std::string>> out;
+            out.reserve(parts[i].size() + parts[i + 1].size());
+            std::merge(std::make_move_iterator(parts[i].begin()), std::make_move_iterator(parts[i].end()),
+                       std::make_move_iterator(parts[i + 1].begin()), std::make_move_iterator(parts[i + 1].end()),
+                       std::back_inserter(out), [](const auto& a, const auto& b) { return before(a.first, b.first); });
+            merged.push_back(std::move(out));
+        }
+        if (parts.size() % 2) merged.push_back(std::move(parts.back()));
+        parts = std::move(merged);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(boardMutex);
+    wallets.clear();
+    std::vector<Key> keys;
+    if (!parts.empty()) {
+        keys.reserve(parts[0].size());
+        wallets.reserve(parts[0].size());
+        for (auto& entry : parts[0]) {
+            wallets.emplace(entry.first.walletId, WalletEntry{std::move(entry.second), entry.first.balance});
+            keys.push_back(std::move(entry.first));
+        }
+    }
+    board.assignSorted(std::move(keys));
+    for (const auto& update : pending) applyUpdate(update.walletId, update.entry);
+    pending.clear();
+    building = false;
+    isBuilt = true;
+    return true;
+}
+
+void Leaderboard::ensureBuilt() {
+    if (built()) return;
+    // Concurrent first requests build it once
+    static std::mutex firstBuild;
+    std::lock_guard<std::mutex> lock(firstBuild);
+    if (!built()) rebuild();
+}
+
+bool Leaderboard::built() {
+    std::shared_lock<std::shared_mutex> lock(boardMutex);
+    return isBuilt;
+}
+
+void Leaderboard::update(const std::string& walletId, const std::string& owner, double balance) {
+    record(walletId, WalletEntry{owner, balance});
+}
+
+void Leaderboard::remove(const std::string& walletId) {
+    record(walletId, std::nullopt);
+}
+
+std::vector<LeaderboardEntry> Leaderboard::top(size_t limit, size_t offset) {
+    std::vector<LeaderboardEntry> result;
+    std::shared_lock<std::shared_mutex> lock(boardMutex);
+    const auto* node = board.at(offset + 1);
+    for (size_t rank = offset + 1; node && result.size() < limit; ++rank, node = node->links[0].next) {
+        result.push_back(toEntry(rank, node->key));
+    }
+    return result;
+}
+
+std::optional<LeaderboardEntry> Leaderboard::rankOf(const std::string& walletId) {
+    std::shared_lock<std::shared_mutex> lock(boardMutex);
+    auto it = wallets.find(walletId);
+    if (it == wallets.end()) return std::nullopt;
+    Key key{it->second.balance, walletId};
+    size_t rank = board.rankOf(key);
+    if (rank == 0) return std::nullopt;
+    return toEntry(rank, key);
+}
+
+size_t Leaderboard::size() {
+    std::shared_lock<std::shared_mutex> lock(boardMutex);
+    return board.size();
+}
+
+} // namespace services
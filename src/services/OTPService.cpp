@@ -54,8 +54,7 @@ bool OTPService::validateOTP(const std::string& username, const std::string& cod
             return false;
         }
         // Invalidate after successful validation
-        std::error_code ec;
-        fs::remove(path, ec);
+        storage::FileManager::removeFile(path);
         return true;
     } catch (...) {
         return false;
@@ -0,0 +1,194 @@
+#include "services/TieringService.h"
+#include "storage/FileManager.h"
+#include "storage/RecordIndex.h"
+#include "storage/SaxModelReader.h"
+#include "storage/TransactionArchive.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+namespace services {
+
+namespace {
+
+// Cold transactions per segment, bounding the memory of one pass
+constexpr size_t kSegmentRecords = 50000;
+// Index entries or hot files examined per pass; the next pass resumes after the last one
+constexpr size_t kScanPerPass = 100000;
+
+std::mutex runMutex;
+// Where the next pass resumes, guarded by runMutex: a position in the index's timestamp
+// order, or a path in the listing when the index is not loaded
+std::optional<storage::RecordIndex::TransactionPosition> indexCursor;
+std::string fileCursor;
+std::mutex reportMutex;
+std::optional<TieringReport> last;
+
+class BackgroundRunner {
+public:
+    void start(std::chrono::seconds interval, int coldAfterDays) {
+        stop();
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+        thread_ = std::thread([this, interval, coldAfterDays] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, interval, [this] { return stop_; })) {
+                lock.unlock();
+                TieringService::runOnce(coldAfterDays);
+                lock.lock();
+            }
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    ~BackgroundRunner() { stop(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+BackgroundRunner& runner() {
+    static BackgroundRunner r;
+    return r;
+}
+
+struct Candidate {
+    std::string path;
+    uint64_t bytes;
+    uint64_t diskBytes;
+};
+
+// The hot file's sizes, nullopt once it is gone
+std::optional<Candidate> candidateFor(const std::string& path) {
+    struct stat st;
+    if (::stat(storage::FileManager::resolve(path).c_str(), &st) != 0) return std::nullopt;
+    return Candidate{path, static_cast<uint64_t>(st.st_size), static_cast<uint64_t>(st.st_blocks) * 512};
+}
+
+// Removes the hot copies of records now in the archive
+void evict(const std::vector<Candidate>& batch, TieringReport& report) {
+    for (const auto& c : batch) {
+        if (!storage::FileManager::evictFile(c.path)) continue;
+        ++report.evicted;
+        report.hot_bytes_reclaimed += c.bytes;
+        report.hot_disk_bytes_reclaimed += c.diskBytes;
+    }
+}
+
+} // namespace
+
+TieringReport TieringService::runOnce(int coldAfterDays) {
+    std::lock_guard<std::mutex> running(runMutex);
+    auto start = std::chrono::steady_clock::now();
+    TieringReport report;
+    int64_t cutoff = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - int64_t(coldAfterDays) * 86400;
+
+    std::vector<models::Transaction> cold;
+    std::vector<Candidate> batch;
+    auto flush = [&] {
+        if (!cold.empty()) {
+            size_t count = cold.size();
+            auto bytes = storage::TransactionArchive::writeSegment(std::move(cold));
+            cold.clear();
+            // Keep the hot copies if the segment did not make it to disk
+            if (!bytes) {
+                batch.clear();
+                return;
+            }
+            ++report.segments_written;
+            report.archived += count;
+            report.archive_bytes_written += *bytes;
+        }
+        evict(batch, report);
+        batch.clear();
+    };
+
+    // Reads one hot file and queues it if it is past the cutoff
+    auto consider = [&](const std::string& path) {
+        std::string buffer;
+        if (!storage::FileManager::readFile(path, buffer)) return;
+        models::Transaction tx;
+        if (!storage::SaxModelReader::parse(buffer, tx)) return;
+        if (std::strtoll(tx.timestamp.c_str(), nullptr, 10) >= cutoff) return;
+        auto candidate = candidateFor(path);
+        if (!candidate) return;
+        batch.push_back(*candidate);
+        // Left over from an interrupted pass: already durable in the archive
+        if (storage::TransactionArchive::contains(tx.transaction_id)) return;
+        cold.push_back(std::move(tx));
+        if (cold.size() >= kSegmentRecords) flush();
+    };
+
+    if (storage::RecordIndex::loaded()) {
+        // The index orders transactions by timestamp, so only the cold end is visited and
+        // only hot files not yet archived are read
+        auto entries = storage::RecordIndex::transactionsBefore(cutoff, indexCursor, kScanPerPass);
+        indexCursor.reset();
+        if (entries.size() == kScanPerPass) indexCursor = entries.back();
+        for (const auto& entry : entries) {
+            ++report.scanned;
+            std::string path = "data/transactions/" + entry.id + ".json";
+            if (storage::TransactionArchive::contains(entry.id)) {
+                // Evicted hot copies stay in the index; one left by an interrupted pass goes now
+                if (auto candidate = candidateFor(path)) batch.push_back(*candidate);
+                continue;
+            }
+            consider(path);
+        }
+    } else {
+        auto paths = storage::FileManager::listRecords("data/transactions");
+        std::sort(paths.begin(), paths.end());
+        auto it = std::upper_bound(paths.begin(), paths.end(), fileCursor);
+        size_t examined = 0;
+        for (; it != paths.end() && examined < kScanPerPass; ++it, ++examined) {
+            ++report.scanned;
+            consider(*it);
+        }
+        fileCursor = it == paths.end() ? std::string() : *std::prev(it);
+    }
+    flush();
+
+    // Evictions change data/transactions without a change log entry; re-snapshot the index
+    // so the next start does not mistake them for an unlogged writer
+    if (report.evicted > 0 && storage::RecordIndex::loaded()) storage::RecordIndex::save();
+
+    report.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(reportMutex);
+    last = report;
+    return report;
+}
+
+void TieringService::startBackground(std::chrono::seconds interval, int coldAfterDays) {
+    runner().start(interval, coldAfterDays);
+}
+
+void TieringService::stopBackground() {
+    runner().stop();
+}
+
+std::optional<TieringReport> TieringService::lastReport() {
+    std::lock_guard<std::mutex> lock(reportMutex);
+    return last;
+}
+
+} // namespace services
@@ -1,5 +1,9 @@
 #include "services/UserService.h"
+#include "services/EventFeed.h"
+#include "services/Leaderboard.h"
+#include "tracing/Tracer.h"
 #include "storage/UserStorage.h"
+#include "storage/FileManager.h"
 #include "auth/AuthService.h"
 
 #include <filesystem>
@@ -11,6 +15,8 @@ bool UserService::registerUser(const std::string& username,
                                const std::string& password,
                                const std::string& email,
                                bool isAdmin) {
+    tracing::Span span("service", "UserService::registerUser");
+    storage::RecordLock lock("data/users/" + username + ".json", storage::LockMode::Exclusive);
     // Check if user exists
     if (storage::UserStorage::load(username).has_value()) return false;
     // Hash password
@@ -20,14 +26,17 @@ bool UserService::registerUser(const std::string& username,
 }
 
 std::optional<models::UserAccount> UserService::getProfile(const std::string& username) {
+    tracing::Span span("service", "UserService::getProfile");
     return storage::UserStorage::load(username);
 }
 
 bool UserService::updateProfile(const std::string& username,
                                 const std::string& email) {
+    tracing::Span span("service", "UserService::updateProfile");
+    storage::RecordLock lock("data/users/" + username + ".json", storage::LockMode::Exclusive);
     auto userOpt = storage::UserStorage::load(username);
     if (!userOpt) return false;
-    auto user = *userOpt;
+    auto user = std::move(*userOpt);
     user.email = email;
     return storage::UserStorage::save(user);
 }
@@ -35,9 +44,11 @@ bool UserService::updateProfile(const std::string& username,
 bool UserService::changePassword(const std::string& username,
                                  const std::string& oldPassword,
                                  const std::string& newPassword) {
+    tracing::Span span("service", "UserService::changePassword");
+    storage::RecordLock lock("data/users/" + username + ".json", storage::LockMode::Exclusive);
     auto userOpt = storage::UserStorage::load(username);
     if (!userOpt) return false;
-    auto user = *userOpt;
+    auto user = std::move(*userOpt);
     if (!auth::AuthService::verifyPassword(oldPassword, user.password_hash)) {
         return false;
     }
@@ -46,9 +57,13 @@ bool UserService::changePassword(const std::string& username,
 }
 
 bool UserService::deleteUser(const std::string& username) {
-    std::filesystem::path path("data/users/" + username + ".json");
-    std::error_code ec;
-    return std::filesystem::remove(path, ec);
+    tracing::Span span("service", "UserService::deleteUser");
+    auto user = storage::UserStorage::load(username);
+    if (!storage::FileManager::removeFile("data/users/" + username + ".json")) return false;
+    // The wallet file stays, but a deleted user's wallet no longer ranks
+    if (user && !user->wallet_id.empty()) Leaderboard::remove(user->wallet_id);
+    EventFeed::publishUserDeleted(username);
+    return true;
 }
 
 } // namespace services 
\ No newline at end of file
@@ -1,35 +1,423 @@
 #include "services/WalletService.h"
+#include "services/AssetLedger.h"
+#include "services/Leaderboard.h"
+#include "services/EventFeed.h"
+#include "services/HoldService.h"
+#include "tracing/Tracer.h"
 #include "storage/WalletStorage.h"
 #include "storage/TransactionStorage.h"
 #include "storage/UserStorage.h"
+#include "storage/FileManager.h"
+#include "storage/IdempotencyIndex.h"
+#include "storage/Snapshot.h"
+#include "storage/ExpirySchedule.h"
+#include "storage/CreditJournal.h"
 #include "models/UserAccount.h"
 
 #include <chrono>
-#include <random>
-#include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace services {
 
+namespace {
+
+constexpr int64_t kDaySeconds = 86400;
+// Lots smaller than this are rounding residue and are dropped
+constexpr double kLotEpsilon = 1e-9;
+// Transactions loaded per batch by forEachTransaction
+constexpr size_t kHistoryBatch = 256;
+
+std::atomic<int64_t> pointLifetime{int64_t(WalletService::kDefaultPointLifetimeDays) * kDaySeconds};
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+using IdIter = std::vector<models::Id128>::const_iterator;
+
+std::vector<std::string> idStrings(IdIter first, IdIter last) {
+    std::vector<std::string> out;
+    out.reserve(static_cast<size_t>(last - first));
+    for (; first != last; ++first) out.push_back(first->toString());
+    return out;
+}
+
+// Adds a credit to the wallet's lots. Expiry is rounded up to the start of the next day, so
+// a wallet holds at most one lot per day of credits and the schedule one entry per lot.
+// Returns false if the lot's day could not be scheduled.
+bool addLot(models::Wallet& wallet, double amount, int64_t now) {
+    int64_t day = (now + pointLifetime.load(std::memory_order_relaxed)) / kDaySeconds + 1;
+    int64_t expiresAt = day * kDaySeconds;
+    auto it = std::lower_bound(wallet.lots.begin(), wallet.lots.end(), expiresAt,
+                               [](const models::PointLot& lot, int64_t t) { return lot.expires_at < t; });
+    if (it != wallet.lots.end() && it->expires_at == expiresAt) {
+        it->amount += amount;
+        return true;
+    }
+    // Scheduled before the wallet is saved: a crash in between leaves a harmless extra entry
+    if (!storage::ExpirySchedule::add(day, wallet.wallet_id)) return false;
+    wallet.lots.insert(it, models::PointLot{amount, now, expiresAt});
+    return true;
+}
+
+// Records a debit of amount against the lots, oldest first. Balance not covered by lots
+// predates them all, so it is spent before any lot. Called before the debit is taken from
+// the balance.
+void consumeLots(models::Wallet& wallet, double amount) {
+    double tracked = 0;
+    for (const auto& lot : wallet.lots) tracked += lot.amount;
+    amount -= std::max(0.0, wallet.balance - tracked);
+    auto it = wallet.lots.begin();
+    while (it != wallet.lots.end() && amount > kLotEpsilon) {
+        double take = std::min(amount, it->amount);
+        it->amount -= take;
+        amount -= take;
+        if (it->amount > kLotEpsilon) break;
+        ++it;
+    }
+    wallet.lots.erase(wallet.lots.begin(), it);
+}
+
+// Transactions applied to a wallet in memory. saveWallet stores their records together with
+// the wallet, then announces them on the event feed.
+struct Applied {
+    std::vector<models::Transaction> transactions;
+    // Wallet balance after each transaction
+    std::vector<double> balances;
+
+    void add(models::Transaction tx, double balance) {
+        transactions.push_back(std::move(tx));
+        balances.push_back(balance);
+    }
+};
+
+// Expires the lots due at now with one debit transaction, recorded on the wallet but not
+// saved; returns the points expired. Must be called with the wallet locked.
+double expireDue(models::Wallet& wallet, int64_t now, Applied& applied) {
+    double amount = 0;
+    auto due = wallet.lots.begin();
+    for (; due != wallet.lots.end() && due->expires_at <= now; ++due) amount += due->amount;
+    if (due == wallet.lots.begin()) return 0.0;
+    int64_t lastExpiry = std::prev(due)->expires_at;
+    wallet.lots.erase(wallet.lots.begin(), due);
+    amount = std::min(amount, wallet.balance);
+    if (amount <= kLotEpsilon) return 0.0;
+
+    // Derived from the expiry time, so a retried expiry rewrites the same record
+    std::string txId = storage::IdempotencyIndex::digest(wallet.wallet_id + ":expire:" + std::to_string(lastExpiry));
+    wallet.balance -= amount;
+    wallet.transaction_ids.push_back(models::Id128::parse(txId));
+    applied.add(models::Transaction(txId, wallet.wallet_id, amount, std::to_string(now), "debit", "Points expired"),
+                wallet.balance);
+    return amount;
+}
+
+// Applies tx to the wallet in memory and adds it to applied. Fails on an unknown type, a
+// debit the asset's available balance (less active holds) does not cover, or a points credit
+// whose lot cannot be scheduled.
+bool applyTransaction(models::Wallet& wallet, models::Transaction tx, int64_t now, Applied& applied) {
+    bool points = tx.asset == models::kDefaultAsset;
+    if (tx.type == "debit") {
+        if (wallet.balanceOf(tx.asset) - HoldService::held(wallet.wallet_id, tx.asset) < tx.amount) return false;
+        if (points) consumeLots(wallet, tx.amount);
+        wallet.balanceFor(tx.asset) -= tx.amount;
+    } else if (tx.type == "credit") {
+        if (points && tx.amount > 0 && !addLot(wallet, tx.amount, now)) return false;
+        wallet.balanceFor(tx.asset) += tx.amount;
+    } else {
+        return false;
+    }
+    wallet.transaction_ids.push_back(models::Id128::parse(tx.transaction_id));
+    double balance = wallet.balanceOf(tx.asset);
+    applied.add(std::move(tx), balance);
+    return true;
+}
+
+bool listsTransaction(const models::Wallet& wallet, const std::string& transactionId) {
+    // A legacy id that was never interned is in no wallet's list
+    auto id = models::Id128::find(transactionId);
+    return id && std::find(wallet.transaction_ids.begin(), wallet.transaction_ids.end(), *id) != wallet.transaction_ids.end();
+}
+
+// Publishes a saved wallet's changes. Called still under the wallet lock, so the board, the
+// ledger and the feed see each wallet's changes in order.
+void announce(const models::Wallet& wallet, const Applied& applied) {
+    Leaderboard::update(wallet.wallet_id, wallet.owner_username, wallet.balance);
+    AssetLedger::update(wallet);
+    for (size_t i = 0; i < applied.transactions.size(); ++i) {
+        const auto& tx = applied.transactions[i];
+        EventFeed::publishTransaction(wallet.wallet_id, tx.transaction_id, tx.type, tx.amount, applied.balances[i],
+                                      wallet.owner_username, tx.asset);
+    }
+}
+
+bool saveWallet(const models::Wallet& wallet, const Applied& applied) {
+    // Records first, wallet last, in one write chain
+    if (!storage::WalletStorage::save(wallet, applied.transactions)) return false;
+    announce(wallet, applied);
+    return true;
+}
+
+// Per-asset amounts, in the order first seen
+using AssetAmounts = std::vector<std::pair<std::string, double>>;
+
+void addAmount(AssetAmounts& amounts, const std::string& asset, double amount) {
+    for (auto& entry : amounts) {
+        if (entry.first == asset) {
+            entry.second += amount;
+            return;
+        }
+    }
+    amounts.emplace_back(asset, amount);
+}
+
+// One journal of a hot wallet and what it holds: credits in its open log, and credits
+// sealed by a fold that has not saved the wallet yet
+struct CreditShard {
+    std::mutex mutex;
+    AssetAmounts open;
+    AssetAmounts sealed;
+};
+
+struct HotWallet {
+    explicit HotWallet(size_t n) : shards(new CreditShard[n]), count(n) {}
+    std::unique_ptr<CreditShard[]> shards;
+    size_t count;
+};
+
+std::shared_mutex hotMutex;
+std::unordered_map<std::string, std::shared_ptr<HotWallet>> hotWallets;
+
+std::shared_ptr<HotWallet> hotWallet(const std::string& walletId) {
+    std::shared_lock<std::shared_mutex> lock(hotMutex);
+    auto it = hotWallets.find(walletId);
+    return it == hotWallets.end() ? nullptr : it->second;
+}
+
+// Threads are dealt shards round-robin as they first credit, so up to as many threads as
+// there are shards never share one
+size_t threadSlot() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+bool journalCredit(HotWallet& hot, const models::Transaction& tx) {
+    size_t index = threadSlot() % hot.count;
+    auto& shard = hot.shards[index];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!storage::CreditJournal::append(tx.wallet_id, index, tx)) return false;
+    addAmount(shard.open, tx.asset, tx.amount);
+    return true;
+}
+
+// Folds journaled credits before a debit of amount that the wallet's balance of asset (less
+// holds) does not cover, and reloads wallet. The journal on disk is checked rather than this
+// process's counters, so credits journaled by another process count too. Must be called with
+// the wallet locked.
+void foldIfShort(models::Wallet& wallet, const std::string& asset, double amount) {
+    if (wallet.balanceOf(asset) - HoldService::held(wallet.wallet_id, asset) >= amount) return;
+    if (!storage::CreditJournal::hasPending(wallet.wallet_id)) return;
+    auto folded = WalletService::foldCredits(wallet.wallet_id);
+    if (!folded || *folded == 0) return;
+    if (auto reloaded = storage::WalletStorage::load(wallet.wallet_id)) wallet = std::move(*reloaded);
+}
+
+class FoldRunner {
+public:
+    void start(std::chrono::milliseconds interval) {
+        stop();
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+        thread_ = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, interval, [this] { return stop_; })) {
+                lock.unlock();
+                WalletService::foldAllCredits();
+                lock.lock();
+            }
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    ~FoldRunner() { stop(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+FoldRunner& foldRunner() {
+    static FoldRunner r;
+    return r;
+}
+
+// Loads the wallet under its lock, tests condition (if any) and applies the transaction
+ConditionalOutcome executeLocked(const std::string& walletId,
+                                 const std::string& transactionId,
+                                 double amount,
+                                 const std::string& type,
+                                 const std::string& description,
+                                 const std::string& idempotencyKey,
+                                 const std::string& asset,
+                                 const std::function<bool(const models::Wallet&)>* condition) {
+    // Serialises read-modify-write cycles on the wallet file across threads and processes
+    storage::RecordLock lock("data/wallets/" + walletId + ".json", storage::LockMode::Exclusive);
+    auto walletOpt = storage::WalletStorage::load(walletId);
+    if (!walletOpt) return ConditionalOutcome::Failed;
+    auto wallet = std::move(*walletOpt);
+
+    // Already applied: the wallet is saved last, so listing the ID means the whole write landed
+    if (listsTransaction(wallet, transactionId)) return ConditionalOutcome::AlreadyApplied;
+    if (condition && !(*condition)(wallet)) return ConditionalOutcome::Skipped;
+    if (type == "debit") foldIfShort(wallet, asset, amount);
+
+    // Points past their expiry are never spendable: retire them before this transaction
+    int64_t now = nowSeconds();
+    Applied applied;
+    double expired = expireDue(wallet, now, applied);
+
+    // Transaction record and wallet record are written together
+    models::Transaction tx(transactionId, walletId, amount, std::to_string(now), type, description);
+    tx.idempotency_key = idempotencyKey;
+    tx.asset = asset;
+    if (!applyTransaction(wallet, std::move(tx), now, applied)) {
+        if (expired > 0) saveWallet(wallet, applied);
+        return ConditionalOutcome::Failed;
+    }
+    return saveWallet(wallet, applied) ? ConditionalOutcome::Applied : ConditionalOutcome::Failed;
+}
+
+// Summary of a request stored with its idempotency key, so a reused key can be matched
+// against the request it was first used for
+std::string requestFingerprint(std::initializer_list<std::string> parts) {
+    std::string out;
+    for (const auto& part : parts) {
+        if (!out.empty()) out += '|';
+        out += part;
+    }
+    return out;
+}
+
+// Shortest text that reads back as the same double
+std::string amountText(double amount) {
+    return nlohmann::json(amount).dump();
+}
+
+// Result of a request whose key was not reserved for it
+TransactionResult claimedResult(const storage::IdempotencyIndex::Claim& claim) {
+    using Status = storage::IdempotencyIndex::Status;
+    TransactionResult result{false, "", false};
+    if (claim.status == Status::Duplicate) {
+        result = TransactionResult{true, claim.entry.transaction_id, true};
+    } else if (claim.status == Status::Conflict) {
+        result.conflict = true;
+    } else if (claim.status == Status::InProgress) {
+        result.in_progress = true;
+    }
+    return result;
+}
+
+// Applies whichever halves of a transfer have not landed, as one write chain
+TransactionResult transferOnce(const std::string& fromWalletId,
+                               const std::string& toWalletId,
+                               double amount,
+                               const std::string& asset,
+                               const std::string& description,
+                               const std::string& idempotencyKey) {
+    // With a key both IDs are derived from it, so a retry finds whichever half already landed
+    std::string debitId = idempotencyKey.empty()
+                              ? models::Id128::generate().toString()
+                              : storage::IdempotencyIndex::digest(fromWalletId + ":transfer:" + idempotencyKey);
+    std::string creditId = storage::IdempotencyIndex::digest(debitId + ":credit");
+
+    // Taken in path order, so two transfers in opposite directions cannot deadlock
+    std::string fromPath = "data/wallets/" + fromWalletId + ".json";
+    std::string toPath = "data/wallets/" + toWalletId + ".json";
+    storage::RecordLock firstLock(std::min(fromPath, toPath), storage::LockMode::Exclusive);
+    storage::RecordLock secondLock(std::max(fromPath, toPath), storage::LockMode::Exclusive);
+    auto fromOpt = storage::WalletStorage::load(fromWalletId);
+    auto toOpt = storage::WalletStorage::load(toWalletId);
+    if (!fromOpt || !toOpt) return TransactionResult{false, "", false};
+    auto from = std::move(*fromOpt);
+    auto to = std::move(*toOpt);
+    bool debited = listsTransaction(from, debitId);
+    bool credited = listsTransaction(to, creditId);
+    if (debited && credited) return TransactionResult{true, debitId, true};
+    if (!debited) foldIfShort(from, asset, amount);
+
+    int64_t now = nowSeconds();
+    std::string timestamp = std::to_string(now);
+    Applied fromApplied;
+    Applied toApplied;
+    double expired = expireDue(from, now, fromApplied);
+    expireDue(to, now, toApplied);
+    if (!debited) {
+        models::Transaction debit(debitId, fromWalletId, amount, timestamp, "debit", description);
+        debit.idempotency_key = idempotencyKey;
+        debit.asset = asset;
+        if (!applyTransaction(from, std::move(debit), now, fromApplied)) {
+            if (expired > 0) saveWallet(from, fromApplied);
+            return TransactionResult{false, "", false};
+        }
+    }
+    if (!credited) {
+        models::Transaction credit(creditId, toWalletId, amount, timestamp, "credit", description);
+        credit.asset = asset;
+        if (!applyTransaction(to, std::move(credit), now, toApplied)) return TransactionResult{false, "", false};
+    }
+
+    // One write chain: every record, then the sender, then the recipient. A crash between the
+    // two wallets leaves only the debit applied, which a retry under the same key completes.
+    std::vector<models::Transaction> records = fromApplied.transactions;
+    records.insert(records.end(), toApplied.transactions.begin(), toApplied.transactions.end());
+    if (!storage::WalletStorage::save({&from, &to}, records)) return TransactionResult{false, "", false};
+    announce(from, fromApplied);
+    announce(to, toApplied);
+    return TransactionResult{true, debitId, debited};
+}
+
+
+} // namespace
+
 std::optional<std::string> WalletService::createWallet(const std::string& username) {
+    tracing::Span span("service", "WalletService::createWallet");
+    // Held across the read-modify-write of the user record, against other threads and processes
+    storage::RecordLock lock("data/users/" + username + ".json", storage::LockMode::Exclusive);
     // Check if user already has a wallet
     auto userOpt = storage::UserStorage::load(username);
     if (!userOpt) return std::nullopt;
     
-    auto user = *userOpt;
+    auto user = std::move(*userOpt);
     if (!user.wallet_id.empty()) {
         return std::nullopt;  // User already has a wallet
     }
 
     // Generate unique wallet ID
-    std::random_device rd;
-    std::mt19937_64 eng(rd());
-    std::uniform_int_distribution<uint64_t> distr;
-    uint64_t rnd = distr(eng);
-    auto now = std::chrono::system_clock::now().time_since_epoch().count();
-    std::ostringstream oss;
-    oss << std::hex << rnd << now;
-    std::string walletId = oss.str();
+    std::string walletId = models::Id128::generate().toString();
 
     models::Wallet wallet(walletId, username, 0.0);
     bool ok = storage::WalletStorage::save(wallet);
@@ -39,74 +427,301 @@ std::optional<std::string> WalletService::createWallet(const std::string& userna
     user.wallet_id = walletId;
     if (!storage::UserStorage::save(user)) {
         // If we can't update the user, delete the wallet
-        std::filesystem::remove("data/wallets/" + walletId + ".json");
+        storage::FileManager::removeFile("data/wallets/" + walletId + ".json");
+        Leaderboard::remove(walletId);
         return std::nullopt;
     }
+    Leaderboard::update(walletId, username, 0.0);
+    AssetLedger::update(wallet);
+    EventFeed::publishWalletCreated(walletId, username);
 
     return walletId;
 }
 
 std::optional<models::Wallet> WalletService::getWallet(const std::string& walletId) {
+    tracing::Span span("service", "WalletService::getWallet");
     return storage::WalletStorage::load(walletId);
 }
 
 bool WalletService::executeTransaction(const std::string& walletId,
                                        double amount,
                                        const std::string& type,
-                                       const std::string& description) {
-    auto walletOpt = storage::WalletStorage::load(walletId);
-    if (!walletOpt) return false;
-    auto wallet = *walletOpt;
+                                       const std::string& description,
+                                       const std::string& idempotencyKey,
+                                       const std::string& asset) {
+    if (!idempotencyKey.empty()) {
+        return executeTransactionIdempotent(walletId, amount, type, description, idempotencyKey, asset).success;
+    }
+
+    // Generate transaction ID
+    std::string txId = models::Id128::generate().toString();
 
-    // Apply transaction
-    if (type == "debit") {
-        if (wallet.balance < amount) {
-            return false;
+    return executeTransactionWithId(walletId, txId, amount, type, description, "", asset);
+}
+
+TransactionResult WalletService::executeTransactionIdempotent(const std::string& walletId,
+                                                             double amount,
+                                                             const std::string& type,
+                                                             const std::string& description,
+                                                             const std::string& idempotencyKey,
+                                                             const std::string& asset) {
+    std::string fingerprint = requestFingerprint({"transaction", type, asset, amountText(amount)});
+    auto claim = storage::IdempotencyIndex::reserve(idempotencyKey, walletId, fingerprint);
+    if (claim.status != storage::IdempotencyIndex::Status::Reserved) return claimedResult(claim);
+
+    // The ID is derived from the key, so a crash between applying and recording the key
+    // still cannot apply the transaction twice
+    std::string txId = storage::IdempotencyIndex::digest(walletId + ":" + idempotencyKey);
+    if (!executeTransactionWithId(walletId, txId, amount, type, description, idempotencyKey, asset)) {
+        storage::IdempotencyIndex::abandon(idempotencyKey);
+        return TransactionResult{false, "", false};
+    }
+    storage::IdempotencyIndex::complete(idempotencyKey, {walletId, txId, fingerprint});
+    return TransactionResult{true, txId, false};
+}
+
+bool WalletService::executeTransactionWithId(const std::string& walletId,
+                                             const std::string& transactionId,
+                                             double amount,
+                                             const std::string& type,
+                                             const std::string& description,
+                                             const std::string& idempotencyKey,
+                                             const std::string& asset) {
+    tracing::Span span("service", "WalletService::executeTransactionWithId");
+    if (!models::validAssetCode(asset)) return false;
+    if (type == "credit") {
+        if (auto hot = hotWallet(walletId)) {
+            models::Transaction tx(transactionId, walletId, amount, std::to_string(nowSeconds()), type, description);
+            tx.idempotency_key = idempotencyKey;
+            tx.asset = asset;
+            return journalCredit(*hot, tx);
         }
-        wallet.balance -= amount;
-    } else if (type == "credit") {
-        wallet.balance += amount;
+    }
+    auto outcome = executeLocked(walletId, transactionId, amount, type, description, idempotencyKey, asset, nullptr);
+    return outcome == ConditionalOutcome::Applied || outcome == ConditionalOutcome::AlreadyApplied;
+}
+
+ConditionalOutcome WalletService::executeTransactionIf(const std::string& walletId,
+                                                       const std::string& transactionId,
+                                                       double amount,
+                                                       const std::string& type,
+                                                       const std::string& description,
+                                                       const std::function<bool(const models::Wallet&)>& condition) {
+    tracing::Span span("service", "WalletService::executeTransactionIf");
+    storage::RecordLock lock("data/wallets/" + walletId + ".json", storage::LockMode::Exclusive);
+    // The condition sees every credit a hot wallet has taken, not just the folded ones
+    if (storage::CreditJournal::hasPending(walletId)) foldCredits(walletId);
+    return executeLocked(walletId, transactionId, amount, type, description, "", models::kDefaultAsset, &condition);
+}
+
+TransactionResult WalletService::transfer(const std::string& fromWalletId,
+                                          const std::string& toWalletId,
+                                          double amount,
+                                          const std::string& asset,
+                                          const std::string& description,
+                                          const std::string& idempotencyKey) {
+    tracing::Span span("service", "WalletService::transfer");
+    if (fromWalletId == toWalletId || !(amount > 0) || !models::validAssetCode(asset)) {
+        return TransactionResult{false, "", false};
+    }
+    if (idempotencyKey.empty()) return transferOnce(fromWalletId, toWalletId, amount, asset, description, "");
+
+    std::string fingerprint = requestFingerprint({"transfer", toWalletId, asset, amountText(amount)});
+    auto claim = storage::IdempotencyIndex::reserve(idempotencyKey, fromWalletId, fingerprint);
+    if (claim.status != storage::IdempotencyIndex::Status::Reserved) return claimedResult(claim);
+    auto result = transferOnce(fromWalletId, toWalletId, amount, asset, description, idempotencyKey);
+    if (result.success) {
+        storage::IdempotencyIndex::complete(idempotencyKey, {fromWalletId, result.transaction_id, fingerprint});
     } else {
-        return false;
+        storage::IdempotencyIndex::abandon(idempotencyKey);
     }
+    return result;
+}
 
-    // Generate transaction ID
-    std::random_device rd;
-    std::mt19937_64 eng(rd());
-    std::uniform_int_distribution<uint64_t> distr;
-    uint64_t rnd = distr(eng);
-    auto now = std::chrono::system_clock::now().time_since_epoch().count();
-    std::ostringstream oss;
-    oss << std::hex << rnd << now;
-    std::string txId = oss.str();
-
-    // Timestamp as seconds since epoch
-    auto ts = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    std::string timestamp = std::to_string(ts);
+void WalletService::setPointLifetimeDays(int days) {
+    pointLifetime.store(int64_t(days) * kDaySeconds, std::memory_order_relaxed);
+}
 
-    // Create transaction record
-    models::Transaction tx(txId, walletId, amount, timestamp, type, description);
-    if (!storage::TransactionStorage::save(tx)) {
-        return false;
+std::optional<double> WalletService::expirePoints(const std::string& walletId, int64_t now) {
+    tracing::Span span("service", "WalletService::expirePoints");
+    storage::RecordLock lock("data/wallets/" + walletId + ".json", storage::LockMode::Exclusive);
+    auto walletOpt = storage::WalletStorage::load(walletId);
+    if (!walletOpt) {
+        // A wallet deleted since it was scheduled has nothing left to expire; one that is
+        // there but unreadable is retried
+        std::error_code ec;
+        bool gone = !std::filesystem::exists(storage::FileManager::resolve("data/wallets/" + walletId + ".json"), ec);
+        if (gone && !ec) return 0.0;
+        return std::nullopt;
     }
+    Applied applied;
+    double expired = expireDue(*walletOpt, now, applied);
+    if (expired > 0 && !saveWallet(*walletOpt, applied)) return std::nullopt;
+    return expired;
+}
+
+bool WalletService::setHotWallet(const std::string& walletId, size_t shards) {
+    if (!storage::WalletStorage::load(walletId)) return false;
+    {
+        std::unique_lock<std::shared_mutex> lock(hotMutex);
+        if (shards == 0) {
+            hotWallets.erase(walletId);
+        } else {
+            hotWallets[walletId] = std::make_shared<HotWallet>(shards);
+        }
+    }
+    // Credits journaled under the previous designation (or by an earlier run) start folded
+    foldCredits(walletId);
+    return true;
+}
 
-    // Update wallet record
-    wallet.transaction_ids.push_back(txId);
-    return storage::WalletStorage::save(wallet);
+bool WalletService::isHotWallet(const std::string& walletId) {
+    return hotWallet(walletId) != nullptr;
+}
+
+std::optional<size_t> WalletService::foldCredits(const std::string& walletId) {
+    tracing::Span span("service", "WalletService::foldCredits");
+    storage::RecordLock lock("data/wallets/" + walletId + ".json", storage::LockMode::Exclusive);
+    auto hot = hotWallet(walletId);
+    size_t folded = 0;
+    // A sealed file left by a fold that failed blocks sealing its shard's log, so once it
+    // is folded a second round picks up that log
+    for (int round = 0; round < 2; ++round) {
+        bool blocked = false;
+        for (size_t index : storage::CreditJournal::openShards(walletId)) {
+            if (hot && index < hot->count) {
+                auto& shard = hot->shards[index];
+                std::lock_guard<std::mutex> shardLock(shard.mutex);
+                if (!storage::CreditJournal::seal(walletId, index)) {
+                    blocked = true;
+                    continue;
+                }
+                for (const auto& [asset, amount] : shard.open) addAmount(shard.sealed, asset, amount);
+                shard.open.clear();
+            } else if (!storage::CreditJournal::seal(walletId, index)) {
+                blocked = true;
+            }
+        }
+
+        auto credits = storage::CreditJournal::sealed(walletId);
+        if (!credits.empty()) {
+            auto walletOpt = storage::WalletStorage::load(walletId);
+            if (!walletOpt) return std::nullopt;
+            auto wallet = std::move(*walletOpt);
+            int64_t now = nowSeconds();
+            Applied applied;
+            expireDue(wallet, now, applied);
+            // Drops credits the wallet already lists: replays, and a fold that saved the
+            // wallet but did not get to remove its sealed files
+            std::unordered_set<models::Id128> known(wallet.transaction_ids.begin(), wallet.transaction_ids.end());
+            size_t applying = 0;
+            for (auto& credit : credits) {
+                if (!known.insert(models::Id128::parse(credit.transaction_id)).second) continue;
+                if (!applyTransaction(wallet, std::move(credit), now, applied)) return std::nullopt;
+                ++applying;
+            }
+            if (!applied.transactions.empty() && !saveWallet(wallet, applied)) return std::nullopt;
+            folded += applying;
+        }
+        if (!storage::CreditJournal::removeSealed(walletId)) return std::nullopt;
+        if (hot) {
+            for (size_t i = 0; i < hot->count; ++i) {
+                std::lock_guard<std::mutex> shardLock(hot->shards[i].mutex);
+                hot->shards[i].sealed.clear();
+            }
+        }
+        if (!blocked) break;
+    }
+    return folded;
+}
+
+void WalletService::foldCreditsIfShort(models::Wallet& wallet, const std::string& asset, double amount) {
+    foldIfShort(wallet, asset, amount);
+}
+
+size_t WalletService::foldAllCredits() {
+    size_t folded = 0;
+    for (const auto& walletId : storage::CreditJournal::wallets()) {
+        folded += foldCredits(walletId).value_or(0);
+    }
+    return folded;
+}
+
+std::vector<std::pair<std::string, double>> WalletService::pendingCredits(const std::string& walletId) {
+    AssetAmounts pending;
+    auto hot = hotWallet(walletId);
+    if (!hot) return pending;
+    for (size_t i = 0; i < hot->count; ++i) {
+        auto& shard = hot->shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto* amounts : {&shard.open, &shard.sealed}) {
+            for (const auto& [asset, amount] : *amounts) addAmount(pending, asset, amount);
+        }
+    }
+    return pending;
+}
+
+void WalletService::startCreditFolding(std::chrono::milliseconds interval) {
+    foldRunner().start(interval);
+}
+
+void WalletService::stopCreditFolding() {
+    foldRunner().stop();
 }
 
 std::vector<models::Transaction> WalletService::getTransactions(const std::string& walletId) {
+    tracing::Span span("service", "WalletService::getTransactions");
     std::vector<models::Transaction> result;
+    storage::Snapshot snapshot;
     auto walletOpt = storage::WalletStorage::load(walletId);
     if (!walletOpt) return result;
-    for (const auto& txId : walletOpt->transaction_ids) {
-        auto txOpt = storage::TransactionStorage::load(txId);
+    std::vector<std::optional<models::Transaction>> loaded;
+    storage::TransactionStorage::loadMany(idStrings(walletOpt->transaction_ids.begin(), walletOpt->transaction_ids.end()), loaded);
+    for (auto& txOpt : loaded) {
         if (txOpt) {
-            result.push_back(*txOpt);
+            result.push_back(std::move(*txOpt));
         }
     }
     return result;
 }
 
-} // namespace services 
\ No newline at end of file
+std::optional<WalletHistory> WalletService::getHistory(const std::string& walletId) {
+    tracing::Span span("service", "WalletService::getHistory");
+    storage::Snapshot snapshot;
+    auto walletOpt = storage::WalletStorage::load(walletId);
+    if (!walletOpt) return std::nullopt;
+    WalletHistory history{*walletOpt, {}, snapshot.sequence()};
+    history.transactions.reserve(history.wallet.transaction_ids.size());
+    std::vector<std::optional<models::Transaction>> loaded;
+    const auto& ids = history.wallet.transaction_ids;
+    storage::TransactionStorage::loadMany(idStrings(ids.begin(), ids.end()), loaded);
+    for (auto& txOpt : loaded) {
+        if (txOpt) {
+            history.transactions.push_back(std::move(*txOpt));
+        }
+    }
+    return history;
+}
+
+bool WalletService::forEachTransaction(const std::string& walletId,
+                                       const std::function<void(const models::Transaction&)>& fn) {
+    tracing::Span span("service", "WalletService::forEachTransaction");
+    storage::Snapshot snapshot;
+    auto walletOpt = storage::WalletStorage::load(walletId);
+    if (!walletOpt) return false;
+    // Streamed a batch at a time, so a long history is never held whole
+    const auto& ids = walletOpt->transaction_ids;
+    std::vector<std::optional<models::Transaction>> loaded;
+    for (size_t begin = 0; begin < ids.size(); begin += kHistoryBatch) {
+        size_t end = std::min(ids.size(), begin + kHistoryBatch);
+        storage::TransactionStorage::loadMany(idStrings(ids.begin() + begin, ids.begin() + end), loaded);
+        for (const auto& txOpt : loaded) {
+            if (txOpt) {
+                fn(*txOpt);
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace services
@@ -0,0 +1,489 @@
+#include "storage/AsyncIO.h"
+#include "storage/ResourceUsage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <linux/io_uring.h>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace storage {
+
+namespace {
+
+// Submission queue depth per thread. A read takes two entries, a chained write three.
+constexpr unsigned kRingEntries = 64;
+constexpr unsigned kPoolThreads = 4;
+// Marks the completion of a close, as opposed to the read it is linked to
+constexpr uint64_t kCloseTag = uint64_t(1) << 63;
+
+// Cleared for good the first time io_uring turns out to be unusable
+std::atomic<bool> uringUsable{true};
+
+// One io_uring instance, driven through the raw syscalls: liburing is not a dependency.
+// Used only by the thread that owns it, so the ring indices need no locking on our side.
+class Ring {
+public:
+    Ring() {
+        io_uring_params params{};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, kRingEntries, &params));
+        if (fd < 0) return;
+        fd_ = fd;
+        sqBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sqBytes_ = cqBytes_ = std::max(sqBytes_, cqBytes_);
+        sqRing_ = map(sqBytes_, IORING_OFF_SQ_RING);
+        cqRing_ = single ? sqRing_ : map(cqBytes_, IORING_OFF_CQ_RING);
+        sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqesBytes_, IORING_OFF_SQES));
+        if (!sqRing_ || !cqRing_ || !sqes_) return;
+
+        auto* sq = static_cast<char*>(sqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto* cq = static_cast<char*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        entries_ = params.sq_entries;
+        ready_ = true;
+    }
+
+    ~Ring() {
+        if (sqes_) munmap(sqes_, sqesBytes_);
+        if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqBytes_);
+        if (sqRing_) munmap(sqRing_, sqBytes_);
+        if (fd_ >= 0) close(fd_);
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    bool ready() const { return ready_; }
+    unsigned capacity() const { return entries_; }
+
+    // Next free entry, zeroed; the caller has checked capacity
+    io_uring_sqe* next(uint8_t opcode, uint64_t userData) {
+        unsigned index = pendingTail_ & sqMask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->user_data = userData;
+        sqArray_[index] = index;
+        ++pendingTail_;
+        return sqe;
+    }
+
+    // Submits everything queued and waits for all of it to complete, handing each completion
+    // to onDone. Linked entries that were cancelled complete too, so the count is exact.
+    // False if the kernel refused a submission: the entries it had not taken are withdrawn,
+    // the ones it had are still waited for, since they point at the caller's buffers, and
+    // the ring is retired so later batches take the thread pool.
+    bool run(const std::function<void(uint64_t, int)>& onDone) {
+        unsigned first = submittedTail_;
+        __atomic_store_n(sqTail_, pendingTail_, __ATOMIC_RELEASE);
+        unsigned done = 0;
+        bool refused = false;
+        while (done < submittedTail_ - first || submittedTail_ != pendingTail_) {
+            unsigned submitting = pendingTail_ - submittedTail_;
+            unsigned outstanding = submittedTail_ - first + submitting - done;
+            int rc = static_cast<int>(syscall(__NR_io_uring_enter, fd_, submitting, outstanding,
+                                              IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (rc >= 0) {
+                submittedTail_ += static_cast<unsigned>(rc);
+            } else if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                // Retried as is
+            } else if (submitting > 0) {
+                refused = true;
+                pendingTail_ = submittedTail_;
+                __atomic_store_n(sqTail_, pendingTail_, __ATOMIC_RELEASE);
+                uringUsable.store(false, std::memory_order_relaxed);
+            } else {
+                // Even waiting failed; completions still land in the ring, so look again shortly
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            unsigned head = *cqHead_;
+            unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head, ++done) {
+                const io_uring_cqe& cqe = cqes_[head & cqMask_];
+                onDone(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        }
+        return !refused;
+    }
+
+private:
+    void* map(size_t bytes, off_t offset) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    int fd_ = -1;
+    bool ready_ = false;
+    unsigned entries_ = 0;
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqBytes_ = 0;
+    size_t cqBytes_ = 0;
+    size_t sqesBytes_ = 0;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned pendingTail_ = 0;
+    unsigned submittedTail_ = 0;
+};
+
+// The calling thread's ring, or nullptr when io_uring cannot be used
+Ring* threadRing() {
+    if (!uringUsable.load(std::memory_order_relaxed)) return nullptr;
+    thread_local Ring ring;
+    if (!ring.ready()) {
+        uringUsable.store(false, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &ring;
+}
+
+// An unsupported opcode means an older kernel; anything else is an ordinary I/O error
+void noteResult(int res) {
+    if (res == -EINVAL || res == -EOPNOTSUPP) uringUsable.store(false, std::memory_order_relaxed);
+}
+
+bool readWhole(int fd, std::string& out) {
+    struct stat st {};
+    if (fstat(fd, &st) != 0) return false;
+    out.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = ::read(fd, &out[done], out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    out.resize(done);
+    return true;
+}
+
+void readOne(FileRead& r) {
+    int fd = open(r.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    r.ok = readWhole(fd, r.data);
+    close(fd);
+}
+
+// Writes w's temp file, leaving the rename to the caller
+bool writeTemp(const FileWrite& w) {
+    int fd = open(w.tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    size_t done = 0;
+    while (done < w.data->size()) {
+        ssize_t n = ::write(fd, w.data->data() + done, w.data->size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    return close(fd) == 0 && done == w.data->size();
+}
+
+// Fallback without io_uring: fixed workers sharing one queue of jobs
+class IoPool {
+public:
+    // Never destroyed: the workers are detached and may still be waiting on it at exit
+    static IoPool& instance() {
+        static IoPool* pool = new IoPool;
+        return *pool;
+    }
+
+    // Runs job(0) .. job(count - 1) on the workers and the calling thread, returning once all
+    // have finished
+    void forEach(size_t count, std::function<void(size_t)> job) {
+        if (count == 0) return;
+        // Shared with the helpers: one may only get to run after this call has returned, and
+        // then finds every index taken
+        struct Batch {
+            std::function<void(size_t)> job;
+            size_t size;
+            std::atomic<size_t> next{0};
+            std::mutex mutex;
+            std::condition_variable cv;
+            size_t remaining;
+            // Helpers' allocations are charged to the caller's request
+            UsageShare usage;
+        };
+        auto batch = std::make_shared<Batch>();
+        batch->job = std::move(job);
+        batch->size = count;
+        batch->remaining = count;
+        auto work = [batch] {
+            size_t finished = 0;
+            {
+                UsageScope scope(batch->usage);
+                for (size_t i; (i = batch->next.fetch_add(1)) < batch->size; ++finished) batch->job(i);
+            }
+            if (finished == 0) return;
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->remaining -= finished;
+            if (batch->remaining == 0) batch->cv.notify_all();
+        };
+        size_t helpers = std::min<size_t>(kPoolThreads, count - 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < helpers; ++i) jobs_.push_back(work);
+        }
+        cv_.notify_all();
+        // The caller works too, so the batch finishes even if every worker is busy elsewhere
+        work();
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->cv.wait(lock, [&] { return batch->remaining == 0; });
+        lock.unlock();
+        batch->usage.join();
+    }
+
+private:
+    IoPool() {
+        for (unsigned i = 0; i < kPoolThreads; ++i) {
+            std::thread([this] { loop(); }).detach();
+        }
+    }
+
+    void loop() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return !jobs_.empty(); });
+                job = std::move(jobs_.front());
+                jobs_.erase(jobs_.begin());
+            }
+            job();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::function<void()>> jobs_;
+};
+
+bool readWithRing(Ring& ring, std::vector<FileRead>& reads, size_t begin, size_t end) {
+    std::vector<int> fds(end - begin, -1);
+    // Opens first: the read needs the file size, which the ring cannot report in the same chain
+    for (size_t i = begin; i < end; ++i) {
+        io_uring_sqe* sqe = ring.next(IORING_OP_OPENAT, i);
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(reads[i].path.c_str());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    }
+    bool unsupported = false;
+    bool ran = ring.run([&](uint64_t i, int res) {
+        if (res >= 0) fds[i - begin] = res;
+        else if (res == -EINVAL || res == -EOPNOTSUPP) unsupported = true;
+    });
+    if (!ran || unsupported) {
+        if (unsupported) noteResult(-EOPNOTSUPP);
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+        return false;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        int fd = fds[i - begin];
+        if (fd < 0) continue;
+        struct stat st {};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            fds[i - begin] = -1;
+            continue;
+        }
+        reads[i].data.resize(static_cast<size_t>(st.st_size));
+        io_uring_sqe* sqe = ring.next(IORING_OP_READ, i);
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(reads[i].data.data());
+        sqe->len = static_cast<uint32_t>(reads[i].data.size());
+        sqe->off = 0;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe = ring.next(IORING_OP_CLOSE, i | kCloseTag);
+        sqe->fd = fd;
+    }
+    std::vector<int> readResults(end - begin, 0);
+    std::vector<bool> closed(end - begin, false);
+    bool ok = ring.run([&](uint64_t tag, int res) {
+        size_t i = static_cast<size_t>(tag & ~kCloseTag) - begin;
+        if (tag & kCloseTag) {
+            // A failed or short read cancels the linked close
+            if (res == -ECANCELED) close(fds[i]);
+            closed[i] = true;
+            return;
+        }
+        readResults[i] = res;
+    });
+    // Files whose close never ran because the kernel refused the submission
+    for (size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i] >= 0 && !closed[i]) close(fds[i]);
+    }
+    if (!ok) return false;
+    for (size_t i = begin; i < end; ++i) {
+        if (fds[i - begin] < 0) continue;
+        int res = readResults[i - begin];
+        if (res < 0) {
+            noteResult(res);
+            continue;
+        }
+        FileRead& r = reads[i];
+        if (static_cast<size_t>(res) < r.data.size()) {
+            // Rare: the file shrank between fstat and the read. Finish it the plain way.
+            readOne(r);
+            continue;
+        }
+        r.ok = true;
+    }
+    return true;
+}
+
+// Returns how many writes of the chain, starting at begin, were renamed
+size_t writeWithRing(Ring& ring, std::vector<FileWrite>& writes, size_t begin, size_t end) {
+    std::vector<int> fds(end - begin, -1);
+    for (size_t i = begin; i < end; ++i) {
+        io_uring_sqe* sqe = ring.next(IORING_OP_OPENAT, i);
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(writes[i].tmp_path.c_str());
+        sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        sqe->len = 0644;
+    }
+    bool unsupported = false;
+    bool ran = ring.run([&](uint64_t i, int res) {
+        if (res >= 0) fds[i - begin] = res;
+        else if (res == -EINVAL || res == -EOPNOTSUPP) unsupported = true;
+    });
+    // The chain only covers the writes before the first failed open
+    size_t chainEnd = begin;
+    while (chainEnd < end && fds[chainEnd - begin] >= 0) ++chainEnd;
+    if (!ran || unsupported) {
+        if (unsupported) noteResult(-EOPNOTSUPP);
+        chainEnd = begin;
+    }
+    for (size_t i = chainEnd; i < end; ++i) {
+        if (fds[i - begin] >= 0) close(fds[i - begin]);
+    }
+
+    // write -> close -> rename, linked across the whole chain so a failure cancels the rest
+    enum Step : uint64_t { Write = 0, Close = 1, Rename = 2 };
+    for (size_t i = begin; i < chainEnd; ++i) {
+        const FileWrite& w = writes[i];
+        io_uring_sqe* sqe = ring.next(IORING_OP_WRITE, (i << 2) | Write);
+        sqe->fd = fds[i - begin];
+        sqe->addr = reinterpret_cast<uint64_t>(w.data->data());
+        sqe->len = static_cast<uint32_t>(w.data->size());
+        sqe->off = 0;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe = ring.next(IORING_OP_CLOSE, (i << 2) | Close);
+        sqe->fd = fds[i - begin];
+        sqe->flags = IOSQE_IO_LINK;
+        sqe = ring.next(IORING_OP_RENAMEAT, (i << 2) | Rename);
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(w.tmp_path.c_str());
+        sqe->len = static_cast<uint32_t>(AT_FDCWD);
+        sqe->addr2 = reinterpret_cast<uint64_t>(w.path.c_str());
+        if (i + 1 < chainEnd) sqe->flags = IOSQE_IO_LINK;
+    }
+    std::vector<bool> closed(end - begin, false);
+    // If the kernel refuses part of the chain, what it took has still completed here, and the
+    // writes it did not take keep their files open until the loop below
+    ring.run([&](uint64_t tag, int res) {
+        size_t i = static_cast<size_t>(tag >> 2);
+        switch (tag & 3) {
+        case Write:
+            if (res >= 0 && static_cast<size_t>(res) != writes[i].data->size()) res = -EIO;
+            break;
+        case Close:
+            closed[i - begin] = res != -ECANCELED;
+            break;
+        case Rename:
+            writes[i].ok = res == 0;
+            break;
+        }
+        if (res < 0) noteResult(res);
+    });
+    size_t renamed = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (i < chainEnd && !closed[i - begin]) close(fds[i - begin]);
+        if (writes[i].ok && renamed == i - begin) ++renamed;
+    }
+    return renamed;
+}
+
+} // namespace
+
+void AsyncIO::read(std::vector<FileRead>& reads) {
+    if (reads.empty()) return;
+    size_t perRound = 0;
+    if (Ring* ring = threadRing()) perRound = ring->capacity() / 2;
+    size_t begin = 0;
+    while (perRound > 0 && begin < reads.size()) {
+        Ring* ring = threadRing();
+        size_t end = std::min(reads.size(), begin + perRound);
+        if (!ring || !readWithRing(*ring, reads, begin, end)) break;
+        begin = end;
+    }
+    if (begin == reads.size()) return;
+    std::vector<FileRead> rest(std::make_move_iterator(reads.begin() + begin), std::make_move_iterator(reads.end()));
+    IoPool::instance().forEach(rest.size(), [&rest](size_t i) { readOne(rest[i]); });
+    std::move(rest.begin(), rest.end(), reads.begin() + begin);
+}
+
+bool AsyncIO::writeChain(std::vector<FileWrite>& writes) {
+    size_t begin = 0;
+    while (begin < writes.size()) {
+        Ring* ring = threadRing();
+        if (!ring) {
+            // Temp files are written in parallel; only the renames keep the chain's order
+            std::vector<char> written(writes.size() - begin, 0);
+            IoPool::instance().forEach(written.size(),
+                                       [&](size_t i) { written[i] = writeTemp(writes[begin + i]); });
+            for (size_t i = 0; i < written.size() && written[i]; ++i, ++begin) {
+                FileWrite& w = writes[begin];
+                if (std::rename(w.tmp_path.c_str(), w.path.c_str()) != 0) break;
+                w.ok = true;
+            }
+            break;
+        }
+        size_t end = std::min(writes.size(), begin + ring->capacity() / 3);
+        begin += writeWithRing(*ring, writes, begin, end);
+        // A write failed; unless the ring itself gave out, the chain stops here
+        if (begin < end && threadRing()) break;
+    }
+    for (size_t i = begin; i < writes.size(); ++i) {
+        writes[i].ok = false;
+        std::remove(writes[i].tmp_path.c_str());
+    }
+    return begin == writes.size();
+}
+
+const char* AsyncIO::backend() {
+    return threadRing() ? "io_uring" : "threads";
+}
+
+} // namespace storage
@@ -0,0 +1,520 @@
+#include "storage/AuditLog.h"
+#include "storage/FileManager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+
+namespace {
+
+constexpr size_t kHashHex = 64;
+// Pause between attempts while appends or syncs are failing
+constexpr int64_t kRetryMs = 100;
+const std::string kGenesis(kHashHex, '0');
+
+std::atomic<uint64_t> recorded{0};
+std::atomic<uint64_t> written{0};
+std::atomic<uint64_t> batches{0};
+std::atomic<uint64_t> fsyncs{0};
+std::atomic<uint64_t> queueFullWaits{0};
+std::atomic<uint64_t> writeFailures{0};
+std::atomic<uint64_t> tornTails{0};
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Hex SHA-256 of "<seq> <prev> <payload>", the hashed form of an entry
+std::string entryHash(std::string_view seq, std::string_view prev, std::string_view payload) {
+    static const char* digits = "0123456789abcdef";
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int size = 0;
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr);
+    EVP_DigestUpdate(ctx, seq.data(), seq.size());
+    EVP_DigestUpdate(ctx, " ", 1);
+    EVP_DigestUpdate(ctx, prev.data(), prev.size());
+    EVP_DigestUpdate(ctx, " ", 1);
+    EVP_DigestUpdate(ctx, payload.data(), payload.size());
+    EVP_DigestFinal_ex(ctx, digest, &size);
+    EVP_MD_CTX_free(ctx);
+    std::string hex(size * 2, '0');
+    for (unsigned int i = 0; i < size; ++i) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 0xF];
+    }
+    return hex;
+}
+
+struct Entry {
+    int64_t ts;
+    std::string actor;
+    std::string action;
+    std::string target;
+    bool ok;
+    nlohmann::json details;
+};
+
+// One parsed line: views into the mapped file
+struct Line {
+    uint64_t seq = 0;
+    std::string_view seqText;
+    std::string_view prev;
+    std::string_view hash;
+    std::string_view payload;
+};
+
+bool parseLine(std::string_view text, Line& line) {
+    size_t sp = text.find(' ');
+    if (sp == std::string_view::npos || sp == 0 || sp > 20) return false;
+    line.seqText = text.substr(0, sp);
+    line.seq = 0;
+    for (char c : line.seqText) {
+        if (c < '0' || c > '9') return false;
+        line.seq = line.seq * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (text.size() < sp + 2 * (kHashHex + 1) + 1) return false;
+    line.prev = text.substr(sp + 1, kHashHex);
+    line.hash = text.substr(sp + 2 + kHashHex, kHashHex);
+    if (text[sp + 1 + kHashHex] != ' ' || text[sp + 2 + 2 * kHashHex] != ' ') return false;
+    line.payload = text.substr(sp + 3 + 2 * kHashHex);
+    return true;
+}
+
+// Reads the sequence and hash of the file's last complete entry. A partial line left by an
+// interrupted append is kept and terminated, so verify() reports the chain broken there
+// instead of the entry vanishing; the chain resumes after it. Returns false if the tail is
+// unreadable.
+bool readTail(int fd, uint64_t& seq, std::string& hash, uint64_t& size) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) return false;
+    size = static_cast<uint64_t>(st.st_size);
+    seq = 0;
+    hash = kGenesis;
+    if (size == 0) return true;
+    std::string buffer;
+    bool torn = false;
+    for (uint64_t window = 4096;; window *= 2) {
+        uint64_t start = size > window ? size - window : 0;
+        buffer.resize(size - start);
+        if (::pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(start)) !=
+            static_cast<ssize_t>(buffer.size())) {
+            return false;
+        }
+        if (!torn && buffer.back() != '\n') {
+            if (::write(fd, "\n", 1) != 1) return false;
+            tornTails.fetch_add(1, std::memory_order_relaxed);
+            torn = true;
+        }
+        size_t end = buffer.rfind('\n');
+        if (end == std::string::npos) {
+            // Only a partial first entry: nothing was ever completed
+            if (start == 0) break;
+            continue;
+        }
+        size_t begin = buffer.rfind('\n', end == 0 ? std::string::npos : end - 1);
+        if (begin == std::string::npos && start != 0) continue;
+        begin = begin == std::string::npos ? 0 : begin + 1;
+        Line line;
+        if (!parseLine(std::string_view(buffer).substr(begin, end - begin), line)) return false;
+        seq = line.seq;
+        hash.assign(line.hash);
+        break;
+    }
+    if (torn) ++size;
+    return true;
+}
+
+class Writer {
+public:
+    Writer() : thread_([this] { run(); }) {}
+
+    ~Writer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool push(Entry entry) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (queue_.size() >= AuditLog::kQueueCapacity) {
+            queueFullWaits.fetch_add(1, std::memory_order_relaxed);
+            space_.wait(lock, [this] { return queue_.size() < AuditLog::kQueueCapacity; });
+        }
+        queue_.push_back(std::move(entry));
+        ++enqueued_;
+        recorded.fetch_add(1, std::memory_order_relaxed);
+        bool healthy = !failing_;
+        lock.unlock();
+        wake_.notify_one();
+        return healthy;
+    }
+
+    bool flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = enqueued_;
+        uint64_t failures = failures_;
+        flushRequested_ = true;
+        wake_.notify_one();
+        synced_.wait(lock, [this, target, failures] { return durable_ >= target || failures_ != failures; });
+        return durable_ >= target;
+    }
+
+    bool failing() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return failing_;
+    }
+
+private:
+    void run() {
+        // Entries taken from the queue but not yet written; kept across failed appends so
+        // they are retried in order, and the queue is not drained again until they land
+        std::vector<Entry> batch;
+        uint64_t batchEnd = 0;
+        // Enqueue count covered by what has been written, and whether it awaits a sync
+        uint64_t writtenEnd = 0;
+        bool unsynced = false;
+        bool retrying = false;
+        auto lastSync = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            auto syncDeadline = lastSync + std::chrono::milliseconds(AuditLog::kSyncIntervalMs);
+            auto ready = [this, &batch] { return stop_ || flushRequested_ || (batch.empty() && !queue_.empty()); };
+            if (retrying) {
+                wake_.wait_for(lock, std::chrono::milliseconds(kRetryMs), [this] { return stop_; });
+            } else if (unsynced) {
+                wake_.wait_until(lock, syncDeadline, ready);
+            } else {
+                wake_.wait(lock, ready);
+            }
+            if (batch.empty() && !queue_.empty()) {
+                batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.end()));
+                queue_.clear();
+                batchEnd = enqueued_;
+            }
+            bool flushing = flushRequested_ || stop_;
+            flushRequested_ = false;
+            bool stopping = stop_;
+            lock.unlock();
+            space_.notify_all();
+
+            bool failed = false;
+            if (!batch.empty()) {
+                if (append(batch)) {
+                    batch.clear();
+                    writtenEnd = batchEnd;
+                    unsynced = true;
+                } else {
+                    failed = true;
+                }
+            }
+            auto now = std::chrono::steady_clock::now();
+            bool synced = false;
+            if (!failed && unsynced && (flushing || retrying || now >= syncDeadline)) {
+                // Entries count as durable only once a sync covering them succeeds
+                if (fd_ >= 0 && ::fdatasync(fd_) == 0) {
+                    fsyncs.fetch_add(1, std::memory_order_relaxed);
+                    unsynced = false;
+                    synced = true;
+                    lastSync = now;
+                } else {
+                    failed = true;
+                }
+            }
+            retrying = failed;
+
+            lock.lock();
+            if (failed) {
+                writeFailures.fetch_add(1, std::memory_order_relaxed);
+                ++failures_;
+                failing_ = true;
+                synced_.notify_all();
+            } else if (synced || (batch.empty() && !unsynced)) {
+                failing_ = false;
+                if (durable_ != writtenEnd) {
+                    durable_ = writtenEnd;
+                    synced_.notify_all();
+                }
+            }
+            // A writer that cannot write gives up at shutdown rather than hang it
+            if (stopping && (failed || (queue_.empty() && batch.empty() && !unsynced))) return;
+        }
+    }
+
+    // Appends the entries as one write, chained onto whatever the file currently ends with.
+    // On failure the entries whose lines landed whole are removed, so a retry neither loses
+    // nor repeats any.
+    bool append(std::vector<Entry>& entries) {
+        std::string logical = AuditLog::kDefaultPath;
+        // Other processes sharing the data directory append to the same chain
+        RecordLock lock(logical, LockMode::Exclusive);
+        if (fd_ < 0) {
+            std::string path = FileManager::resolve(logical);
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd_ < 0) return false;
+            knownSize_ = UINT64_MAX;
+        }
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) return false;
+        // Someone else appended since our last batch: pick up their tail
+        if (static_cast<uint64_t>(st.st_size) != knownSize_ && !readTail(fd_, seq_, hash_, knownSize_)) {
+            knownSize_ = UINT64_MAX;
+            return false;
+        }
+
+        std::string buffer;
+        for (const auto& e : entries) {
+            nlohmann::json payload = {
+                {"ts", e.ts},
+                {"actor", e.actor},
+                {"action", e.action},
+                {"target", e.target},
+                {"ok", e.ok},
+                {"details", e.details}
+            };
+            std::string text = payload.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+            std::string seq = std::to_string(seq_ + 1);
+            std::string hash = entryHash(seq, hash_, text);
+            buffer += seq;
+            buffer += ' ';
+            buffer += hash_;
+            buffer += ' ';
+            buffer += hash;
+            buffer += ' ';
+            buffer += text;
+            buffer += '\n';
+            ++seq_;
+            hash_ = std::move(hash);
+        }
+
+        size_t done = 0;
+        while (done < buffer.size()) {
+            ssize_t n = ::write(fd_, buffer.data() + done, buffer.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                size_t landed = static_cast<size_t>(std::count(buffer.begin(), buffer.begin() + done, '\n'));
+                entries.erase(entries.begin(), entries.begin() + landed);
+                written.fetch_add(landed, std::memory_order_relaxed);
+                // Force a tail reload so the chain resumes from what actually landed
+                knownSize_ = UINT64_MAX;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        knownSize_ += buffer.size();
+        written.fetch_add(entries.size(), std::memory_order_relaxed);
+        batches.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable space_;
+    std::condition_variable synced_;
+    std::deque<Entry> queue_;
+    uint64_t enqueued_ = 0;
+    uint64_t durable_ = 0;
+    // Failed append or sync attempts, and whether the latest attempt failed
+    uint64_t failures_ = 0;
+    bool failing_ = false;
+    bool flushRequested_ = false;
+    bool stop_ = false;
+
+    // Writer thread only
+    int fd_ = -1;
+    uint64_t knownSize_ = UINT64_MAX;
+    uint64_t seq_ = 0;
+    std::string hash_ = kGenesis;
+
+    std::thread thread_;
+};
+
+Writer& writer() {
+    static Writer w;
+    return w;
+}
+
+// Outcome of verifying one slice of the file
+struct ChunkResult {
+    uint64_t entries = 0;
+    uint64_t firstSeq = 0;
+    std::string firstPrev;
+    uint64_t lastSeq = 0;
+    std::string lastHash;
+    // Offset of the first broken line in the file, with its sequence and the reason
+    uint64_t badOffset = UINT64_MAX;
+    uint64_t badSeq = 0;
+    std::string error;
+};
+
+void verifyChunk(const char* data, uint64_t size, uint64_t begin, uint64_t end, ChunkResult& out) {
+    // A chunk owns the lines that start inside it
+    if (begin > 0) {
+        const void* nl = std::memchr(data + begin - 1, '\n', size - (begin - 1));
+        if (!nl) return;
+        begin = static_cast<uint64_t>(static_cast<const char*>(nl) - data) + 1;
+    }
+    uint64_t pos = begin;
+    while (pos < end && pos < size) {
+        const void* nl = std::memchr(data + pos, '\n', size - pos);
+        auto fail = [&](const std::string& why) {
+            out.badOffset = pos;
+            out.badSeq = out.entries ? out.lastSeq + 1 : 0;
+            out.error = why;
+        };
+        if (!nl) {
+            fail("truncated final entry");
+            return;
+        }
+        uint64_t lineEnd = static_cast<uint64_t>(static_cast<const char*>(nl) - data);
+        Line line;
+        if (!parseLine(std::string_view(data + pos, lineEnd - pos), line)) {
+            fail("malformed entry");
+            return;
+        }
+        if (out.entries > 0 && (line.seq != out.lastSeq + 1 || line.prev != out.lastHash)) {
+            fail("entry does not follow its predecessor");
+            out.badSeq = line.seq;
+            return;
+        }
+        if (entryHash(line.seqText, line.prev, line.payload) != line.hash) {
+            fail("hash mismatch");
+            out.badSeq = line.seq;
+            return;
+        }
+        if (out.entries == 0) {
+            out.firstSeq = line.seq;
+            out.firstPrev.assign(line.prev);
+        }
+        ++out.entries;
+        out.lastSeq = line.seq;
+        out.lastHash.assign(line.hash);
+        pos = lineEnd + 1;
+    }
+}
+
+} // namespace
+
+bool AuditLog::record(const std::string& actor,
+                      const std::string& action,
+                      const std::string& target,
+                      bool ok,
+                      const nlohmann::json& details) {
+    return writer().push(Entry{nowMs(), actor, action, target, ok, details});
+}
+
+bool AuditLog::flush() {
+    return writer().flush();
+}
+
+AuditVerifyReport AuditLog::verify(const std::string& logicalPath, unsigned workers) {
+    auto start = std::chrono::steady_clock::now();
+    AuditVerifyReport report;
+    auto finish = [&] {
+        report.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        return report;
+    };
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+
+    std::string path = FileManager::resolve(logicalPath);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        report.error = "cannot open " + path;
+        return finish();
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        report.error = "cannot stat " + path;
+        return finish();
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (size == 0) {
+        ::close(fd);
+        report.ok = true;
+        report.head_hash = kGenesis;
+        return finish();
+    }
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        report.error = "cannot map " + path;
+        return finish();
+    }
+    const char* data = static_cast<const char*>(map);
+
+    // Every line carries its predecessor's hash, so slices verify independently and only
+    // their boundaries need joining
+    std::vector<ChunkResult> chunks(workers);
+    std::vector<std::thread> pool;
+    uint64_t step = (size + workers - 1) / workers;
+    for (unsigned w = 0; w < workers; ++w) {
+        uint64_t begin = std::min<uint64_t>(size, step * w);
+        uint64_t end = std::min<uint64_t>(size, begin + step);
+        pool.emplace_back(verifyChunk, data, size, begin, end, std::ref(chunks[w]));
+    }
+    for (auto& t : pool) t.join();
+    ::munmap(map, size);
+
+    uint64_t expectedSeq = 1;
+    std::string expectedPrev = kGenesis;
+    for (const auto& chunk : chunks) {
+        if (chunk.entries > 0 && (chunk.firstSeq != expectedSeq || chunk.firstPrev != expectedPrev)) {
+            report.first_bad_seq = chunk.firstSeq;
+            report.error = "entry does not follow its predecessor";
+            return finish();
+        }
+        report.entries += chunk.entries;
+        if (chunk.entries > 0) {
+            expectedSeq = chunk.lastSeq + 1;
+            expectedPrev = chunk.lastHash;
+        }
+        if (!chunk.error.empty()) {
+            report.first_bad_seq = chunk.badSeq ? chunk.badSeq : expectedSeq;
+            report.error = chunk.error;
+            return finish();
+        }
+    }
+    report.ok = true;
+    report.head_hash = expectedPrev;
+    return finish();
+}
+
+AuditStats AuditLog::stats() {
+    AuditStats stats;
+    stats.recorded = recorded.load(std::memory_order_relaxed);
+    stats.written = written.load(std::memory_order_relaxed);
+    stats.batches = batches.load(std::memory_order_relaxed);
+    stats.fsyncs = fsyncs.load(std::memory_order_relaxed);
+    stats.queue_full_waits = queueFullWaits.load(std::memory_order_relaxed);
+    stats.write_failures = writeFailures.load(std::memory_order_relaxed);
+    stats.torn_tails = tornTails.load(std::memory_order_relaxed);
+    stats.failing = writer().failing();
+    return stats;
+}
+
+} // namespace storage
@@ -0,0 +1,40 @@
+#include "storage/CampaignStorage.h"
+#include "storage/FileManager.h"
+#include <nlohmann/json.hpp>
+
+namespace storage {
+
+bool CampaignStorage::save(const models::Campaign& campaign) {
+    if (!models::validCampaignId(campaign.campaign_id)) return false;
+    nlohmann::json j = campaign;
+    std::string path = "data/campaigns/" + campaign.campaign_id + ".json";
+    return FileManager::writeJson(path, j);
+}
+
+std::optional<models::Campaign> CampaignStorage::load(const std::string& campaign_id) {
+    if (!models::validCampaignId(campaign_id)) return std::nullopt;
+    std::string path = "data/campaigns/" + campaign_id + ".json";
+    nlohmann::json j;
+    if (!FileManager::readJson(path, j)) return std::nullopt;
+    try {
+        models::Campaign c = j.get<models::Campaign>();
+        return c;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+std::vector<models::Campaign> CampaignStorage::listAll() {
+    std::vector<models::Campaign> campaigns;
+    for (const auto& path : FileManager::listRecords("data/campaigns")) {
+        nlohmann::json j;
+        if (FileManager::readJson(path, j)) {
+            try {
+                campaigns.push_back(j.get<models::Campaign>());
+            } catch (...) {}
+        }
+    }
+    return campaigns;
+}
+
+} // namespace storage
@@ -0,0 +1,214 @@
+#include "storage/ChangeLog.h"
+#include "storage/FileManager.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+namespace fs = std::filesystem;
+
+namespace {
+
+// A log past this size is moved to <path>.1 (replacing the previous one) and started afresh;
+// sequence numbers continue
+constexpr uint64_t kRotateBytes = uint64_t{64} << 20;
+constexpr const char* kRotatedSuffix = ".1";
+
+std::atomic<bool> logging{false};
+std::mutex logMutex;
+int logFd = -1;
+uint64_t sequence = 0;
+uint64_t offset = 0;
+std::string logPath;
+
+// Replication bookkeeping lives under data/replication and is never itself replicated
+bool replicated(const std::string& path) {
+    return path.rfind("data/", 0) == 0 && path.rfind("data/replication/", 0) != 0;
+}
+
+// Recovers the last sequence number from the final complete line of an existing log
+uint64_t lastSequenceIn(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+    in.seekg(0, std::ios::end);
+    std::streamoff size = in.tellg();
+    std::streamoff tail = std::min<std::streamoff>(size, 1 << 20);
+    std::string buffer(static_cast<size_t>(tail), '\0');
+    in.seekg(size - tail);
+    in.read(&buffer[0], tail);
+    size_t end = buffer.rfind('\n');
+    while (end != std::string::npos && end > 0) {
+        size_t begin = buffer.rfind('\n', end - 1);
+        begin = begin == std::string::npos ? 0 : begin + 1;
+        try {
+            return nlohmann::json::parse(buffer.substr(begin, end - begin)).at("seq").get<uint64_t>();
+        } catch (...) {}
+        if (begin == 0) break;
+        end = begin - 1;
+    }
+    return 0;
+}
+
+// A log that was just rotated continues the sequence of the rotated file
+uint64_t lastSequenceOf(const std::string& path) {
+    uint64_t seq = lastSequenceIn(path);
+    return seq != 0 ? seq : lastSequenceIn(path + kRotatedSuffix);
+}
+
+// Opens the log again if it was rotated or removed since it was opened; returns false if
+// it cannot be opened. Requires logMutex and the log's RecordLock.
+bool reopenIfMoved(bool& reopened) {
+    struct stat opened{}, named{};
+    reopened = false;
+    if (logFd >= 0 && ::fstat(logFd, &opened) == 0 && ::stat(logPath.c_str(), &named) == 0 &&
+        opened.st_ino == named.st_ino && opened.st_dev == named.st_dev) {
+        return true;
+    }
+    if (logFd >= 0) ::close(logFd);
+    logFd = ::open(logPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    reopened = true;
+    return logFd >= 0;
+}
+
+// Brings sequence and offset to the end of the log, which other processes append to as well.
+// Requires logMutex and the log's RecordLock.
+bool refresh() {
+    bool reopened;
+    if (!reopenIfMoved(reopened)) return false;
+    struct stat st{};
+    if (::fstat(logFd, &st) != 0) return false;
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (reopened || size != offset) {
+        sequence = lastSequenceOf(logPath);
+        offset = size;
+    }
+    return true;
+}
+
+// Requires logMutex and the log's RecordLock held exclusively
+void rotateIfFull() {
+    if (offset < kRotateBytes) return;
+    std::string rotated = logPath + kRotatedSuffix;
+    if (std::rename(logPath.c_str(), rotated.c_str()) != 0) return;
+    bool reopened;
+    if (reopenIfMoved(reopened)) offset = 0;
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// head is empty for a delete, or the start of the entry up to and including the document
+// ({"doc":...,). The other fields are dumped after it; keys sort with "doc" first, so the
+// line is the same one a single object holding every field would dump to.
+void append(const char* op, const std::string& path, std::string head) {
+    nlohmann::json entry;
+    entry["ts"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    entry["op"] = op;
+    entry["path"] = path;
+
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (logFd < 0) return;
+    // Writers in other processes share the log: the next sequence number is read from its
+    // tail under an exclusive lock, and each line goes out as one O_APPEND write, so lines
+    // never interleave and a follower never sees a torn entry followed by a newline
+    RecordLock fileLock(logPath, LockMode::Exclusive);
+    if (!refresh()) return;
+    rotateIfFull();
+    entry["seq"] = sequence + 1;
+    std::string fields = entry.dump();
+    std::string line = std::move(head);
+    if (line.empty()) {
+        line = std::move(fields);
+    } else {
+        line.append(fields, 1, std::string::npos);
+    }
+    line += '\n';
+    if (!writeAll(logFd, line)) return;
+    ++sequence;
+    offset += line.size();
+}
+
+} // namespace
+
+bool ChangeLog::enable(const std::string& path) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (logFd >= 0) ::close(logFd);
+    logFd = -1;
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    logPath = path;
+    offset = 0;
+    RecordLock fileLock(logPath, LockMode::Shared);
+    if (!refresh()) {
+        logPath.clear();
+        return false;
+    }
+    logging.store(true, std::memory_order_release);
+    return true;
+}
+
+void ChangeLog::disable() {
+    std::lock_guard<std::mutex> lock(logMutex);
+    logging.store(false, std::memory_order_release);
+    if (logFd >= 0) ::close(logFd);
+    logFd = -1;
+    logPath.clear();
+}
+
+bool ChangeLog::enabled() {
+    return logging.load(std::memory_order_acquire);
+}
+
+template <typename Json>
+void ChangeLog::appendPut(const std::string& path, const Json& doc) {
+    if (!replicated(path)) return;
+    std::string line = "{\"doc\":";
+    dumpInto(line, doc);
+    line += ',';
+    append("put", path, std::move(line));
+}
+
+template void ChangeLog::appendPut(const std::string&, const nlohmann::json&);
+template void ChangeLog::appendPut(const std::string&, const ArenaJson&);
+
+void ChangeLog::appendDelete(const std::string& path) {
+    if (!replicated(path)) return;
+    append("del", path, std::string());
+}
+
+uint64_t ChangeLog::lastSequence() {
+    return position().seq;
+}
+
+ChangeLogPosition ChangeLog::position() {
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (logFd >= 0) {
+        RecordLock fileLock(logPath, LockMode::Shared);
+        refresh();
+    }
+    return ChangeLogPosition{sequence, offset};
+}
+
+std::string ChangeLog::path() {
+    std::lock_guard<std::mutex> lock(logMutex);
+    return logPath;
+}
+
+} // namespace storage
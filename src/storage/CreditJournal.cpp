@@ -0,0 +1,142 @@
+#include "storage/CreditJournal.h"
+#include "storage/FileManager.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+#include <nlohmann/json.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace storage {
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kDir = "data/hot";
+constexpr const char* kOpenExtension = ".log";
+constexpr const char* kSealedExtension = ".fold";
+
+std::string walletDir(const std::string& walletId) {
+    return FileManager::resolve(std::string(kDir) + "/" + walletId);
+}
+
+std::string shardPath(const std::string& walletId, size_t shard, const char* extension) {
+    return walletDir(walletId) + "/" + std::to_string(shard) + extension;
+}
+
+// Appends hold this shared and seal holds it exclusive, so a log is never renamed away from
+// under a writer of this or another process
+std::string lockPathFor(const std::string& walletId, size_t shard) {
+    return std::string(kDir) + "/" + walletId + "/" + std::to_string(shard) + kOpenExtension;
+}
+
+// Shard numbers of the wallet's files with the given extension, ascending
+std::vector<size_t> shardsWith(const std::string& walletId, const char* extension) {
+    std::vector<size_t> shards;
+    std::error_code ec;
+    for (fs::directory_iterator it(walletDir(walletId), ec), end; !ec && it != end; it.increment(ec)) {
+        const auto& path = it->path();
+        if (path.extension() != extension) continue;
+        std::string stem = path.stem().string();
+        char* endp = nullptr;
+        unsigned long shard = std::strtoul(stem.c_str(), &endp, 10);
+        if (endp == stem.c_str() || *endp != '\0') continue;
+        shards.push_back(static_cast<size_t>(shard));
+    }
+    std::sort(shards.begin(), shards.end());
+    return shards;
+}
+
+} // namespace
+
+bool CreditJournal::append(const std::string& walletId, size_t shard, const models::Transaction& tx) {
+    std::string path = shardPath(walletId, shard, kOpenExtension);
+    RecordLock lock(lockPathFor(walletId, shard), LockMode::Shared);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == ENOENT) {
+        std::error_code ec;
+        fs::create_directories(walletDir(walletId), ec);
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) return false;
+    // One write per line: a crash can cut off only the last line, which reads then skip
+    std::string line = nlohmann::json(tx).dump() + "\n";
+    ssize_t n;
+    do {
+        n = ::write(fd, line.data(), line.size());
+    } while (n < 0 && errno == EINTR);
+    ::close(fd);
+    return n == static_cast<ssize_t>(line.size());
+}
+
+bool CreditJournal::seal(const std::string& walletId, size_t shard) {
+    RecordLock lock(lockPathFor(walletId, shard), LockMode::Exclusive);
+    std::string sealedPath = shardPath(walletId, shard, kSealedExtension);
+    std::error_code ec;
+    if (fs::exists(sealedPath, ec)) return false;
+    std::string openPath = shardPath(walletId, shard, kOpenExtension);
+    // Nothing appended since the last fold is not an error
+    return std::rename(openPath.c_str(), sealedPath.c_str()) == 0 || errno == ENOENT;
+}
+
+std::vector<size_t> CreditJournal::openShards(const std::string& walletId) {
+    return shardsWith(walletId, kOpenExtension);
+}
+
+bool CreditJournal::hasPending(const std::string& walletId) {
+    std::error_code ec;
+    for (fs::directory_iterator it(walletDir(walletId), ec), end; !ec && it != end; it.increment(ec)) {
+        const auto& path = it->path();
+        if (path.extension() == kOpenExtension || path.extension() == kSealedExtension) return true;
+    }
+    return false;
+}
+
+std::vector<models::Transaction> CreditJournal::sealed(const std::string& walletId) {
+    std::vector<models::Transaction> credits;
+    for (size_t shard : shardsWith(walletId, kSealedExtension)) {
+        std::string text;
+        std::string relative = std::string(kDir) + "/" + walletId + "/" + std::to_string(shard) + kSealedExtension;
+        if (!FileManager::readFile(relative, text)) continue;
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            // A line without its newline is an append that did not finish
+            if (end == std::string::npos) break;
+            try {
+                credits.push_back(nlohmann::json::parse(text.begin() + start, text.begin() + end).get<models::Transaction>());
+            } catch (...) {}
+            start = end + 1;
+        }
+    }
+    return credits;
+}
+
+bool CreditJournal::removeSealed(const std::string& walletId) {
+    bool ok = true;
+    for (size_t shard : shardsWith(walletId, kSealedExtension)) {
+        std::error_code ec;
+        fs::remove(shardPath(walletId, shard, kSealedExtension), ec);
+        ok = ok && !ec;
+    }
+    return ok;
+}
+
+std::vector<std::string> CreditJournal::wallets() {
+    std::vector<std::string> result;
+    std::error_code ec;
+    for (fs::directory_iterator it(FileManager::resolve(kDir), ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_directory(ec)) continue;
+        std::string walletId = it->path().filename().string();
+        if (!openShards(walletId).empty() || !shardsWith(walletId, kSealedExtension).empty()) {
+            result.push_back(std::move(walletId));
+        }
+    }
+    return result;
+}
+
+} // namespace storage
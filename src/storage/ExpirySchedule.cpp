@@ -0,0 +1,81 @@
+#include "storage/ExpirySchedule.h"
+#include "storage/FileManager.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace storage {
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kDir = "data/expiry";
+constexpr const char* kExtension = ".due";
+
+std::string dayPath(int64_t day) {
+    return std::string(kDir) + "/" + std::to_string(day) + kExtension;
+}
+
+} // namespace
+
+bool ExpirySchedule::add(int64_t day, const std::string& walletId) {
+    std::string path = FileManager::resolve(dayPath(day));
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    // A single O_APPEND write, so lines from concurrent processes never interleave
+    std::string line = walletId + "\n";
+    ssize_t n;
+    do {
+        n = ::write(fd, line.data(), line.size());
+    } while (n < 0 && errno == EINTR);
+    ::close(fd);
+    return n == static_cast<ssize_t>(line.size());
+}
+
+std::vector<int64_t> ExpirySchedule::dueDays(int64_t now) {
+    std::vector<int64_t> days;
+    std::error_code ec;
+    for (fs::directory_iterator it(FileManager::resolve(kDir), ec), end; !ec && it != end; it.increment(ec)) {
+        const auto& path = it->path();
+        if (path.extension() != kExtension) continue;
+        std::string stem = path.stem().string();
+        char* endp = nullptr;
+        int64_t day = std::strtoll(stem.c_str(), &endp, 10);
+        if (endp == stem.c_str() || *endp != '\0') continue;
+        if (day * 86400 <= now) days.push_back(day);
+    }
+    std::sort(days.begin(), days.end());
+    return days;
+}
+
+std::vector<std::string> ExpirySchedule::wallets(int64_t day) {
+    std::vector<std::string> result;
+    std::string text;
+    if (!FileManager::readFile(dayPath(day), text)) return result;
+    std::unordered_set<std::string> seen;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        // A line without its newline is an append that did not finish
+        if (end == std::string::npos) break;
+        std::string id = text.substr(start, end - start);
+        if (!id.empty() && seen.insert(id).second) result.push_back(std::move(id));
+        start = end + 1;
+    }
+    return result;
+}
+
+bool ExpirySchedule::remove(int64_t day) {
+    std::error_code ec;
+    return fs::remove(FileManager::resolve(dayPath(day)), ec);
+}
+
+} // namespace storage
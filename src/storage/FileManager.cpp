@@ -1,38 +1,427 @@
 #include "storage/FileManager.h"
+#include "storage/AsyncIO.h"
+#include "storage/ChangeLog.h"
+#include "storage/RecordIndex.h"
+#include "storage/ResourceUsage.h"
+#include "storage/Snapshot.h"
+#include "tracing/Tracer.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <fstream>
 #include <filesystem>
+#include <optional>
 #include <system_error>
+#include <unordered_map>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace storage {
 namespace fs = std::filesystem;
 
-bool FileManager::writeJson(const std::string& path, const nlohmann::json& j) {
+namespace {
+
+// Empty means the process working directory
+thread_local std::string dataRoot;
+
+constexpr const char* kLockFile = "data/.locks";
+// Lock bytes are spread over this range of the (empty) lock file
+constexpr uint64_t kLockRange = uint64_t(1) << 40;
+
+std::atomic<uint64_t> sharedAcquired{0};
+std::atomic<uint64_t> exclusiveAcquired{0};
+std::atomic<uint64_t> contended{0};
+std::atomic<uint64_t> waitUsTotal{0};
+std::atomic<uint64_t> waitUsMax{0};
+std::atomic<uint64_t> tmpCounter{0};
+
+// Each thread opens the lock file itself: fcntl OFD locks belong to the open file
+// description, so threads sharing one descriptor would not exclude each other
+struct ThreadLockState {
+    std::unordered_map<std::string, int> fds;
+    struct Held {
+        int depth;
+        LockMode mode;
+    };
+    // Keyed by descriptor and byte so hash collisions nest instead of self-deadlocking
+    std::unordered_map<std::string, Held> held;
+
+    ~ThreadLockState() {
+        for (auto& entry : fds) ::close(entry.second);
+    }
+};
+
+thread_local ThreadLockState lockState;
+
+int lockFd() {
+    std::string path = FileManager::resolve(kLockFile);
+    auto it = lockState.fds.find(path);
+    if (it != lockState.fds.end()) return it->second;
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0) lockState.fds.emplace(path, fd);
+    return fd;
+}
+
+// FNV-1a, stable across processes and builds unlike std::hash
+uint64_t lockOffset(const std::string& path) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : path) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h % kLockRange;
+}
+
+bool setLock(int fd, int64_t offset, short type, bool wait) {
+    struct flock fl = {};
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = offset;
+    fl.l_len = 1;
+    while (::fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl) != 0) {
+        if (errno != EINTR) return false;
+    }
+    return true;
+}
+
+std::string heldKey(int fd, int64_t offset) {
+    return std::to_string(fd) + ":" + std::to_string(offset);
+}
+
+bool readWhole(const std::string& path, std::string& out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    UsageScope::fileOpened();
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    // Records are small, so one sized read beats both stream buffering and mmap setup
+    out.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = ::read(fd, &out[done], out.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    out.resize(done);
+    UsageScope::bytesRead(done);
+    return true;
+}
+
+} // namespace
+
+RecordLock::RecordLock(const std::string& path, LockMode mode) {
+    acquire(path, mode, true);
+}
+
+RecordLock::RecordLock(const std::string& path, LockMode mode, std::try_to_lock_t) {
+    acquire(path, mode, false);
+}
+
+void RecordLock::acquire(const std::string& path, LockMode mode, bool wait) {
+    fd_ = lockFd();
+    if (fd_ < 0) return;
+    offset_ = static_cast<int64_t>(lockOffset(path));
+    auto& held = lockState.held[heldKey(fd_, offset_)];
+    if (held.depth > 0 && (held.mode == LockMode::Exclusive || mode == LockMode::Shared)) {
+        ++held.depth;
+        held_ = true;
+        return;
+    }
+
+    short type = mode == LockMode::Exclusive ? F_WRLCK : F_RDLCK;
+    if (!setLock(fd_, offset_, type, false)) {
+        if (!wait) {
+            if (held.depth == 0) lockState.held.erase(heldKey(fd_, offset_));
+            return;
+        }
+        contended.fetch_add(1, std::memory_order_relaxed);
+        tracing::Span span("storage", "RecordLock::wait", path);
+        auto start = std::chrono::steady_clock::now();
+        bool ok = setLock(fd_, offset_, type, true);
+        uint64_t waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        waitUsTotal.fetch_add(waited, std::memory_order_relaxed);
+        uint64_t max = waitUsMax.load(std::memory_order_relaxed);
+        while (waited > max && !waitUsMax.compare_exchange_weak(max, waited, std::memory_order_relaxed)) {}
+        if (!ok) {
+            if (held.depth == 0) lockState.held.erase(heldKey(fd_, offset_));
+            return;
+        }
+    }
+    (mode == LockMode::Exclusive ? exclusiveAcquired : sharedAcquired).fetch_add(1, std::memory_order_relaxed);
+    // A nested Exclusive over a Shared hold converts the lock in place until the outermost release
+    if (held.depth == 0 || mode == LockMode::Exclusive) held.mode = mode;
+    ++held.depth;
+    held_ = true;
+}
+
+RecordLock::~RecordLock() {
+    if (!held_) return;
+    auto it = lockState.held.find(heldKey(fd_, offset_));
+    if (it == lockState.held.end()) return;
+    if (--it->second.depth > 0) return;
+    lockState.held.erase(it);
+    setLock(fd_, offset_, F_UNLCK, false);
+}
+
+LockStats FileManager::lockStats() {
+    LockStats s;
+    s.shared_acquired = sharedAcquired.load(std::memory_order_relaxed);
+    s.exclusive_acquired = exclusiveAcquired.load(std::memory_order_relaxed);
+    s.contended = contended.load(std::memory_order_relaxed);
+    s.wait_us_total = waitUsTotal.load(std::memory_order_relaxed);
+    s.wait_us_max = waitUsMax.load(std::memory_order_relaxed);
+    return s;
+}
+
+std::string FileManager::resolve(const std::string& path) {
+    if (dataRoot.empty()) return path;
+    return dataRoot + "/" + path;
+}
+
+ScopedDataRoot::ScopedDataRoot(const std::string& root) : previous_(dataRoot) {
+    dataRoot = root;
+}
+
+ScopedDataRoot::~ScopedDataRoot() {
+    dataRoot = previous_;
+}
+
+namespace {
+
+// Formatted straight into the heap buffer that is written and kept by VersionStore, which
+// outlives the request
+template <typename Json>
+std::shared_ptr<std::string> dumpRecord(const Json& j) {
+    auto text = std::make_shared<std::string>();
+    dumpInto(*text, j, 4);
+    return text;
+}
+
+// Unique per process and write, so concurrent writers never share a temp file
+std::string tmpPathFor(const std::string& path) {
+    return path + "." + std::to_string(::getpid()) + "." +
+           std::to_string(tmpCounter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+}
+
+} // namespace
+
+template <typename Json>
+bool FileManager::writeJson(const std::string& logicalPath, const Json& j) {
+    tracing::Span span("storage", "FileManager::writeJson", logicalPath);
+    std::string path = resolve(logicalPath);
     fs::path p(path);
     if (p.has_parent_path()) {
         fs::create_directories(p.parent_path());
     }
-    std::string tmpPath = path + ".tmp";
+    RecordLock lock(logicalPath, LockMode::Exclusive);
+    // Leader writes feed the record index and the change log; replica roots do neither
+    std::optional<RecordIndex::UpdateScope> indexing;
+    if (dataRoot.empty()) indexing.emplace();
+    bool versioned = VersionStore::beginWrite(path);
+    std::string tmpPath = tmpPathFor(path);
+    auto content = dumpRecord(j);
     {
         std::ofstream ofs(tmpPath, std::ios::trunc);
-        if (!ofs) return false;
-        ofs << j.dump(4);
-        ofs.flush();
-        if (!ofs) return false;
+        UsageScope::fileOpened();
+        bool written = ofs && ofs.write(content->data(), static_cast<std::streamsize>(content->size())).flush();
+        if (!written) {
+            std::error_code ec;
+            fs::remove(tmpPath, ec);
+            VersionStore::abortWrite(path, versioned);
+            return false;
+        }
     }
+    UsageScope::bytesWritten(content->size());
     std::error_code ec;
     fs::rename(tmpPath, path, ec);
-    return !ec;
+    UsageScope::renamed();
+    if (ec) {
+        fs::remove(tmpPath, ec);
+        VersionStore::abortWrite(path, versioned);
+        return false;
+    }
+    VersionStore::commit(path, versioned, std::move(content));
+    if (indexing) {
+        RecordIndex::onPut(logicalPath, j);
+        if (ChangeLog::enabled()) ChangeLog::appendPut(logicalPath, j);
+    }
+    return true;
+}
+
+template bool FileManager::writeJson(const std::string&, const nlohmann::json&);
+template bool FileManager::writeJson(const std::string&, const ArenaJson&);
+
+bool FileManager::writeJsonChain(const std::vector<ChainedWrite>& writes) {
+    tracing::Span span("storage", "FileManager::writeJsonChain");
+    // All locks are taken before any I/O, without waiting: blocking on one while holding the
+    // others could deadlock against a writer taking them in another order. If any is busy,
+    // the records are written one by one instead, each waiting for its own lock.
+    std::deque<RecordLock> locks;
+    for (const auto& w : writes) {
+        locks.emplace_back(w.path, LockMode::Exclusive, std::try_to_lock);
+        if (!locks.back().held()) {
+            locks.clear();
+            for (const auto& each : writes) {
+                if (!writeJson(each.path, *each.doc)) return false;
+            }
+            return true;
+        }
+    }
+
+    std::optional<RecordIndex::UpdateScope> indexing;
+    if (dataRoot.empty()) indexing.emplace();
+    struct Prepared {
+        bool versioned;
+        std::shared_ptr<std::string> content;
+    };
+    std::vector<Prepared> prepared;
+    std::vector<FileWrite> ios;
+    prepared.reserve(writes.size());
+    ios.reserve(writes.size());
+    for (const auto& w : writes) {
+        std::string path = resolve(w.path);
+        fs::path p(path);
+        if (p.has_parent_path()) fs::create_directories(p.parent_path());
+        bool versioned = VersionStore::beginWrite(path);
+        auto content = dumpRecord(*w.doc);
+        ios.push_back(FileWrite{tmpPathFor(path), path, content.get(), false});
+        prepared.push_back(Prepared{versioned, std::move(content)});
+    }
+    bool ok = AsyncIO::writeChain(ios);
+    for (size_t i = 0; i < writes.size(); ++i) {
+        Prepared& p = prepared[i];
+        if (!ios[i].ok) {
+            VersionStore::abortWrite(ios[i].path, p.versioned);
+            continue;
+        }
+        UsageScope::fileOpened();
+        UsageScope::bytesWritten(p.content->size());
+        UsageScope::renamed();
+        VersionStore::commit(ios[i].path, p.versioned, std::move(p.content));
+        if (indexing) {
+            RecordIndex::onPut(writes[i].path, *writes[i].doc);
+            if (ChangeLog::enabled()) ChangeLog::appendPut(writes[i].path, *writes[i].doc);
+        }
+    }
+    return ok;
+}
+
+bool FileManager::removeFile(const std::string& logicalPath) {
+    return remove(logicalPath, true);
+}
+
+bool FileManager::evictFile(const std::string& logicalPath) {
+    return remove(logicalPath, false);
+}
+
+bool FileManager::remove(const std::string& logicalPath, bool deleted) {
+    tracing::Span span("storage", "FileManager::remove", logicalPath);
+    RecordLock lock(logicalPath, LockMode::Exclusive);
+    std::string path = resolve(logicalPath);
+    std::optional<RecordIndex::UpdateScope> indexing;
+    if (dataRoot.empty() && deleted) indexing.emplace();
+    bool versioned = VersionStore::beginWrite(path);
+    std::error_code ec;
+    bool removed = fs::remove(path, ec);
+    if (removed) {
+        VersionStore::commit(path, versioned, nullptr);
+    } else {
+        VersionStore::abortWrite(path, versioned);
+    }
+    if (removed && indexing) {
+        RecordIndex::onDelete(logicalPath);
+        if (ChangeLog::enabled()) ChangeLog::appendDelete(logicalPath);
+    }
+    return removed;
 }
 
 bool FileManager::readJson(const std::string& path, nlohmann::json& j) {
-    std::ifstream ifs(path);
-    if (!ifs) return false;
+    std::string buffer;
+    if (!readFile(path, buffer)) return false;
     try {
-        ifs >> j;
+        j = nlohmann::json::parse(buffer);
         return true;
     } catch (...) {
         return false;
     }
 }
 
-} // namespace storage 
\ No newline at end of file
+bool FileManager::readFile(const std::string& logicalPath, std::string& out) {
+    tracing::Span span("storage", "FileManager::readFile", logicalPath);
+    std::string path = resolve(logicalPath);
+    RecordLock lock(logicalPath, LockMode::Shared);
+    // Under a snapshot, a record written since it was taken is served from its retained version
+    if (auto version = VersionStore::visible(path)) {
+        if (!*version) return false;
+        out = **version;
+        return true;
+    }
+    return readWhole(path, out);
+}
+
+void FileManager::readFiles(const std::vector<std::string>& logicalPaths,
+                            std::vector<std::optional<std::string>>& out) {
+    tracing::Span span("storage", "FileManager::readFiles");
+    out.assign(logicalPaths.size(), std::nullopt);
+    // No record locks: records are only ever replaced by rename, so each read sees one whole
+    // version, and a batch never holds up writers to its records. Under a snapshot a write
+    // may replace a file between the version check and its read, so the check is repeated
+    // after the reads.
+    bool snapshot = VersionStore::current() != nullptr;
+    std::vector<FileRead> reads;
+    std::vector<size_t> slots;
+    for (size_t i = 0; i < logicalPaths.size(); ++i) {
+        std::string path = resolve(logicalPaths[i]);
+        if (auto version = VersionStore::visible(path)) {
+            if (*version) out[i] = **version;
+            continue;
+        }
+        reads.push_back(FileRead{std::move(path), {}, false});
+        slots.push_back(i);
+    }
+    AsyncIO::read(reads);
+    for (size_t k = 0; k < reads.size(); ++k) {
+        if (reads[k].ok) {
+            UsageScope::fileOpened();
+            UsageScope::bytesRead(reads[k].data.size());
+        }
+        if (snapshot) {
+            if (auto version = VersionStore::visible(reads[k].path)) {
+                if (*version) out[slots[k]] = **version;
+                continue;
+            }
+        }
+        if (reads[k].ok) out[slots[k]] = std::move(reads[k].data);
+    }
+}
+
+std::vector<std::string> FileManager::listRecords(const std::string& logicalDir) {
+    tracing::Span span("storage", "FileManager::listRecords", logicalDir);
+    std::vector<std::string> paths;
+    std::string dir = resolve(logicalDir);
+    std::error_code ec;
+    uint64_t entries = 0;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        ++entries;
+        if (it->path().extension() == ".json") {
+            paths.push_back(logicalDir + "/" + it->path().filename().string());
+        }
+    }
+    UsageScope::dirScanned(entries);
+    for (const auto& name : VersionStore::deletedSince(dir)) {
+        if (fs::path(name).extension() == ".json") paths.push_back(logicalDir + "/" + name);
+    }
+    return paths;
+}
+
+} // namespace storage
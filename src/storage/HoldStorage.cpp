@@ -0,0 +1,59 @@
+#include "storage/HoldStorage.h"
+#include "storage/FileManager.h"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+
+namespace storage {
+
+namespace {
+
+const char* const kHoldsDir = "data/holds";
+
+// Wallet IDs come from hold IDs supplied by callers, so they must not leave the directory
+bool validWalletId(const std::string& walletId) {
+    if (walletId.empty() || walletId.size() > 128) return false;
+    for (char c : walletId) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+std::string pathFor(const std::string& walletId) {
+    return std::string(kHoldsDir) + "/" + walletId + ".json";
+}
+
+} // namespace
+
+bool HoldStorage::save(const std::string& walletId, const std::vector<models::Hold>& holds) {
+    if (!validWalletId(walletId)) return false;
+    if (holds.empty()) {
+        FileManager::removeFile(pathFor(walletId));
+        return true;
+    }
+    nlohmann::json j = {{"holds", holds}};
+    return FileManager::writeJson(pathFor(walletId), j);
+}
+
+std::optional<std::vector<models::Hold>> HoldStorage::load(const std::string& walletId) {
+    if (!validWalletId(walletId)) return std::nullopt;
+    std::error_code ec;
+    if (!std::filesystem::exists(FileManager::resolve(pathFor(walletId)), ec)) return std::vector<models::Hold>{};
+    nlohmann::json j;
+    if (!FileManager::readJson(pathFor(walletId), j)) return std::nullopt;
+    try {
+        return j.at("holds").get<std::vector<models::Hold>>();
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+std::vector<std::string> HoldStorage::wallets() {
+    std::vector<std::string> result;
+    for (const auto& path : FileManager::listRecords(kHoldsDir)) {
+        result.push_back(std::filesystem::path(path).stem().string());
+    }
+    return result;
+}
+
+} // namespace storage
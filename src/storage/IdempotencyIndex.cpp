@@ -0,0 +1,332 @@
+#include "storage/IdempotencyIndex.h"
+#include "storage/FileManager.h"
+
+#include <nlohmann/json.hpp>
+#include <openssl/sha.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kRecentCapacity = 100000;
+constexpr int64_t kDaySeconds = 86400;
+// One directory per scope, so keys of different scopes never meet
+constexpr const char* kDirs[] = {"data/idempotency", "data/campaign_credits"};
+
+struct Recent {
+    IdempotencyIndex::Entry entry;
+    int64_t day;
+};
+
+// Completed keys only: a completed key never changes until its bucket expires
+struct IndexState {
+    std::mutex mutex;
+    std::unordered_map<std::string, Recent> recent;
+    std::deque<std::string> order;
+};
+
+IndexState& state() {
+    static IndexState s;
+    return s;
+}
+
+std::atomic<int64_t> sweptDay{0};
+
+// Removes expired buckets off the request path; reserve wakes it on the first call of a day
+class Sweeper {
+public:
+    void wake(int64_t now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        due_ = now;
+        if (!thread_.joinable()) thread_ = std::thread([this] { loop(); });
+        wake_.notify_one();
+    }
+
+    ~Sweeper() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+private:
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [this] { return stop_ || due_ != 0; });
+            if (stop_) return;
+            int64_t now = due_;
+            due_ = 0;
+            lock.unlock();
+            IdempotencyIndex::expire(now);
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    int64_t due_ = 0;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+Sweeper& sweeper() {
+    static Sweeper s;
+    return s;
+}
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Where a key of one scope lives
+struct Slot {
+    const char* dir;
+    std::string digest;
+    // Key of the in-memory table, which all scopes share
+    std::string recentKey;
+};
+
+Slot slotOf(const std::string& key, IdempotencyIndex::Scope scope) {
+    size_t index = static_cast<size_t>(scope);
+    std::string d = IdempotencyIndex::digest(key);
+    return Slot{kDirs[index], d, std::to_string(index) + d};
+}
+
+std::string pathFor(const Slot& slot, int64_t day) {
+    return std::string(slot.dir) + "/" + std::to_string(day) + "/" + slot.digest.substr(0, 2) + "/" + slot.digest +
+           ".json";
+}
+
+// Serializes reserve, complete and abandon of one key across threads and processes
+std::string lockPathFor(const Slot& slot) {
+    return std::string(slot.dir) + "/" + slot.digest;
+}
+
+// A key's stored record and the bucket it is in
+struct Stored {
+    int64_t day;
+    nlohmann::json doc;
+    // Last change to the file, in seconds since the epoch; set only for an unparsable file
+    int64_t modified = 0;
+};
+
+// Finds the key in the buckets still within retention, newest first. A file that exists but
+// does not parse is a reservation still being written, or one whose writer crashed between
+// creating and filling it; it is reported with an empty doc and the file's mtime.
+std::optional<Stored> find(const std::string& key, const Slot& slot, int64_t today) {
+    for (int64_t day = today; day >= today - IdempotencyIndex::kRetentionDays; --day) {
+        std::string text;
+        if (!FileManager::readFile(pathFor(slot, day), text)) continue;
+        try {
+            auto doc = nlohmann::json::parse(text);
+            // Guard against digest collisions by comparing the full key
+            if (doc.at("key").get<std::string>() != key) continue;
+            return Stored{day, std::move(doc)};
+        } catch (...) {
+            struct stat st {};
+            int64_t modified = ::stat(FileManager::resolve(pathFor(slot, day)).c_str(), &st) == 0 ? st.st_mtime : 0;
+            return Stored{day, nlohmann::json(), modified};
+        }
+    }
+    return std::nullopt;
+}
+
+IdempotencyIndex::Entry entryOf(const nlohmann::json& doc) {
+    return IdempotencyIndex::Entry{doc.value("wallet_id", ""), doc.value("transaction_id", ""),
+                                   doc.value("fingerprint", "")};
+}
+
+void remember(const Slot& slot, const IdempotencyIndex::Entry& entry, int64_t day) {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.recent.emplace(slot.recentKey, Recent{entry, day}).second) {
+        s.order.push_back(slot.recentKey);
+        if (s.order.size() > kRecentCapacity) {
+            s.recent.erase(s.order.front());
+            s.order.pop_front();
+        }
+    }
+}
+
+std::optional<IdempotencyIndex::Entry> recentEntry(const Slot& slot, int64_t today) {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.recent.find(slot.recentKey);
+    if (it == s.recent.end() || it->second.day < today - IdempotencyIndex::kRetentionDays) return std::nullopt;
+    return it->second.entry;
+}
+
+// Creates the reservation only if no file is there; a single write, so a reader sees the
+// whole record or an empty file. Returns 0 or the errno of the failure.
+int createExclusive(const std::string& path, const std::string& text) {
+    std::string full = FileManager::resolve(path);
+    int fd = ::open(full.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == ENOENT) {
+        std::error_code ec;
+        fs::create_directories(fs::path(full).parent_path(), ec);
+        fd = ::open(full.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) return errno;
+    ssize_t n;
+    do {
+        n = ::write(fd, text.data(), text.size());
+    } while (n < 0 && errno == EINTR);
+    int error = n < 0 ? errno : EIO;
+    ::close(fd);
+    if (n == static_cast<ssize_t>(text.size())) return 0;
+    ::unlink(full.c_str());
+    return error;
+}
+
+nlohmann::json pendingDoc(const std::string& key, const std::string& walletId, const std::string& fingerprint,
+                          int64_t now) {
+    return nlohmann::json{{"key", key},
+                          {"wallet_id", walletId},
+                          {"fingerprint", fingerprint},
+                          {"status", "pending"},
+                          {"reserved_at", now}};
+}
+
+} // namespace
+
+std::string IdempotencyIndex::digest(const std::string& key) {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(key.c_str()), key.size(), hash);
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0');
+    for (int i = 0; i < 16; ++i) {
+        oss << std::setw(2) << static_cast<int>(hash[i]);
+    }
+    return oss.str();
+}
+
+IdempotencyIndex::Claim IdempotencyIndex::reserve(const std::string& key, const std::string& walletId,
+                                                  const std::string& fingerprint, Scope scope) {
+    int64_t now = nowSeconds();
+    int64_t today = now / kDaySeconds;
+    if (sweptDay.exchange(today) != today) sweeper().wake(now);
+    Slot slot = slotOf(key, scope);
+    auto matches = [&](const Entry& entry) {
+        return entry.wallet_id == walletId && entry.fingerprint == fingerprint;
+    };
+    if (auto entry = recentEntry(slot, today)) {
+        return Claim{matches(*entry) ? Status::Duplicate : Status::Conflict, *entry};
+    }
+
+    RecordLock lock(lockPathFor(slot), LockMode::Exclusive);
+    if (auto stored = find(key, slot, today)) {
+        if (stored->doc.is_null()) {
+            if (now - stored->modified < kPendingTimeoutSeconds) return Claim{Status::InProgress, {}};
+            // Left empty or torn by a crash; nothing ran under it, so take the key over
+            if (!FileManager::writeJson(pathFor(slot, stored->day), pendingDoc(key, walletId, fingerprint, now))) {
+                return Claim{Status::Failed, {}};
+            }
+            return Claim{Status::Reserved, Entry{walletId, "", fingerprint}};
+        }
+        Entry entry = entryOf(stored->doc);
+        if (!matches(entry)) return Claim{Status::Conflict, entry};
+        if (stored->doc.value("status", "") == "done") {
+            remember(slot, entry, stored->day);
+            return Claim{Status::Duplicate, entry};
+        }
+        if (now - stored->doc.value("reserved_at", int64_t(0)) < kPendingTimeoutSeconds) {
+            return Claim{Status::InProgress, entry};
+        }
+        // The request holding the key died; its transaction ID is derived from the key, so
+        // running it again applies it at most once
+        if (!FileManager::writeJson(pathFor(slot, stored->day), pendingDoc(key, walletId, fingerprint, now))) {
+            return Claim{Status::Failed, {}};
+        }
+        return Claim{Status::Reserved, entry};
+    }
+    if (int error = createExclusive(pathFor(slot, today), pendingDoc(key, walletId, fingerprint, now).dump())) {
+        return Claim{error == EEXIST ? Status::InProgress : Status::Failed, {}};
+    }
+    return Claim{Status::Reserved, Entry{walletId, "", fingerprint}};
+}
+
+bool IdempotencyIndex::complete(const std::string& key, const Entry& entry, Scope scope) {
+    int64_t today = nowSeconds() / kDaySeconds;
+    Slot slot = slotOf(key, scope);
+    RecordLock lock(lockPathFor(slot), LockMode::Exclusive);
+    auto stored = find(key, slot, today);
+    int64_t day = stored ? stored->day : today;
+    nlohmann::json j;
+    j["key"] = key;
+    j["wallet_id"] = entry.wallet_id;
+    j["transaction_id"] = entry.transaction_id;
+    j["fingerprint"] = entry.fingerprint;
+    j["status"] = "done";
+    if (!FileManager::writeJson(pathFor(slot, day), j)) return false;
+    remember(slot, entry, day);
+    return true;
+}
+
+void IdempotencyIndex::abandon(const std::string& key, Scope scope) {
+    int64_t today = nowSeconds() / kDaySeconds;
+    Slot slot = slotOf(key, scope);
+    RecordLock lock(lockPathFor(slot), LockMode::Exclusive);
+    auto stored = find(key, slot, today);
+    if (!stored || stored->doc.value("status", "") == "done") return;
+    std::error_code ec;
+    fs::remove(FileManager::resolve(pathFor(slot, stored->day)), ec);
+}
+
+std::optional<IdempotencyIndex::Entry> IdempotencyIndex::lookup(const std::string& key, Scope scope) {
+    int64_t today = nowSeconds() / kDaySeconds;
+    Slot slot = slotOf(key, scope);
+    if (auto entry = recentEntry(slot, today)) return entry;
+    auto stored = find(key, slot, today);
+    if (!stored || stored->doc.is_null() || stored->doc.value("status", "") != "done") return std::nullopt;
+    Entry entry = entryOf(stored->doc);
+    remember(slot, entry, stored->day);
+    return entry;
+}
+
+size_t IdempotencyIndex::expire(int64_t now) {
+    int64_t oldest = now / kDaySeconds - kRetentionDays;
+    size_t removed = 0;
+    std::error_code ec;
+    // Anything that is not a bucket within retention goes, including the flat layout
+    // ({hh}/{digest}.json) of earlier versions; transaction IDs derived from those keys still
+    // keep a retried request from applying twice
+    for (const char* dir : kDirs) {
+        for (fs::directory_iterator it(FileManager::resolve(dir), ec), end; !ec && it != end; it.increment(ec)) {
+            if (!it->is_directory(ec)) continue;
+            std::string name = it->path().filename().string();
+            char* endp = nullptr;
+            long long day = std::strtoll(name.c_str(), &endp, 10);
+            bool bucket = endp != name.c_str() && *endp == '\0' && name.size() > 2;
+            if (bucket && day >= oldest) continue;
+            std::error_code removeEc;
+            fs::remove_all(it->path(), removeEc);
+            if (!removeEc) ++removed;
+        }
+        ec.clear();
+    }
+    return removed;
+}
+
+} // namespace storage
@@ -0,0 +1,516 @@
+#include "storage/RecordIndex.h"
+#include "storage/ChangeLog.h"
+#include "storage/FileManager.h"
+#include "storage/SaxModelReader.h"
+#include "storage/TransactionArchive.h"
+#include "models/Id128.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <zlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[8] = {'R', 'W', 'I', 'D', 'X', 'S', 'N', 'P'};
+// 2 dropped the user and wallet maps
+constexpr uint32_t kFormatVersion = 2;
+
+constexpr const char* kTransactionsDir = "data/transactions";
+
+// Fixed-width, naturally aligned fields in host byte order
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t crc;
+    uint64_t payload_bytes;
+    uint64_t changelog_seq;
+    uint64_t changelog_offset;
+    int64_t created_ms;
+    int64_t dir_mtime_ns;
+    uint64_t count;
+};
+
+struct TxEntry {
+    models::Id128 wallet_id;
+    int64_t timestamp;
+};
+
+// Wallet and transaction ids are held as Id128: the maps grow with every transaction ever
+// written, and binary keys keep each entry free of string allocations
+struct Index {
+    std::unordered_map<models::Id128, TxEntry> transactions;
+    std::set<std::pair<int64_t, models::Id128>> txOrder;
+
+    void putTransaction(const models::Id128& id, const models::Id128& walletId, int64_t timestamp) {
+        auto it = transactions.find(id);
+        if (it != transactions.end()) txOrder.erase({it->second.timestamp, id});
+        transactions[id] = TxEntry{walletId, timestamp};
+        txOrder.emplace(timestamp, id);
+    }
+
+    void erase(const std::string& id) {
+        auto key = models::Id128::find(id);
+        if (!key) return;
+        auto it = transactions.find(*key);
+        if (it == transactions.end()) return;
+        txOrder.erase({it->second.timestamp, *key});
+        transactions.erase(it);
+    }
+};
+
+std::shared_mutex indexMutex;
+Index index;
+std::atomic<bool> isLoaded{false};
+// Held shared by in-flight FileManager writes, exclusively while save() captures the index
+std::shared_mutex updateGate;
+
+std::mutex statusMutex;
+RecordIndexStatus currentStatus;
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t parseTimestamp(const std::string& text) {
+    return std::strtoll(text.c_str(), nullptr, 10);
+}
+
+// The ID of "data/transactions/<id>.json"; false for any other path
+bool classify(const std::string& path, std::string& id) {
+    std::string prefix = std::string(kTransactionsDir) + "/";
+    if (path.compare(0, prefix.size(), prefix) != 0) return false;
+    fs::path name(path.substr(prefix.size()));
+    if (name.has_parent_path() || name.extension() != ".json") return false;
+    id = name.stem().string();
+    return true;
+}
+
+// A string field of a record document, whichever string type the document uses
+template <typename Json>
+std::string field(const Json& doc, const char* key, const char* fallback) {
+    auto value = doc.value(key, fallback);
+    return std::string(value.data(), value.size());
+}
+
+template <typename Json>
+void applyPut(Index& idx, const std::string& id, const Json& doc) {
+    idx.putTransaction(models::Id128::parse(id), models::Id128::parse(field(doc, "wallet_id", "")),
+                       parseTimestamp(field(doc, "timestamp", "0")));
+}
+
+// Directory modification time in ns since the Unix epoch, -1 if it does not exist. Compared
+// with change log timestamps, so not file_clock, whose epoch is the library's choice.
+int64_t dirMtime(const char* dir) {
+    struct stat st;
+    if (::stat(FileManager::resolve(dir).c_str(), &st) != 0) return -1;
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+void putString(std::string& out, const std::string& s) {
+    uint32_t size = static_cast<uint32_t>(s.size());
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.append(s);
+}
+
+class PayloadReader {
+public:
+    PayloadReader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+    bool string(std::string& out) {
+        uint32_t size;
+        if (!raw(&size, sizeof(size)) || static_cast<size_t>(end_ - p_) < size) return false;
+        out.assign(p_, size);
+        p_ += size;
+        return true;
+    }
+
+    bool raw(void* out, size_t size) {
+        if (static_cast<size_t>(end_ - p_) < size) return false;
+        std::memcpy(out, p_, size);
+        p_ += size;
+        return true;
+    }
+
+    bool done() const { return p_ == end_; }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<const char*>(p);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+    }
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Loads and verifies the snapshot; reason is set when it is unusable
+bool readSnapshot(Index& idx, Header& header, std::string& reason) {
+    MappedFile file(FileManager::resolve(RecordIndex::kSnapshotPath));
+    if (!file.data()) {
+        reason = "no snapshot";
+        return false;
+    }
+    if (file.size() < sizeof(Header)) {
+        reason = "truncated snapshot";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kFormatVersion) {
+        reason = "unknown snapshot format";
+        return false;
+    }
+    const char* payload = file.data() + sizeof(Header);
+    if (header.payload_bytes != file.size() - sizeof(Header) ||
+        crc32(0L, reinterpret_cast<const Bytef*>(payload), static_cast<uInt>(header.payload_bytes)) != header.crc) {
+        reason = "snapshot checksum mismatch";
+        return false;
+    }
+
+    PayloadReader in(payload, header.payload_bytes);
+    idx.transactions.reserve(header.count);
+    std::string a, b;
+    for (uint64_t i = 0; i < header.count; ++i) {
+        int64_t ts;
+        if (!in.string(a) || !in.string(b) || !in.raw(&ts, sizeof(ts))) break;
+        idx.putTransaction(models::Id128::parse(a), models::Id128::parse(b), ts);
+    }
+    if (!in.done() || idx.transactions.size() != header.count) {
+        reason = "malformed snapshot";
+        return false;
+    }
+    return true;
+}
+
+// Brings a loaded snapshot up to date from the change log. The snapshot is current as-is
+// when the transaction directory did not change since it was written; otherwise every change
+// must be in the log, contiguous from the snapshot's sequence, and the directory may not have
+// changed after the last logged entry (a writer running without the log).
+bool catchUp(Index& idx, const Header& header, uint64_t& replayed, std::string& reason) {
+    int64_t mtime = dirMtime(kTransactionsDir);
+    if (mtime == header.dir_mtime_ns) return true;
+
+    std::string logPath = ChangeLog::path();
+    if (logPath.empty() || header.changelog_seq == 0) {
+        reason = "records changed since snapshot and no change log to replay";
+        return false;
+    }
+    ChangeLogPosition end = ChangeLog::position();
+    if (end.seq < header.changelog_seq || end.offset < header.changelog_offset) {
+        reason = "change log was reset";
+        return false;
+    }
+    std::string tail;
+    {
+        MappedFile log(logPath);
+        if (end.offset > log.size()) {
+            reason = "change log shorter than expected";
+            return false;
+        }
+        if (end.offset > header.changelog_offset) {
+            tail.assign(log.data() + header.changelog_offset, end.offset - header.changelog_offset);
+        }
+    }
+
+    uint64_t expected = header.changelog_seq + 1;
+    int64_t lastTs = 0;
+    size_t pos = 0;
+    for (size_t nl; (nl = tail.find('\n', pos)) != std::string::npos; pos = nl + 1) {
+        nlohmann::json entry = nlohmann::json::parse(tail.begin() + pos, tail.begin() + nl, nullptr, false);
+        if (entry.is_discarded() || entry.value("seq", uint64_t(0)) != expected) {
+            reason = "gap in change log";
+            return false;
+        }
+        ++expected;
+        lastTs = entry.value("ts", int64_t(0));
+        std::string id;
+        if (!classify(entry.value("path", ""), id)) continue;
+        if (entry.value("op", "") == "del") {
+            idx.erase(id);
+        } else if (entry.contains("doc")) {
+            applyPut(idx, id, entry["doc"]);
+        }
+        ++replayed;
+    }
+    if (mtime / 1000000 > lastTs) {
+        reason = std::string(kTransactionsDir) + " changed after the last logged change";
+        return false;
+    }
+    return true;
+}
+
+// Parses every transaction file, split across workers
+void rebuild(Index& idx, unsigned workers) {
+    std::vector<std::string> paths = FileManager::listRecords(kTransactionsDir);
+    std::vector<std::vector<models::Transaction>> partials(workers);
+    std::vector<std::thread> pool;
+    for (unsigned w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w] {
+            for (size_t i = w; i < paths.size(); i += workers) {
+                models::Transaction tx;
+                if (SaxModelReader::read(paths[i], tx)) partials[w].push_back(std::move(tx));
+            }
+        });
+    }
+    for (auto& t : pool) t.join();
+
+    idx.transactions.reserve(paths.size());
+    for (auto& part : partials) {
+        for (auto& tx : part) {
+            idx.putTransaction(models::Id128::parse(tx.transaction_id), models::Id128::parse(tx.wallet_id),
+                               parseTimestamp(tx.timestamp));
+        }
+    }
+    // Cold transactions are indexed too; their hot copies are gone
+    TransactionArchive::forEach([&](const models::Transaction& tx) {
+        idx.putTransaction(models::Id128::parse(tx.transaction_id), models::Id128::parse(tx.wallet_id),
+                           parseTimestamp(tx.timestamp));
+    });
+}
+
+class PeriodicSaver {
+public:
+    void start(std::chrono::seconds interval) {
+        stop();
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+        thread_ = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, interval, [this] { return stop_; })) {
+                lock.unlock();
+                RecordIndex::save();
+                lock.lock();
+            }
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    ~PeriodicSaver() { stop(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+PeriodicSaver& saver() {
+    static PeriodicSaver s;
+    return s;
+}
+
+} // namespace
+
+bool RecordIndex::load(unsigned workers) {
+    auto start = std::chrono::steady_clock::now();
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+
+    RecordIndexStatus st;
+    Index fresh;
+    Header header{};
+    bool fromSnapshot = false;
+    try {
+        fromSnapshot = readSnapshot(fresh, header, st.rebuild_reason) &&
+                       catchUp(fresh, header, st.replayed_changes, st.rebuild_reason);
+    } catch (...) {
+        st.rebuild_reason = "unreadable snapshot";
+    }
+    if (fromSnapshot) {
+        st.source = "snapshot";
+        st.snapshot_ms = header.created_ms;
+    } else {
+        fresh = Index{};
+        st.replayed_changes = 0;
+        try {
+            rebuild(fresh, workers);
+        } catch (...) {
+            return false;
+        }
+        st.source = "rebuild";
+    }
+    st.transactions = fresh.transactions.size();
+    {
+        std::unique_lock<std::shared_mutex> lock(indexMutex);
+        index = std::move(fresh);
+        isLoaded.store(true, std::memory_order_release);
+    }
+    st.load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(statusMutex);
+        currentStatus = st;
+    }
+    // Whatever was replayed or rebuilt need not be repeated on the next start
+    if (!fromSnapshot || st.replayed_changes > 0) save();
+    return true;
+}
+
+bool RecordIndex::save() {
+    if (!loaded()) return false;
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    // Copied out under the gate and serialized after it is released, so writers wait only
+    // for the copy
+    std::vector<std::pair<models::Id128, TxEntry>> transactions;
+    {
+        std::unique_lock<std::shared_mutex> gate(updateGate);
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+        ChangeLogPosition pos = ChangeLog::position();
+        header.changelog_seq = ChangeLog::enabled() ? pos.seq : 0;
+        header.changelog_offset = ChangeLog::enabled() ? pos.offset : 0;
+        header.created_ms = nowMs();
+        header.dir_mtime_ns = dirMtime(kTransactionsDir);
+        transactions.assign(index.transactions.begin(), index.transactions.end());
+    }
+    header.count = transactions.size();
+    std::string payload;
+    for (const auto& tx : transactions) {
+        putString(payload, tx.first.toString());
+        putString(payload, tx.second.wallet_id.toString());
+        payload.append(reinterpret_cast<const char*>(&tx.second.timestamp), sizeof(int64_t));
+    }
+    header.payload_bytes = payload.size();
+    header.crc = static_cast<uint32_t>(
+        crc32(0L, reinterpret_cast<const Bytef*>(payload.data()), static_cast<uInt>(payload.size())));
+
+    std::string path = FileManager::resolve(kSnapshotPath);
+    std::string tmpPath = path + "." + std::to_string(::getpid()) + ".tmp";
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header));
+    for (size_t done = 0; ok && done < payload.size();) {
+        ssize_t n = ::write(fd, payload.data() + done, payload.size() - done);
+        if (n <= 0) ok = false;
+        else done += static_cast<size_t>(n);
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+    if (ok) fs::rename(tmpPath, path, ec);
+    if (!ok || ec) {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(statusMutex);
+    currentStatus.snapshot_ms = header.created_ms;
+    return true;
+}
+
+void RecordIndex::startPeriodicSnapshots(std::chrono::seconds interval) {
+    saver().start(interval);
+}
+
+void RecordIndex::stopPeriodicSnapshots() {
+    saver().stop();
+}
+
+bool RecordIndex::loaded() {
+    return isLoaded.load(std::memory_order_acquire);
+}
+
+RecordIndexStatus RecordIndex::status() {
+    RecordIndexStatus st;
+    {
+        std::lock_guard<std::mutex> lock(statusMutex);
+        st = currentStatus;
+    }
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    st.transactions = index.transactions.size();
+    return st;
+}
+
+std::vector<RecordIndex::TransactionPosition> RecordIndex::transactionsBefore(
+    int64_t before, const std::optional<TransactionPosition>& from, size_t limit) {
+    std::vector<TransactionPosition> out;
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    auto it = index.txOrder.begin();
+    if (from) {
+        // An id no longer known resumes after every transaction of its timestamp
+        auto id = models::Id128::find(from->id);
+        it = id ? index.txOrder.upper_bound({from->timestamp, *id})
+                : index.txOrder.upper_bound({from->timestamp, models::Id128(~0ULL, ~0ULL)});
+    }
+    for (; it != index.txOrder.end() && it->first < before && out.size() < limit; ++it) {
+        out.push_back(TransactionPosition{it->first, it->second.toString()});
+    }
+    return out;
+}
+
+RecordIndex::UpdateScope::UpdateScope() {
+    updateGate.lock_shared();
+}
+
+RecordIndex::UpdateScope::~UpdateScope() {
+    updateGate.unlock_shared();
+}
+
+template <typename Json>
+void RecordIndex::onPut(const std::string& path, const Json& doc) {
+    if (!loaded()) return;
+    std::string id;
+    if (!classify(path, id)) return;
+    std::unique_lock<std::shared_mutex> lock(indexMutex);
+    applyPut(index, id, doc);
+}
+
+template void RecordIndex::onPut(const std::string&, const nlohmann::json&);
+template void RecordIndex::onPut(const std::string&, const ArenaJson&);
+
+void RecordIndex::onDelete(const std::string& path) {
+    if (!loaded()) return;
+    std::string id;
+    if (!classify(path, id)) return;
+    std::unique_lock<std::shared_mutex> lock(indexMutex);
+    index.erase(id);
+}
+
+} // namespace storage
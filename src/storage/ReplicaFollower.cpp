@@ -0,0 +1,214 @@
+#include "storage/ReplicaFollower.h"
+#include "storage/FileManager.h"
+
+#include <nlohmann/json.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace storage {
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kStatusPath = "data/replication/follower.json";
+// Replica status is re-read at most this often by the read router; the lag itself is always
+// computed against the current clock, so caching never understates staleness
+constexpr int64_t kStatusCacheMs = 50;
+// Polls that apply nothing rewrite the status only this often, to keep caught_up_at fresh
+constexpr int64_t kStatusHeartbeatMs = 100;
+// Where ChangeLog rotates a full log
+constexpr const char* kRotatedSuffix = ".1";
+
+struct LogHead {
+    uint64_t seq;
+    int64_t ts;
+};
+
+// First entry of a log, which identifies the file across rotations; nullopt if it has none
+std::optional<LogHead> headOf(const std::string& logPath) {
+    std::ifstream in(logPath, std::ios::binary);
+    std::string line;
+    if (!in || !std::getline(in, line) || in.eof()) return std::nullopt;
+    try {
+        auto entry = nlohmann::json::parse(line);
+        return LogHead{entry.at("seq").get<uint64_t>(), entry.at("ts").get<int64_t>()};
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct ReplicaConfig {
+    std::mutex mutex;
+    std::string root;
+    int64_t maxStalenessMs = 0;
+    std::optional<ReplicaStatus> cached;
+    int64_t cachedAt = 0;
+};
+
+ReplicaConfig& config() {
+    static ReplicaConfig c;
+    return c;
+}
+
+} // namespace
+
+ReplicaFollower::ReplicaFollower(const std::string& leaderLogPath, const std::string& replicaRoot)
+    : leaderLogPath_(leaderLogPath), replicaRoot_(replicaRoot) {
+    if (auto saved = readStatus(replicaRoot_)) status_ = *saved;
+}
+
+size_t ReplicaFollower::pollOnce() {
+    // Everything the leader finished writing before this instant is already in its log
+    int64_t pollStart = nowMs();
+    std::error_code ec;
+    if (!fs::exists(leaderLogPath_, ec)) return 0;
+    ReplicaStatus before = status_;
+    size_t applied = 0;
+
+    auto head = headOf(leaderLogPath_);
+    if (head && status_.file_seq != 0 && (head->seq != status_.file_seq || head->ts != status_.file_ts)) {
+        // The log was rotated or replaced. The rest of a rotated log is applied first; a log
+        // that starts over from a lower sequence number is replayed from its start.
+        auto rotated = headOf(leaderLogPath_ + kRotatedSuffix);
+        if (rotated && rotated->seq == status_.file_seq && rotated->ts == status_.file_ts) {
+            applied += applyFrom(leaderLogPath_ + kRotatedSuffix);
+        }
+        status_.offset = 0;
+        if (head->seq <= status_.applied_seq) status_.applied_seq = head->seq - 1;
+    }
+    if (head) {
+        status_.file_seq = head->seq;
+        status_.file_ts = head->ts;
+    }
+    applied += applyFrom(leaderLogPath_);
+
+    // An idle poll only refreshes caught_up_at on disk every kStatusHeartbeatMs
+    bool moved = applied > 0 || status_.offset != before.offset || status_.file_seq != before.file_seq;
+    if (!moved && pollStart - status_.caught_up_at < kStatusHeartbeatMs) return 0;
+    status_.caught_up_at = pollStart;
+
+    nlohmann::json j;
+    j["offset"] = status_.offset;
+    j["applied_seq"] = status_.applied_seq;
+    j["last_entry_ts"] = status_.last_entry_ts;
+    j["caught_up_at"] = status_.caught_up_at;
+    j["file_seq"] = status_.file_seq;
+    j["file_ts"] = status_.file_ts;
+    ScopedDataRoot root(replicaRoot_);
+    FileManager::writeJson(kStatusPath, j);
+    return applied;
+}
+
+size_t ReplicaFollower::applyFrom(const std::string& logPath) {
+    std::ifstream in(logPath, std::ios::binary);
+    if (!in) return 0;
+    in.seekg(0, std::ios::end);
+    std::streamoff size = in.tellg();
+    if (size < static_cast<std::streamoff>(status_.offset)) {
+        // Log was truncated in place; start over (entries are re-applied idempotently by sequence)
+        status_.offset = 0;
+    }
+    std::string buffer(static_cast<size_t>(size - static_cast<std::streamoff>(status_.offset)), '\0');
+    in.seekg(static_cast<std::streamoff>(status_.offset));
+    in.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+    buffer.resize(static_cast<size_t>(in.gcount()));
+
+    ScopedDataRoot root(replicaRoot_);
+    size_t applied = 0;
+    size_t pos = 0;
+    for (size_t nl; (nl = buffer.find('\n', pos)) != std::string::npos; pos = nl + 1) {
+        try {
+            nlohmann::json entry = nlohmann::json::parse(buffer.begin() + pos, buffer.begin() + nl);
+            uint64_t seq = entry.at("seq").get<uint64_t>();
+            if (seq > status_.applied_seq) {
+                const std::string path = entry.at("path").get<std::string>();
+                if (entry.at("op").get<std::string>() == "del") {
+                    FileManager::removeFile(path);
+                } else {
+                    FileManager::writeJson(path, entry.at("doc"));
+                }
+                status_.applied_seq = seq;
+                status_.last_entry_ts = entry.at("ts").get<int64_t>();
+                ++applied;
+            }
+        } catch (...) {
+            // Skip a corrupt line rather than stalling replication forever
+        }
+    }
+    status_.offset += pos;
+    return applied;
+}
+
+void ReplicaFollower::run(const std::atomic<bool>& stop, std::chrono::milliseconds interval) {
+    while (!stop.load()) {
+        // Keep draining while there is a backlog, only sleep once caught up
+        if (pollOnce() == 0) std::this_thread::sleep_for(interval);
+    }
+}
+
+std::optional<ReplicaStatus> ReplicaFollower::readStatus(const std::string& replicaRoot) {
+    ScopedDataRoot root(replicaRoot);
+    nlohmann::json j;
+    if (!FileManager::readJson(kStatusPath, j)) return std::nullopt;
+    try {
+        ReplicaStatus s;
+        s.offset = j.at("offset").get<uint64_t>();
+        s.applied_seq = j.at("applied_seq").get<uint64_t>();
+        s.last_entry_ts = j.at("last_entry_ts").get<int64_t>();
+        s.caught_up_at = j.at("caught_up_at").get<int64_t>();
+        s.file_seq = j.value("file_seq", uint64_t(0));
+        s.file_ts = j.value("file_ts", int64_t(0));
+        return s;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+void ReadReplica::configure(const std::string& replicaRoot, int64_t maxStalenessMs) {
+    auto& c = config();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    c.root = replicaRoot;
+    c.maxStalenessMs = maxStalenessMs;
+    c.cached.reset();
+    c.cachedAt = 0;
+}
+
+void ReadReplica::disable() {
+    configure("", 0);
+}
+
+std::optional<int64_t> ReadReplica::lagMs() {
+    auto& c = config();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    if (c.root.empty()) return std::nullopt;
+    int64_t now = nowMs();
+    if (!c.cached || now - c.cachedAt >= kStatusCacheMs) {
+        c.cached = ReplicaFollower::readStatus(c.root);
+        c.cachedAt = now;
+    }
+    if (!c.cached) return std::nullopt;
+    return std::max<int64_t>(0, now - c.cached->caught_up_at);
+}
+
+std::optional<int64_t> ReadReplica::usableLagMs() {
+    auto lag = lagMs();
+    if (!lag) return std::nullopt;
+    std::lock_guard<std::mutex> lock(config().mutex);
+    if (*lag > config().maxStalenessMs) return std::nullopt;
+    return lag;
+}
+
+std::string ReadReplica::root() {
+    std::lock_guard<std::mutex> lock(config().mutex);
+    return config().root;
+}
+
+} // namespace storage
@@ -0,0 +1,119 @@
+#include "storage/RequestArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace storage {
+
+namespace {
+
+std::atomic<uint64_t> requestCount{0};
+std::atomic<uint64_t> arenaBytes{0};
+std::atomic<uint64_t> heapFallbacks{0};
+std::atomic<uint64_t> peakBytes{0};
+
+// Bump allocator over a retained first chunk plus chunks added as a request grows.
+// Deallocation only checks ownership: the arena's own blocks are reclaimed by release().
+class Arena : public std::pmr::memory_resource {
+public:
+    void open() { ++depth_; }
+    // True when the outermost scope closed
+    bool close() { return --depth_ == 0; }
+    bool active() const { return depth_ > 0; }
+
+    // Frees every block; the first chunk is kept for the next request
+    void release() {
+        while (chunks_.size() > 1) chunks_.pop_back();
+        if (!chunks_.empty()) used_ = 0;
+        requestCount.fetch_add(1, std::memory_order_relaxed);
+        arenaBytes.fetch_add(requestBytes_, std::memory_order_relaxed);
+        uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (requestBytes_ > peak &&
+               !peakBytes.compare_exchange_weak(peak, requestBytes_, std::memory_order_relaxed)) {}
+        reserved_ = chunks_.empty() ? 0 : chunks_.front().size;
+        requestBytes_ = 0;
+    }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t align) override {
+        if (!chunks_.empty()) {
+            if (void* p = bump(chunks_.back(), bytes, align)) return p;
+        }
+        if (reserved_ + bytes + align > RequestArena::kMaxBytes) {
+            heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        // Each new chunk doubles the arena, so a request adds O(log n) chunks
+        size_t size = std::max({RequestArena::kInitialBytes, reserved_, bytes + align});
+        chunks_.push_back(Chunk{std::unique_ptr<char[]>(new char[size]), size});
+        reserved_ += size;
+        used_ = 0;
+        return bump(chunks_.back(), bytes, align);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        if (!owns(p)) std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    void* bump(Chunk& chunk, size_t bytes, size_t align) {
+        size_t start = (reinterpret_cast<uintptr_t>(chunk.data.get()) + used_ + align - 1) & ~(uintptr_t(align) - 1);
+        start -= reinterpret_cast<uintptr_t>(chunk.data.get());
+        if (start + bytes > chunk.size) return nullptr;
+        used_ = start + bytes;
+        requestBytes_ += bytes;
+        return chunk.data.get() + start;
+    }
+
+    bool owns(const void* p) const {
+        auto c = static_cast<const char*>(p);
+        for (const auto& chunk : chunks_) {
+            if (c >= chunk.data.get() && c < chunk.data.get() + chunk.size) return true;
+        }
+        return false;
+    }
+
+    int depth_ = 0;
+    std::vector<Chunk> chunks_;
+    // Bytes used in the last chunk, and the total size of all chunks
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+    uint64_t requestBytes_ = 0;
+};
+
+thread_local Arena arena;
+
+} // namespace
+
+RequestArena::RequestArena() {
+    arena.open();
+}
+
+RequestArena::~RequestArena() {
+    if (arena.close()) arena.release();
+}
+
+std::pmr::memory_resource* RequestArena::resource() {
+    if (arena.active()) return &arena;
+    return std::pmr::new_delete_resource();
+}
+
+RequestArenaStats RequestArena::stats() {
+    RequestArenaStats s;
+    s.requests = requestCount.load(std::memory_order_relaxed);
+    s.arena_bytes = arenaBytes.load(std::memory_order_relaxed);
+    s.heap_fallbacks = heapFallbacks.load(std::memory_order_relaxed);
+    s.peak_bytes = peakBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace storage
@@ -0,0 +1,94 @@
+#include "storage/ResourceUsage.h"
+
+#include <atomic>
+
+namespace storage {
+
+namespace {
+
+std::atomic<bool> countAllocations{false};
+// Plain pointer: read from operator new, which may run before or after thread_local objects
+// with constructors exist
+thread_local ResourceUsage* current = nullptr;
+
+} // namespace
+
+UsageScope::UsageScope() {
+    if (current) return;
+    owner_ = true;
+    current = &usage_;
+}
+
+UsageScope::UsageScope(UsageShare& share) {
+    // A task run inline on a thread that already has a scope is charged there directly
+    if (current) return;
+    owner_ = true;
+    share_ = &share;
+    current = &usage_;
+}
+
+UsageScope::~UsageScope() {
+    if (!owner_) return;
+    current = nullptr;
+    if (share_) {
+        std::lock_guard<std::mutex> lock(share_->mutex_);
+        share_->collected_ += usage_;
+    }
+}
+
+const ResourceUsage& UsageScope::totals() const {
+    return current ? *current : usage_;
+}
+
+void UsageScope::fileOpened() {
+    if (current) ++current->files_opened;
+}
+
+void UsageScope::bytesRead(uint64_t bytes) {
+    if (current) current->bytes_read += bytes;
+}
+
+void UsageScope::bytesWritten(uint64_t bytes) {
+    if (current) current->bytes_written += bytes;
+}
+
+void UsageScope::renamed() {
+    if (current) ++current->renames;
+}
+
+void UsageScope::dirScanned(uint64_t entries) {
+    if (!current) return;
+    ++current->dir_scans;
+    current->dir_entries += entries;
+}
+
+void UsageScope::allocated(uint64_t bytes) {
+    if (!countAllocations.load(std::memory_order_relaxed)) return;
+    if (auto* usage = current) {
+        ++usage->allocations;
+        usage->allocated_bytes += bytes;
+    }
+}
+
+void UsageScope::setAllocationCounting(bool on) {
+    countAllocations.store(on, std::memory_order_relaxed);
+}
+
+bool UsageScope::allocationCounting() {
+    return countAllocations.load(std::memory_order_relaxed);
+}
+
+UsageShare::UsageShare() : request_(current) {}
+
+UsageShare::~UsageShare() {
+    join();
+}
+
+void UsageShare::join() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!request_) return;
+    *request_ += collected_;
+    request_ = nullptr;
+}
+
+} // namespace storage
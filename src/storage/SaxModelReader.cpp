@@ -0,0 +1,331 @@
+#include "storage/SaxModelReader.h"
+#include "storage/FileManager.h"
+
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+namespace storage {
+
+namespace {
+
+using json = nlohmann::json;
+
+// A scalar SAX event; strings are moved out of the parser's buffer rather than copied
+struct Scalar {
+    enum Kind { Null, Bool, Integer, Float, String } kind;
+    bool b = false;
+    double d = 0;
+    std::string* s = nullptr;
+};
+
+bool toDouble(const Scalar& v, double& out) {
+    if (v.kind != Scalar::Integer && v.kind != Scalar::Float) return false;
+    out = v.d;
+    return true;
+}
+
+bool toString(Scalar& v, std::string& out) {
+    if (v.kind != Scalar::String) return false;
+    out = std::move(*v.s);
+    return true;
+}
+
+bool toBool(const Scalar& v, bool& out) {
+    if (v.kind != Scalar::Bool) return false;
+    out = v.b;
+    return true;
+}
+
+// Per-model field tables: assign() stores one top-level scalar and marks it in `seen`,
+// arrayField() returns the id list a top-level array fills, if any, stringArrayField() the
+// string list, and numberArrayField() tells whether a top-level array of numbers is
+// collected and handed to assignNumbers() once closed. markArray() marks a top-level array
+// field in `seen` when it opens.
+
+constexpr unsigned kUserRequired = 0xF;
+
+bool assign(models::UserAccount& u, const std::string& key, Scalar& v, unsigned& seen) {
+    if (key == "username") { seen |= 1; return toString(v, u.username); }
+    if (key == "password_hash") { seen |= 2; return toString(v, u.password_hash); }
+    if (key == "email") { seen |= 4; return toString(v, u.email); }
+    if (key == "is_admin") { seen |= 8; return toBool(v, u.is_admin); }
+    if (key == "wallet_id") return toString(v, u.wallet_id);
+    return true;
+}
+
+std::vector<models::Id128>* arrayField(models::UserAccount&, const std::string&) {
+    return nullptr;
+}
+
+std::vector<std::string>* stringArrayField(models::UserAccount&, const std::string&) {
+    return nullptr;
+}
+
+bool numberArrayField(models::UserAccount&, const std::string&) { return false; }
+
+bool assignNumbers(models::UserAccount&, const std::string&, const std::vector<double>&) { return false; }
+
+void markArray(models::UserAccount&, const std::string&, unsigned&) {}
+
+constexpr unsigned kWalletRequired = 0xF;
+constexpr unsigned kWalletAssetCodes = 0x10;
+constexpr unsigned kWalletAssetBalances = 0x20;
+
+bool assign(models::Wallet& w, const std::string& key, Scalar& v, unsigned& seen) {
+    if (key == "wallet_id") { seen |= 1; return toString(v, w.wallet_id); }
+    if (key == "owner_username") { seen |= 2; return toString(v, w.owner_username); }
+    if (key == "balance") { seen |= 4; return toDouble(v, w.balance); }
+    // transaction_ids, lots and the asset columns must be arrays
+    if (key == "transaction_ids" || key == "lots" || key == "asset_codes" || key == "asset_balances") return false;
+    return true;
+}
+
+std::vector<models::Id128>* arrayField(models::Wallet& w, const std::string& key) {
+    return key == "transaction_ids" ? &w.transaction_ids : nullptr;
+}
+
+std::vector<std::string>* stringArrayField(models::Wallet& w, const std::string& key) {
+    return key == "asset_codes" ? &w.asset_codes : nullptr;
+}
+
+bool numberArrayField(models::Wallet&, const std::string& key) { return key == "lots" || key == "asset_balances"; }
+
+bool assignNumbers(models::Wallet& w, const std::string& key, const std::vector<double>& values) {
+    if (key == "asset_balances") {
+        w.asset_balances = values;
+        return true;
+    }
+    if (key != "lots" || values.size() % 3 != 0) return false;
+    w.lots.clear();
+    w.lots.reserve(values.size() / 3);
+    for (size_t i = 0; i < values.size(); i += 3) {
+        w.lots.push_back(models::PointLot{values[i], static_cast<int64_t>(values[i + 1]),
+                                          static_cast<int64_t>(values[i + 2])});
+    }
+    return true;
+}
+
+void markArray(models::Wallet&, const std::string& key, unsigned& seen) {
+    if (key == "asset_codes") seen |= kWalletAssetCodes;
+    if (key == "asset_balances") seen |= kWalletAssetBalances;
+}
+
+constexpr unsigned kTransactionRequired = 0x3F;
+
+bool assign(models::Transaction& t, const std::string& key, Scalar& v, unsigned& seen) {
+    if (key == "transaction_id") { seen |= 1; return toString(v, t.transaction_id); }
+    if (key == "wallet_id") { seen |= 2; return toString(v, t.wallet_id); }
+    if (key == "amount") { seen |= 4; return toDouble(v, t.amount); }
+    if (key == "timestamp") { seen |= 8; return toString(v, t.timestamp); }
+    if (key == "type") { seen |= 16; return toString(v, t.type); }
+    if (key == "description") { seen |= 32; return toString(v, t.description); }
+    if (key == "idempotency_key") return toString(v, t.idempotency_key);
+    if (key == "asset") return toString(v, t.asset);
+    return true;
+}
+
+std::vector<models::Id128>* arrayField(models::Transaction&, const std::string&) {
+    return nullptr;
+}
+
+std::vector<std::string>* stringArrayField(models::Transaction&, const std::string&) {
+    return nullptr;
+}
+
+bool numberArrayField(models::Transaction&, const std::string&) { return false; }
+
+bool assignNumbers(models::Transaction&, const std::string&, const std::vector<double>&) { return false; }
+
+void markArray(models::Transaction&, const std::string&, unsigned&) {}
+
+template <typename Model>
+class ModelSaxHandler {
+public:
+    ModelSaxHandler(Model& model, unsigned& seen) : model_(model), seen_(seen) {}
+
+    bool null() { Scalar v{Scalar::Null}; return scalar(v); }
+    bool boolean(bool b) { Scalar v{Scalar::Bool}; v.b = b; return scalar(v); }
+    bool number_integer(json::number_integer_t n) {
+        Scalar v{Scalar::Integer}; v.d = static_cast<double>(n); return scalar(v);
+    }
+    bool number_unsigned(json::number_unsigned_t n) {
+        Scalar v{Scalar::Integer}; v.d = static_cast<double>(n); return scalar(v);
+    }
+    bool number_float(json::number_float_t d, const json::string_t&) {
+        Scalar v{Scalar::Float}; v.d = d; return scalar(v);
+    }
+    bool string(json::string_t& s) { Scalar v{Scalar::String}; v.s = &s; return scalar(v); }
+    bool binary(json::binary_t&) { return depth_ > 1; }
+
+    bool start_object(std::size_t) {
+        if (depth_ == 0) {
+            depth_ = 1;
+            return true;
+        }
+        // Nested objects are never part of these models
+        if (depth_ == 1 && !unknownKey()) return false;
+        if (inArray() && depth_ == 2) return false;
+        ++depth_;
+        return true;
+    }
+
+    bool end_object() {
+        --depth_;
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        if (depth_ == 0) return false;
+        if (depth_ == 1) {
+            list_ = arrayField(model_, key_);
+            strings_ = list_ ? nullptr : stringArrayField(model_, key_);
+            if (list_) {
+                list_->clear();
+            } else if (strings_) {
+                strings_->clear();
+            } else if (numberArrayField(model_, key_)) {
+                numbers_ = true;
+                numberValues_.clear();
+            } else if (!unknownKey()) {
+                return false;
+            }
+            markArray(model_, key_, seen_);
+        } else if (inArray() && depth_ == 2) {
+            return false;
+        }
+        ++depth_;
+        return true;
+    }
+
+    bool end_array() {
+        if (--depth_ == 1 && list_) {
+            list_ = nullptr;
+            listSeen_ = true;
+        } else if (depth_ == 1 && strings_) {
+            strings_ = nullptr;
+        } else if (depth_ == 1 && numbers_) {
+            numbers_ = false;
+            return assignNumbers(model_, key_, numberValues_);
+        }
+        return true;
+    }
+
+    bool key(json::string_t& k) {
+        if (depth_ == 1) key_.swap(k);
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+        return false;
+    }
+
+    bool listSeen() const { return listSeen_; }
+
+private:
+    // Fields outside the model may hold any value; known scalar fields reject a null probe
+    bool inArray() const { return list_ || strings_ || numbers_; }
+
+    bool unknownKey() {
+        if (arrayField(model_, key_) || stringArrayField(model_, key_) || numberArrayField(model_, key_)) {
+            return false;
+        }
+        Scalar probe{Scalar::Null};
+        unsigned ignored = 0;
+        return assign(model_, key_, probe, ignored);
+    }
+
+    bool scalar(Scalar& v) {
+        if (depth_ == 0) return false;
+        if (depth_ == 1) return assign(model_, key_, v, seen_);
+        if (list_ && depth_ == 2) {
+            if (v.kind != Scalar::String) return false;
+            list_->push_back(models::Id128::parse(*v.s));
+        } else if (strings_ && depth_ == 2) {
+            if (v.kind != Scalar::String) return false;
+            strings_->push_back(std::move(*v.s));
+        } else if (numbers_ && depth_ == 2) {
+            double d;
+            if (!toDouble(v, d)) return false;
+            numberValues_.push_back(d);
+        }
+        return true;
+    }
+
+    Model& model_;
+    unsigned& seen_;
+    int depth_ = 0;
+    std::string key_;
+    std::vector<models::Id128>* list_ = nullptr;
+    std::vector<std::string>* strings_ = nullptr;
+    bool listSeen_ = false;
+    bool numbers_ = false;
+    std::vector<double> numberValues_;
+};
+
+} // namespace
+
+bool SaxModelReader::parse(std::string_view text, models::UserAccount& user) {
+    unsigned seen = 0;
+    user.wallet_id.clear();
+    ModelSaxHandler<models::UserAccount> handler(user, seen);
+    if (!json::sax_parse(text.begin(), text.end(), &handler)) return false;
+    return (seen & kUserRequired) == kUserRequired;
+}
+
+bool SaxModelReader::parse(std::string_view text, models::Wallet& wallet) {
+    unsigned seen = 0;
+    wallet.lots.clear();
+    wallet.asset_codes.clear();
+    wallet.asset_balances.clear();
+    ModelSaxHandler<models::Wallet> handler(wallet, seen);
+    if (!json::sax_parse(text.begin(), text.end(), &handler)) return false;
+    // The asset columns come as a pair, like from_json requires
+    if (!(seen & kWalletAssetCodes) != !(seen & kWalletAssetBalances)) return false;
+    if (wallet.asset_codes.size() != wallet.asset_balances.size()) return false;
+    if (handler.listSeen()) seen |= 8;
+    return (seen & kWalletRequired) == kWalletRequired;
+}
+
+bool SaxModelReader::parse(std::string_view text, models::Transaction& tx) {
+    unsigned seen = 0;
+    tx.idempotency_key.clear();
+    tx.asset = models::kDefaultAsset;
+    ModelSaxHandler<models::Transaction> handler(tx, seen);
+    if (!json::sax_parse(text.begin(), text.end(), &handler)) return false;
+    return (seen & kTransactionRequired) == kTransactionRequired;
+}
+
+template <typename Model>
+bool SaxModelReader::read(const std::string& path, Model& model) {
+    std::string buffer;
+    if (!FileManager::readFile(path, buffer)) return false;
+    return parse(buffer, model);
+}
+
+template <typename Model>
+void SaxModelReader::readMany(const std::vector<std::string>& paths, std::vector<std::optional<Model>>& out) {
+    out.assign(paths.size(), std::nullopt);
+    std::vector<std::string> batch;
+    std::vector<std::optional<std::string>> texts;
+    // Bounded so a long list never holds every file's text at once
+    for (size_t begin = 0; begin < paths.size(); begin += kReadBatch) {
+        size_t end = std::min(paths.size(), begin + kReadBatch);
+        batch.assign(paths.begin() + begin, paths.begin() + end);
+        FileManager::readFiles(batch, texts);
+        for (size_t i = 0; i < texts.size(); ++i) {
+            if (!texts[i]) continue;
+            Model model;
+            if (parse(*texts[i], model)) out[begin + i] = std::move(model);
+        }
+    }
+}
+
+template bool SaxModelReader::read(const std::string&, models::UserAccount&);
+template bool SaxModelReader::read(const std::string&, models::Wallet&);
+template bool SaxModelReader::read(const std::string&, models::Transaction&);
+template void SaxModelReader::readMany(const std::vector<std::string>&, std::vector<std::optional<models::UserAccount>>&);
+template void SaxModelReader::readMany(const std::vector<std::string>&, std::vector<std::optional<models::Wallet>>&);
+template void SaxModelReader::readMany(const std::vector<std::string>&,
+                                       std::vector<std::optional<models::Transaction>>&);
+
+} // namespace storage
@@ -0,0 +1,319 @@
+#include "storage/Snapshot.h"
+#include "storage/ResourceUsage.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+
+namespace {
+
+constexpr std::chrono::milliseconds kCollectInterval(200);
+// Past this many pinned files, replaced contents are read into memory at once instead
+constexpr size_t kMaxPinnedFiles = 256;
+
+std::atomic<size_t> pinnedFiles{0};
+
+// A replaced record file held open until a snapshot reads it; the descriptor keeps the old
+// contents alive after the rename that replaced them
+class PinnedFile {
+public:
+    explicit PinnedFile(int fd) : fd_(fd) { pinnedFiles.fetch_add(1, std::memory_order_relaxed); }
+    ~PinnedFile() {
+        ::close(fd_);
+        pinnedFiles.fetch_sub(1, std::memory_order_relaxed);
+    }
+    PinnedFile(const PinnedFile&) = delete;
+    PinnedFile& operator=(const PinnedFile&) = delete;
+
+    VersionStore::Bytes contents() {
+        std::call_once(read_, [this] { bytes_ = readAll(fd_); });
+        return bytes_;
+    }
+
+    static VersionStore::Bytes readAll(int fd) {
+        auto bytes = std::make_shared<std::string>();
+        struct stat st;
+        if (::fstat(fd, &st) != 0) return bytes;
+        bytes->resize(static_cast<size_t>(st.st_size));
+        size_t done = 0;
+        while (done < bytes->size()) {
+            ssize_t n = ::pread(fd, &(*bytes)[done], bytes->size() - done, static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += static_cast<size_t>(n);
+        }
+        bytes->resize(done);
+        UsageScope::bytesRead(done);
+        return bytes;
+    }
+
+private:
+    int fd_;
+    std::once_flag read_;
+    VersionStore::Bytes bytes_;
+};
+
+struct Version {
+    uint64_t seq;
+    // Null when the record did not exist as of seq, or when the version is still in file
+    VersionStore::Bytes bytes;
+    std::shared_ptr<PinnedFile> file;
+};
+
+bool exists(const Version& v) {
+    return v.bytes || v.file;
+}
+
+struct State {
+    std::mutex mutex;
+    uint64_t commitSeq = 0;
+    std::multiset<uint64_t> active;
+    // Oldest first; the first version has seq 0 and holds the contents before the first
+    // versioned write, so every snapshot finds a version at or below its sequence
+    std::unordered_map<std::string, std::vector<Version>> chains;
+    // Versioned writes in flight, whose chains the collector leaves alone, and the old file
+    // each one pinned for a record that had no chain yet
+    std::unordered_map<std::string, size_t> writing;
+    std::unordered_map<std::string, Version> replaced;
+};
+
+State& state() {
+    static State s;
+    return s;
+}
+
+// The version a write to path is about to replace, null bytes if there is no such file
+Version pin(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return Version{0, nullptr, nullptr};
+    UsageScope::fileOpened();
+    if (pinnedFiles.load(std::memory_order_relaxed) < kMaxPinnedFiles) {
+        return Version{0, nullptr, std::make_shared<PinnedFile>(fd)};
+    }
+    auto bytes = PinnedFile::readAll(fd);
+    ::close(fd);
+    return Version{0, std::move(bytes), nullptr};
+}
+
+thread_local const Snapshot* currentSnapshot = nullptr;
+
+// Newest version visible at seq; chains always start at seq 0
+const Version& visibleAt(const std::vector<Version>& chain, uint64_t seq) {
+    size_t i = chain.size();
+    while (i > 1 && chain[i - 1].seq > seq) --i;
+    return chain[i - 1];
+}
+
+class Collector {
+public:
+    Collector() : thread_([this] { run(); }) {}
+    ~Collector() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, kCollectInterval, [this] { return stop_; })) {
+            lock.unlock();
+            VersionStore::collectGarbage();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+void ensureCollector() {
+    static Collector collector;
+}
+
+} // namespace
+
+Snapshot::Snapshot() : previous_(currentSnapshot) {
+    auto& s = state();
+    ensureCollector();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    // Nested scopes read at the enclosing snapshot's point in time. A write that began before
+    // this point and commits after it made no version, so it reads as having happened before.
+    sequence_ = previous_ ? previous_->sequence_ : s.commitSeq;
+    s.active.insert(sequence_);
+    currentSnapshot = this;
+}
+
+Snapshot::~Snapshot() {
+    currentSnapshot = previous_;
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.active.erase(s.active.find(sequence_));
+}
+
+bool VersionStore::beginWrite(const std::string& path) {
+    auto& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.active.empty()) return false;
+        ++s.writing[path];
+        // A record with a chain already has its old versions; only the first write pins one
+        if (s.chains.count(path)) return true;
+    }
+    Version previous = pin(path);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.replaced[path] = std::move(previous);
+    return true;
+}
+
+uint64_t VersionStore::commit(const std::string& path, bool versioned, Bytes current) {
+    auto& s = state();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    uint64_t seq = ++s.commitSeq;
+    auto it = s.chains.find(path);
+    if (!versioned) {
+        // No snapshot was open when this write began, so none needs what it replaced, and
+        // the ones taken since count it as before them: all of them read the file on disk
+        if (it != s.chains.end()) {
+            auto dropped = std::move(it->second);
+            s.chains.erase(it);
+            lock.unlock();
+        }
+        return seq;
+    }
+    auto writer = s.writing.find(path);
+    if (writer != s.writing.end() && --writer->second == 0) s.writing.erase(writer);
+    if (it != s.chains.end()) {
+        it->second.push_back({seq, std::move(current), nullptr});
+        return seq;
+    }
+    auto pinned = s.replaced.find(path);
+    Version previous{0, nullptr, nullptr};
+    if (pinned != s.replaced.end()) {
+        previous = std::move(pinned->second);
+        s.replaced.erase(pinned);
+    }
+    s.chains[path] = {std::move(previous), {seq, std::move(current), nullptr}};
+    return seq;
+}
+
+void VersionStore::abortWrite(const std::string& path, bool versioned) {
+    if (!versioned) return;
+    auto& s = state();
+    Version previous{0, nullptr, nullptr};
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto writer = s.writing.find(path);
+    if (writer != s.writing.end() && --writer->second == 0) s.writing.erase(writer);
+    auto pinned = s.replaced.find(path);
+    if (pinned != s.replaced.end()) {
+        previous = std::move(pinned->second);
+        s.replaced.erase(pinned);
+    }
+}
+
+std::optional<VersionStore::Bytes> VersionStore::visible(const std::string& path) {
+    const Snapshot* snapshot = currentSnapshot;
+    if (!snapshot) return std::nullopt;
+    auto& s = state();
+    Version version;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.chains.find(path);
+        if (it != s.chains.end()) {
+            version = visibleAt(it->second, snapshot->sequence());
+        } else {
+            // A write in flight has pinned the file it is replacing, which is what any open
+            // snapshot reads once the write commits
+            auto pinned = s.replaced.find(path);
+            if (pinned == s.replaced.end()) return std::nullopt;
+            version = pinned->second;
+        }
+    }
+    // A pinned file is read outside the lock, once, by whichever snapshot asks first
+    if (version.file) return version.file->contents();
+    return version.bytes;
+}
+
+std::vector<std::string> VersionStore::deletedSince(const std::string& dir) {
+    std::vector<std::string> names;
+    const Snapshot* snapshot = currentSnapshot;
+    if (!snapshot) return names;
+    std::string prefix = dir + "/";
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    for (const auto& entry : s.chains) {
+        const auto& chain = entry.second;
+        if (entry.first.compare(0, prefix.size(), prefix) != 0) continue;
+        if (exists(chain.back()) || !exists(visibleAt(chain, snapshot->sequence()))) continue;
+        std::string name = entry.first.substr(prefix.size());
+        if (name.find('/') == std::string::npos) names.push_back(std::move(name));
+    }
+    return names;
+}
+
+const Snapshot* VersionStore::current() {
+    return currentSnapshot;
+}
+
+uint64_t VersionStore::commitSequence() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.commitSeq;
+}
+
+void VersionStore::collectGarbage() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    uint64_t watermark = s.active.empty() ? std::numeric_limits<uint64_t>::max() : *s.active.begin();
+    for (auto it = s.chains.begin(); it != s.chains.end();) {
+        auto& chain = it->second;
+        if (s.writing.count(it->first)) {
+            ++it;
+            continue;
+        }
+        if (chain.back().seq <= watermark) {
+            // Every open snapshot sees the latest version, which is the file on disk
+            it = s.chains.erase(it);
+            continue;
+        }
+        // Keep the version the oldest snapshot reads and everything newer
+        size_t keep = chain.size() - 1;
+        while (keep > 0 && chain[keep].seq > watermark) --keep;
+        if (keep > 0) {
+            chain.erase(chain.begin(), chain.begin() + static_cast<std::ptrdiff_t>(keep));
+            chain.front().seq = 0;
+        }
+        ++it;
+    }
+}
+
+VersionStats VersionStore::stats() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    VersionStats stats;
+    stats.commit_sequence = s.commitSeq;
+    stats.active_snapshots = s.active.size();
+    stats.chains = s.chains.size();
+    for (const auto& entry : s.chains) stats.versions += entry.second.size();
+    stats.pinned_files = pinnedFiles.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace storage
@@ -0,0 +1,545 @@
+#include "storage/TransactionArchive.h"
+#include "storage/FileManager.h"
+#include "storage/SaxModelReader.h"
+#include "storage/ResourceUsage.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <zlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace storage {
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kArchiveDir = "data/archive";
+constexpr char kHeaderMagic[8] = {'R', 'W', 'S', 'E', 'G', '0', '0', '1'};
+constexpr char kTrailerMagic[8] = {'R', 'W', 'S', 'E', 'G', 'E', 'N', 'D'};
+constexpr uint32_t kFormatVersion = 1;
+// Uncompressed bytes per block: large enough to compress well, small enough to inflate fast
+constexpr size_t kBlockBytes = 64 * 1024;
+constexpr size_t kBlockCacheEntries = 64;
+
+// Fixed-size tail of every segment, in host byte order
+struct Trailer {
+    uint64_t footer_offset;
+    uint64_t footer_size;
+    uint32_t footer_crc;
+    uint32_t version;
+    char magic[8];
+};
+
+struct BlockInfo {
+    uint64_t offset;
+    uint32_t compressed;
+    uint32_t raw;
+    uint32_t crc;
+};
+
+struct Segment {
+    std::string path;
+    int fd = -1;
+    uint64_t bytes = 0;
+    std::vector<BlockInfo> blocks;
+
+    ~Segment() {
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+struct Location {
+    uint32_t segment;
+    uint32_t block;
+};
+
+struct Archive {
+    std::vector<std::unique_ptr<Segment>> segments;
+    // Keyed by binary id: the index holds every archived transaction, so entry size dominates.
+    // Ids in an older form stay strings rather than grow the process-wide intern table.
+    std::unordered_map<models::Id128, Location> ids;
+    std::unordered_map<std::string, Location> legacyIds;
+    // Segment files already opened, and the directory mtime when they were last listed
+    std::unordered_set<std::string> paths;
+    int64_t dirMtimeNs = -1;
+};
+
+std::shared_mutex registryMutex;
+// Keyed by resolved archive directory, so a redirected data root has its own archive
+std::unordered_map<std::string, std::unique_ptr<Archive>> archives;
+
+std::atomic<uint64_t> coldReads{0};
+std::atomic<uint64_t> coldReadUsTotal{0};
+std::atomic<uint64_t> coldReadUsMax{0};
+std::atomic<uint64_t> cacheHits{0};
+std::atomic<uint64_t> cacheMisses{0};
+std::atomic<uint64_t> segmentCounter{0};
+
+template <typename T>
+void put(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void putString(std::string& out, std::string_view s) {
+    put(out, static_cast<uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+class Cursor {
+public:
+    explicit Cursor(std::string_view data) : data_(data) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (data_.size() < sizeof(T)) return false;
+        std::memcpy(&value, data_.data(), sizeof(T));
+        data_.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool getString(std::string_view& s) {
+        uint32_t size;
+        if (!get(size) || data_.size() < size) return false;
+        s = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return true;
+    }
+
+    bool empty() const { return data_.empty(); }
+
+private:
+    std::string_view data_;
+};
+
+uint32_t crcOf(const char* data, size_t size) {
+    return static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size)));
+}
+
+bool preadAll(int fd, char* out, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Block of each record in a segment, by id
+struct SegmentIds {
+    std::vector<std::pair<models::Id128, uint32_t>> canonical;
+    std::vector<std::pair<std::string, uint32_t>> legacy;
+};
+
+// Opens a segment and reads its block index into ids
+std::unique_ptr<Segment> openSegment(const std::string& path, SegmentIds& ids) {
+    auto seg = std::make_unique<Segment>();
+    seg->path = path;
+    seg->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (seg->fd < 0) return nullptr;
+    struct stat st;
+    if (::fstat(seg->fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(kHeaderMagic) + sizeof(Trailer)) {
+        return nullptr;
+    }
+    seg->bytes = static_cast<uint64_t>(st.st_size);
+    Trailer trailer;
+    if (!preadAll(seg->fd, reinterpret_cast<char*>(&trailer), sizeof(trailer), seg->bytes - sizeof(trailer)) ||
+        std::memcmp(trailer.magic, kTrailerMagic, sizeof(kTrailerMagic)) != 0 || trailer.version != kFormatVersion ||
+        trailer.footer_offset + trailer.footer_size + sizeof(trailer) != seg->bytes) {
+        return nullptr;
+    }
+    std::string footer(trailer.footer_size, '\0');
+    if (!preadAll(seg->fd, &footer[0], footer.size(), trailer.footer_offset) ||
+        crcOf(footer.data(), footer.size()) != trailer.footer_crc) {
+        return nullptr;
+    }
+
+    Cursor in(footer);
+    uint32_t blockCount;
+    if (!in.get(blockCount)) return nullptr;
+    seg->blocks.resize(blockCount);
+    for (auto& b : seg->blocks) {
+        if (!in.get(b.offset) || !in.get(b.compressed) || !in.get(b.raw) || !in.get(b.crc)) return nullptr;
+    }
+    uint64_t recordCount;
+    if (!in.get(recordCount)) return nullptr;
+    ids.canonical.reserve(ids.canonical.size() + recordCount);
+    for (uint64_t i = 0; i < recordCount; ++i) {
+        std::string_view id;
+        uint32_t block;
+        if (!in.getString(id) || !in.get(block) || block >= blockCount) return nullptr;
+        if (auto binary = models::Id128::parseCanonical(id)) {
+            ids.canonical.emplace_back(*binary, block);
+        } else {
+            ids.legacy.emplace_back(std::string(id), block);
+        }
+    }
+    return seg;
+}
+
+void addSegment(Archive& archive, std::unique_ptr<Segment> seg, const SegmentIds& ids) {
+    uint32_t index = static_cast<uint32_t>(archive.segments.size());
+    archive.paths.insert(seg->path);
+    archive.segments.push_back(std::move(seg));
+    // Later segments win: a record archived twice after an interrupted run is identical anyway
+    for (const auto& id : ids.canonical) archive.ids[id.first] = Location{index, id.second};
+    for (const auto& id : ids.legacy) archive.legacyIds[id.first] = Location{index, id.second};
+}
+
+int64_t mtimeNsOf(const std::string& dir) {
+    struct stat st;
+    if (::stat(dir.c_str(), &st) != 0) return -1;
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// Opens the segments in dir not yet registered; registryMutex must be held exclusively
+void scanLocked(Archive& archive, const std::string& dir, int64_t mtimeNs) {
+    // Recorded before listing, so a segment renamed in during the listing triggers another scan
+    archive.dirMtimeNs = mtimeNs;
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".seg") continue;
+        std::string path = it->path().string();
+        if (!archive.paths.count(path)) paths.push_back(std::move(path));
+    }
+    // Segment names start with their creation time, so this is write order
+    std::sort(paths.begin(), paths.end());
+    for (const auto& path : paths) {
+        SegmentIds ids;
+        if (auto seg = openSegment(path, ids)) addSegment(archive, std::move(seg), ids);
+    }
+}
+
+// Picks up segments written by other processes since the last listing; a stat of the
+// directory when nothing changed. Returns whether it rescanned.
+bool refresh(Archive& archive, const std::string& dir) {
+    int64_t mtimeNs = mtimeNsOf(dir);
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        if (archive.dirMtimeNs == mtimeNs) return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(registryMutex);
+    if (archive.dirMtimeNs == mtimeNs) return false;
+    scanLocked(archive, dir, mtimeNs);
+    return true;
+}
+
+// The archive of the calling thread's data root, loading its segments on first use
+Archive& archiveFor(const std::string& dir) {
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        auto it = archives.find(dir);
+        if (it != archives.end()) return *it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(registryMutex);
+    auto& slot = archives[dir];
+    if (slot) return *slot;
+    slot = std::make_unique<Archive>();
+    scanLocked(*slot, dir, mtimeNsOf(dir));
+    return *slot;
+}
+
+// Location of a transaction, rescanning the directory once on a miss
+std::optional<Location> locate(Archive& archive, const std::string& dir, const std::string& transactionId) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        {
+            std::shared_lock<std::shared_mutex> lock(registryMutex);
+            if (auto id = models::Id128::parseCanonical(transactionId)) {
+                auto it = archive.ids.find(*id);
+                if (it != archive.ids.end()) return it->second;
+            } else {
+                auto it = archive.legacyIds.find(transactionId);
+                if (it != archive.legacyIds.end()) return it->second;
+            }
+        }
+        if (attempt == 0 && !refresh(archive, dir)) break;
+    }
+    return std::nullopt;
+}
+
+class BlockCache {
+public:
+    std::shared_ptr<const std::string> get(const Segment* seg, uint32_t block) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(Key{seg, block});
+        if (it == map_.end()) return nullptr;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    void put(const Segment* seg, uint32_t block, std::shared_ptr<const std::string> data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Key key{seg, block};
+        if (map_.count(key)) return;
+        lru_.emplace_front(key, std::move(data));
+        map_[key] = lru_.begin();
+        if (lru_.size() > kBlockCacheEntries) {
+            map_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+private:
+    struct Key {
+        const Segment* seg;
+        uint32_t block;
+        bool operator==(const Key& o) const { return seg == o.seg && block == o.block; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<const void*>{}(k.seg) ^ (static_cast<size_t>(k.block) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+    using Entry = std::pair<Key, std::shared_ptr<const std::string>>;
+
+    std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> map_;
+};
+
+BlockCache& blockCache() {
+    static BlockCache cache;
+    return cache;
+}
+
+// Decompressed contents of one block, nullptr if unreadable or corrupt
+std::shared_ptr<const std::string> readBlock(const Segment& seg, uint32_t index) {
+    if (auto cached = blockCache().get(&seg, index)) {
+        cacheHits.fetch_add(1, std::memory_order_relaxed);
+        return cached;
+    }
+    cacheMisses.fetch_add(1, std::memory_order_relaxed);
+    const BlockInfo& info = seg.blocks[index];
+    std::string compressed(info.compressed, '\0');
+    if (!preadAll(seg.fd, &compressed[0], compressed.size(), info.offset)) return nullptr;
+    UsageScope::bytesRead(compressed.size());
+    auto raw = std::make_shared<std::string>(info.raw, '\0');
+    uLongf rawSize = info.raw;
+    if (uncompress(reinterpret_cast<Bytef*>(&(*raw)[0]), &rawSize,
+                   reinterpret_cast<const Bytef*>(compressed.data()), info.compressed) != Z_OK ||
+        rawSize != info.raw || crcOf(raw->data(), raw->size()) != info.crc) {
+        return nullptr;
+    }
+    blockCache().put(&seg, index, raw);
+    return raw;
+}
+
+// Calls fn(id, json) for each record of a decompressed block until it returns false
+template <typename Fn>
+void forEachRecord(const std::string& block, Fn&& fn) {
+    Cursor in(block);
+    std::string_view id, json;
+    while (!in.empty() && in.getString(id) && in.getString(json)) {
+        if (!fn(id, json)) return;
+    }
+}
+
+} // namespace
+
+std::optional<models::Transaction> TransactionArchive::load(const std::string& transactionId) {
+    auto start = std::chrono::steady_clock::now();
+    std::string dir = FileManager::resolve(kArchiveDir);
+    Archive& archive = archiveFor(dir);
+    auto location = locate(archive, dir, transactionId);
+    if (!location) return std::nullopt;
+    const Segment* seg;
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        seg = archive.segments[location->segment].get();
+    }
+    auto data = readBlock(*seg, location->block);
+    if (!data) return std::nullopt;
+    std::optional<models::Transaction> result;
+    forEachRecord(*data, [&](std::string_view id, std::string_view json) {
+        if (id != transactionId) return true;
+        models::Transaction tx;
+        if (SaxModelReader::parse(json, tx)) result = std::move(tx);
+        return false;
+    });
+
+    uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    coldReads.fetch_add(1, std::memory_order_relaxed);
+    coldReadUsTotal.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = coldReadUsMax.load(std::memory_order_relaxed);
+    while (us > max && !coldReadUsMax.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+    return result;
+}
+
+bool TransactionArchive::contains(const std::string& transactionId) {
+    std::string dir = FileManager::resolve(kArchiveDir);
+    return locate(archiveFor(dir), dir, transactionId).has_value();
+}
+
+std::optional<uint64_t> TransactionArchive::writeSegment(std::vector<models::Transaction> transactions) {
+    if (transactions.empty()) return std::nullopt;
+    // Wallet order keeps each wallet's history in as few blocks as possible
+    std::sort(transactions.begin(), transactions.end(), [](const models::Transaction& a, const models::Transaction& b) {
+        if (a.wallet_id != b.wallet_id) return a.wallet_id < b.wallet_id;
+        if (a.timestamp != b.timestamp) return a.timestamp < b.timestamp;
+        return a.transaction_id < b.transaction_id;
+    });
+
+    std::string file(kHeaderMagic, sizeof(kHeaderMagic));
+    std::vector<BlockInfo> blocks;
+    std::vector<std::pair<std::string, uint32_t>> ids;
+    ids.reserve(transactions.size());
+    std::string raw;
+    auto flush = [&]() -> bool {
+        if (raw.empty()) return true;
+        uLongf size = compressBound(static_cast<uLong>(raw.size()));
+        std::string compressed(size, '\0');
+        if (compress2(reinterpret_cast<Bytef*>(&compressed[0]), &size,
+                      reinterpret_cast<const Bytef*>(raw.data()), static_cast<uLong>(raw.size()), 6) != Z_OK) {
+            return false;
+        }
+        blocks.push_back(BlockInfo{file.size(), static_cast<uint32_t>(size), static_cast<uint32_t>(raw.size()),
+                                   crcOf(raw.data(), raw.size())});
+        file.append(compressed.data(), size);
+        raw.clear();
+        return true;
+    };
+    for (const auto& tx : transactions) {
+        putString(raw, tx.transaction_id);
+        putString(raw, nlohmann::json(tx).dump());
+        ids.emplace_back(tx.transaction_id, static_cast<uint32_t>(blocks.size()));
+        if (raw.size() >= kBlockBytes && !flush()) return std::nullopt;
+    }
+    if (!flush()) return std::nullopt;
+
+    std::string footer;
+    put(footer, static_cast<uint32_t>(blocks.size()));
+    for (const auto& b : blocks) {
+        put(footer, b.offset);
+        put(footer, b.compressed);
+        put(footer, b.raw);
+        put(footer, b.crc);
+    }
+    put(footer, static_cast<uint64_t>(ids.size()));
+    for (const auto& id : ids) {
+        putString(footer, id.first);
+        put(footer, id.second);
+    }
+    Trailer trailer{};
+    trailer.footer_offset = file.size();
+    trailer.footer_size = footer.size();
+    trailer.footer_crc = crcOf(footer.data(), footer.size());
+    trailer.version = kFormatVersion;
+    std::memcpy(trailer.magic, kTrailerMagic, sizeof(kTrailerMagic));
+    file += footer;
+    put(file, trailer);
+
+    std::string dir = FileManager::resolve(kArchiveDir);
+    // Load the existing segments first so the new one is registered exactly once
+    Archive& archive = archiveFor(dir);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    char name[96];
+    std::snprintf(name, sizeof(name), "seg-%015lld-%d-%llu.seg", static_cast<long long>(ms),
+                  static_cast<int>(::getpid()),
+                  static_cast<unsigned long long>(segmentCounter.fetch_add(1, std::memory_order_relaxed)));
+    std::string path = dir + "/" + name;
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return std::nullopt;
+    bool ok = writeAll(fd, file) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (ok) fs::rename(tmpPath, path, ec);
+    if (!ok || ec) {
+        fs::remove(tmpPath, ec);
+        return std::nullopt;
+    }
+    // Persist the rename before callers delete the hot copies
+    int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+
+    SegmentIds written;
+    auto seg = openSegment(path, written);
+    if (!seg) return std::nullopt;
+    std::unique_lock<std::shared_mutex> lock(registryMutex);
+    // A rescan on another thread may have registered it since the rename
+    if (!archive.paths.count(path)) addSegment(archive, std::move(seg), written);
+    return static_cast<uint64_t>(file.size());
+}
+
+void TransactionArchive::forEach(const std::function<void(const models::Transaction&)>& fn) {
+    std::string dir = FileManager::resolve(kArchiveDir);
+    Archive& archive = archiveFor(dir);
+    refresh(archive, dir);
+    size_t count;
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        count = archive.segments.size();
+    }
+    for (size_t s = 0; s < count; ++s) {
+        const Segment* seg;
+        {
+            std::shared_lock<std::shared_mutex> lock(registryMutex);
+            seg = archive.segments[s].get();
+        }
+        for (uint32_t b = 0; b < seg->blocks.size(); ++b) {
+            auto data = readBlock(*seg, b);
+            if (!data) continue;
+            forEachRecord(*data, [&](std::string_view, std::string_view json) {
+                models::Transaction tx;
+                if (SaxModelReader::parse(json, tx)) fn(tx);
+                return true;
+            });
+        }
+    }
+}
+
+ArchiveStats TransactionArchive::stats() {
+    ArchiveStats s;
+    std::string dir = FileManager::resolve(kArchiveDir);
+    Archive& archive = archiveFor(dir);
+    refresh(archive, dir);
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        s.segments = archive.segments.size();
+        s.records = archive.ids.size() + archive.legacyIds.size();
+        for (const auto& seg : archive.segments) s.archive_bytes += seg->bytes;
+    }
+    s.cold_reads = coldReads.load(std::memory_order_relaxed);
+    s.cold_read_us_total = coldReadUsTotal.load(std::memory_order_relaxed);
+    s.cold_read_us_max = coldReadUsMax.load(std::memory_order_relaxed);
+    s.block_cache_hits = cacheHits.load(std::memory_order_relaxed);
+    s.block_cache_misses = cacheMisses.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace storage
@@ -1,43 +1,55 @@
 #include "storage/TransactionStorage.h"
 #include "storage/FileManager.h"
+#include "storage/SaxModelReader.h"
+#include "storage/RequestArena.h"
+#include "tracing/Tracer.h"
+#include "storage/TransactionArchive.h"
 #include <nlohmann/json.hpp>
-#include <filesystem>
+#include <unordered_set>
 
 namespace storage {
-namespace fs = std::filesystem;
 
 bool TransactionStorage::save(const models::Transaction& tx) {
-    nlohmann::json j = tx;
+    tracing::Span span("storage", "TransactionStorage::save");
+    RequestArena arena;
+    ArenaJson j = tx;
     std::string path = "data/transactions/" + tx.transaction_id + ".json";
     return FileManager::writeJson(path, j);
 }
 
 std::optional<models::Transaction> TransactionStorage::load(const std::string& transaction_id) {
+    tracing::Span span("storage", "TransactionStorage::load");
     std::string path = "data/transactions/" + transaction_id + ".json";
-    nlohmann::json j;
-    if (!FileManager::readJson(path, j)) return std::nullopt;
-    try {
-        models::Transaction t = j.get<models::Transaction>();
-        return t;
-    } catch (...) {
-        return std::nullopt;
+    models::Transaction t;
+    if (!SaxModelReader::read(path, t)) return TransactionArchive::load(transaction_id);
+    return t;
+}
+
+void TransactionStorage::loadMany(const std::vector<std::string>& transaction_ids,
+                                  std::vector<std::optional<models::Transaction>>& out) {
+    tracing::Span span("storage", "TransactionStorage::loadMany");
+    std::vector<std::string> paths;
+    paths.reserve(transaction_ids.size());
+    for (const auto& id : transaction_ids) paths.push_back("data/transactions/" + id + ".json");
+    SaxModelReader::readMany(paths, out);
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (!out[i]) out[i] = TransactionArchive::load(transaction_ids[i]);
     }
 }
 
 std::vector<models::Transaction> TransactionStorage::listAll() {
     std::vector<models::Transaction> transactions;
-    std::string dir = "data/transactions";
-    if (!fs::exists(dir)) return transactions;
-    for (auto& entry : fs::directory_iterator(dir)) {
-        if (entry.path().extension() == ".json") {
-            nlohmann::json j;
-            if (FileManager::readJson(entry.path().string(), j)) {
-                try {
-                    transactions.push_back(j.get<models::Transaction>());
-                } catch (...) {}
-            }
-        }
+    std::vector<std::optional<models::Transaction>> loaded;
+    SaxModelReader::readMany(FileManager::listRecords("data/transactions"), loaded);
+    for (auto& t : loaded) {
+        if (t) transactions.push_back(std::move(*t));
     }
+    // A record interrupted mid-tiering can briefly be in both tiers
+    std::unordered_set<std::string> hot;
+    for (const auto& t : transactions) hot.insert(t.transaction_id);
+    TransactionArchive::forEach([&](const models::Transaction& t) {
+        if (!hot.count(t.transaction_id)) transactions.push_back(t);
+    });
     return transactions;
 }
 
@@ -1,44 +1,59 @@
 #include "storage/UserStorage.h"
 #include "storage/FileManager.h"
+#include "storage/SaxModelReader.h"
+#include "storage/RequestArena.h"
+#include "tracing/Tracer.h"
 #include <nlohmann/json.hpp>
-#include <filesystem>
+#include <algorithm>
 
 namespace storage {
-namespace fs = std::filesystem;
 
 bool UserStorage::save(const models::UserAccount& user) {
-    nlohmann::json j = user;
+    tracing::Span span("storage", "UserStorage::save");
+    RequestArena arena;
+    ArenaJson j = user;
     std::string path = "data/users/" + user.username + ".json";
     return FileManager::writeJson(path, j);
 }
 
 std::optional<models::UserAccount> UserStorage::load(const std::string& username) {
+    tracing::Span span("storage", "UserStorage::load");
     std::string path = "data/users/" + username + ".json";
-    nlohmann::json j;
-    if (!FileManager::readJson(path, j)) return std::nullopt;
-    try {
-        models::UserAccount u = j.get<models::UserAccount>();
-        return u;
-    } catch (...) {
-        return std::nullopt;
-    }
+    models::UserAccount u;
+    if (!SaxModelReader::read(path, u)) return std::nullopt;
+    return u;
 }
 
 std::vector<models::UserAccount> UserStorage::listAll() {
     std::vector<models::UserAccount> users;
-    std::string dir = "data/users";
-    if (!fs::exists(dir)) return users;
-    for (auto& entry : fs::directory_iterator(dir)) {
-        if (entry.path().extension() == ".json") {
-            nlohmann::json j;
-            if (FileManager::readJson(entry.path().string(), j)) {
-                try {
-                    users.push_back(j.get<models::UserAccount>());
-                } catch (...) {}
-            }
-        }
+    std::vector<std::optional<models::UserAccount>> loaded;
+    SaxModelReader::readMany(FileManager::listRecords("data/users"), loaded);
+    for (auto& u : loaded) {
+        if (u) users.push_back(std::move(*u));
     }
     return users;
 }
 
+void UserStorage::forEach(const std::function<bool(const models::UserAccount&)>& fn) {
+    auto paths = FileManager::listRecords("data/users");
+    std::vector<std::string> batch;
+    std::vector<std::optional<models::UserAccount>> loaded;
+    for (size_t begin = 0; begin < paths.size(); begin += SaxModelReader::kReadBatch) {
+        size_t end = std::min(paths.size(), begin + SaxModelReader::kReadBatch);
+        batch.assign(paths.begin() + begin, paths.begin() + end);
+        SaxModelReader::readMany(batch, loaded);
+        for (const auto& u : loaded) {
+            if (u && !fn(*u)) return;
+        }
+    }
+}
+
+void UserStorage::loadMany(const std::vector<std::string>& usernames,
+                           std::vector<std::optional<models::UserAccount>>& out) {
+    std::vector<std::string> paths;
+    paths.reserve(usernames.size());
+    for (const auto& name : usernames) paths.push_back("data/users/" + name + ".json");
+    SaxModelReader::readMany(paths, out);
+}
+
 } // namespace storage 
\ No newline at end of file
@@ -1,42 +1,57 @@
 #include "storage/WalletStorage.h"
 #include "storage/FileManager.h"
+#include "storage/SaxModelReader.h"
+#include "storage/RequestArena.h"
+#include "tracing/Tracer.h"
 #include <nlohmann/json.hpp>
-#include <filesystem>
 
 namespace storage {
-namespace fs = std::filesystem;
 
 bool WalletStorage::save(const models::Wallet& wallet) {
-    nlohmann::json j = wallet;
+    tracing::Span span("storage", "WalletStorage::save");
+    RequestArena arena;
+    ArenaJson j = wallet;
     std::string path = "data/wallets/" + wallet.wallet_id + ".json";
     return FileManager::writeJson(path, j);
 }
 
+bool WalletStorage::save(const models::Wallet& wallet, const std::vector<models::Transaction>& transactions) {
+    if (transactions.empty()) return save(wallet);
+    return save(std::vector<const models::Wallet*>{&wallet}, transactions);
+}
+
+bool WalletStorage::save(const std::vector<const models::Wallet*>& wallets,
+                         const std::vector<models::Transaction>& transactions) {
+    tracing::Span span("storage", "WalletStorage::save");
+    RequestArena arena;
+    std::vector<ArenaJson> docs;
+    std::vector<ChainedWrite> writes;
+    docs.reserve(transactions.size() + wallets.size());
+    for (const auto& tx : transactions) {
+        docs.emplace_back(tx);
+        writes.push_back(ChainedWrite{"data/transactions/" + tx.transaction_id + ".json", &docs.back()});
+    }
+    for (const auto* wallet : wallets) {
+        docs.emplace_back(*wallet);
+        writes.push_back(ChainedWrite{"data/wallets/" + wallet->wallet_id + ".json", &docs.back()});
+    }
+    return FileManager::writeJsonChain(writes);
+}
+
 std::optional<models::Wallet> WalletStorage::load(const std::string& wallet_id) {
+    tracing::Span span("storage", "WalletStorage::load");
     std::string path = "data/wallets/" + wallet_id + ".json";
-    nlohmann::json j;
-    if (!FileManager::readJson(path, j)) return std::nullopt;
-    try {
-        models::Wallet w = j.get<models::Wallet>();
-        return w;
-    } catch (...) {
-        return std::nullopt;
-    }
+    models::Wallet w;
+    if (!SaxModelReader::read(path, w)) return std::nullopt;
+    return w;
 }
 
 std::vector<models::Wallet> WalletStorage::listAll() {
     std::vector<models::Wallet> wallets;
-    std::string dir = "data/wallets";
-    if (!fs::exists(dir)) return wallets;
-    for (auto& entry : fs::directory_iterator(dir)) {
-        if (entry.path().extension() == ".json") {
-            nlohmann::json j;
-            if (FileManager::readJson(entry.path().string(), j)) {
-                try {
-                    wallets.push_back(j.get<models::Wallet>());
-                } catch (...) {}
-            }
-        }
+    std::vector<std::optional<models::Wallet>> loaded;
+    SaxModelReader::readMany(FileManager::listRecords("data/wallets"), loaded);
+    for (auto& w : loaded) {
+        if (w) wallets.push_back(std::move(*w));
     }
     return wallets;
 }
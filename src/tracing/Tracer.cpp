@@ -0,0 +1,179 @@
+#include "tracing/Tracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+
+namespace tracing {
+
+namespace {
+
+std::atomic<bool> on{false};
+// A request is sampled when a per-thread random draw falls below this
+std::atomic<uint64_t> threshold{0};
+std::atomic<uint64_t> traceIds{0};
+std::atomic<uint64_t> spans{0};
+std::atomic<uint64_t> sampled{0};
+std::atomic<int> threadIds{0};
+
+std::mutex fileMutex;
+std::ofstream out;
+
+struct Event {
+    const char* category;
+    const char* name;
+    int64_t start_us;
+    int64_t dur_us;
+    std::string detail;
+};
+
+struct ThreadState {
+    // Whether a request is open on this thread, and whether it is sampled
+    bool inRequest = false;
+    bool sampled = false;
+    uint64_t traceId = 0;
+    int tid = ++threadIds;
+    uint64_t rng = 0x9E3779B97F4A7C15ull * static_cast<uint64_t>(tid);
+    // Finished spans of the current request, written when its root closes
+    std::vector<Event> events;
+    // Merged into the args of the root, which closes last
+    nlohmann::json rootArgs;
+};
+
+thread_local ThreadState state;
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift64*: cheap enough to draw on every request
+uint64_t draw(uint64_t& x) {
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+void writeEvents() {
+    std::string text;
+    int pid = static_cast<int>(::getpid());
+    for (const auto& e : state.events) {
+        nlohmann::json args{{"trace", state.traceId}};
+        if (!e.detail.empty()) args["detail"] = e.detail;
+        if (&e == &state.events.back() && state.rootArgs.is_object()) args.update(state.rootArgs);
+        nlohmann::json event{
+            {"name", e.name},
+            {"cat", e.category},
+            {"ph", "X"},
+            {"ts", e.start_us},
+            {"dur", e.dur_us},
+            {"pid", pid},
+            {"tid", state.tid},
+            {"args", std::move(args)}
+        };
+        text += event.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        text += ",\n";
+    }
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (!out.is_open()) return;
+    out << text;
+    out.flush();
+    spans.fetch_add(state.events.size(), std::memory_order_relaxed);
+}
+
+} // namespace
+
+bool Tracer::start(const std::string& path, double sampleRate) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (out.is_open()) out.close();
+    out.open(path, std::ios::trunc);
+    if (!out) return false;
+    out << "[\n";
+    double rate = std::min(1.0, std::max(0.0, sampleRate));
+    threshold.store(rate >= 1.0 ? UINT64_MAX : static_cast<uint64_t>(rate * 18446744073709551616.0),
+                    std::memory_order_relaxed);
+    spans.store(0, std::memory_order_relaxed);
+    sampled.store(0, std::memory_order_relaxed);
+    on.store(true, std::memory_order_release);
+    return true;
+}
+
+void Tracer::stop() {
+    on.store(false, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (out.is_open()) out.close();
+}
+
+bool Tracer::enabled() {
+    return on.load(std::memory_order_acquire);
+}
+
+uint64_t Tracer::spansWritten() {
+    return spans.load(std::memory_order_relaxed);
+}
+
+uint64_t Tracer::requestsSampled() {
+    return sampled.load(std::memory_order_relaxed);
+}
+
+Span::Span(const char* category, const char* name) {
+    if (!state.sampled) return;
+    begin(category, name);
+}
+
+Span::Span(const char* category, const char* name, const std::string& detail) {
+    if (!state.sampled) return;
+    detail_ = detail;
+    begin(category, name);
+}
+
+void Span::begin(const char* category, const char* name) {
+    active_ = true;
+    category_ = category;
+    name_ = name;
+    start_us_ = nowUs();
+}
+
+Span::~Span() {
+    if (!active_) return;
+    state.events.push_back(Event{category_, name_, start_us_, nowUs() - start_us_, std::move(detail_)});
+}
+
+RootSpan::RootSpan(const char* category, const char* name) {
+    if (!on.load(std::memory_order_relaxed)) return;
+    // A request opened inside another (a batch's commands) takes the outer decision, sampled
+    // or not, so a batch is traced whole or not at all
+    if (!state.inRequest) {
+        owner_ = true;
+        state.inRequest = true;
+        uint64_t limit = threshold.load(std::memory_order_relaxed);
+        if (limit != UINT64_MAX && draw(state.rng) >= limit) return;
+        state.sampled = true;
+        state.traceId = traceIds.fetch_add(1, std::memory_order_relaxed) + 1;
+        sampled.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (state.sampled) span_.emplace(category, name);
+}
+
+void RootSpan::annotate(const nlohmann::json& args) {
+    if (owner_ && state.sampled) state.rootArgs = args;
+}
+
+RootSpan::~RootSpan() {
+    span_.reset();
+    if (!owner_) return;
+    state.inRequest = false;
+    if (!state.sampled) return;
+    writeEvents();
+    state.events.clear();
+    state.rootArgs = nullptr;
+    state.sampled = false;
+}
+
+} // namespace tracing
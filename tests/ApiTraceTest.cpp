@@ -0,0 +1,78 @@
+// API traces: recorded calls carry no passwords, OTPs or session tokens, and a recording
+// replays against a copy of the data it was taken from without divergences
+#include "TestSupport.h"
+#include "api/ApiRouter.h"
+#include "api/ApiTrace.h"
+#include "client/TraceReplay.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using api::ApiRouter;
+
+namespace {
+
+std::string token;
+std::string otp;
+
+void record(const std::string& path) {
+    CHECK(api::TraceRecorder::start(path));
+    CHECK(ApiRouter::registerUser("alice", "hunter2-Secret", "alice@example.com").success);
+    auto login = ApiRouter::initiateLogin("alice", "hunter2-Secret");
+    CHECK(login.success);
+    otp = login.data["otp"].get<std::string>();
+    auto session = ApiRouter::completeLogin("alice", otp);
+    CHECK(session.success);
+    token = session.data["token"].get<std::string>();
+    auto wallet = ApiRouter::createWallet(token);
+    CHECK(wallet.success);
+    std::string walletId = wallet.data["walletId"].get<std::string>();
+    CHECK(ApiRouter::executeTransaction(token, walletId, 25, "credit", "seed").success);
+    CHECK(ApiRouter::changePassword(token, "hunter2-Secret", "hunter3-Secret").success);
+    CHECK(!ApiRouter::initiateLogin("alice", "hunter2-Secret").success);
+    CHECK(ApiRouter::getWallet(token, walletId).success);
+    api::TraceRecorder::stop();
+}
+
+void credentialsRedacted(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), {});
+    CHECK(bytes.find("hunter2-Secret") == std::string::npos);
+    CHECK(bytes.find("hunter3-Secret") == std::string::npos);
+    CHECK(bytes.find(otp) == std::string::npos);
+    CHECK(bytes.find(token) == std::string::npos);
+
+    api::TraceReader reader(path);
+    std::vector<api::TraceEntry> entries;
+    for (api::TraceEntry entry; reader.next(entry);) entries.push_back(entry);
+    CHECK(entries.size() == 8);
+    // One alias per distinct secret, the same wherever the secret recurs
+    std::string password = entries[0].args["password"].get<std::string>();
+    CHECK(password.rfind("secret:", 0) == 0);
+    CHECK(entries[1].args["password"] == password);
+    CHECK(entries[1].ids["otp"] == entries[2].args["otp"]);
+    CHECK(entries[1].ids["otp"] != password);
+    CHECK(entries[5].args["oldPassword"] == password && entries[5].args["newPassword"] != password);
+    CHECK(entries[6].args["password"] == password && !entries[6].success);
+    // Session tokens are recorded in a form replay can map back from
+    CHECK(entries[2].ids["token"] == api::traceTokenFor(token));
+    CHECK(entries[3].args["token"] == api::traceTokenFor(token));
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("api_trace");
+    // The replay starts from the data as it was before the recording
+    fs::create_directories("data");
+    fs::copy("data", "before", fs::copy_options::recursive);
+    std::string trace = scratch.path() + "/calls.trace";
+    record(trace);
+    credentialsRedacted(trace);
+    CHECK(client::TraceReplay::run(trace, scratch.path() + "/before", false) == 0);
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Asset ledger: the vectorized column sums agree with a plain per-wallet sum, including the
+// tail of a shard's column, and saves of different wallets from many threads all land
+#include "TestSupport.h"
+#include "models/Wallet.h"
+#include "services/AssetLedger.h"
+#include "storage/FileManager.h"
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using services::AssetLedger;
+
+namespace {
+
+const std::vector<std::string> kAssets = {"gold", "miles", "tokens"};
+
+// Balances are multiples of 1/4, so every order of summation gives the exact same total
+models::Wallet makeWallet(int i, int round) {
+    std::string n = std::to_string(i);
+    models::Wallet wallet("w" + n, "u" + n, (i + round) % 7 == 0 ? 0.0 : 0.25 * (i + round));
+    for (size_t a = 0; a < kAssets.size(); ++a) {
+        if ((i + round) % (a + 2) == 0) wallet.balanceFor(kAssets[a]) = 1.5 * (i % 11) + round;
+    }
+    return wallet;
+}
+
+// The expected totals, one wallet at a time
+void checkAgainst(const std::vector<models::Wallet>& wallets) {
+    std::map<std::string, std::pair<double, size_t>> expected;
+    expected[models::kDefaultAsset];
+    for (const auto& w : wallets) {
+        auto& points = expected[models::kDefaultAsset];
+        points.first += w.balance;
+        points.second += w.balance != 0.0;
+        for (size_t i = 0; i < w.asset_codes.size(); ++i) {
+            auto& other = expected[w.asset_codes[i]];
+            other.first += w.asset_balances[i];
+            other.second += w.asset_balances[i] != 0.0;
+        }
+    }
+    auto totals = AssetLedger::totals();
+    CHECK(totals.size() == expected.size());
+    CHECK(totals[0].asset == models::kDefaultAsset);
+    for (const auto& t : totals) {
+        auto it = expected.find(t.asset);
+        CHECK(it != expected.end());
+        CHECK(t.total == it->second.first && t.holders == it->second.second);
+    }
+}
+
+void builtFromFiles() {
+    // Not a multiple of the shard count or the four sum lanes, so column tails are summed too
+    std::vector<models::Wallet> wallets;
+    for (int i = 0; i < 1003; ++i) {
+        wallets.push_back(makeWallet(i, 0));
+        CHECK(storage::FileManager::writeJson("data/wallets/" + wallets.back().wallet_id + ".json",
+                                              nlohmann::json(wallets.back())));
+    }
+    AssetLedger::ensureBuilt();
+    checkAgainst(wallets);
+    CHECK(!AssetLedger::total("unheld"));
+    CHECK(AssetLedger::total("gold")->holders > 0);
+}
+
+void savesReplaceBalances() {
+    std::vector<models::Wallet> wallets;
+    for (int i = 0; i < 1003; ++i) wallets.push_back(makeWallet(i, 0));
+    // A save that drops an asset zeroes the wallet's slot in that column
+    wallets[5] = models::Wallet("w5", "u5", 3);
+    AssetLedger::update(wallets[5]);
+    wallets.push_back(makeWallet(2000, 0));
+    wallets.back().balanceFor("late") = 4;
+    AssetLedger::update(wallets.back());
+    checkAgainst(wallets);
+    CHECK(AssetLedger::total("late")->total == 4);
+}
+
+void concurrentSaves() {
+    const int threads = 8, perThread = 300, rounds = 5;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([t] {
+            for (int round = 1; round <= rounds; ++round) {
+                for (int i = t * perThread; i < (t + 1) * perThread; ++i) AssetLedger::update(makeWallet(i, round));
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    std::vector<models::Wallet> wallets;
+    for (int i = 0; i < threads * perThread; ++i) wallets.push_back(makeWallet(i, rounds));
+    // w2000 no longer holds "late", which stays listed at zero
+    wallets[2000].balanceFor("late");
+    checkAgainst(wallets);
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("asset_ledger");
+    builtFromFiles();
+    savesReplaceBalances();
+    concurrentSaves();
+    return 0;
+}
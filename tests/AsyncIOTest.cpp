@@ -0,0 +1,149 @@
+// Batched I/O: reads and write chains on io_uring and, in a child where io_uring is blocked,
+// on the thread pool fallback; a chain renames in order and stops at the first failure, and a
+// ring the kernel refuses submissions on hands over to the pool without leaking descriptors
+#include "TestSupport.h"
+#include "storage/AsyncIO.h"
+#include "storage/FileManager.h"
+#include "storage/Snapshot.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+using storage::AsyncIO;
+using storage::FileRead;
+using storage::FileWrite;
+
+namespace {
+
+// Makes the syscall nr fail with error for this process and the threads it starts
+bool blockSyscall(int nr, int error) {
+    struct sock_filter filter[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<unsigned>(nr), 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | static_cast<unsigned>(error)),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+    };
+    struct sock_fprog program = {static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])), filter};
+    return ::prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0 &&
+           ::prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) == 0;
+}
+
+size_t openDescriptors() {
+    size_t count = 0;
+    for (auto it = fs::directory_iterator("/proc/self/fd"); it != fs::directory_iterator(); ++it) ++count;
+    return count;
+}
+
+std::string contents(const std::string& path) {
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+void chainWritesAndReads(const std::string& dir) {
+    fs::create_directories(dir);
+    const size_t count = 40;
+    std::vector<std::unique_ptr<std::string>> data;
+    std::vector<FileWrite> writes;
+    for (size_t i = 0; i < count; ++i) {
+        data.push_back(std::make_unique<std::string>(std::string(100 + i, 'a' + i % 26)));
+        std::string path = dir + "/r" + std::to_string(i);
+        writes.push_back(FileWrite{path + ".tmp", path, data.back().get(), false});
+    }
+    CHECK(AsyncIO::writeChain(writes));
+    for (size_t i = 0; i < count; ++i) {
+        CHECK(writes[i].ok && contents(writes[i].path) == *data[i]);
+        CHECK(!fs::exists(writes[i].tmp_path));
+    }
+
+    std::vector<FileRead> reads;
+    for (size_t i = 0; i < count; ++i) reads.push_back(FileRead{dir + "/r" + std::to_string(i), {}, false});
+    reads.push_back(FileRead{dir + "/missing", {}, false});
+    AsyncIO::read(reads);
+    for (size_t i = 0; i < count; ++i) CHECK(reads[i].ok && reads[i].data == *data[i]);
+    CHECK(!reads[count].ok);
+}
+
+void chainStopsAtFailure(const std::string& dir) {
+    std::string ok = "ok", bad = "bad", after = "after";
+    std::vector<FileWrite> writes = {
+        FileWrite{dir + "/s0.tmp", dir + "/s0", &ok, false},
+        FileWrite{dir + "/nodir/s1.tmp", dir + "/nodir/s1", &bad, false},
+        FileWrite{dir + "/s2.tmp", dir + "/s2", &after, false},
+    };
+    CHECK(!AsyncIO::writeChain(writes));
+    CHECK(writes[0].ok && contents(dir + "/s0") == "ok");
+    CHECK(!writes[1].ok && !writes[2].ok);
+    // The write after the failure is neither visible nor left behind as a temp file
+    CHECK(!fs::exists(dir + "/s2") && !fs::exists(dir + "/s2.tmp"));
+}
+
+void batchReadsUnderSnapshot() {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 8; ++i) {
+        paths.push_back("data/batch/r" + std::to_string(i) + ".json");
+        CHECK(storage::FileManager::writeJson(paths.back(), nlohmann::json{{"v", 1}}));
+    }
+    storage::Snapshot snapshot;
+    for (const auto& path : paths) CHECK(storage::FileManager::writeJson(path, nlohmann::json{{"v", 2}}));
+    std::vector<std::optional<std::string>> out;
+    storage::FileManager::readFiles(paths, out);
+    for (const auto& text : out) CHECK(text && nlohmann::json::parse(*text)["v"] == 1);
+}
+
+void runAll(const char* expectedBackend) {
+    CHECK(std::strcmp(AsyncIO::backend(), expectedBackend) == 0);
+    std::string dir = fs::current_path().string() + "/" + expectedBackend;
+    chainWritesAndReads(dir);
+    chainStopsAtFailure(dir);
+    batchReadsUnderSnapshot();
+}
+
+// The ring is set up, but the kernel refuses every submission on it
+void refusedSubmissions(const std::string& dir) {
+    CHECK(std::strcmp(AsyncIO::backend(), "io_uring") == 0);
+    size_t before = openDescriptors();
+    chainWritesAndReads(dir);
+    CHECK(std::strcmp(AsyncIO::backend(), "threads") == 0);
+    CHECK(openDescriptors() == before);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 2 && std::string(argv[1]) == "threads") {
+        fs::current_path(argv[2]);
+        CHECK(blockSyscall(__NR_io_uring_setup, ENOSYS));
+        runAll("threads");
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "refused") {
+        fs::current_path(argv[2]);
+        CHECK(blockSyscall(__NR_io_uring_enter, ENOMEM));
+        refusedSubmissions(fs::current_path().string() + "/refused");
+        return 0;
+    }
+    test_support::ScratchDir scratch("async_io");
+    // io_uring may be unavailable here too, in which case both runs take the fallback
+    bool ring = std::strcmp(AsyncIO::backend(), "io_uring") == 0;
+    runAll(ring ? "io_uring" : "threads");
+    fs::create_directories("child");
+    CHECK(test_support::runSelf({"threads", scratch.path() + "/child"}) == 0);
+    if (ring) {
+        fs::create_directories("refused_child");
+        CHECK(test_support::runSelf({"refused", scratch.path() + "/refused_child"}) == 0);
+    }
+    return 0;
+}
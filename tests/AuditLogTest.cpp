@@ -0,0 +1,212 @@
+// Audit log hash chain: verify() pins the first broken entry wherever it falls relative to the
+// slices checked in parallel, and torn appends and failed writes leave a visible break without
+// losing or repeating an entry
+#include "TestSupport.h"
+#include "storage/AuditLog.h"
+
+#include <algorithm>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+namespace fs = std::filesystem;
+using storage::AuditLog;
+
+namespace {
+
+constexpr int kEntries = 2000;
+constexpr unsigned kWorkers = 4;
+const std::string kTampered = "data/audit/tampered.log";
+
+std::vector<std::string> linesOf(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+void writeLines(const std::string& path, const std::vector<std::string>& lines) {
+    std::ofstream out(path, std::ios::trunc);
+    for (const auto& line : lines) out << line << '\n';
+}
+
+// The third field of "<seq> <prev hash> <hash> <payload>"
+std::string hashOf(const std::string& line) {
+    return line.substr(line.find(' ') + 1 + 64 + 1, 64);
+}
+
+std::string targetOf(int i) {
+    return "t-" + std::to_string(i);
+}
+
+// Index of the first line verify() gives each worker after the first, the lines whose
+// predecessor is checked only when the slices are joined
+std::vector<size_t> sliceStarts(const std::vector<std::string>& lines, unsigned workers) {
+    uint64_t size = 0;
+    std::vector<uint64_t> offsets;
+    for (const auto& line : lines) {
+        offsets.push_back(size);
+        size += line.size() + 1;
+    }
+    uint64_t step = (size + workers - 1) / workers;
+    std::vector<size_t> starts;
+    for (unsigned w = 1; w < workers; ++w) {
+        auto it = std::lower_bound(offsets.begin(), offsets.end(), step * w);
+        if (it != offsets.end()) starts.push_back(static_cast<size_t>(it - offsets.begin()));
+    }
+    return starts;
+}
+
+// Rewrites the line's target in place, keeping its length and its hashes
+std::string forged(std::string line) {
+    size_t at = line.find("\"target\":\"t-");
+    CHECK(at != std::string::npos);
+    line[at + 10] = 'x';
+    return line;
+}
+
+uint64_t firstBadSeq(const std::vector<std::string>& lines, unsigned workers) {
+    writeLines(kTampered, lines);
+    auto report = AuditLog::verify(kTampered, workers);
+    CHECK(!report.ok);
+    return report.first_bad_seq;
+}
+
+void chainVerifies() {
+    for (int i = 0; i < kEntries; ++i) CHECK(AuditLog::record("auditor", "credit", targetOf(i), i % 7 != 0));
+    CHECK(AuditLog::flush());
+    auto lines = linesOf(AuditLog::kDefaultPath);
+    CHECK(lines.size() == static_cast<size_t>(kEntries));
+    for (unsigned workers : {1u, 3u, kWorkers, 16u}) {
+        auto report = AuditLog::verify(AuditLog::kDefaultPath, workers);
+        CHECK(report.ok && report.first_bad_seq == 0);
+        CHECK(report.entries == static_cast<uint64_t>(kEntries));
+        CHECK(report.head_hash == hashOf(lines.back()));
+    }
+    auto stats = AuditLog::stats();
+    CHECK(stats.written == static_cast<uint64_t>(kEntries));
+    CHECK(stats.fsyncs > 0 && stats.write_failures == 0 && !stats.failing);
+}
+
+void tamperedEntryIsPinned() {
+    auto lines = linesOf(AuditLog::kDefaultPath);
+    auto starts = sliceStarts(lines, kWorkers);
+    CHECK(starts.size() == kWorkers - 1);
+
+    // A forged payload, in the middle of a slice, first in one or last in the one before
+    std::vector<size_t> forgedAt{0, lines.size() / 2 + 17, lines.size() - 1};
+    for (size_t start : starts) {
+        forgedAt.push_back(start);
+        forgedAt.push_back(start - 1);
+    }
+    for (size_t i : forgedAt) {
+        auto tampered = lines;
+        tampered[i] = forged(tampered[i]);
+        for (unsigned workers : {1u, kWorkers}) CHECK(firstBadSeq(tampered, workers) == i + 1);
+        CHECK(AuditLog::verify(kTampered, kWorkers).error == "hash mismatch");
+    }
+
+    // A dropped entry is caught at its successor, inside a slice or where two are joined
+    for (size_t start : starts) {
+        for (size_t i = start - 2; i <= start + 2; ++i) {
+            auto tampered = lines;
+            tampered.erase(tampered.begin() + static_cast<std::ptrdiff_t>(i));
+            for (unsigned workers : {1u, kWorkers}) CHECK(firstBadSeq(tampered, workers) == i + 2);
+        }
+    }
+
+    // Two entries swapped across a slice boundary
+    auto swapped = lines;
+    std::swap(swapped[starts[1] - 1], swapped[starts[1]]);
+    for (unsigned workers : {1u, kWorkers}) CHECK(firstBadSeq(swapped, workers) == starts[1] + 1);
+    fs::remove(kTampered);
+}
+
+// Text appended by someone else mid-line, as an interrupted append leaves it
+void tornTailIsKeptAsABreak() {
+    uint64_t before = AuditLog::stats().torn_tails;
+    {
+        std::ofstream out(AuditLog::kDefaultPath, std::ios::app);
+        out << kEntries + 1 << " 0000";
+    }
+    CHECK(AuditLog::record("auditor", "credit", "after-torn", true));
+    CHECK(AuditLog::flush());
+    CHECK(AuditLog::stats().torn_tails == before + 1);
+
+    auto lines = linesOf(AuditLog::kDefaultPath);
+    CHECK(lines.size() == static_cast<size_t>(kEntries) + 2);
+    auto report = AuditLog::verify(AuditLog::kDefaultPath, kWorkers);
+    CHECK(!report.ok);
+    CHECK(report.first_bad_seq == static_cast<uint64_t>(kEntries) + 1);
+    CHECK(report.error == "malformed entry");
+    // The chain resumed from the last whole entry
+    lines.erase(lines.end() - 2);
+    writeLines(kTampered, lines);
+    report = AuditLog::verify(kTampered, kWorkers);
+    CHECK(report.ok && report.entries == static_cast<uint64_t>(kEntries) + 1);
+    fs::remove(kTampered);
+}
+
+// In a fresh process: appends stop partway through a line at a file size limit, and are
+// retried once it is lifted
+int retriesFailedAppends() {
+    std::signal(SIGXFSZ, SIG_IGN);
+    CHECK(AuditLog::record("auditor", "credit", "first", true));
+    CHECK(AuditLog::flush());
+    struct rlimit limit;
+    CHECK(::getrlimit(RLIMIT_FSIZE, &limit) == 0);
+    struct rlimit capped = limit;
+    capped.rlim_cur = static_cast<rlim_t>(fs::file_size(AuditLog::kDefaultPath) + 10);
+    CHECK(::setrlimit(RLIMIT_FSIZE, &capped) == 0);
+
+    constexpr int kRetried = 50;
+    for (int i = 0; i < kRetried; ++i) AuditLog::record("auditor", "credit", targetOf(i), true);
+    CHECK(!AuditLog::flush());
+    auto stats = AuditLog::stats();
+    CHECK(stats.failing && stats.write_failures > 0);
+    CHECK(!AuditLog::record("auditor", "credit", targetOf(kRetried), true));
+
+    CHECK(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+    bool flushed = false;
+    for (int attempt = 0; attempt < 50 && !flushed; ++attempt) flushed = AuditLog::flush();
+    CHECK(flushed);
+    stats = AuditLog::stats();
+    CHECK(!stats.failing && stats.written == static_cast<uint64_t>(kRetried) + 2);
+
+    // The 10 bytes that landed are a torn entry 2; every queued entry follows it exactly once
+    auto lines = linesOf(AuditLog::kDefaultPath);
+    CHECK(lines.size() == static_cast<size_t>(kRetried) + 3);
+    for (int i = 0; i <= kRetried; ++i) {
+        size_t found = std::count_if(lines.begin(), lines.end(), [&](const std::string& line) {
+            return line.find("\"target\":\"" + targetOf(i) + "\"") != std::string::npos;
+        });
+        CHECK(found == 1);
+    }
+    auto report = AuditLog::verify(AuditLog::kDefaultPath, kWorkers);
+    CHECK(!report.ok && report.first_bad_seq == 2);
+    lines.erase(lines.begin() + 1);
+    writeLines(kTampered, lines);
+    report = AuditLog::verify(kTampered, kWorkers);
+    CHECK(report.ok && report.entries == static_cast<uint64_t>(kRetried) + 2);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 2 && std::string(argv[1]) == "retry") {
+        fs::current_path(argv[2]);
+        return retriesFailedAppends();
+    }
+    test_support::ScratchDir scratch("audit_log");
+    chainVerifies();
+    tamperedEntryIsPinned();
+    tornTailIsKeptAsABreak();
+
+    test_support::ScratchDir retry("audit_log_retry");
+    CHECK(test_support::runSelf({"retry", retry.path()}) == 0);
+    return 0;
+}
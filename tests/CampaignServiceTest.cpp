@@ -0,0 +1,154 @@
+// Campaigns: a run credits every eligible wallet once, predicates filter on profile and
+// balance, an interrupted run resumes without crediting twice, and client idempotency keys
+// cannot collide with the campaign's own
+#include "TestSupport.h"
+#include "models/Id128.h"
+#include "services/AdminService.h"
+#include "services/CampaignService.h"
+#include "services/WalletService.h"
+#include "storage/CampaignStorage.h"
+#include "storage/IdempotencyIndex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using services::CampaignService;
+using services::WalletService;
+
+namespace {
+
+struct Member {
+    std::string username;
+    std::string walletId;
+};
+
+std::vector<Member> members;
+std::map<std::string, double> balances;
+
+// Five users with wallets and one without, seeded with distinct balances
+void seed() {
+    struct Spec {
+        const char* name;
+        const char* email;
+        bool admin;
+        double balance;
+    };
+    const Spec specs[] = {{"ada", "ada@corp.com", true, 50},   {"bob", "bob@corp.com", false, 20},
+                          {"cy", "cy@corp.com", false, 200},   {"dee", "dee@other.com", false, 20},
+                          {"eve", "eve@corp.com", false, 0},   {"fay", "fay@corp.com", false, 0}};
+    for (const auto& spec : specs) {
+        CHECK(services::AdminService::createUser(spec.name, "password", spec.email, spec.admin));
+        if (std::string(spec.name) == "fay") continue;
+        auto wallet = WalletService::createWallet(spec.name);
+        CHECK(wallet);
+        if (spec.balance > 0) CHECK(WalletService::executeTransaction(*wallet, spec.balance, "credit", "seed"));
+        members.push_back(Member{spec.name, *wallet});
+        balances[*wallet] = spec.balance;
+    }
+}
+
+void checkBalances() {
+    for (const auto& [walletId, balance] : balances) CHECK(WalletService::getWallet(walletId)->balance == balance);
+}
+
+models::Campaign create(const std::string& id, double amount, const std::string& target) {
+    auto campaign = CampaignService::createCampaign(models::Campaign(id, "bonus " + id, amount, target));
+    CHECK(campaign && campaign->status == "pending");
+    return *campaign;
+}
+
+void generatedIdsAreCanonical() {
+    auto campaign = CampaignService::createCampaign(models::Campaign("", "unnamed", 1, "all"));
+    CHECK(campaign && models::validCampaignId(campaign->campaign_id));
+    CHECK(models::Id128::parseCanonical(campaign->campaign_id));
+    CHECK(CampaignService::createCampaign(models::Campaign("bad id", "spaces", 1, "all")) == std::nullopt);
+}
+
+void runCreditsEveryWallet() {
+    create("welcome", 10, "all");
+    auto done = CampaignService::runCampaign("welcome", 3);
+    CHECK(done && done->status == "completed");
+    CHECK(done->processed == 6 && done->credited == 5 && done->skipped == 1 && done->failed == 0);
+    for (auto& [walletId, balance] : balances) balance += 10;
+    checkBalances();
+    // A completed campaign is not run again
+    auto again = CampaignService::runCampaign("welcome", 3);
+    CHECK(again && again->credited == 5);
+    checkBalances();
+}
+
+void predicateFilters() {
+    auto rule = models::Campaign("corp-mid", "corp", 5, "predicate");
+    rule.predicate.email_suffix = "@corp.com";
+    rule.predicate.is_admin = false;
+    rule.predicate.min_balance = 15;
+    rule.predicate.max_balance = 100;
+    CHECK(CampaignService::createCampaign(rule));
+    auto done = CampaignService::runCampaign("corp-mid", 2);
+    // Only bob: ada is an admin, cy is over the maximum, dee is outside corp.com, eve is
+    // under the minimum and fay has no wallet
+    CHECK(done && done->status == "completed" && done->credited == 1 && done->skipped == 5);
+    balances[members[1].walletId] += 5;
+    checkBalances();
+}
+
+void clientKeyDoesNotCollide() {
+    create("promo", 3, "all");
+    // A client credit whose key spells out the campaign's own key for the wallet
+    const std::string& walletId = members[3].walletId;
+    CHECK(WalletService::executeTransaction(walletId, 1, "credit", "client", "campaign:promo:" + walletId));
+    balances[walletId] += 1;
+    auto done = CampaignService::runCampaign("promo", 2);
+    CHECK(done && done->status == "completed" && done->failed == 0 && done->credited == 5);
+    for (auto& [id, balance] : balances) balance += 3;
+    checkBalances();
+}
+
+void resumesAfterInterruption() {
+    auto campaign = create("resume", 7, "all");
+    // A run that crashed after crediting two wallets, recording only the first in the index
+    for (size_t i = 0; i < 2; ++i) {
+        const std::string& walletId = members[i].walletId;
+        std::string txId = CampaignService::transactionIdFor("resume", walletId);
+        CHECK(WalletService::executeTransactionIf(walletId, txId, 7, "credit", "bonus resume",
+                                                  [](const models::Wallet&) { return true; }) ==
+              services::ConditionalOutcome::Applied);
+        balances[walletId] += 7;
+    }
+    std::string fingerprint = "campaign|" + nlohmann::json(7.0).dump();
+    std::string key = "campaign:resume:" + members[0].walletId;
+    using Index = storage::IdempotencyIndex;
+    CHECK(Index::reserve(key, members[0].walletId, fingerprint, Index::Scope::Campaign).status == Index::Status::Reserved);
+    CHECK(Index::complete(key, {members[0].walletId, CampaignService::transactionIdFor("resume", members[0].walletId),
+                                fingerprint}, Index::Scope::Campaign));
+    campaign.status = "running";
+    campaign.processed = 2;
+    CHECK(storage::CampaignStorage::save(campaign));
+
+    auto done = CampaignService::runCampaign("resume", 2);
+    CHECK(done && done->status == "completed");
+    CHECK(done->credited == 3 && done->already_credited == 2 && done->failed == 0);
+    for (size_t i = 2; i < members.size(); ++i) balances[members[i].walletId] += 7;
+    checkBalances();
+
+    // Forced to run once more, every wallet is found in the index and nothing is credited
+    done->status = "interrupted";
+    CHECK(storage::CampaignStorage::save(*done));
+    auto rerun = CampaignService::runCampaign("resume", 2);
+    CHECK(rerun && rerun->status == "completed" && rerun->credited == 0 && rerun->already_credited == 5);
+    checkBalances();
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("campaign_service");
+    seed();
+    generatedIdsAreCanonical();
+    runCreditsEveryWallet();
+    predicateFilters();
+    clientKeyDoesNotCollide();
+    resumesAfterInterruption();
+    return 0;
+}
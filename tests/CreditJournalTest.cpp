@@ -0,0 +1,115 @@
+// Hot wallet credits: journaled per shard, folded exactly once, visible to other processes
+#include "TestSupport.h"
+#include "services/UserService.h"
+#include "services/WalletService.h"
+#include "storage/CreditJournal.h"
+#include "storage/WalletStorage.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using services::WalletService;
+
+namespace {
+
+double balanceOf(const std::string& walletId) {
+    auto wallet = storage::WalletStorage::load(walletId);
+    CHECK(wallet);
+    return wallet->balance;
+}
+
+void concurrentCreditsAreJournaledThenFolded(const std::string& w) {
+    CHECK(WalletService::setHotWallet(w, 4) && WalletService::isHotWallet(w));
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&] {
+            for (int i = 0; i < 100; ++i) CHECK(WalletService::executeTransaction(w, 1, "credit", "c"));
+        });
+    }
+    for (auto& t : writers) t.join();
+    // Nothing reaches the wallet file until a fold
+    CHECK(balanceOf(w) == 0);
+    CHECK(storage::CreditJournal::hasPending(w));
+    auto pending = WalletService::pendingCredits(w);
+    CHECK(pending.size() == 1 && pending[0].second == 400);
+
+    CHECK(WalletService::foldAllCredits() == 400);
+    CHECK(balanceOf(w) == 400);
+    CHECK(storage::WalletStorage::load(w)->transaction_ids.size() == 400);
+    CHECK(!storage::CreditJournal::hasPending(w));
+}
+
+void debitFoldsJournaledCreditsWhenShort(const std::string& w) {
+    double before = balanceOf(w);
+    for (int i = 0; i < 10; ++i) CHECK(WalletService::executeTransaction(w, 10, "credit", "c"));
+    // Only covered once the journaled credits are folded in
+    CHECK(WalletService::executeTransaction(w, before + 50, "debit", "d"));
+    CHECK(balanceOf(w) == 50);
+    CHECK(WalletService::pendingCredits(w).empty());
+}
+
+void otherProcessDebitsAgainstJournal(const std::string& w, const std::string& dir) {
+    for (int i = 0; i < 10; ++i) CHECK(WalletService::executeTransaction(w, 10, "credit", "c"));
+    CHECK(balanceOf(w) == 50);
+    // The child does not treat the wallet as hot, yet must see these credits
+    CHECK(test_support::runSelf({"debit", dir, w, "120"}) == 0);
+    CHECK(balanceOf(w) == 30);
+    CHECK(!storage::CreditJournal::hasPending(w));
+}
+
+void leftoverDuplicateIsFoldedOnce(const std::string& w) {
+    double before = balanceOf(w);
+    // A crash between appending and acknowledging can journal the same credit twice
+    models::Transaction tx("0123456789abcdef0123456789abcdef", w, 7, "1", "credit", "retried");
+    CHECK(storage::CreditJournal::append(w, 2, tx));
+    CHECK(storage::CreditJournal::append(w, 2, tx));
+    WalletService::foldAllCredits();
+    CHECK(balanceOf(w) == before + 7);
+}
+
+void shardSwapsLoseNoCredits(const std::string& w) {
+    double before = balanceOf(w);
+    std::atomic<int> applied{0};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 2; ++t) {
+        writers.emplace_back([&] {
+            for (int i = 0; i < 150; ++i) {
+                if (WalletService::executeTransaction(w, 1, "credit", "c")) ++applied;
+            }
+        });
+    }
+    for (int i = 0; i < 15; ++i) {
+        WalletService::setHotWallet(w, 1 + i % 4);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    for (auto& t : writers) t.join();
+    WalletService::foldAllCredits();
+    CHECK(applied == 300);
+    CHECK(balanceOf(w) == before + 300);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 5 && std::string(argv[1]) == "debit") {
+        std::filesystem::current_path(argv[2]);
+        return WalletService::executeTransaction(argv[3], std::stod(argv[4]), "debit", "d") ? 0 : 1;
+    }
+    test_support::ScratchDir scratch("credit_journal");
+    CHECK(services::UserService::registerUser("pool", "pw123456", "pool@example.com"));
+    auto w = WalletService::createWallet("pool");
+    CHECK(w);
+    CHECK(!WalletService::setHotWallet("missing", 4));
+
+    concurrentCreditsAreJournaledThenFolded(*w);
+    debitFoldsJournaledCreditsWhenShort(*w);
+    otherProcessDebitsAgainstJournal(*w, scratch.path());
+    leftoverDuplicateIsFoldedOnce(*w);
+    shardSwapsLoseNoCredits(*w);
+    WalletService::setHotWallet(*w, 0);
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Event feed slow-consumer policies: Drop skips ahead and counts, Spill loses nothing, and
+// Block holds a publisher only for a bounded time
+#include "TestSupport.h"
+#include "services/EventFeed.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace services;
+
+namespace {
+
+constexpr size_t kRing = EventFeed::kCapacity;
+
+// Publishes n transactions whose amount is their index
+void publish(size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        EventFeed::publishTransaction("w", "tx" + std::to_string(i), "credit", double(i), 0, "u", "points");
+    }
+}
+
+std::vector<WalletEvent> drain(EventSubscription& sub) {
+    std::vector<WalletEvent> events;
+    while (sub.poll(events, 512) > 0) {}
+    return events;
+}
+
+void dropSkipsAhead() {
+    EventSubscription sub("drop", SlowConsumerPolicy::Drop);
+    CHECK(sub.active());
+    publish(2 * kRing + 10);
+    auto events = drain(sub);
+    CHECK(events.size() + sub.stats().dropped == 2 * kRing + 10);
+    CHECK(events.size() <= kRing && events.back().amount == double(2 * kRing + 9));
+    for (size_t i = 1; i < events.size(); ++i) CHECK(events[i].sequence == events[i - 1].sequence + 1);
+}
+
+void spillKeepsEverything() {
+    EventSubscription sub("spill", SlowConsumerPolicy::Spill);
+    publish(3 * kRing);
+    // The spill writer moves the parked events to the subscriber's file in the background
+    for (int i = 0; i < 400 && sub.stats().spilled == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(sub.stats().spilled > 0);
+    size_t files = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("data/feed")) {
+        if (std::filesystem::file_size(entry.path()) > 0) ++files;
+    }
+    CHECK(files == 1);
+    auto events = drain(sub);
+    CHECK(events.size() == 3 * kRing && sub.stats().dropped == 0);
+    for (size_t i = 0; i < events.size(); ++i) CHECK(events[i].amount == double(i));
+}
+
+void blockWaitIsBounded() {
+    EventSubscription sub("block", SlowConsumerPolicy::Block);
+    // A subscriber that never polls costs one bounded wait, then is treated as Drop
+    auto start = std::chrono::steady_clock::now();
+    publish(kRing + 100);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(sub.stats().block_timeouts == 1);
+    CHECK(elapsed < std::chrono::seconds(1));
+    auto events = drain(sub);
+    CHECK(events.size() + sub.stats().dropped == kRing + 100);
+
+    // Once it polls again it is waited for: a live consumer sees the events in order, and any
+    // it lost to a timed-out wait are counted
+    uint64_t droppedBefore = sub.stats().dropped;
+    std::atomic<bool> done{false};
+    std::vector<WalletEvent> received;
+    std::thread consumer([&] {
+        while (!done.load() || sub.poll(received, 512) > 0) sub.poll(received, 512);
+    });
+    publish(4 * kRing);
+    done = true;
+    consumer.join();
+    for (size_t i = 1; i < received.size(); ++i) CHECK(received[i].sequence > received[i - 1].sequence);
+    CHECK(received.size() + (sub.stats().dropped - droppedBefore) == 4 * kRing);
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("event_feed");
+    dropSkipsAhead();
+    spillKeepsEverything();
+    blockWaitIsBounded();
+    return 0;
+}
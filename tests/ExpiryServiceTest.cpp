@@ -0,0 +1,80 @@
+// Point expiry: due lots are debited, a day's schedule is dropped once settled even when a
+// wallet listed on it has since been deleted, and debits spend untracked balance before lots
+#include "TestSupport.h"
+#include "models/Wallet.h"
+#include "services/ExpiryService.h"
+#include "services/WalletService.h"
+#include "storage/ExpirySchedule.h"
+#include "storage/FileManager.h"
+#include "storage/WalletStorage.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+using services::ExpiryService;
+using storage::ExpirySchedule;
+
+namespace {
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void writeWallet(const std::string& id, double balance, int64_t expiresAt, double lot = -1) {
+    models::Wallet wallet(id, "owner_" + id, balance);
+    wallet.lots.push_back(models::PointLot{lot < 0 ? balance : lot, expiresAt - 86400, expiresAt});
+    CHECK(storage::FileManager::writeJson("data/wallets/" + id + ".json", nlohmann::json(wallet)));
+    CHECK(ExpirySchedule::add(expiresAt / 86400, id));
+}
+
+void deletedWalletCountsAsSettled() {
+    int64_t expiresAt = (nowSeconds() / 86400 - 2) * 86400;
+    writeWallet("w_live", 40, expiresAt);
+    writeWallet("w_gone", 25, expiresAt);
+    CHECK(storage::FileManager::removeFile("data/wallets/w_gone.json"));
+
+    auto report = ExpiryService::runDue(2);
+    CHECK(report.days == 1 && report.wallets_checked == 2);
+    CHECK(report.failures == 0 && report.wallets_expired == 1 && report.points_expired == 40);
+    CHECK(storage::WalletStorage::load("w_live")->balance == 0);
+    CHECK(ExpirySchedule::dueDays(nowSeconds()).empty());
+}
+
+void unreadableWalletIsRetried() {
+    int64_t expiresAt = (nowSeconds() / 86400 - 1) * 86400;
+    CHECK(ExpirySchedule::add(expiresAt / 86400, "w_bad"));
+    CHECK(storage::FileManager::writeJson("data/wallets/w_bad.json", nlohmann::json::array()));
+
+    auto report = ExpiryService::runDue(1);
+    CHECK(report.failures == 1);
+    CHECK(ExpirySchedule::dueDays(nowSeconds()).size() == 1);
+}
+
+// Balance from before lots existed is the oldest, so it goes before any lot
+void untrackedBalanceSpentFirst() {
+    int64_t expiresAt = (nowSeconds() / 86400 + 30) * 86400;
+    writeWallet("w_legacy", 100, expiresAt, 60);
+    CHECK(services::WalletService::executeTransaction("w_legacy", 30, "debit", "spend"));
+    auto wallet = storage::WalletStorage::load("w_legacy");
+    CHECK(wallet && wallet->balance == 70 && wallet->lots.size() == 1 && wallet->lots[0].amount == 60);
+    CHECK(services::WalletService::executeTransaction("w_legacy", 25, "debit", "spend"));
+    wallet = storage::WalletStorage::load("w_legacy");
+    CHECK(wallet && wallet->balance == 45 && wallet->lots.size() == 1 && wallet->lots[0].amount == 45);
+    CHECK(services::WalletService::executeTransaction("w_legacy", 45, "debit", "spend"));
+    wallet = storage::WalletStorage::load("w_legacy");
+    CHECK(wallet && wallet->balance == 0 && wallet->lots.empty());
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("expiry_service");
+    deletedWalletCountsAsSettled();
+    unreadableWalletIsRetried();
+    untrackedBalanceSpentFirst();
+    return 0;
+}
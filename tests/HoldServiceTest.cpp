@@ -0,0 +1,151 @@
+// Holds: reserve funds without debiting, capture or release exactly once, expire, and bind
+// debits in every process
+#include "TestSupport.h"
+#include "services/HoldService.h"
+#include "services/UserService.h"
+#include "services/WalletService.h"
+#include "storage/HoldStorage.h"
+#include "storage/IdempotencyIndex.h"
+#include "storage/WalletStorage.h"
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using services::HoldService;
+using services::WalletService;
+
+namespace {
+
+double balanceOf(const std::string& walletId) {
+    auto wallet = storage::WalletStorage::load(walletId);
+    CHECK(wallet);
+    return wallet->balance;
+}
+
+void authorizeReservesWithoutDebiting(const std::string& w) {
+    auto txBefore = storage::WalletStorage::load(w)->transaction_ids.size();
+    auto hold = HoldService::authorize(w, 60);
+    CHECK(hold && hold->status == "authorized");
+    CHECK(storage::WalletStorage::load(w)->transaction_ids.size() == txBefore);
+    CHECK(HoldService::held(w) == 60);
+    // Neither a second hold nor a debit may spend the held points
+    CHECK(!HoldService::authorize(w, 50));
+    CHECK(!WalletService::executeTransaction(w, 50, "debit", "x"));
+    CHECK(WalletService::executeTransaction(w, 40, "debit", "x"));
+
+    auto captured = HoldService::capture(hold->hold_id, 40, "order");
+    CHECK(captured && captured->status == "captured" && captured->captured == 40);
+    CHECK(HoldService::held(w) == 0 && balanceOf(w) == 20);
+    // A repeated capture returns the first result without debiting again
+    auto again = HoldService::capture(hold->hold_id, 40, "order");
+    CHECK(again && again->transaction_id == captured->transaction_id);
+    CHECK(balanceOf(w) == 20);
+    CHECK(!HoldService::release(hold->hold_id));
+}
+
+void releaseAndExpiry(const std::string& w) {
+    auto released = HoldService::authorize(w, 20);
+    CHECK(released);
+    CHECK(HoldService::release(released->hold_id)->status == "released");
+    CHECK(HoldService::release(released->hold_id));
+    CHECK(!HoldService::capture(released->hold_id, 0, "x"));
+
+    auto expiring = HoldService::authorize(w, 20, models::kDefaultAsset, 1);
+    CHECK(expiring);
+    CHECK(HoldService::expireDue(expiring->expires_at) == 1);
+    CHECK(HoldService::get(expiring->hold_id)->status == "expired" && HoldService::held(w) == 0);
+    CHECK(!HoldService::capture(expiring->hold_id, 0, "x"));
+    // Settled holds are forgotten after the retention period
+    HoldService::expireDue(expiring->expires_at + HoldService::kRetainSeconds);
+    CHECK(!HoldService::get(expiring->hold_id));
+
+    auto small = HoldService::authorize(w, 10);
+    CHECK(!HoldService::capture(small->hold_id, 11, "over"));
+    CHECK(HoldService::get(small->hold_id)->status == "authorized" && HoldService::held(w) == 10);
+    HoldService::release(small->hold_id);
+}
+
+void concurrentHoldsNeverExceedBalance(const std::string& w) {
+    CHECK(WalletService::executeTransaction(w, 80, "credit", "top up"));
+    CHECK(balanceOf(w) == 100);
+    std::atomic<int> granted{0};
+    std::vector<std::string> ids[4];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 20; ++i) {
+                if (auto hold = HoldService::authorize(w, 3)) {
+                    ++granted;
+                    ids[t].push_back(hold->hold_id);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK(granted == 33 && HoldService::held(w) == 99);
+    threads.clear();
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (const auto& id : ids[t]) CHECK(HoldService::capture(id, 0, "c"));
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK(balanceOf(w) == 1 && HoldService::held(w) == 0);
+}
+
+void holdsBindOtherProcesses(const std::string& w, const std::string& dir) {
+    CHECK(WalletService::executeTransaction(w, 99, "credit", "top up"));
+    auto hold = HoldService::authorize(w, 70);
+    CHECK(hold);
+    // Holds live on disk with the wallet, so a debit from another process sees them
+    CHECK(test_support::runSelf({"debit", dir, w, "40"}) == 1);
+    CHECK(test_support::runSelf({"debit", dir, w, "30"}) == 0);
+    CHECK(balanceOf(w) == 70);
+    CHECK(HoldService::capture(hold->hold_id, 0, "c"));
+    CHECK(balanceOf(w) == 0);
+}
+
+void interruptedCaptureSettlesWithoutSecondDebit(const std::string& w) {
+    CHECK(WalletService::executeTransaction(w, 30, "credit", "top up"));
+    auto hold = HoldService::authorize(w, 5);
+    CHECK(hold);
+    // The debit landed but the process died before marking the hold captured
+    std::string txId = storage::IdempotencyIndex::digest(w + ":hold:" + hold->hold_id);
+    CHECK(WalletService::executeTransactionWithId(w, txId, 5, "debit", "d"));
+    auto holds = *storage::HoldStorage::load(w);
+    for (auto& h : holds) {
+        if (h.hold_id != hold->hold_id) continue;
+        h.status = "capturing";
+        h.transaction_id = txId;
+        h.captured = 5;
+    }
+    CHECK(storage::HoldStorage::save(w, holds));
+    HoldService::expireDue(hold->expires_at - 1);
+    CHECK(HoldService::get(hold->hold_id)->status == "captured");
+    CHECK(balanceOf(w) == 25);
+    CHECK(!HoldService::get("../../x-y") && !HoldService::get("nodash"));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 5 && std::string(argv[1]) == "debit") {
+        std::filesystem::current_path(argv[2]);
+        return WalletService::executeTransaction(argv[3], std::stod(argv[4]), "debit", "d") ? 0 : 1;
+    }
+    test_support::ScratchDir scratch("holds");
+    CHECK(services::UserService::registerUser("alice", "pw123456", "alice@example.com"));
+    auto w = WalletService::createWallet("alice");
+    CHECK(w);
+    CHECK(WalletService::executeTransaction(*w, 100, "credit", "p"));
+
+    authorizeReservesWithoutDebiting(*w);
+    releaseAndExpiry(*w);
+    concurrentHoldsNeverExceedBalance(*w);
+    holdsBindOtherProcesses(*w, scratch.path());
+    interruptedCaptureSettlesWithoutSecondDebit(*w);
+    return 0;
+}
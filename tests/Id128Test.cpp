@@ -0,0 +1,66 @@
+// Binary ids: canonical and legacy ids round-trip, and lookups and archive reads do not
+// intern legacy ids
+#include "TestSupport.h"
+#include "models/Id128.h"
+#include "models/Transaction.h"
+#include "storage/TransactionArchive.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using models::Id128;
+
+namespace {
+
+void roundTrips() {
+    Id128 generated = Id128::generate();
+    std::string text = generated.toString();
+    CHECK(text.size() == 32 && generated.canonical());
+    CHECK(Id128::parse(text) == generated && Id128::parseCanonical(text) == generated);
+
+    size_t before = Id128::internedCount();
+    Id128 legacy = Id128::parse("3f9a1c0e55d8b2");
+    CHECK(!legacy.canonical() && legacy.toString() == "3f9a1c0e55d8b2");
+    CHECK(Id128::parse("3f9a1c0e55d8b2") == legacy);
+    CHECK(Id128::internedCount() == before + 1);
+    // Upper case is not canonical: it would not round-trip through the binary form
+    CHECK(!Id128::parseCanonical("ABCDEF0123456789ABCDEF0123456789"));
+
+    std::unordered_set<Id128> ids{generated, legacy};
+    CHECK(ids.count(Id128::parse(text)) == 1 && ids.size() == 2);
+}
+
+void lookupsDoNotIntern() {
+    size_t before = Id128::internedCount();
+    CHECK(!Id128::find("never-seen-before"));
+    CHECK(!Id128::parseCanonical("never-seen-before"));
+    CHECK(Id128::internedCount() == before);
+    CHECK(Id128::find("3f9a1c0e55d8b2"));
+}
+
+void archiveKeepsLegacyIdsOut() {
+    std::vector<models::Transaction> transactions;
+    std::string canonical = Id128::generate().toString();
+    transactions.emplace_back(canonical, "w1", 5, "1700000000", "credit", "new");
+    transactions.emplace_back("abc123legacy", "w1", 7, "1700000001", "credit", "old");
+    CHECK(storage::TransactionArchive::writeSegment(transactions));
+
+    size_t before = Id128::internedCount();
+    CHECK(storage::TransactionArchive::stats().records == 2);
+    auto legacy = storage::TransactionArchive::load("abc123legacy");
+    CHECK(legacy && legacy->amount == 7);
+    CHECK(storage::TransactionArchive::contains(canonical));
+    CHECK(!storage::TransactionArchive::contains("abc123missing"));
+    CHECK(Id128::internedCount() == before);
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("id128");
+    roundTrips();
+    lookupsDoNotIntern();
+    archiveKeepsLegacyIdsOut();
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Idempotency keys: one reservation per key across threads, duplicates and conflicts told
+// apart, abandoned and crash-torn keys reusable, expired days swept off the request path
+#include "TestSupport.h"
+#include "storage/IdempotencyIndex.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using storage::IdempotencyIndex;
+using Status = IdempotencyIndex::Status;
+
+namespace {
+
+void reserveCompleteDuplicate() {
+    auto claim = IdempotencyIndex::reserve("order-1", "w1", "credit|5");
+    CHECK(claim.status == Status::Reserved);
+    // Still running: a second request with the key must not execute
+    CHECK(IdempotencyIndex::reserve("order-1", "w1", "credit|5").status == Status::InProgress);
+    CHECK(!IdempotencyIndex::lookup("order-1"));
+    CHECK(IdempotencyIndex::complete("order-1", {"w1", "tx-1", "credit|5"}));
+
+    auto again = IdempotencyIndex::reserve("order-1", "w1", "credit|5");
+    CHECK(again.status == Status::Duplicate && again.entry.transaction_id == "tx-1");
+    auto other = IdempotencyIndex::reserve("order-1", "w1", "credit|6");
+    CHECK(other.status == Status::Conflict);
+    auto found = IdempotencyIndex::lookup("order-1");
+    CHECK(found && found->wallet_id == "w1" && found->transaction_id == "tx-1");
+}
+
+void abandonedKeyIsReusable() {
+    CHECK(IdempotencyIndex::reserve("order-2", "w1", "debit|3").status == Status::Reserved);
+    IdempotencyIndex::abandon("order-2");
+    CHECK(IdempotencyIndex::reserve("order-2", "w1", "debit|3").status == Status::Reserved);
+    CHECK(IdempotencyIndex::complete("order-2", {"w1", "tx-2", "debit|3"}));
+    // Abandoning a completed key changes nothing
+    IdempotencyIndex::abandon("order-2");
+    CHECK(IdempotencyIndex::lookup("order-2"));
+}
+
+void oneWinnerAmongConcurrentRequests() {
+    std::atomic<int> reserved{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            if (IdempotencyIndex::reserve("order-3", "w2", "credit|1").status == Status::Reserved) ++reserved;
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK(reserved == 1);
+}
+
+int64_t today() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() / 86400;
+}
+
+// Runs first: the first reserve of the day starts the sweep
+void expiredDaysSweptInBackground() {
+    std::string old = "data/idempotency/" + std::to_string(today() - 5);
+    fs::create_directories(old + "/ab");
+    std::ofstream(old + "/ab/abcd.json") << "{}";
+    CHECK(IdempotencyIndex::reserve("order-0", "w1", "credit|1").status == Status::Reserved);
+    for (int i = 0; i < 500 && fs::exists(old); ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(!fs::exists(old));
+    CHECK(fs::exists("data/idempotency/" + std::to_string(today())));
+}
+
+// A reservation file created but never filled, as a crash between the two leaves it
+void tornReservationTimesOut() {
+    std::string d = IdempotencyIndex::digest("order-4");
+    std::string path = "data/idempotency/" + std::to_string(today()) + "/" + d.substr(0, 2) + "/" + d + ".json";
+    fs::create_directories(fs::path(path).parent_path());
+    std::ofstream(path).close();
+    CHECK(IdempotencyIndex::reserve("order-4", "w1", "credit|2").status == Status::InProgress);
+
+    fs::last_write_time(path, fs::file_time_type::clock::now() -
+                                  std::chrono::seconds(IdempotencyIndex::kPendingTimeoutSeconds + 5));
+    auto claim = IdempotencyIndex::reserve("order-4", "w1", "credit|2");
+    CHECK(claim.status == Status::Reserved && claim.entry.wallet_id == "w1");
+    CHECK(IdempotencyIndex::complete("order-4", {"w1", "tx-4", "credit|2"}));
+    CHECK(IdempotencyIndex::reserve("order-4", "w1", "credit|2").status == Status::Duplicate);
+}
+
+void digestIsStable() {
+    CHECK(IdempotencyIndex::digest("order-1") == IdempotencyIndex::digest("order-1"));
+    CHECK(IdempotencyIndex::digest("order-1") != IdempotencyIndex::digest("order-2"));
+    CHECK(IdempotencyIndex::digest("order-1").size() == 32);
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("idempotency");
+    expiredDaysSweptInBackground();
+    reserveCompleteDuplicate();
+    abandonedKeyIsReusable();
+    oneWinnerAmongConcurrentRequests();
+    tornReservationTimesOut();
+    digestIsStable();
+    return 0;
+}
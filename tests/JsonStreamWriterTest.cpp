@@ -0,0 +1,93 @@
+// Streamed JSON: the writer's output matches nlohmann::json::dump() byte for byte, including
+// the notation of doubles at both ends of the plain range
+#include "TestSupport.h"
+#include "api/JsonStreamWriter.h"
+#include "api/ResponseSink.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using api::JsonStreamWriter;
+
+namespace {
+
+// Collects everything written, in chunks small enough that values straddle them
+struct StringSink : api::ChunkedBufferSink {
+    std::string out;
+    StringSink() : api::ChunkedBufferSink([this](const char* data, size_t size) {
+        out.append(data, size);
+        return true;
+    }, 16) {}
+};
+
+void doublesMatchDump() {
+    const std::vector<double> values = {
+        0.0, -0.0, 1.0, -2.5, 12.25, 0.1, 1.0 / 3, 0.001, 0.0001, 0.00001, 1.5e-7,
+        100.0, 123456789012345.0, 1e15, 1e16, 1.2345678901234568e+17, 1e21,
+        5e-324, std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+    for (double value : values) {
+        StringSink sink;
+        JsonStreamWriter writer(sink);
+        writer.value(value);
+        sink.flush();
+        CHECK(sink.out == nlohmann::json(value).dump());
+    }
+
+    StringSink sink;
+    JsonStreamWriter writer(sink);
+    writer.beginArray();
+    for (double value : values) writer.value(value);
+    writer.endArray();
+    sink.flush();
+    CHECK(sink.out == nlohmann::json(values).dump());
+}
+
+void documentsMatchDump() {
+    nlohmann::json expected = {
+        {"name", "quote \" backslash \\ tab \t newline \n bell \x07"},
+        {"amount", 0.0001},
+        {"count", 42},
+        {"ok", true},
+        {"missing", nullptr},
+        {"nested", {{"values", {1.5, 2.0, 1e-5}}, {"empty", nlohmann::json::array()}}}};
+    StringSink sink;
+    JsonStreamWriter writer(sink);
+    // Keys in the order dump() sorts them
+    writer.beginObject();
+    writer.key("amount");
+    writer.value(0.0001);
+    writer.key("count");
+    writer.value(42LL);
+    writer.key("missing");
+    writer.null();
+    writer.key("name");
+    writer.value(expected["name"].get<std::string>());
+    writer.key("nested");
+    writer.beginObject();
+    writer.key("empty");
+    writer.beginArray();
+    writer.endArray();
+    writer.key("values");
+    writer.beginArray();
+    writer.value(1.5);
+    writer.value(2.0);
+    writer.value(1e-5);
+    writer.endArray();
+    writer.endObject();
+    writer.key("ok");
+    writer.value(true);
+    writer.endObject();
+    sink.flush();
+    CHECK(sink.out == expected.dump());
+}
+
+} // namespace
+
+int main() {
+    doublesMatchDump();
+    documentsMatchDump();
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Leaderboard: built on first use, kept current by balance changes, and deleted users leave it
+#include "TestSupport.h"
+#include "services/Leaderboard.h"
+#include "services/UserService.h"
+#include "services/WalletService.h"
+
+#include <string>
+#include <vector>
+
+using services::Leaderboard;
+using services::UserService;
+using services::WalletService;
+
+namespace {
+
+std::vector<std::string> wallets;
+
+void builtOnFirstUse() {
+    for (int i = 0; i < 5; ++i) {
+        std::string name = "user" + std::to_string(i);
+        CHECK(UserService::registerUser(name, "password", name + "@example.com"));
+        auto wallet = WalletService::createWallet(name);
+        CHECK(wallet);
+        CHECK(WalletService::executeTransaction(*wallet, 10.0 * (i + 1), "credit", "seed"));
+        wallets.push_back(*wallet);
+    }
+    // Nothing reads the wallet files for the board until it is asked for
+    CHECK(!Leaderboard::built());
+    Leaderboard::ensureBuilt();
+    CHECK(Leaderboard::built() && Leaderboard::size() == 5);
+    auto top = Leaderboard::top(2);
+    CHECK(top.size() == 2 && top[0].wallet_id == wallets[4] && top[0].rank == 1);
+    CHECK(top[1].owner_username == "user3");
+}
+
+void followsBalanceChanges() {
+    CHECK(WalletService::executeTransaction(wallets[0], 100, "credit", "bonus"));
+    auto first = Leaderboard::rankOf(wallets[0]);
+    CHECK(first && first->rank == 1 && first->balance == 110);
+    CHECK(Leaderboard::top(1, 4)[0].wallet_id == wallets[1]);
+}
+
+void deletedUserLeavesBoard() {
+    CHECK(UserService::deleteUser("user0"));
+    CHECK(!Leaderboard::rankOf(wallets[0]));
+    CHECK(Leaderboard::size() == 4);
+    // A rebuild from the files leaves the orphaned wallet out too
+    CHECK(Leaderboard::rebuild(2));
+    CHECK(!Leaderboard::rankOf(wallets[0]) && Leaderboard::size() == 4);
+    CHECK(Leaderboard::top(1)[0].wallet_id == wallets[4]);
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("leaderboard");
+    builtOnFirstUse();
+    followsBalanceChanges();
+    deletedUserLeavesBoard();
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Rate limiter: bursts and refills per key, and a flood of new keys cannot reset an active one
+#include "TestSupport.h"
+#include "auth/RateLimiter.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void burstThenReject() {
+    auth::RateLimiter limiter(3, 0.001);
+    CHECK(limiter.tryAcquire("alice"));
+    CHECK(limiter.tryAcquire("alice"));
+    CHECK(limiter.tryAcquire("alice"));
+    CHECK(!limiter.tryAcquire("alice"));
+    // Keys have separate buckets
+    CHECK(limiter.tryAcquire("bob"));
+    auto stats = limiter.stats();
+    CHECK(stats.allowed == 4 && stats.rejected == 1);
+}
+
+void refillsOverTime() {
+    auth::RateLimiter limiter(1, 50);
+    CHECK(limiter.tryAcquire("k"));
+    CHECK(!limiter.tryAcquire("k"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    CHECK(limiter.tryAcquire("k"));
+}
+
+void floodDoesNotEvictActiveKey() {
+    // A tiny table with a slow refill, so every flooding key stays active
+    auth::RateLimiter limiter(2, 0.001, 1);
+    CHECK(limiter.tryAcquire("victim"));
+    CHECK(limiter.tryAcquire("victim"));
+    CHECK(!limiter.tryAcquire("victim"));
+    for (int i = 0; i < 20000; ++i) limiter.tryAcquire("k" + std::to_string(i));
+    CHECK(!limiter.tryAcquire("victim"));
+    auto stats = limiter.stats();
+    CHECK(stats.evicted == 0 && stats.overflowed > 0);
+}
+
+void concurrentCallersShareOneBudget() {
+    auth::RateLimiter limiter(100, 0.001);
+    std::atomic<int> granted{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 100; ++i) {
+                if (limiter.tryAcquire("shared")) ++granted;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK(granted == 100);
+}
+
+} // namespace
+
+int main() {
+    burstThenReject();
+    refillsOverTime();
+    floodDoesNotEvictActiveKey();
+    concurrentCallersShareOneBudget();
+    return 0;
+}
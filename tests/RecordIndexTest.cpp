@@ -0,0 +1,159 @@
+// Record index start-up: a snapshot reloads exactly what was saved, is caught up from the change
+// log past its saved offset, and is rejected for a rebuild when it is corrupt or the
+// transaction directory changed without a log entry
+#include "TestSupport.h"
+#include "models/Id128.h"
+#include "storage/ChangeLog.h"
+#include "storage/FileManager.h"
+#include "storage/RecordIndex.h"
+#include "storage/TransactionStorage.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+using storage::RecordIndex;
+
+namespace {
+
+constexpr int64_t kAll = std::numeric_limits<int64_t>::max();
+// Fixed snapshot header: magic, version, crc, then six 8-byte fields
+constexpr size_t kHeaderBytes = 8 + 4 + 4 + 6 * 8;
+
+models::Id128 walletId = models::Id128::generate();
+
+std::string saveTransaction(int64_t timestamp) {
+    models::Transaction tx(models::Id128::generate().toString(), walletId.toString(), 5, std::to_string(timestamp),
+                           "credit");
+    CHECK(storage::TransactionStorage::save(tx));
+    return tx.transaction_id;
+}
+
+// Every indexed transaction as "<timestamp> <id>", oldest first
+std::vector<std::string> ordered() {
+    std::vector<std::string> out;
+    for (const auto& pos : RecordIndex::transactionsBefore(kAll, std::nullopt, SIZE_MAX)) {
+        out.push_back(std::to_string(pos.timestamp) + " " + pos.id);
+    }
+    return out;
+}
+
+void flipByte(const std::string& path, uint64_t offset) {
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekg(static_cast<std::streamoff>(offset));
+    char c = 0;
+    f.read(&c, 1);
+    c = static_cast<char>(c ^ 0x5a);
+    f.seekp(static_cast<std::streamoff>(offset));
+    f.write(&c, 1);
+}
+
+void rebuildsThenReloadsSnapshot() {
+    for (int i = 0; i < 50; ++i) saveTransaction(1000 + (i * 37) % 50);
+    CHECK(RecordIndex::load(3));
+    auto st = RecordIndex::status();
+    CHECK(st.source == "rebuild" && st.rebuild_reason == "no snapshot");
+    CHECK(st.transactions == 50);
+    CHECK(fs::exists(RecordIndex::kSnapshotPath));
+    auto before = ordered();
+    CHECK(before.size() == 50);
+
+    CHECK(RecordIndex::load(3));
+    st = RecordIndex::status();
+    CHECK(st.source == "snapshot" && st.rebuild_reason.empty());
+    CHECK(st.replayed_changes == 0 && st.transactions == 50 && st.snapshot_ms > 0);
+    CHECK(ordered() == before);
+}
+
+void replaysChangesPastSnapshot() {
+    std::vector<std::string> added;
+    for (int i = 0; i < 10; ++i) added.push_back(saveTransaction(2000 + i));
+    CHECK(storage::FileManager::removeFile("data/transactions/" + added[3] + ".json"));
+    CHECK(storage::FileManager::removeFile("data/transactions/" + added[7] + ".json"));
+    // Not counted: only transactions are indexed
+    CHECK(storage::FileManager::writeJson("data/users/someone.json", nlohmann::json{{"username", "someone"}}));
+    auto live = ordered();
+    CHECK(live.size() == 58);
+
+    // Only the entries past the snapshot's offset are replayed, not the 50 before it
+    CHECK(RecordIndex::load(3));
+    auto st = RecordIndex::status();
+    CHECK(st.source == "snapshot");
+    CHECK(st.replayed_changes == 12);
+    CHECK(st.transactions == 58);
+    CHECK(ordered() == live);
+
+    // The replay was saved, so the next load replays nothing
+    CHECK(RecordIndex::load(3));
+    CHECK(RecordIndex::status().source == "snapshot" && RecordIndex::status().replayed_changes == 0);
+}
+
+void rejectsCorruptSnapshots() {
+    auto expected = ordered();
+    struct Case {
+        uint64_t offset;
+        const char* reason;
+    };
+    for (Case c : {Case{0, "unknown snapshot format"}, Case{8, "unknown snapshot format"},
+                   Case{kHeaderBytes + 5, "snapshot checksum mismatch"}}) {
+        flipByte(RecordIndex::kSnapshotPath, c.offset);
+        CHECK(RecordIndex::load(3));
+        auto st = RecordIndex::status();
+        CHECK(st.source == "rebuild" && st.rebuild_reason == c.reason);
+        CHECK(ordered() == expected);
+    }
+    fs::resize_file(RecordIndex::kSnapshotPath, kHeaderBytes - 1);
+    CHECK(RecordIndex::load(3));
+    CHECK(RecordIndex::status().rebuild_reason == "truncated snapshot");
+    CHECK(ordered() == expected);
+    // Every rebuild left a good snapshot behind
+    CHECK(RecordIndex::load(3));
+    CHECK(RecordIndex::status().source == "snapshot");
+}
+
+// Writes without the change log, as a process running without it would
+int writeUnlogged(const std::string& what) {
+    if (what == "user") {
+        return storage::FileManager::writeJson("data/users/unlogged.json", nlohmann::json{{"username", "unlogged"}}) ? 0 : 1;
+    }
+    saveTransaction(3000);
+    return 0;
+}
+
+void rebuildsAfterUnloggedWrites(const std::string& scratch) {
+    // Other directories may change freely
+    CHECK(test_support::runSelf({"unlogged", scratch, "user"}) == 0);
+    CHECK(RecordIndex::load(3));
+    CHECK(RecordIndex::status().source == "snapshot");
+
+    auto count = RecordIndex::status().transactions;
+    CHECK(test_support::runSelf({"unlogged", scratch, "transaction"}) == 0);
+    CHECK(RecordIndex::load(3));
+    auto st = RecordIndex::status();
+    CHECK(st.source == "rebuild");
+    CHECK(st.rebuild_reason == "data/transactions changed after the last logged change");
+    CHECK(st.transactions == count + 1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 3 && std::string(argv[1]) == "unlogged") {
+        fs::current_path(argv[2]);
+        return writeUnlogged(argv[3]);
+    }
+    test_support::ScratchDir scratch("record_index");
+    CHECK(storage::ChangeLog::enable());
+    rebuildsThenReloadsSnapshot();
+    replaysChangesPastSnapshot();
+    rejectsCorruptSnapshots();
+    rebuildsAfterUnloggedWrites(scratch.path());
+    storage::ChangeLog::disable();
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Resource usage: work a request hands to worker threads is charged to it once joined
+#include "TestSupport.h"
+#include "models/Wallet.h"
+#include "services/Leaderboard.h"
+#include "storage/FileManager.h"
+#include "storage/ResourceUsage.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using storage::UsageScope;
+using storage::UsageShare;
+
+namespace {
+
+void tasksChargedOnJoin() {
+    UsageScope request;
+    UsageShare share;
+    std::vector<std::thread> tasks;
+    for (int t = 0; t < 4; ++t) {
+        tasks.emplace_back([&] {
+            UsageScope scope(share);
+            for (int i = 0; i < 10; ++i) UsageScope::fileOpened();
+            UsageScope::bytesRead(100);
+        });
+    }
+    for (auto& t : tasks) t.join();
+    CHECK(request.totals().files_opened == 0);
+    share.join();
+    CHECK(request.totals().files_opened == 40 && request.totals().bytes_read == 400);
+
+    // A task that finishes after the join is not charged
+    std::thread([&] {
+        UsageScope scope(share);
+        UsageScope::fileOpened();
+    }).join();
+    share.join();
+    CHECK(request.totals().files_opened == 40);
+}
+
+void inlineTaskJoinsOpenScope() {
+    UsageScope request;
+    UsageShare share;
+    {
+        UsageScope scope(share);
+        UsageScope::renamed();
+    }
+    // Counted directly, not once more on join
+    CHECK(request.totals().renames == 1);
+    share.join();
+    CHECK(request.totals().renames == 1);
+}
+
+void noRequestNoCharge() {
+    UsageShare share;
+    std::thread([&] {
+        UsageScope scope(share);
+        UsageScope::fileOpened();
+    }).join();
+    share.join();
+    UsageScope request;
+    CHECK(request.totals().files_opened == 0);
+}
+
+void leaderboardRebuildCharged() {
+    const int wallets = 24;
+    for (int i = 0; i < wallets; ++i) {
+        std::string n = std::to_string(i);
+        models::Wallet wallet("w" + n, "u" + n, i);
+        CHECK(storage::FileManager::writeJson("data/wallets/w" + n + ".json", nlohmann::json(wallet)));
+        CHECK(storage::FileManager::writeJson("data/users/u" + n + ".json", nlohmann::json{{"username", "u" + n}}));
+    }
+    UsageScope request;
+    CHECK(services::Leaderboard::rebuild(4));
+    CHECK(services::Leaderboard::size() == static_cast<size_t>(wallets));
+    CHECK(request.totals().files_opened >= static_cast<uint64_t>(wallets));
+    CHECK(request.totals().bytes_read > 0);
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("resource_usage");
+    tasksChargedOnJoin();
+    inlineTaskJoinsOpenScope();
+    noRequestNoCharge();
+    leaderboardRebuildCharged();
+    return 0;
+}
@@ -0,0 +1,190 @@
+// SAX model reader: every document parses to exactly what the models' from_json produce, and
+// is rejected exactly when from_json throws
+#include "TestSupport.h"
+#include "storage/SaxModelReader.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using storage::SaxModelReader;
+
+namespace {
+
+// Parses text both ways and compares the outcome and, when both accept it, every field
+template <typename Model>
+bool sameAsFromJson(const std::string& text) {
+    bool domOk = true;
+    Model dom;
+    try {
+        nlohmann::json::parse(text).get_to(dom);
+    } catch (const nlohmann::json::exception&) {
+        domOk = false;
+    }
+    Model sax;
+    bool saxOk = SaxModelReader::parse(text, sax);
+    if (domOk != saxOk) {
+        std::fprintf(stderr, "from_json %s, SaxModelReader %s: %s\n", domOk ? "accepts" : "rejects",
+                     saxOk ? "accepts" : "rejects", text.c_str());
+        return false;
+    }
+    if (!domOk) return true;
+    nlohmann::json a = dom, b = sax;
+    if (a != b) {
+        std::fprintf(stderr, "from_json %s, SaxModelReader %s\n", a.dump().c_str(), b.dump().c_str());
+        return false;
+    }
+    return true;
+}
+
+// Applies edit to a copy of base, the document edited back to text
+template <typename Model, typename Edit>
+bool sameAfter(const nlohmann::json& base, Edit edit) {
+    nlohmann::json doc = base;
+    edit(doc);
+    return sameAsFromJson<Model>(doc.dump());
+}
+
+// Every required field removed in turn, and replaced with each other JSON type
+template <typename Model>
+void requiredFields(const nlohmann::json& base, const std::vector<std::string>& required) {
+    const std::vector<nlohmann::json> others{nullptr, true, 7, -7, 2.5, "text", nlohmann::json::array(),
+                                             nlohmann::json::array({"a"}), nlohmann::json::object({{"k", 1}})};
+    for (const auto& key : required) {
+        CHECK((sameAfter<Model>(base, [&](nlohmann::json& j) { j.erase(key); })));
+        for (const auto& value : others) CHECK((sameAfter<Model>(base, [&](nlohmann::json& j) { j[key] = value; })));
+    }
+}
+
+// Fields outside the model, nested any way, and documents that are not objects at all
+template <typename Model>
+void unknownAndMalformed(const nlohmann::json& base) {
+    const std::vector<nlohmann::json> nested{
+        nullptr, nlohmann::json::object({{"a", {1, {{"b", nlohmann::json::array({nlohmann::json::object()})}}}}}),
+        nlohmann::json::array({nlohmann::json::array({1, 2}), nlohmann::json::object({{"x", "y"}})}), 3.25, "s"};
+    for (const auto& value : nested) {
+        CHECK((sameAfter<Model>(base, [&](nlohmann::json& j) { j["zz_unknown"] = value; })));
+        CHECK((sameAfter<Model>(base, [&](nlohmann::json& j) { j["aa_unknown"] = value; })));
+    }
+    std::string text = base.dump();
+    for (const std::string& bad : {std::string("[]"), std::string("null"), std::string("\"x\""), std::string("{}"),
+                                   text + "x", text.substr(0, text.size() - 1), std::string("")}) {
+        CHECK(sameAsFromJson<Model>(bad));
+    }
+}
+
+// Escapes, surrogate pairs and raw UTF-8, written by hand since dump() would normalize them
+const std::vector<std::string> kEscaped{
+    R"("a\"b\\c\/d")", R"("tab\tnew\nline\r\bback\f")", R"("é中😀")", "\"caf\xc3\xa9\"",
+    R"("\u0000nul")", R"("")"};
+
+void users() {
+    nlohmann::json base = {{"username", "ana"}, {"password_hash", "$argon2$x"}, {"email", "ana@example.com"},
+                           {"is_admin", false}, {"wallet_id", "0123456789abcdef0123456789abcdef"}};
+    CHECK(sameAsFromJson<models::UserAccount>(base.dump()));
+    requiredFields<models::UserAccount>(base, {"username", "password_hash", "email", "is_admin"});
+    CHECK((sameAfter<models::UserAccount>(base, [](nlohmann::json& j) { j.erase("wallet_id"); })));
+    CHECK((sameAfter<models::UserAccount>(base, [](nlohmann::json& j) { j["wallet_id"] = nullptr; })));
+    CHECK((sameAfter<models::UserAccount>(base, [](nlohmann::json& j) { j["wallet_id"] = 5; })));
+    CHECK((sameAfter<models::UserAccount>(base, [](nlohmann::json& j) { j["is_admin"] = true; })));
+    unknownAndMalformed<models::UserAccount>(base);
+    for (const auto& s : kEscaped) {
+        CHECK(sameAsFromJson<models::UserAccount>(
+            R"({"username":)" + s + R"(,"password_hash":"h","email":)" + s + R"(,"is_admin":true})"));
+    }
+}
+
+void wallets() {
+    nlohmann::json base = {{"wallet_id", "0123456789abcdef0123456789abcdef"},
+                           {"owner_username", "ana"},
+                           {"balance", 120.5},
+                           {"transaction_ids", {"fedcba9876543210fedcba9876543210", "legacy-1"}},
+                           {"lots", {50, 1700000000, 1731536000, 70.5, 1700086400, 1731622400}},
+                           {"asset_codes", {"gold", "miles"}},
+                           {"asset_balances", {3, 0.25}}};
+    CHECK(sameAsFromJson<models::Wallet>(base.dump()));
+    requiredFields<models::Wallet>(base, {"wallet_id", "owner_username", "balance", "transaction_ids"});
+
+    // Lots: flat triples of numbers, whole seconds truncated
+    for (const nlohmann::json& lots :
+         {nlohmann::json::array(), nlohmann::json{1, 2}, nlohmann::json{1, 2, 3, 4}, nlohmann::json{1.5, 2.9, -3.9},
+          nlohmann::json{1, "2", 3}, nlohmann::json{1, nullptr, 3}, nlohmann::json{1, true, 3},
+          nlohmann::json{1, {2}, 3}, nlohmann::json{{1, 2, 3}}, nlohmann::json::object(), nlohmann::json(5)}) {
+        CHECK((sameAfter<models::Wallet>(base, [&](nlohmann::json& j) { j["lots"] = lots; })));
+    }
+    CHECK((sameAfter<models::Wallet>(base, [](nlohmann::json& j) { j.erase("lots"); })));
+
+    // Asset columns: parallel arrays, both or neither
+    const std::vector<nlohmann::json> codes{nlohmann::json::array(), nlohmann::json{"gold"},
+                                            nlohmann::json{"gold", "miles"}, nlohmann::json{1}, nlohmann::json{nullptr},
+                                            nlohmann::json("gold"), nlohmann::json{{"gold"}}};
+    const std::vector<nlohmann::json> balances{nlohmann::json::array(), nlohmann::json{1},
+                                               nlohmann::json{1, 2.5}, nlohmann::json{"1"}, nlohmann::json{true},
+                                               nlohmann::json(1), nlohmann::json{{1}}};
+    for (const auto& c : codes) {
+        for (const auto& b : balances) {
+            CHECK((sameAfter<models::Wallet>(base, [&](nlohmann::json& j) { j["asset_codes"] = c; j["asset_balances"] = b; })));
+        }
+        CHECK((sameAfter<models::Wallet>(base, [&](nlohmann::json& j) { j["asset_codes"] = c; j.erase("asset_balances"); })));
+    }
+    for (const auto& b : balances) {
+        CHECK((sameAfter<models::Wallet>(base, [&](nlohmann::json& j) { j.erase("asset_codes"); j["asset_balances"] = b; })));
+    }
+
+    // Transaction ids: strings only, canonical or legacy
+    for (const nlohmann::json& ids : {nlohmann::json::array(), nlohmann::json{"x"}, nlohmann::json{1},
+                                      nlohmann::json{nullptr}, nlohmann::json{{"a"}}, nlohmann::json{{{"a", 1}}}}) {
+        CHECK((sameAfter<models::Wallet>(base, [&](nlohmann::json& j) { j["transaction_ids"] = ids; })));
+    }
+    for (const nlohmann::json& balance : {nlohmann::json(0), nlohmann::json(-3), nlohmann::json(18446744073709551615ULL),
+                                          nlohmann::json(1e300), nlohmann::json(true)}) {
+        CHECK((sameAfter<models::Wallet>(base, [&](nlohmann::json& j) { j["balance"] = balance; })));
+    }
+    unknownAndMalformed<models::Wallet>(base);
+    for (const auto& s : kEscaped) {
+        CHECK(sameAsFromJson<models::Wallet>(R"({"wallet_id":"w","owner_username":)" + s +
+                                             R"(,"balance":1,"transaction_ids":[)" + s + R"(],"asset_codes":[)" + s +
+                                             R"(],"asset_balances":[2]})"));
+    }
+    // A repeated key keeps its last value, arrays included
+    CHECK(sameAsFromJson<models::Wallet>(
+        R"({"wallet_id":"a","wallet_id":"b","owner_username":"o","balance":1,"transaction_ids":["x"],"transaction_ids":["y","z"],"lots":[1,2,3],"lots":[4,5,6]})"));
+}
+
+void transactions() {
+    nlohmann::json base = {{"transaction_id", "0123456789abcdef0123456789abcdef"},
+                           {"wallet_id", "fedcba9876543210fedcba9876543210"},
+                           {"amount", 12.75},
+                           {"timestamp", "1700000000"},
+                           {"type", "credit"},
+                           {"description", "Welcome bonus"},
+                           {"idempotency_key", "req-1"},
+                           {"asset", "gold"}};
+    CHECK(sameAsFromJson<models::Transaction>(base.dump()));
+    requiredFields<models::Transaction>(base, {"transaction_id", "wallet_id", "amount", "timestamp", "type", "description"});
+    for (const char* optional : {"idempotency_key", "asset"}) {
+        CHECK((sameAfter<models::Transaction>(base, [&](nlohmann::json& j) { j.erase(optional); })));
+        CHECK((sameAfter<models::Transaction>(base, [&](nlohmann::json& j) { j[optional] = nullptr; })));
+        CHECK((sameAfter<models::Transaction>(base, [&](nlohmann::json& j) { j[optional] = 1; })));
+    }
+    for (const nlohmann::json& amount : {nlohmann::json(0), nlohmann::json(-5), nlohmann::json(0.1),
+                                         nlohmann::json(1.2345678901234568e+17), nlohmann::json(true)}) {
+        CHECK((sameAfter<models::Transaction>(base, [&](nlohmann::json& j) { j["amount"] = amount; })));
+    }
+    unknownAndMalformed<models::Transaction>(base);
+    for (const auto& s : kEscaped) {
+        CHECK(sameAsFromJson<models::Transaction>(R"({"transaction_id":"t","wallet_id":"w","amount":1,"timestamp":"1","type":)" +
+                                                  s + R"(,"description":)" + s + R"(,"idempotency_key":)" + s + "}"));
+    }
+}
+
+} // namespace
+
+int main() {
+    users();
+    wallets();
+    transactions();
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Storage snapshots: reads pinned to one point in time, replaced files kept open instead of
+// read, and taking a snapshot never waits for writes in progress
+#include "TestSupport.h"
+#include "storage/FileManager.h"
+#include "storage/Snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+using storage::FileManager;
+using storage::Snapshot;
+using storage::VersionStore;
+
+namespace {
+
+int valueOf(const std::string& path) {
+    nlohmann::json j;
+    if (!FileManager::readJson(path, j)) return -1;
+    return j["v"].get<int>();
+}
+
+bool listed(const std::string& dir, const std::string& path) {
+    auto records = FileManager::listRecords(dir);
+    return std::find(records.begin(), records.end(), path) != records.end();
+}
+
+void readsAtSnapshotSequence() {
+    CHECK(FileManager::writeJson("data/snap/a.json", nlohmann::json{{"v", 1}}));
+    CHECK(FileManager::writeJson("data/snap/c.json", nlohmann::json{{"v", 1}}));
+    {
+        Snapshot snapshot;
+        CHECK(FileManager::writeJson("data/snap/a.json", nlohmann::json{{"v", 2}}));
+        // The replaced file is pinned, not read, until a snapshot asks for it
+        CHECK(VersionStore::stats().pinned_files == 1);
+        CHECK(FileManager::writeJson("data/snap/a.json", nlohmann::json{{"v", 3}}));
+        CHECK(VersionStore::stats().pinned_files == 1);
+        CHECK(FileManager::writeJson("data/snap/b.json", nlohmann::json{{"v", 1}}));
+        CHECK(FileManager::removeFile("data/snap/c.json"));
+
+        CHECK(valueOf("data/snap/a.json") == 1);
+        CHECK(valueOf("data/snap/b.json") == -1);
+        CHECK(valueOf("data/snap/c.json") == 1);
+        CHECK(listed("data/snap", "data/snap/c.json"));
+        {
+            Snapshot nested;
+            CHECK(nested.sequence() == snapshot.sequence());
+            CHECK(valueOf("data/snap/a.json") == 1);
+        }
+    }
+    CHECK(valueOf("data/snap/a.json") == 3);
+    CHECK(valueOf("data/snap/b.json") == 1);
+    CHECK(!listed("data/snap", "data/snap/c.json"));
+
+    VersionStore::collectGarbage();
+    auto stats = VersionStore::stats();
+    CHECK(stats.active_snapshots == 0 && stats.chains == 0 && stats.pinned_files == 0);
+}
+
+void snapshotDoesNotWaitForWrites() {
+    CHECK(FileManager::writeJson("data/snap/d.json", nlohmann::json{{"v", 1}}));
+    std::string path = FileManager::resolve("data/snap/d.json");
+    // A write begun with no snapshot open, stalled before it replaces the file
+    bool versioned = VersionStore::beginWrite(path);
+    CHECK(!versioned);
+    auto taken = std::async(std::launch::async, [] {
+        Snapshot snapshot;
+        return snapshot.sequence();
+    });
+    CHECK(taken.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    taken.get();
+
+    Snapshot snapshot;
+    CHECK(FileManager::writeJson("data/snap/d.json.tmp", nlohmann::json{{"v", 2}}));
+    std::rename(FileManager::resolve("data/snap/d.json.tmp").c_str(), path.c_str());
+    VersionStore::commit(path, versioned, std::make_shared<std::string>("{\"v\":2}"));
+    // The write was under way when the snapshot was taken, so it reads as before it
+    CHECK(valueOf("data/snap/d.json") == 2);
+    CHECK(FileManager::writeJson("data/snap/d.json", nlohmann::json{{"v", 3}}));
+    CHECK(valueOf("data/snap/d.json") == 2);
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("snapshot");
+    readsAtSnapshotSequence();
+    snapshotDoesNotWaitForWrites();
+    return 0;
+}
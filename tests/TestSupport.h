@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Fails the test with the condition's location; unlike assert it also runs in release builds
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                                 \
+        }                                                                                 \
+    } while (0)
+
+namespace test_support {
+
+// An empty working directory for one test run, entered on construction and removed on
+// destruction; the services resolve data/ against it
+class ScratchDir {
+public:
+    explicit ScratchDir(const std::string& name)
+        : path_(std::filesystem::temp_directory_path() / ("reward_" + name + "_" + std::to_string(::getpid()))) {
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+        std::filesystem::current_path(path_);
+    }
+
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::current_path(path_.parent_path(), ec);
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    std::string path() const { return path_.string(); }
+
+private:
+    std::filesystem::path path_;
+};
+
+// Starts this test executable again as a separate process with the given arguments.
+// Cross-process locking is per open file description, so a forked child would share the
+// parent's locks; exec gives it its own.
+inline pid_t spawnSelf(const std::vector<std::string>& args) {
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        std::vector<char*> argv;
+        static char self[] = "self";
+        argv.push_back(self);
+        for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+        argv.push_back(nullptr);
+        ::execv("/proc/self/exe", argv.data());
+        ::_exit(127);
+    }
+    return pid;
+}
+
+// Exit status of a spawned process, -1 if it did not exit normally
+inline int waitExit(pid_t pid) {
+    int status = 0;
+    if (pid < 0 || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+}
+
+inline int runSelf(const std::vector<std::string>& args) {
+    return waitExit(spawnSelf(args));
+}
+
+} // namespace test_support
@@ -0,0 +1,73 @@
+// Request tracing: a batch is sampled as a whole, its commands never drawing a decision of
+// their own, and every sampled request's spans share its trace id
+#include "TestSupport.h"
+#include "api/ApiRouter.h"
+#include "tracing/Tracer.h"
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using api::ApiRouter;
+
+namespace {
+
+constexpr int kBatches = 400;
+constexpr size_t kCommands = 5;
+
+// The trace file is an open JSON array of events, each followed by ",\n"
+nlohmann::json events(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string body = text.str();
+    while (!body.empty() && (body.back() == '\n' || body.back() == ',')) body.pop_back();
+    if (body == "[") return nlohmann::json::array();
+    return nlohmann::json::parse(body + "]");
+}
+
+} // namespace
+
+int main() {
+    test_support::ScratchDir scratch("tracer");
+    CHECK(ApiRouter::registerUser("tracer", "Password-123", "tracer@example.com").success);
+    auto otp = ApiRouter::initiateLogin("tracer", "Password-123").data["otp"].get<std::string>();
+    std::string token = ApiRouter::completeLogin("tracer", otp).data["token"].get<std::string>();
+    std::string walletId = ApiRouter::createWallet(token).data["walletId"].get<std::string>();
+
+    std::vector<api::ApiCommand> commands(kCommands, api::ApiCommand{api::ApiOp::GetWallet, {{"walletId", walletId}}});
+    CHECK(tracing::Tracer::start("spans.json", 0.25));
+    for (int i = 0; i < kBatches; ++i) CHECK(ApiRouter::dispatch(token, commands).success);
+    tracing::Tracer::stop();
+
+    // Every trace is one dispatch with all of its commands, and only dispatches were drawn
+    std::map<uint64_t, std::multiset<std::string>> traces;
+    for (const auto& e : events("spans.json")) {
+        if (e["cat"] == "api") traces[e["args"]["trace"].get<uint64_t>()].insert(e["name"].get<std::string>());
+    }
+    uint64_t sampled = tracing::Tracer::requestsSampled();
+    CHECK(sampled > 0 && sampled < static_cast<uint64_t>(kBatches));
+    CHECK(traces.size() == sampled);
+    for (const auto& trace : traces) {
+        CHECK(trace.second.count("dispatch") == 1);
+        CHECK(trace.second.count("getWallet") == kCommands);
+    }
+
+    // Outside a batch each call is its own request again
+    CHECK(tracing::Tracer::start("single.json", 1.0));
+    CHECK(ApiRouter::getWallet(token, walletId).success);
+    CHECK(ApiRouter::getWallet(token, walletId).success);
+    tracing::Tracer::stop();
+    CHECK(tracing::Tracer::requestsSampled() == 2);
+    std::set<uint64_t> ids;
+    for (const auto& e : events("single.json")) {
+        if (e["name"] == "getWallet") ids.insert(e["args"]["trace"].get<uint64_t>());
+    }
+    CHECK(ids.size() == 2);
+    return 0;
+}
@@ -0,0 +1,221 @@
+// Cold tier round trip: tiered transactions read back through storage, the wallet history and
+// an index rebuild exactly as written, and a corrupt block or footer loses only what it covers
+#include "TestSupport.h"
+#include "models/Id128.h"
+#include "services/TieringService.h"
+#include "services/WalletService.h"
+#include "storage/FileManager.h"
+#include "storage/RecordIndex.h"
+#include "storage/TransactionArchive.h"
+#include "storage/TransactionStorage.h"
+#include "storage/WalletStorage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using services::TieringService;
+using storage::RecordIndex;
+using storage::TransactionArchive;
+using storage::TransactionStorage;
+
+namespace {
+
+// Enough cold records to fill several 64KB blocks
+constexpr size_t kCold = 3000;
+constexpr size_t kRecent = 5;
+// Archived before the pass, as an interrupted pass leaves them: in a segment, still hot
+constexpr size_t kPreArchived = 100;
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool sameTransaction(const models::Transaction& a, const models::Transaction& b) {
+    return a.transaction_id == b.transaction_id && a.wallet_id == b.wallet_id && a.amount == b.amount &&
+           a.timestamp == b.timestamp && a.type == b.type && a.description == b.description &&
+           a.idempotency_key == b.idempotency_key && a.asset == b.asset;
+}
+
+bool hot(const models::Transaction& tx) {
+    return fs::exists("data/transactions/" + tx.transaction_id + ".json");
+}
+
+// Cold transactions first, in timestamp order, then the recent ones
+std::vector<models::Transaction> seed() {
+    models::Wallet wallet(models::Id128::generate().toString(), "archivist", 0);
+    std::vector<models::Transaction> transactions;
+    int64_t coldStart = nowSeconds() - 200 * 86400;
+    for (size_t i = 0; i < kCold + kRecent; ++i) {
+        int64_t ts = i < kCold ? coldStart + int64_t(i) : nowSeconds() - int64_t(i);
+        models::Transaction tx(models::Id128::generate().toString(), wallet.wallet_id, 1.25 + double(i),
+                               std::to_string(ts), i % 3 ? "credit" : "debit",
+                               "purchase #" + std::to_string(i * 7919) + " \"quoted\" \\ note");
+        if (i % 5 == 0) tx.idempotency_key = "key-" + std::to_string(i);
+        if (i % 4 == 0) tx.asset = "gold";
+        wallet.transaction_ids.push_back(models::Id128::parse(tx.transaction_id));
+        transactions.push_back(std::move(tx));
+    }
+    CHECK(storage::WalletStorage::save(wallet, transactions));
+    return transactions;
+}
+
+void writeExpected(const std::vector<models::Transaction>& transactions) {
+    std::ofstream out("expected.txt");
+    for (const auto& tx : transactions) out << tx.transaction_id << "\n";
+}
+
+std::vector<std::string> readExpected() {
+    std::vector<std::string> ids;
+    std::ifstream in("expected.txt");
+    for (std::string line; std::getline(in, line);) ids.push_back(line);
+    return ids;
+}
+
+std::vector<std::string> segmentsBySize() {
+    std::vector<std::string> paths;
+    for (const auto& entry : fs::directory_iterator("data/archive")) {
+        if (entry.path().extension() == ".seg") paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end(), [](const std::string& a, const std::string& b) {
+        return fs::file_size(a) < fs::file_size(b);
+    });
+    return paths;
+}
+
+void flipByte(const std::string& path, uint64_t offset) {
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekg(static_cast<std::streamoff>(offset));
+    char c = 0;
+    f.read(&c, 1);
+    c = static_cast<char>(c ^ 0x5a);
+    f.seekp(static_cast<std::streamoff>(offset));
+    f.write(&c, 1);
+}
+
+// Offset of the footer, read from the fixed trailer ending the segment
+uint64_t footerOffset(const std::string& path) {
+    // footer_offset, footer_size, footer_crc, version, magic
+    constexpr size_t kTrailerBytes = 8 + 8 + 4 + 4 + 8;
+    std::ifstream f(path, std::ios::binary);
+    f.seekg(-static_cast<std::streamoff>(kTrailerBytes), std::ios::end);
+    uint64_t offset = 0;
+    f.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+    return offset;
+}
+
+void tiersAndReadsBack() {
+    auto transactions = seed();
+    std::vector<models::Transaction> interrupted(transactions.begin(), transactions.begin() + kPreArchived);
+    CHECK(TransactionArchive::writeSegment(interrupted));
+    CHECK(TransactionArchive::contains(transactions[0].transaction_id));
+    CHECK(hot(transactions[0]));
+
+    CHECK(RecordIndex::load(1));
+    auto report = TieringService::runOnce(90);
+    CHECK(report.scanned == kCold);
+    CHECK(report.archived == kCold - kPreArchived);
+    CHECK(report.evicted == kCold);
+    CHECK(report.segments_written == 1);
+    CHECK(report.hot_bytes_reclaimed > 0);
+
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        const auto& tx = transactions[i];
+        CHECK(hot(tx) == (i >= kCold));
+        auto loaded = TransactionStorage::load(tx.transaction_id);
+        CHECK(loaded && sameTransaction(*loaded, tx));
+    }
+    auto stats = TransactionArchive::stats();
+    CHECK(stats.segments == 2);
+    CHECK(stats.records == kCold);
+    CHECK(stats.cold_reads >= kCold);
+    CHECK(stats.block_cache_hits > 0);
+
+    // The history mixes both tiers in wallet order
+    auto history = services::WalletService::getTransactions(transactions[0].wallet_id);
+    CHECK(history.size() == transactions.size());
+    for (size_t i = 0; i < history.size(); ++i) CHECK(sameTransaction(history[i], transactions[i]));
+    std::vector<std::optional<models::Transaction>> many;
+    std::vector<std::string> ids{transactions[kCold - 1].transaction_id, "missing", transactions[kCold].transaction_id};
+    TransactionStorage::loadMany(ids, many);
+    CHECK(many.size() == 3 && many[0] && !many[1] && many[2]);
+    CHECK(TransactionStorage::listAll().size() == transactions.size());
+
+    // Nothing is left for the next pass
+    report = TieringService::runOnce(90);
+    CHECK(report.archived == 0 && report.evicted == 0 && report.segments_written == 0);
+    writeExpected(transactions);
+}
+
+// In a fresh process with no snapshot: the rebuild indexes the evicted records from the archive
+int coldStart() {
+    auto ids = readExpected();
+    CHECK(ids.size() == kCold + kRecent);
+    fs::remove(RecordIndex::kSnapshotPath);
+    CHECK(RecordIndex::load(2));
+    auto st = RecordIndex::status();
+    CHECK(st.source == "rebuild");
+    CHECK(st.transactions == ids.size());
+    size_t visited = 0;
+    TransactionArchive::forEach([&](const models::Transaction&) { ++visited; });
+    CHECK(visited == kCold);
+    return 0;
+}
+
+// In a fresh process, with no cached blocks: a block failing its CRC loses only its records
+int corruptBlock() {
+    auto ids = readExpected();
+    // The pass's segment holds records kPreArchived.. in timestamp order; its first block
+    // starts right after the header magic
+    auto segments = segmentsBySize();
+    CHECK(segments.size() == 2);
+    flipByte(segments[1], 8 + 64);
+    CHECK(!TransactionStorage::load(ids[kPreArchived]));
+    CHECK(TransactionStorage::load(ids[kCold - 1]));
+    CHECK(TransactionStorage::load(ids[0]));
+    CHECK(TransactionStorage::load(ids[kCold]));
+    return 0;
+}
+
+// In a fresh process: a segment whose footer fails its CRC is ignored as a whole
+int corruptFooter() {
+    auto ids = readExpected();
+    auto segments = segmentsBySize();
+    CHECK(segments.size() == 2);
+    flipByte(segments[0], footerOffset(segments[0]) + 2);
+    CHECK(TransactionArchive::stats().segments == 1);
+    CHECK(TransactionArchive::stats().records == kCold - kPreArchived);
+    CHECK(!TransactionArchive::contains(ids[0]));
+    CHECK(TransactionStorage::load(ids[kCold - 1]));
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 2 && std::string(argv[1]) == "cold") {
+        fs::current_path(argv[2]);
+        return coldStart();
+    }
+    if (argc > 2 && std::string(argv[1]) == "block") {
+        fs::current_path(argv[2]);
+        return corruptBlock();
+    }
+    if (argc > 2 && std::string(argv[1]) == "footer") {
+        fs::current_path(argv[2]);
+        return corruptFooter();
+    }
+    test_support::ScratchDir scratch("transaction_archive");
+    tiersAndReadsBack();
+    CHECK(test_support::runSelf({"cold", scratch.path()}) == 0);
+    CHECK(test_support::runSelf({"block", scratch.path()}) == 0);
+    CHECK(test_support::runSelf({"footer", scratch.path()}) == 0);
+    return 0;
+}
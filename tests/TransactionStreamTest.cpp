@@ -0,0 +1,44 @@
+// Streamed history: every record streamTransactions writes is byte for byte the record
+// getTransactions returns, for points and other assets alike
+#include "TestSupport.h"
+#include "api/ApiRouter.h"
+#include "api/ResponseSink.h"
+
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+using api::ApiRouter;
+
+int main() {
+    test_support::ScratchDir scratch("transaction_stream");
+    CHECK(ApiRouter::registerUser("streamer", "Password-123", "streamer@example.com").success);
+    auto otp = ApiRouter::initiateLogin("streamer", "Password-123").data["otp"].get<std::string>();
+    std::string token = ApiRouter::completeLogin("streamer", otp).data["token"].get<std::string>();
+    std::string walletId = ApiRouter::createWallet(token).data["walletId"].get<std::string>();
+
+    // Amounts whose shortest form and dump() notation disagree, on points and on an asset
+    CHECK(ApiRouter::executeTransaction(token, walletId, 0.0001, "credit", "tiny").success);
+    CHECK(ApiRouter::executeTransaction(token, walletId, 1.2345678901234568e+17, "credit", "huge", "", "gold").success);
+    CHECK(ApiRouter::executeTransaction(token, walletId, 12.5, "debit", "spend", "", "gold").success);
+
+    auto listed = ApiRouter::getTransactions(token, walletId);
+    CHECK(listed.success);
+    const auto& transactions = listed.data["transactions"];
+    CHECK(transactions.size() == 3);
+
+    std::string streamed;
+    api::ChunkedBufferSink sink([&](const char* data, size_t size) {
+        streamed.append(data, size);
+        return true;
+    }, 64);
+    CHECK(ApiRouter::streamTransactions(token, walletId, sink).success);
+    CHECK(nlohmann::json::parse(streamed)["data"]["transactions"].size() == transactions.size());
+    size_t assets = 0;
+    for (const auto& tx : transactions) {
+        CHECK(streamed.find(tx.dump()) != std::string::npos);
+        assets += tx.value("asset", "") == "gold";
+    }
+    CHECK(assets == 2);
+    return 0;
+}